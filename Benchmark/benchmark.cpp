@@ -0,0 +1,729 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+//=============================================================================
+// Headless benchmark of the main rendering and conversion paths. Creates a
+// `D3DContext` on a hidden window and prints one JSON object per line to
+// stdout so that results can be compared between driver and library versions.
+// Log messages are written to stderr.
+//
+// Usage: Benchmark [--iterations=N] [--sizes=720p,1080p,4k] [--adapter=N]
+//                  [--filter=NAME]
+//=============================================================================
+
+#include <Libvidgfx/libvidgfx.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <stdio.h>
+#include <string.h>
+
+//=============================================================================
+// Constants
+
+const int DEFAULT_NUM_ITERATIONS = 100;
+const int NUM_WARMUP_ITERATIONS = 5;
+const int MAX_DRAIN_FRAMES = 1000; // Frames to wait for late GPU results
+const char * const BENCH_SCOPE = "benchmark";
+const wchar_t * const WINDOW_CLASS = L"LibvidgfxBenchmark";
+
+struct BenchSize {
+	const char *	name;
+	int				width;
+	int				height;
+};
+const BenchSize BENCH_SIZES[] = {
+	{ "720p", 1280, 720 },
+	{ "1080p", 1920, 1080 },
+	{ "4k", 3840, 2160 }
+};
+const int NUM_BENCH_SIZES = sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]);
+
+// Output to input size ratios for `prepareTexture()`. 1080p to 720p is 2/3
+const float PREPARE_RATIOS[] = { 0.5f, 2.0f / 3.0f, 1.0f / 3.0f, 0.25f };
+const int NUM_PREPARE_RATIOS =
+	sizeof(PREPARE_RATIOS) / sizeof(PREPARE_RATIOS[0]);
+const char * const PREPARE_FILTER_STRS[] = {
+	"point",
+	"bilinear",
+	"bicubic",
+	"lanczos"
+};
+
+const int COMPOSITE_LAYERS[] = { 1, 8, 32 };
+const int NUM_COMPOSITE_LAYERS =
+	sizeof(COMPOSITE_LAYERS) / sizeof(COMPOSITE_LAYERS[0]);
+const QSize COMPOSITE_LAYER_SIZE(512, 512);
+
+//=============================================================================
+// Helpers
+
+static void logCallback(
+	const QString &cat, const QString &msg, VidgfxLogLvl lvl)
+{
+	const char *lvlStr = "Notice";
+	if(lvl == GfxWarning)
+		lvlStr = "Warning";
+	else if(lvl == GfxCritical)
+		lvlStr = "Critical";
+	fprintf(stderr, "[%s] %s: %s\n", cat.toUtf8().constData(), lvlStr,
+		msg.toUtf8().constData());
+}
+
+static QByteArray jsonEscape(const QByteArray &str)
+{
+	QByteArray ret;
+	ret.reserve(str.size());
+	for(int i = 0; i < str.size(); i++) {
+		char c = str.at(i);
+		if(c == '"' || c == '\\') {
+			ret.append('\\');
+			ret.append(c);
+		} else if((unsigned char)c < 0x20)
+			ret.append(' ');
+		else
+			ret.append(c);
+	}
+	return ret;
+}
+
+/// <summary>
+/// Creates writable textures in the layout that `convertToBgrx()` expects for
+/// a `size` frame of the specified format.
+/// </summary>
+/// <returns>False if the format cannot be converted</returns>
+static bool createPlanes(
+	VidgfxContext *gfx, VidgfxPixFormat format, const QSize &size,
+	VidgfxTex *planes[3])
+{
+	int w = size.width();
+	int h = size.height();
+	planes[0] = planes[1] = planes[2] = NULL;
+	switch(format) {
+	default:
+		// RGB formats don't need converting and NV16 is output only
+		return false;
+	case GfxYV12Format:
+	case GfxIYUVFormat:
+		planes[0] = vidgfx_context_new_tex(gfx, QSize(w / 4, h), true);
+		planes[1] = vidgfx_context_new_tex(gfx, QSize(w / 8, h / 2), true);
+		planes[2] = vidgfx_context_new_tex(gfx, QSize(w / 8, h / 2), true);
+		if(planes[0] != NULL && planes[1] != NULL && planes[2] != NULL)
+			return true;
+		break;
+	case GfxNV12Format:
+		planes[0] = vidgfx_context_new_tex(gfx, QSize(w / 4, h), true);
+		planes[1] = vidgfx_context_new_rg_tex(gfx, QSize(w / 2, h / 2), true);
+		if(planes[0] != NULL && planes[1] != NULL)
+			return true;
+		break;
+	case GfxUYVYFormat:
+	case GfxHDYCFormat:
+	case GfxYUY2Format:
+		planes[0] = vidgfx_context_new_tex(gfx, QSize(w / 2, h), true);
+		if(planes[0] != NULL)
+			return true;
+		break;
+	}
+
+	// Failed to create a texture
+	for(int i = 0; i < 3; i++) {
+		if(planes[i] != NULL)
+			vidgfx_context_destroy_tex(gfx, planes[i]);
+		planes[i] = NULL;
+	}
+	return false;
+}
+
+/// <summary>
+/// Creates an image with a gradient and a partially transparent border so that
+/// both the samplers and `diluteImage()` have realistic work to do.
+/// </summary>
+static QImage createTestImage(const QSize &size)
+{
+	QImage img(size, QImage::Format_ARGB32);
+	int border = qMax(1, size.height() / 8);
+	for(int y = 0; y < size.height(); y++) {
+		QRgb *row = reinterpret_cast<QRgb *>(img.scanLine(y));
+		for(int x = 0; x < size.width(); x++) {
+			bool isBorder = x < border || y < border ||
+				x >= size.width() - border || y >= size.height() - border;
+			row[x] = qRgba(
+				x * 255 / size.width(), y * 255 / size.height(), 128,
+				isBorder ? 0 : 255);
+		}
+	}
+	return img;
+}
+
+//=============================================================================
+// BenchRunner class
+
+/// <summary>
+/// Runs each benchmark for a fixed number of iterations after a short warmup.
+/// CPU time is measured around the call and the submission of its commands
+/// while GPU time comes from the `D3DContext` profiler which delivers its
+/// results a few frames later.
+/// </summary>
+class BenchRunner
+{
+private: // Datatypes ---------------------------------------------------------
+	struct Options {
+		int		numIterations;
+		bool	sizeEnabled[NUM_BENCH_SIZES];
+		QString	filter;
+		int		adapter;
+	};
+
+private: // Members -----------------------------------------------------------
+	Options				m_options;
+	HWND				m_hwnd;
+	VidgfxD3DContext *	m_d3d;
+	VidgfxContext *		m_gfx;
+
+	// Current benchmark
+	bool				m_useGpu;
+	QElapsedTimer		m_timer;
+	double				m_cpuMsec;
+	double				m_gpuMsec;
+	int					m_numGpuSamples;
+	int					m_numDropped;
+
+public: // Constructor/destructor ---------------------------------------------
+	BenchRunner();
+	virtual ~BenchRunner();
+
+public: // Methods ------------------------------------------------------------
+	bool	parseArgs(int argc, char *argv[]);
+	bool	initialize();
+	void	printDeviceInfo();
+	void	runAll();
+
+private:
+	bool	isEnabled(const char *bench) const;
+
+	void	beginBench(bool useGpu);
+	void	beginIteration(bool timed);
+	void	endIteration(bool timed);
+	void	endBench(
+		const char *bench, const QSize &size, const QByteArray &param,
+		qint64 numPixels);
+
+	void	benchUpdateData(const QSize &size);
+	void	benchConvertToBgrx(const QSize &size, VidgfxPixFormat format);
+	void	benchPrepareTex(
+		const QSize &size, float ratio, VidgfxFilter filter);
+	void	benchNv16Readback(const QSize &size);
+	void	benchDilute(const QSize &size);
+	void	benchComposite(const QSize &size, int numLayers);
+
+	static void	profileFrameCallback(
+		void *opaque, VidgfxD3DContext *context,
+		const VidgfxD3DProfileFrame *frame);
+};
+
+BenchRunner::BenchRunner()
+	: m_options()
+	, m_hwnd(NULL)
+	, m_d3d(NULL)
+	, m_gfx(NULL)
+	, m_useGpu(false)
+	, m_timer()
+	, m_cpuMsec(0.0)
+	, m_gpuMsec(0.0)
+	, m_numGpuSamples(0)
+	, m_numDropped(0)
+{
+	m_options.numIterations = DEFAULT_NUM_ITERATIONS;
+	for(int i = 0; i < NUM_BENCH_SIZES; i++)
+		m_options.sizeEnabled[i] = true;
+	m_options.adapter = -1;
+}
+
+BenchRunner::~BenchRunner()
+{
+	if(m_d3d != NULL) {
+		vidgfx_d3dcontext_remove_profile_frame_callback(
+			m_d3d, profileFrameCallback, this);
+		vidgfx_d3dcontext_destroy(m_d3d);
+	}
+	if(m_hwnd != NULL)
+		DestroyWindow(m_hwnd);
+}
+
+bool BenchRunner::parseArgs(int argc, char *argv[])
+{
+	for(int i = 1; i < argc; i++) {
+		QString arg = QString::fromLocal8Bit(argv[i]);
+		QString value = arg.section(QChar('='), 1);
+		bool ok = true;
+		if(arg.startsWith(QStringLiteral("--iterations="))) {
+			m_options.numIterations = value.toInt(&ok);
+			ok = ok && m_options.numIterations > 0;
+		} else if(arg.startsWith(QStringLiteral("--sizes="))) {
+			QStringList sizes = value.toLower().split(QChar(','));
+			for(int j = 0; j < NUM_BENCH_SIZES; j++) {
+				m_options.sizeEnabled[j] = sizes.contains(
+					QString::fromLatin1(BENCH_SIZES[j].name));
+			}
+		} else if(arg.startsWith(QStringLiteral("--adapter="))) {
+			m_options.adapter = value.toInt(&ok);
+		} else if(arg.startsWith(QStringLiteral("--filter="))) {
+			m_options.filter = value;
+		} else
+			ok = false;
+		if(!ok) {
+			fprintf(stderr,
+				"Usage: %s [--iterations=N] [--sizes=720p,1080p,4k] "
+				"[--adapter=N] [--filter=NAME]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BenchRunner::initialize()
+{
+	// The swap chain requires a window but it is never shown
+	WNDCLASSEX wc;
+	memset(&wc, 0, sizeof(wc));
+	wc.cbSize = sizeof(wc);
+	wc.lpfnWndProc = DefWindowProc;
+	wc.hInstance = GetModuleHandle(NULL);
+	wc.lpszClassName = WINDOW_CLASS;
+	RegisterClassEx(&wc);
+	m_hwnd = CreateWindowEx(
+		0, WINDOW_CLASS, L"Libvidgfx benchmark", WS_OVERLAPPEDWINDOW,
+		CW_USEDEFAULT, CW_USEDEFAULT, 640, 360, NULL, NULL, wc.hInstance,
+		NULL);
+	if(m_hwnd == NULL) {
+		fprintf(stderr, "Failed to create the benchmark window\n");
+		return false;
+	}
+
+	m_d3d = vidgfx_d3dcontext_new();
+	if(!vidgfx_d3dcontext_init(
+		m_d3d, m_hwnd, QSize(640, 360), QColor(0, 0, 0),
+		m_options.adapter))
+	{
+		fprintf(stderr, "Failed to initialize the graphics context\n");
+		return false;
+	}
+	m_gfx = vidgfx_d3dcontext_get_context(m_d3d);
+
+	// Every `prepareTexture()` iteration must do the full rescale
+	vidgfx_context_set_scale_cache_size(m_gfx, 0);
+
+	vidgfx_d3dcontext_add_profile_frame_callback(
+		m_d3d, profileFrameCallback, this);
+	vidgfx_d3dcontext_set_profiling_enabled(m_d3d, true);
+	return true;
+}
+
+/// <summary>
+/// Prints the adapter that the results were measured on so that they can be
+/// associated with a specific driver.
+/// </summary>
+void BenchRunner::printDeviceInfo()
+{
+	VidgfxD3DAdapterInfo adapters[16];
+	int numAdapters = qMin(16, vidgfx_d3d_query_adapters(adapters, 16));
+	int index = qMax(0, vidgfx_d3dcontext_get_adapter(m_d3d));
+	QByteArray desc = "Unknown";
+	quint32 vendorId = 0;
+	quint32 deviceId = 0;
+	if(index < numAdapters) {
+		desc = adapters[index].description;
+		vendorId = adapters[index].vendor_id;
+		deviceId = adapters[index].device_id;
+	}
+	printf("{\"type\":\"device\",\"version\":\"%s\",\"adapter\":%d,"
+		"\"description\":\"%s\",\"vendor_id\":%u,\"device_id\":%u,"
+		"\"iterations\":%d}\n",
+		VIDGFX_VER_STR, index, jsonEscape(desc).constData(), vendorId,
+		deviceId, m_options.numIterations);
+	fflush(stdout);
+}
+
+void BenchRunner::runAll()
+{
+	for(int i = 0; i < NUM_BENCH_SIZES; i++) {
+		if(!m_options.sizeEnabled[i])
+			continue;
+		QSize size(BENCH_SIZES[i].width, BENCH_SIZES[i].height);
+
+		if(isEnabled("update_data"))
+			benchUpdateData(size);
+
+		if(isEnabled("convert_to_bgrx")) {
+			for(int j = 0; j < NUM_PIXEL_FORMAT_TYPES; j++)
+				benchConvertToBgrx(size, (VidgfxPixFormat)j);
+		}
+
+		if(isEnabled("prepare_tex")) {
+			for(int j = GfxBilinearFilter; j < NUM_STANDARD_TEXTURE_FILTERS;
+				j++)
+			{
+				for(int k = 0; k < NUM_PREPARE_RATIOS; k++)
+					benchPrepareTex(size, PREPARE_RATIOS[k], (VidgfxFilter)j);
+			}
+		}
+
+		if(isEnabled("nv16_readback"))
+			benchNv16Readback(size);
+
+		if(isEnabled("dilute_img"))
+			benchDilute(size);
+
+		if(isEnabled("composite")) {
+			for(int j = 0; j < NUM_COMPOSITE_LAYERS; j++)
+				benchComposite(size, COMPOSITE_LAYERS[j]);
+		}
+	}
+}
+
+bool BenchRunner::isEnabled(const char *bench) const
+{
+	if(m_options.filter.isEmpty())
+		return true;
+	return QString::fromLatin1(bench).contains(m_options.filter);
+}
+
+void BenchRunner::beginBench(bool useGpu)
+{
+	m_useGpu = useGpu;
+	m_cpuMsec = 0.0;
+	m_gpuMsec = 0.0;
+	m_numGpuSamples = 0;
+	m_numDropped = 0;
+}
+
+/// <summary>
+/// Warmup iterations are not timed or profiled so that one-off costs such as
+/// growing the scratch targets are excluded from the results.
+/// </summary>
+void BenchRunner::beginIteration(bool timed)
+{
+	if(timed && m_useGpu) {
+		vidgfx_d3dcontext_begin_profile_frame(m_d3d);
+		vidgfx_d3dcontext_begin_profile_scope(m_d3d, BENCH_SCOPE);
+	}
+	m_timer.start();
+}
+
+void BenchRunner::endIteration(bool timed)
+{
+	if(m_useGpu) {
+		if(timed)
+			vidgfx_d3dcontext_end_profile_scope(m_d3d);
+		vidgfx_context_flush(m_gfx);
+	}
+	if(!timed)
+		return;
+	m_cpuMsec += (double)m_timer.nsecsElapsed() / 1000000.0;
+	if(m_useGpu)
+		vidgfx_d3dcontext_end_profile_frame(m_d3d);
+}
+
+/// <summary>
+/// Waits for the outstanding GPU results and prints the averages of the
+/// benchmark. Throughput is based on whichever of the CPU or GPU was slower.
+/// </summary>
+void BenchRunner::endBench(
+	const char *bench, const QSize &size, const QByteArray &param,
+	qint64 numPixels)
+{
+	int numIterations = m_options.numIterations;
+	if(m_useGpu) {
+		// Empty frames don't contain our scope but still deliver the results
+		// of the frames before them
+		for(int i = 0; i < MAX_DRAIN_FRAMES; i++) {
+			if(m_numGpuSamples + m_numDropped >= numIterations)
+				break;
+			vidgfx_d3dcontext_begin_profile_frame(m_d3d);
+			vidgfx_d3dcontext_end_profile_frame(m_d3d);
+			vidgfx_context_flush(m_gfx);
+			Sleep(1);
+		}
+	}
+
+	double cpuMsec = m_cpuMsec / (double)numIterations;
+	double gpuMsec = 0.0;
+	if(m_numGpuSamples > 0)
+		gpuMsec = m_gpuMsec / (double)m_numGpuSamples;
+	double msec = qMax(cpuMsec, gpuMsec);
+	double mpixPerSec = 0.0;
+	if(msec > 0.0)
+		mpixPerSec = (double)numPixels / (msec * 1000.0);
+
+	QByteArray gpuStr = "null";
+	if(m_numGpuSamples > 0)
+		gpuStr = QByteArray::number(gpuMsec, 'f', 4);
+	printf("{\"type\":\"result\",\"bench\":\"%s\",\"param\":\"%s\","
+		"\"width\":%d,\"height\":%d,\"iterations\":%d,\"cpu_ms\":%.4f,"
+		"\"gpu_ms\":%s,\"gpu_samples\":%d,\"mpix_per_sec\":%.2f}\n",
+		bench, jsonEscape(param).constData(), size.width(), size.height(),
+		numIterations, cpuMsec, gpuStr.constData(), m_numGpuSamples,
+		mpixPerSec);
+	fflush(stdout);
+}
+
+void BenchRunner::benchUpdateData(const QSize &size)
+{
+	VidgfxTex *tex = vidgfx_context_new_tex(m_gfx, size, true);
+	if(tex == NULL)
+		return;
+	QImage img = createTestImage(size);
+
+	beginBench(true);
+	for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++) {
+		beginIteration(i >= 0);
+		vidgfx_tex_update_data(tex, img);
+		endIteration(i >= 0);
+	}
+	endBench("update_data", size, "ARGB32",
+		(qint64)size.width() * size.height());
+
+	vidgfx_context_destroy_tex(m_gfx, tex);
+}
+
+void BenchRunner::benchConvertToBgrx(const QSize &size, VidgfxPixFormat format)
+{
+	VidgfxTex *planes[3];
+	if(!createPlanes(m_gfx, format, size, planes))
+		return;
+
+	// Mid-grey in every plane. Every plane is at most two bytes per pixel
+	int stride = size.width() * 2;
+	QByteArray data(stride * size.height(), (char)0x80);
+	const quint8 *ptrs[3];
+	int strides[3];
+	for(int i = 0; i < 3; i++) {
+		ptrs[i] = reinterpret_cast<const quint8 *>(data.constData());
+		strides[i] = stride;
+	}
+	vidgfx_tex_update_planes(
+		format, size, ptrs, strides, planes[0], planes[1], planes[2]);
+
+	beginBench(true);
+	bool failed = false;
+	for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++) {
+		beginIteration(i >= 0);
+		VidgfxTex *out = vidgfx_context_convert_to_bgrx(
+			m_gfx, format, planes[0], planes[1], planes[2]);
+		endIteration(i >= 0);
+		if(out == NULL) {
+			failed = true;
+			break;
+		}
+	}
+	if(failed) {
+		fprintf(stderr, "convertToBgrx() failed for %s\n",
+			VidgfxPixFormatStrs[format]);
+	} else {
+		endBench("convert_to_bgrx", size, VidgfxPixFormatStrs[format],
+			(qint64)size.width() * size.height());
+	}
+
+	for(int i = 0; i < 3; i++) {
+		if(planes[i] != NULL)
+			vidgfx_context_destroy_tex(m_gfx, planes[i]);
+	}
+}
+
+void BenchRunner::benchPrepareTex(
+	const QSize &size, float ratio, VidgfxFilter filter)
+{
+	VidgfxTex *tex = vidgfx_context_new_tex(m_gfx, createTestImage(size));
+	if(tex == NULL)
+		return;
+	QSize outSize(
+		qMax(1, qRound((float)size.width() * ratio)),
+		qMax(1, qRound((float)size.height() * ratio)));
+
+	beginBench(true);
+	QPointF pxSize, botRight;
+	for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++) {
+		beginIteration(i >= 0);
+		vidgfx_context_prepare_tex(
+			m_gfx, tex, outSize, filter, true, pxSize, botRight);
+		endIteration(i >= 0);
+	}
+	QByteArray param = QByteArray(PREPARE_FILTER_STRS[filter]) + "@" +
+		QByteArray::number(outSize.width()) + "x" +
+		QByteArray::number(outSize.height());
+	endBench("prepare_tex", size, param,
+		(qint64)outSize.width() * outSize.height());
+
+	vidgfx_context_destroy_tex(m_gfx, tex);
+}
+
+/// <summary>
+/// The complete output path of a video encoder: RGB to NV16 followed by a
+/// synchronous readback of both planes to system memory.
+/// </summary>
+void BenchRunner::benchNv16Readback(const QSize &size)
+{
+	QSize planeSize(size.width() / 4, size.height());
+	QRect planeRect(QPoint(0, 0), planeSize);
+	VidgfxTex *src = vidgfx_context_new_tex(m_gfx, createTestImage(size));
+	VidgfxTex *planeY =
+		vidgfx_context_new_tex(m_gfx, planeSize, false, true);
+	VidgfxTex *planeUV =
+		vidgfx_context_new_tex(m_gfx, planeSize, false, true);
+	VidgfxTex *stagingY = vidgfx_context_new_staging_tex(m_gfx, planeSize);
+	VidgfxTex *stagingUV = vidgfx_context_new_staging_tex(m_gfx, planeSize);
+	if(src != NULL && planeY != NULL && planeUV != NULL && stagingY != NULL &&
+		stagingUV != NULL)
+	{
+		beginBench(true);
+		for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++)
+		{
+			beginIteration(i >= 0);
+			vidgfx_context_scale_to_nv16(m_gfx, src, planeY, planeUV);
+			vidgfx_context_copy_tex_data(
+				m_gfx, stagingY, planeY, QPoint(0, 0), planeRect);
+			vidgfx_context_copy_tex_data(
+				m_gfx, stagingUV, planeUV, QPoint(0, 0), planeRect);
+			if(vidgfx_tex_map(stagingY) != NULL)
+				vidgfx_tex_unmap(stagingY);
+			if(vidgfx_tex_map(stagingUV) != NULL)
+				vidgfx_tex_unmap(stagingUV);
+			endIteration(i >= 0);
+		}
+		endBench("nv16_readback", size, "BT601",
+			(qint64)size.width() * size.height());
+	}
+
+	VidgfxTex *texs[5] = { src, planeY, planeUV, stagingY, stagingUV };
+	for(int i = 0; i < 5; i++) {
+		if(texs[i] != NULL)
+			vidgfx_context_destroy_tex(m_gfx, texs[i]);
+	}
+}
+
+void BenchRunner::benchDilute(const QSize &size)
+{
+	QImage src = createTestImage(size);
+
+	beginBench(false);
+	for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++) {
+		// `diluteImage()` modifies the image in-place
+		QImage img = src.copy();
+		beginIteration(i >= 0);
+		vidgfx_context_dilute_img(m_gfx, img);
+		endIteration(i >= 0);
+	}
+	endBench("dilute_img", size, "ARGB32",
+		(qint64)size.width() * size.height());
+}
+
+/// <summary>
+/// Draws `numLayers` alpha blended layers to the canvas like a typical scene.
+/// </summary>
+void BenchRunner::benchComposite(const QSize &size, int numLayers)
+{
+	vidgfx_context_resize_canvas_target(m_gfx, size);
+	VidgfxTex *tex =
+		vidgfx_context_new_tex(m_gfx, createTestImage(COMPOSITE_LAYER_SIZE));
+	if(tex == NULL)
+		return;
+
+	// Spread the layers diagonally across the canvas so that they overlap
+	QVector<VidgfxVertBuf *> bufs;
+	for(int i = 0; i < numLayers; i++) {
+		VidgfxVertBuf *buf = vidgfx_context_new_vertbuf(
+			m_gfx, VIDGFX_TEX_DECAL_RECT_BUF_SIZE);
+		if(buf == NULL)
+			break;
+		float t = (numLayers > 1) ? (float)i / (float)(numLayers - 1) : 0.0f;
+		QRectF rect(
+			t * (float)(size.width() - COMPOSITE_LAYER_SIZE.width()),
+			t * (float)(size.height() - COMPOSITE_LAYER_SIZE.height()),
+			(float)COMPOSITE_LAYER_SIZE.width(),
+			(float)COMPOSITE_LAYER_SIZE.height());
+		vidgfx_create_tex_decal_rect(buf, rect);
+		bufs.append(buf);
+	}
+
+	if(bufs.size() == numLayers) {
+		QMatrix4x4 mat;
+		vidgfx_context_set_view_mat(m_gfx, mat);
+		mat.ortho(0.0f, size.width(), size.height(), 0.0f, -1.0f, 1.0f);
+		vidgfx_context_set_proj_mat(m_gfx, mat);
+
+		beginBench(true);
+		for(int i = -NUM_WARMUP_ITERATIONS; i < m_options.numIterations; i++)
+		{
+			beginIteration(i >= 0);
+			vidgfx_context_set_render_target(m_gfx, GfxCanvas1Target);
+			vidgfx_context_clear(m_gfx, QColor(0, 0, 0));
+			vidgfx_context_set_shader(m_gfx, GfxTexDecalShader);
+			vidgfx_context_set_topology(m_gfx, GfxTriangleStripTopology);
+			vidgfx_context_set_blending(m_gfx, GfxAlphaBlending);
+			vidgfx_context_set_tex_filter(m_gfx, GfxBilinearFilter);
+			vidgfx_context_set_tex(m_gfx, tex);
+			for(int j = 0; j < numLayers; j++)
+				vidgfx_context_draw_buf(m_gfx, bufs.at(j));
+			endIteration(i >= 0);
+		}
+		endBench("composite", size,
+			QByteArray::number(numLayers) + " layers",
+			(qint64)size.width() * size.height());
+	}
+
+	for(int i = 0; i < bufs.size(); i++)
+		vidgfx_context_destroy_vertbuf(m_gfx, bufs.at(i));
+	vidgfx_context_destroy_tex(m_gfx, tex);
+}
+
+void BenchRunner::profileFrameCallback(
+	void *opaque, VidgfxD3DContext *context,
+	const VidgfxD3DProfileFrame *frame)
+{
+	BenchRunner *runner = static_cast<BenchRunner *>(opaque);
+	if(!runner->m_useGpu)
+		return;
+	runner->m_numDropped += frame->num_dropped_frames;
+	for(int i = 0; i < frame->num_scopes; i++) {
+		const VidgfxD3DProfileScope &scope = frame->scopes[i];
+		if(scope.depth != 0 || strcmp(scope.name, BENCH_SCOPE) != 0)
+			continue;
+		runner->m_gpuMsec += scope.gpu_msec;
+		runner->m_numGpuSamples++;
+	}
+}
+
+//=============================================================================
+// Main entry point
+
+int main(int argc, char *argv[])
+{
+	vidgfx_init();
+	vidgfx_set_log_callback(logCallback);
+
+	BenchRunner runner;
+	if(!runner.parseArgs(argc, argv))
+		return 1;
+	if(!runner.initialize())
+		return 1;
+	runner.printDeviceInfo();
+	runner.runAll();
+	return 0;
+}
@@ -0,0 +1,113 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Texture version of `GraphicsContext::diluteImage()`. Copies the colour
+// information of nearby pixels to fully transparent pixels so that bilinear
+// filtering doesn't fringe. Requires feature level 10.0 for `Load()`.
+
+Texture2D texTexture;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+// The maximum distance from the pixel to search for colour information. Must
+// match `GraphicsContext::diluteImage()`.
+static const int MAX_DILUTION = 2;
+
+float4 main(PSInput input) : SV_TARGET
+{
+	uint w, h;
+	texTexture.GetDimensions(w, h);
+	int x = (int)input.pos.x;
+	int y = (int)input.pos.y;
+	float4 texCol = texTexture.Load(int3(x, y, 0));
+	if(texCol.a > 0.0f)
+		return texCol;
+
+	// Same search as `dilutePixel()` on the CPU. Every side of a ring that
+	// has colour information overwrites the sides before it and clamping a
+	// side to the texture affects the sides that follow. Transparent pixels
+	// that have no colour information nearby become transparent black.
+	float4 outCol = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	bool found = false;
+	[loop] for(int d = 1; d <= MAX_DILUTION; d++) {
+		int xStart = x - d;
+		int xEnd = x + d;
+		int yStart = y - d;
+		int yEnd = y + d;
+		int s;
+		int t;
+		float4 col;
+
+		if(yStart >= 0) { // Top
+			xStart = max(xStart, 0);
+			xEnd = min(xEnd, (int)w - 1);
+			[loop] for(s = xStart; s <= xEnd; s++) {
+				col = texTexture.Load(int3(s, yStart, 0));
+				if(col.a > 0.0f) {
+					outCol = float4(col.rgb, 0.0f);
+					found = true;
+					break;
+				}
+			}
+		}
+		if(xStart >= 0) { // Left
+			yStart = max(yStart, 0);
+			yEnd = min(yEnd, (int)h - 1);
+			[loop] for(t = yStart; t <= yEnd; t++) {
+				col = texTexture.Load(int3(xStart, t, 0));
+				if(col.a > 0.0f) {
+					outCol = float4(col.rgb, 0.0f);
+					found = true;
+					break;
+				}
+			}
+		}
+		if(xEnd < (int)w) { // Right
+			yStart = max(yStart, 0);
+			yEnd = min(yEnd, (int)h - 1);
+			[loop] for(t = yStart; t <= yEnd; t++) {
+				col = texTexture.Load(int3(xEnd, t, 0));
+				if(col.a > 0.0f) {
+					outCol = float4(col.rgb, 0.0f);
+					found = true;
+					break;
+				}
+			}
+		}
+		if(yEnd < (int)h) { // Bottom
+			xStart = max(xStart, 0);
+			xEnd = min(xEnd, (int)w - 1);
+			[loop] for(s = xStart; s <= xEnd; s++) {
+				col = texTexture.Load(int3(s, yEnd, 0));
+				if(col.a > 0.0f) {
+					outCol = float4(col.rgb, 0.0f);
+					found = true;
+					break;
+				}
+			}
+		}
+
+		if(found)
+			break;
+	}
+
+	return outCol;
+}
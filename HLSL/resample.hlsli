@@ -0,0 +1,76 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Shared implementation of the "resample*-ps.hlsl" shaders. Designed for use
+// with the "texDecal-vs.hlsl" vertex shader. Resamples the input texture along
+// a single axis using the precomputed filter weights of
+// `D3DContext::getResampleWeights()` so that bicubic and Lanczos scaling of
+// any ratio is a single horizontal and a single vertical pass. Requires
+// feature level 10.0 for `Load()`.
+//
+// Define `RESAMPLE_VERTICAL` to 1 before including this file to resample
+// along the Y axis instead of the X axis.
+
+cbuffer Resample
+{
+	// x: Number of taps, y: Offset of output pixel 0 in the resampled axis,
+	// z: Offset in the other axis, w: 0 = Don't swizzle, 1+ = Swizzle RGB
+	float4 params;
+	float4 texMax; // XY = Last valid input texel, ZW = Unused
+};
+
+Texture2D texTexture;
+Texture2D weightTexture; // Row 0: X = First tap, Rows 1+: 4 weights each
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+float4 main(PSInput input) : SV_TARGET
+{
+	int numTaps = (int)params.x;
+	int2 outPos = int2(input.pos.xy);
+	int2 maxPos = int2(texMax.xy);
+#if RESAMPLE_VERTICAL
+	int outIndex = outPos.y;
+	int2 srcPos = int2(outPos.x + (int)params.z, 0);
+#else
+	int outIndex = outPos.x;
+	int2 srcPos = int2(0, outPos.y + (int)params.z);
+#endif // RESAMPLE_VERTICAL
+	int first = (int)params.y + (int)weightTexture.Load(
+		int3(outIndex, 0, 0)).x;
+
+	float4 outCol = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	[loop] for(int i = 0; i < numTaps; i += 4) {
+		float4 weights = weightTexture.Load(int3(outIndex, 1 + i / 4, 0));
+		[unroll] for(int j = 0; j < 4; j++) {
+#if RESAMPLE_VERTICAL
+			srcPos.y = clamp(first + i + j, 0, maxPos.y);
+#else
+			srcPos.x = clamp(first + i + j, 0, maxPos.x);
+#endif // RESAMPLE_VERTICAL
+			outCol += weights[j] * texTexture.Load(int3(srcPos, 0));
+		}
+	}
+
+	// Swizzle if we're storing BGRA data in a RGBA texture
+	outCol.rgb = params.w ? outCol.bgr : outCol.rgb;
+	return outCol;
+}
@@ -0,0 +1,86 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Compute shader version of "rgb-y-ps.hlsl" and "rgb-i420uv-ps.hlsl" that
+// outputs all three planes of I420 (Or YV12 with the chroma planes swapped) in
+// a single pass. Each thread converts an 8x2 block of input pixels into 4
+// luminance texels and 1 texel of each chroma plane. Only used on feature
+// level 11.0 devices.
+
+Texture2D<float4> srcTexture : register(t0);
+RWTexture2D<unorm float4> yPlane : register(u0);
+RWTexture2D<unorm float4> uPlane : register(u1);
+RWTexture2D<unorm float4> vPlane : register(u2);
+
+//-----------------------------------------------------------------------------
+// RGB->YUV coefficients, must match the pixel shaders
+
+// BT.601 (Y [16 .. 235]) with linear, full-range RGB input
+static const float4 yCoef = { 0.256788f, 0.504129f, 0.097906f, 0.0625f };
+
+// BT.601 (U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x2 uvCoef = {
+	-0.148223f,  0.439216f,
+	-0.290993f, -0.367788f,
+	 0.439216f, -0.071427f,
+	 0.5f,       0.5f};
+
+//-----------------------------------------------------------------------------
+
+float toY(float4 rgb)
+{
+	return dot(float4(rgb.rgb, 1.0f), yCoef);
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint uvWidth, uvHeight;
+	uPlane.GetDimensions(uvWidth, uvHeight);
+	if(id.x >= uvWidth || id.y >= uvHeight)
+		return; // Partial thread group at the edge of the image
+
+	// Fetch the 8x2 block of input pixels that this thread covers. The plane
+	// sizes are validated by the context so we never read out of bounds.
+	int2 pos = int2(id.x * 8, id.y * 2);
+	float4 top[8];
+	float4 bot[8];
+	[unroll] for(int i = 0; i < 8; i++) {
+		top[i] = srcTexture.Load(int3(pos.x + i, pos.y, 0));
+		bot[i] = srcTexture.Load(int3(pos.x + i, pos.y + 1, 0));
+	}
+
+	// Do RGB->Y conversion on both rows and pack 4 samples per texel
+	uint2 yPos = uint2(id.x * 2, id.y * 2);
+	yPlane[yPos] = float4(
+		toY(top[0]), toY(top[1]), toY(top[2]), toY(top[3]));
+	yPlane[yPos + uint2(1, 0)] = float4(
+		toY(top[4]), toY(top[5]), toY(top[6]), toY(top[7]));
+	yPlane[yPos + uint2(0, 1)] = float4(
+		toY(bot[0]), toY(bot[1]), toY(bot[2]), toY(bot[3]));
+	yPlane[yPos + uint2(1, 1)] = float4(
+		toY(bot[4]), toY(bot[5]), toY(bot[6]), toY(bot[7]));
+
+	// Subsample chroma using MPEG-2 style siting (Left aligned horizontally,
+	// centered vertically) exactly like "rgb-i420uv-ps.hlsl"
+	float2 a = mul(float4(lerp(top[0], bot[0], 0.5f).rgb, 1.0f), uvCoef);
+	float2 b = mul(float4(lerp(top[2], bot[2], 0.5f).rgb, 1.0f), uvCoef);
+	float2 c = mul(float4(lerp(top[4], bot[4], 0.5f).rgb, 1.0f), uvCoef);
+	float2 d = mul(float4(lerp(top[6], bot[6], 0.5f).rgb, 1.0f), uvCoef);
+	uPlane[id.xy] = float4(a.x, b.x, c.x, d.x);
+	vPlane[id.xy] = float4(a.y, b.y, c.y, d.y);
+}
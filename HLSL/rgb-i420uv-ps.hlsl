@@ -0,0 +1,92 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Designed for use with the "texDecal-vs.hlsl" vertex shader. Outputs the
+// separate U and V planes of I420 (Or YV12 if the render targets are swapped)
+// where each output pixel contains 4 chroma samples that cover a 8x2 block of
+// input pixels.
+
+cbuffer RgbYuv420
+{
+	float4 texOffsets; // Horizontal offsets
+	float4 vertOffsets; // Vertical offsets, only RG are used
+};
+
+Texture2D texTexture;
+SamplerState texSampler;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+struct PSOutput
+{
+	float4 uuuu : SV_TARGET0;
+	float4 vvvv : SV_TARGET1;
+};
+
+//-----------------------------------------------------------------------------
+// RGB->UV coefficients
+
+// BT.601 (U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x2 uvCoef = {
+	-0.148223f,  0.439216f,
+	-0.290993f, -0.367788f,
+	 0.439216f, -0.071427f,
+	 0.5f,       0.5f};
+
+// BT.709 (U/V [16 .. 240]) with linear, full-range RGB input
+//static const float4x2 uvCoef = {
+//	-0.1006f,  0.4392f,
+//	-0.3386f, -0.3989f,
+//	 0.4392f, -0.0403f,
+//	 0.5f,     0.50f};
+
+//-----------------------------------------------------------------------------
+
+float2 chromaSample(float2 uv)
+{
+	// Sample both rows of the chroma siting position and subsample vertically.
+	// The conversion is linear so it's cheaper to average the RGB values
+	// before converting instead of after.
+	float4 top = texTexture.Sample(
+		texSampler, float2(uv.x, uv.y + vertOffsets.r));
+	float4 bot = texTexture.Sample(
+		texSampler, float2(uv.x, uv.y + vertOffsets.g));
+	float4 col = lerp(top, bot, 0.5f);
+	return mul(float4(col.rgb, 1.0f), uvCoef);
+}
+
+PSOutput main(PSInput input)
+{
+	PSOutput output;
+
+	// MPEG-2 style subsampling (Left aligned horizontally, centered
+	// vertically)
+	float2 a = chromaSample(float2(input.uv.x + texOffsets.r, input.uv.y));
+	float2 b = chromaSample(float2(input.uv.x + texOffsets.g, input.uv.y));
+	float2 c = chromaSample(float2(input.uv.x + texOffsets.b, input.uv.y));
+	float2 d = chromaSample(float2(input.uv.x + texOffsets.a, input.uv.y));
+
+	// Pack into the separate planes
+	output.uuuu = float4(a.x, b.x, c.x, d.x);
+	output.vvvv = float4(a.y, b.y, c.y, d.y);
+
+	return output;
+}
@@ -0,0 +1,78 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Compute shader version of "rgb-y-ps.hlsl" and "rgb-nv12uv-ps.hlsl" that
+// outputs both planes of NV12 in a single pass. Each thread converts a 4x2
+// block of input pixels into 2 luminance texels and 1 chroma texel. Only used
+// on feature level 11.0 devices.
+
+Texture2D<float4> srcTexture : register(t0);
+RWTexture2D<unorm float4> yPlane : register(u0);
+RWTexture2D<unorm float4> uvPlane : register(u1);
+
+//-----------------------------------------------------------------------------
+// RGB->YUV coefficients, must match the pixel shaders
+
+// BT.601 (Y [16 .. 235]) with linear, full-range RGB input
+static const float4 yCoef = { 0.256788f, 0.504129f, 0.097906f, 0.0625f };
+
+// BT.601 (U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x2 uvCoef = {
+	-0.148223f,  0.439216f,
+	-0.290993f, -0.367788f,
+	 0.439216f, -0.071427f,
+	 0.5f,       0.5f};
+
+//-----------------------------------------------------------------------------
+
+float toY(float4 rgb)
+{
+	return dot(float4(rgb.rgb, 1.0f), yCoef);
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint uvWidth, uvHeight;
+	uvPlane.GetDimensions(uvWidth, uvHeight);
+	if(id.x >= uvWidth || id.y >= uvHeight)
+		return; // Partial thread group at the edge of the image
+
+	// Fetch the 4x2 block of input pixels that this thread covers. The plane
+	// sizes are validated by the context so we never read out of bounds.
+	int2 pos = int2(id.x * 4, id.y * 2);
+	float4 top[4];
+	float4 bot[4];
+	[unroll] for(int i = 0; i < 4; i++) {
+		top[i] = srcTexture.Load(int3(pos.x + i, pos.y, 0));
+		bot[i] = srcTexture.Load(int3(pos.x + i, pos.y + 1, 0));
+	}
+
+	// Do RGB->Y conversion on both rows and pack 4 samples per texel
+	yPlane[uint2(id.x, id.y * 2)] = float4(
+		toY(top[0]), toY(top[1]), toY(top[2]), toY(top[3]));
+	yPlane[uint2(id.x, id.y * 2 + 1)] = float4(
+		toY(bot[0]), toY(bot[1]), toY(bot[2]), toY(bot[3]));
+
+	// Subsample chroma using MPEG-2 style siting (Left aligned horizontally,
+	// centered vertically) exactly like "rgb-nv12uv-ps.hlsl"
+	float4 a = lerp(top[0], bot[0], 0.5f);
+	float4 c = lerp(top[2], bot[2], 0.5f);
+	uvPlane[id.xy] = float4(
+		mul(float4(a.rgb, 1.0f), uvCoef),
+		mul(float4(c.rgb, 1.0f), uvCoef));
+}
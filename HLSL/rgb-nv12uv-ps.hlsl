@@ -0,0 +1,78 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Designed for use with the "texDecal-vs.hlsl" vertex shader. Outputs the
+// interleaved chroma plane of NV12 where each output pixel contains 2 UV pairs
+// that cover a 4x2 block of input pixels.
+
+cbuffer RgbYuv420
+{
+	float4 texOffsets; // Horizontal offsets, only RG are used
+	float4 vertOffsets; // Vertical offsets, only RG are used
+};
+
+Texture2D texTexture;
+SamplerState texSampler;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+//-----------------------------------------------------------------------------
+// RGB->UV coefficients
+
+// BT.601 (U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x2 uvCoef = {
+	-0.148223f,  0.439216f,
+	-0.290993f, -0.367788f,
+	 0.439216f, -0.071427f,
+	 0.5f,       0.5f};
+
+// BT.709 (U/V [16 .. 240]) with linear, full-range RGB input
+//static const float4x2 uvCoef = {
+//	-0.1006f,  0.4392f,
+//	-0.3386f, -0.3989f,
+//	 0.4392f, -0.0403f,
+//	 0.5f,     0.50f};
+
+//-----------------------------------------------------------------------------
+
+float4 main(PSInput input) : SV_TARGET
+{
+	// Sample both rows of the chroma siting positions. We use MPEG-2 style
+	// subsampling (Left aligned horizontally, centered vertically).
+	float4 aTop = texTexture.Sample(texSampler,
+		float2(input.uv.x + texOffsets.r, input.uv.y + vertOffsets.r));
+	float4 aBot = texTexture.Sample(texSampler,
+		float2(input.uv.x + texOffsets.r, input.uv.y + vertOffsets.g));
+	float4 cTop = texTexture.Sample(texSampler,
+		float2(input.uv.x + texOffsets.g, input.uv.y + vertOffsets.r));
+	float4 cBot = texTexture.Sample(texSampler,
+		float2(input.uv.x + texOffsets.g, input.uv.y + vertOffsets.g));
+
+	// Subsample vertically. The conversion is linear so it's cheaper to
+	// average the RGB values before converting instead of after.
+	float4 a = lerp(aTop, aBot, 0.5f);
+	float4 c = lerp(cTop, cBot, 0.5f);
+
+	// Do RGB->UV conversion and pack
+	return float4(
+		mul(float4(a.rgb, 1.0f), uvCoef),
+		mul(float4(c.rgb, 1.0f), uvCoef));
+}
@@ -0,0 +1,106 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Shared implementation of the "rgb-nv16scaled-*.hlsl" shaders. Designed for
+// use with the "texDecal-vs.hlsl" vertex shader. Scales the input texture to
+// the output size, converts it to YUV and packs it into NV16 all in a single
+// pass so that the input is only read once. Each output sample is a 2x2 box of
+// bilinear taps that covers the footprint of the output pixel in the input
+// texture which is the same as a mipmap for downscales of up to 4x.
+//
+// Define `USE_BT709` to 1 before including this file to use the BT.709 matrix
+// instead of BT.601.
+
+cbuffer RgbYuv420
+{
+	float4 texOffsets; // Horizontal offsets of the 4 packed output pixels
+	float4 vertOffsets; // XY = Box tap offsets, ZW = Unused
+};
+
+Texture2D texTexture;
+SamplerState texSampler;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+struct PSOutput
+{
+	float4 yyyy : SV_TARGET0;
+	float4 uvuv : SV_TARGET1;
+};
+
+//-----------------------------------------------------------------------------
+// RGB->YUV coefficients
+
+#if USE_BT709
+// BT.709 (Y [16 .. 235], U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x4 yuvCoef = {
+	0.1826f, -0.1006f,  0.4392f, 0.0f,
+	0.6142f, -0.3386f, -0.3989f, 0.0f,
+	0.0620f,  0.4392f, -0.0403f, 0.0f,
+	0.0625f,  0.5f,     0.50f,   1.0f};
+#else
+// BT.601 (Y [16 .. 235], U/V [16 .. 240]) with linear, full-range RGB input
+static const float4x4 yuvCoef = {
+	0.256788f, -0.148223f,  0.439216f, 0.0f,
+	0.504129f, -0.290993f, -0.367788f, 0.0f,
+	0.097906f,  0.439216f, -0.071427f, 0.0f,
+	0.0625f,    0.5f,       0.5f,      1.0f};
+#endif
+
+//-----------------------------------------------------------------------------
+
+float4 boxSample(float2 uv)
+{
+	float4 col = texTexture.Sample(
+		texSampler, uv + float2(-vertOffsets.x, -vertOffsets.y));
+	col += texTexture.Sample(
+		texSampler, uv + float2(vertOffsets.x, -vertOffsets.y));
+	col += texTexture.Sample(
+		texSampler, uv + float2(-vertOffsets.x, vertOffsets.y));
+	col += texTexture.Sample(
+		texSampler, uv + float2(vertOffsets.x, vertOffsets.y));
+	return col * 0.25f;
+}
+
+PSOutput main(PSInput input)
+{
+	PSOutput output;
+
+	// Sample the footprints of the output pixels that will be packed into
+	// our output texel
+	float4 a = boxSample(float2(input.uv.x + texOffsets.r, input.uv.y));
+	float4 b = boxSample(float2(input.uv.x + texOffsets.g, input.uv.y));
+	float4 c = boxSample(float2(input.uv.x + texOffsets.b, input.uv.y));
+	float4 d = boxSample(float2(input.uv.x + texOffsets.a, input.uv.y));
+
+	// Do RGB->YUV conversion on all samples
+	a = mul(float4(a.rgb, 1.0f), yuvCoef);
+	b = mul(float4(b.rgb, 1.0f), yuvCoef);
+	c = mul(float4(c.rgb, 1.0f), yuvCoef);
+	d = mul(float4(d.rgb, 1.0f), yuvCoef);
+
+	// Pack luminance into the first render target and MPEG-2 style (Left
+	// aligned) subsampled chroma into the second like "rgb-nv16-ps.hlsl"
+	output.yyyy = float4(a.r, b.r, c.r, d.r);
+	output.uvuv = float4(a.g, a.b, c.g, c.b);
+
+	return output;
+}
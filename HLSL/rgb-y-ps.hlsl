@@ -0,0 +1,67 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Designed for use with the "texDecal-vs.hlsl" vertex shader. Outputs only
+// the luminance plane that is shared by all of the YUV 4:2:0 formats. Each
+// output pixel contains 4 horizontally adjacent luminance samples.
+
+cbuffer RgbYuv420
+{
+	float4 texOffsets; // Horizontal offsets
+	float4 vertOffsets; // Unused
+};
+
+Texture2D texTexture;
+SamplerState texSampler;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+//-----------------------------------------------------------------------------
+// RGB->Y coefficients
+
+// BT.601 (Y [16 .. 235]) with linear, full-range RGB input
+static const float4 yCoef = { 0.256788f, 0.504129f, 0.097906f, 0.0625f };
+
+// BT.709 (Y [16 .. 235]) with linear, full-range RGB input
+//static const float4 yCoef = { 0.1826f, 0.6142f, 0.0620f, 0.0625f };
+
+//-----------------------------------------------------------------------------
+
+float4 main(PSInput input) : SV_TARGET
+{
+	// Sample the appropriate input texture texels that will be packed into our
+	// output pixel
+	float4 a = texTexture.Sample(
+		texSampler, float2(input.uv.x + texOffsets.r, input.uv.y));
+	float4 b = texTexture.Sample(
+		texSampler, float2(input.uv.x + texOffsets.g, input.uv.y));
+	float4 c = texTexture.Sample(
+		texSampler, float2(input.uv.x + texOffsets.b, input.uv.y));
+	float4 d = texTexture.Sample(
+		texSampler, float2(input.uv.x + texOffsets.a, input.uv.y));
+
+	// Do RGB->Y conversion on all samples and pack them
+	return float4(
+		dot(float4(a.rgb, 1.0f), yCoef),
+		dot(float4(b.rgb, 1.0f), yCoef),
+		dot(float4(c.rgb, 1.0f), yCoef),
+		dot(float4(d.rgb, 1.0f), yCoef));
+}
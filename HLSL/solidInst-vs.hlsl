@@ -0,0 +1,79 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Instanced rectangle outlines for "solid-ps". Each instance is drawn as 4
+// copies of a unit quad, one for each edge of the outline. Requires feature
+// level 10.0 for `SV_InstanceID`.
+
+cbuffer Camera
+{
+	matrix viewMat;
+	matrix projMat;
+};
+
+struct VSInput
+{
+	float2 corner : POSITION; // Unit quad, (0, 0) to (1, 1)
+	float4 rect : RECT; // Left, top, right, bottom
+	float4 col : COLOR;
+	float4 params : PARAMS; // Half line width, -, -
+	uint id : SV_InstanceID;
+};
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float4 col : COLOR;
+};
+
+PSInput main(VSInput input)
+{
+	PSInput output;
+
+	// Calculate the rectangle of the edge. Matches `rectOutline()` where the
+	// horizontal edges are inset so that the corners are not drawn twice.
+	float2 hw = input.params.xy;
+	float4 edge;
+	uint side = input.id & 3;
+	if(side == 0) { // Top
+		edge = float4(
+			input.rect.x + hw.x, input.rect.y - hw.y,
+			input.rect.z - hw.x, input.rect.y + hw.y);
+	} else if(side == 1) { // Bottom
+		edge = float4(
+			input.rect.x + hw.x, input.rect.w - hw.y,
+			input.rect.z - hw.x, input.rect.w + hw.y);
+	} else if(side == 2) { // Left
+		edge = float4(
+			input.rect.x - hw.x, input.rect.y - hw.y,
+			input.rect.x + hw.x, input.rect.w + hw.y);
+	} else { // Right
+		edge = float4(
+			input.rect.z - hw.x, input.rect.y - hw.y,
+			input.rect.z + hw.x, input.rect.w + hw.y);
+	}
+
+	// Transform to viewport space
+	output.pos = float4(lerp(edge.xy, edge.zw, input.corner), 0.0f, 1.0f);
+	output.pos = mul(output.pos, viewMat);
+	output.pos = mul(output.pos, projMat);
+
+	// Forward colour
+	output.col = input.col;
+
+	return output;
+}
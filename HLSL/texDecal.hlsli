@@ -0,0 +1,111 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Shared implementation of the "texDecal*-ps.hlsl" shaders. Designed for use
+// with the "texDecal-vs.hlsl" vertex shader. Each feature is selected at
+// compile time so that no permutation pays for the features it doesn't use.
+// Define each of the following to 0 or 1 before including this file:
+//
+// `TEXDECAL_OPAQUE`: Ignore the alpha channel of the texture.
+// `TEXDECAL_PREMULTIPLIED`: The texture has premultiplied alpha. Colour
+// effects are applied to the unpremultiplied colour.
+// `TEXDECAL_BC`: Apply the brightness and contrast only.
+// `TEXDECAL_GBCS`: Apply the gamma, brightness, contrast and saturation.
+// `TEXDECAL_SRGB`: Decode sRGB texels into linear light.
+// `TEXDECAL_SWIZZLE`: Swizzle RGB as we're storing BGRA data in a RGBA
+// texture.
+
+cbuffer TexDecal
+{
+	float4 modCol;
+	uint4 flags; // Unused, features are compile-time permutations
+	float4 gbcs; // r: Gamma g: Brightness b: Contrast a: Saturation
+};
+
+Texture2D texTexture;
+SamplerState texSampler;
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+//-----------------------------------------------------------------------------
+// RGB->Luma coefficients
+
+// BT.601
+//static const float3 lumaCoef = { 0.299f, 0.587f, 0.114f };
+
+// BT.709
+static const float3 lumaCoef = { 0.2126f, 0.7152f, 0.0722f };
+
+//-----------------------------------------------------------------------------
+
+float4 main(PSInput input) : SV_TARGET
+{
+	float4 texCol = texTexture.Sample(texSampler, input.uv);
+
+#if TEXDECAL_SWIZZLE
+	texCol.rgb = texCol.bgr;
+#endif
+
+#if TEXDECAL_PREMULTIPLIED
+	// Undo the premultiplication so that effects don't darken the edges
+	float invAlpha = texCol.a > 0.0f ? 1.0f / texCol.a : 0.0f;
+	texCol.rgb *= invAlpha;
+#endif
+
+#if TEXDECAL_SRGB
+	// Exact sRGB EOTF
+	float3 lo = texCol.rgb / 12.92f;
+	float3 hi = pow((texCol.rgb + 0.055f) / 1.055f, 2.4f);
+	texCol.rgb = (texCol.rgb <= 0.04045f) ? lo : hi;
+#endif
+
+#if TEXDECAL_BC
+	// Identical to `TEXDECAL_GBCS` with a gamma and saturation of 1
+	texCol.rgb += gbcs.g;
+	texCol.rgb = lerp(float3(0.5f, 0.5f, 0.5f), texCol.rgb, gbcs.b);
+#endif
+
+#if TEXDECAL_GBCS
+	// Apply gamma
+	texCol.rgb = pow(texCol.rgb, gbcs.r);
+
+	// Apply brightness
+	texCol.rgb += gbcs.g;
+
+	// Apply saturation
+	float luma = dot(texCol.rgb, lumaCoef);
+	texCol.rgb = lerp(float3(luma, luma, luma), texCol.rgb, gbcs.a);
+
+	// Apply contrast
+	texCol.rgb = lerp(float3(0.5f, 0.5f, 0.5f), texCol.rgb, gbcs.b);
+#endif
+
+#if TEXDECAL_PREMULTIPLIED
+	texCol.rgb *= texCol.a;
+#endif
+
+	// Apply vertex colour modulation and return
+#if TEXDECAL_OPAQUE
+	return float4(texCol.rgb * modCol.rgb, modCol.a);
+#else
+	return texCol * modCol;
+#endif
+}
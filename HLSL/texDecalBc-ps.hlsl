@@ -0,0 +1,26 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Texture decal that applies brightness and contrast, see "texDecal.hlsli"
+
+#define TEXDECAL_OPAQUE 0
+#define TEXDECAL_PREMULTIPLIED 0
+#define TEXDECAL_BC 1
+#define TEXDECAL_GBCS 0
+#define TEXDECAL_SRGB 0
+#define TEXDECAL_SWIZZLE 0
+#include "texDecal.hlsli"
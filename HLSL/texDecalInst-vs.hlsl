@@ -0,0 +1,69 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+// Instanced version of "texDecal-vs". Each instance is drawn as 4 copies of a
+// unit quad, one for each piece of a scrolled rectangle. Requires feature
+// level 10.0 for `SV_InstanceID`.
+
+cbuffer Camera
+{
+	matrix viewMat;
+	matrix projMat;
+};
+
+struct VSInput
+{
+	float2 corner : POSITION; // Unit quad, (0, 0) to (1, 1)
+	float4 rect : RECT; // Left, top, right, bottom
+	float4 uvRect : UVRECT; // Top-left UV, bottom-right UV
+	float4 params : PARAMS; // Scroll offset in [0..1), -, -
+	uint id : SV_InstanceID;
+};
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+PSInput main(VSInput input)
+{
+	PSInput output;
+
+	// The rectangle is split into 4 pieces at the scroll offset with the
+	// texture wrapping around from each piece to the next. Piece 0 is the
+	// top-left piece, 1 the top-right, 2 the bottom-left and 3 the
+	// bottom-right. Pieces of zero size are culled by the rasterizer.
+	float2 piece = float2(input.id & 1, (input.id >> 1) & 1);
+	float2 split = input.params.xy;
+	float2 pos = lerp(
+		input.corner * split,
+		split + input.corner * (1.0f - split), piece);
+	float2 uv = lerp(
+		(1.0f - split) + input.corner * split,
+		input.corner * (1.0f - split), piece);
+
+	// Transform to viewport space
+	output.pos = float4(lerp(input.rect.xy, input.rect.zw, pos), 0.0f, 1.0f);
+	output.pos = mul(output.pos, viewMat);
+	output.pos = mul(output.pos, projMat);
+
+	// Map to the texture's UV rectangle
+	output.uv = lerp(input.uvRect.xy, input.uvRect.zw, uv);
+
+	return output;
+}
@@ -15,34 +15,12 @@
 // more details.
 //*****************************************************************************
 
-// Designed for use with the "texDecal-vs.hlsl" vertex shader. Identical to the
-// other except the alpha channel of the image is ignored.
+// Texture decal that ignores the alpha channel, see "texDecal.hlsli"
 
-cbuffer TexDecal
-{
-	float4 modCol;
-	uint4 flags; // x: 0 = Don't swizzle, 1+ = Swizzle RGB
-	float4 gbcs; // r: Gamma g: Brightness b: Contrast a: Saturation
-};
-
-Texture2D texTexture;
-SamplerState texSampler;
-
-struct PSInput
-{
-	float4 pos : SV_POSITION;
-	float2 uv : TEXCOORD0;
-};
-
-float4 main(PSInput input) : SV_TARGET
-{
-	//return float4(input.uv, 0.0f, 1.0f);
-
-	// Fetch texture texel data and swizzle it if we're storing BGRA data in a
-	// RGBA texture
-	float4 texCol = texTexture.Sample(
-		texSampler, input.uv);
-	texCol.rgb = flags.x ? texCol.bgr : texCol.rgb;
-
-	return float4(texCol.rgb * modCol.rgb, modCol.a);
-}
+#define TEXDECAL_OPAQUE 1
+#define TEXDECAL_PREMULTIPLIED 0
+#define TEXDECAL_BC 0
+#define TEXDECAL_GBCS 0
+#define TEXDECAL_SRGB 0
+#define TEXDECAL_SWIZZLE 0
+#include "texDecal.hlsli"
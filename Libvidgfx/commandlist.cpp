@@ -0,0 +1,302 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#include "commandlist.h"
+
+CommandList::CommandList()
+	: m_cmds()
+	, m_floats()
+	, m_ptrs()
+{
+}
+
+CommandList::~CommandList()
+{
+}
+
+/// <summary>
+/// Removes all recorded commands while keeping the allocated memory so that
+/// the list can be rerecorded every frame without reallocating.
+/// </summary>
+void CommandList::reset()
+{
+	// `resize()` doesn't release the reserved capacity unlike `clear()`
+	m_cmds.resize(0);
+	m_floats.resize(0);
+	m_ptrs.resize(0);
+}
+
+/// <summary>
+/// Replays every recorded command on `context` in the order that they were
+/// recorded. The list is left unmodified so that it can be executed again.
+/// </summary>
+void CommandList::execute(GraphicsContext *context) const
+{
+	if(context == NULL || !context->isValid())
+		return;
+
+	for(int i = 0; i < m_cmds.size(); i++) {
+		const Command &cmd = m_cmds.at(i);
+		const int *args = cmd.args;
+		switch(cmd.type) {
+		default:
+			break;
+		case SetViewMatrixCmd:
+			context->setViewMatrix(QMatrix4x4(&m_floats.at(args[0])));
+			break;
+		case SetProjectionMatrixCmd:
+			context->setProjectionMatrix(QMatrix4x4(&m_floats.at(args[0])));
+			break;
+		case SetUserRenderTargetCmd:
+			context->setUserRenderTarget(
+				static_cast<Texture *>(m_ptrs.at(args[0])),
+				static_cast<Texture *>(m_ptrs.at(args[0] + 1)));
+			break;
+		case SetUserRenderTargetViewportCmd:
+			context->setUserRenderTargetViewport(
+				QRect(args[0], args[1], args[2], args[3]));
+			break;
+		case SetResizeLayerRectCmd: {
+			const float *f = &m_floats.at(args[0]);
+			context->setResizeLayerRect(QRectF(f[0], f[1], f[2], f[3]));
+			break; }
+		case SetRgbNv16PxSizeCmd: {
+			const float *f = &m_floats.at(args[0]);
+			context->setRgbNv16PxSize(QPointF(f[0], f[1]));
+			break; }
+		case SetTexDecalModColorCmd:
+			context->setTexDecalModColor(colorAt(args[0]));
+			break;
+		case SetTexDecalEffectsCmd: {
+			const float *f = &m_floats.at(args[0]);
+			context->setTexDecalEffects(f[0], f[1], f[2], f[3]);
+			break; }
+		case SetTexDecalSrgbCmd:
+			context->setTexDecalSrgb(args[0] != 0);
+			break;
+		case SetRenderTargetCmd:
+			context->setRenderTarget((VidgfxRendTarget)args[0]);
+			break;
+		case SetShaderCmd:
+			context->setShader((VidgfxShader)args[0]);
+			break;
+		case SetTopologyCmd:
+			context->setTopology((VidgfxTopology)args[0]);
+			break;
+		case SetBlendingCmd:
+			context->setBlending((VidgfxBlending)args[0]);
+			break;
+		case SetTextureCmd:
+			context->setTexture(
+				static_cast<Texture *>(m_ptrs.at(args[0])),
+				static_cast<Texture *>(m_ptrs.at(args[0] + 1)),
+				static_cast<Texture *>(m_ptrs.at(args[0] + 2)));
+			break;
+		case SetTextureFilterCmd:
+			context->setTextureFilter((VidgfxFilter)args[0]);
+			break;
+		case SetScissorRectCmd:
+			context->setScissorRect(
+				QRect(args[0], args[1], args[2], args[3]));
+			break;
+		case ClearCmd:
+			context->clear(colorAt(args[0]));
+			break;
+		case DrawBufferCmd:
+			context->drawBuffer(
+				static_cast<VertexBuffer *>(m_ptrs.at(args[0])), args[1],
+				args[2]);
+			break;
+		case DrawInstancedCmd:
+			context->drawInstanced(
+				static_cast<VertexBuffer *>(m_ptrs.at(args[0])), args[1],
+				args[2]);
+			break;
+		}
+	}
+}
+
+void CommandList::setViewMatrix(const QMatrix4x4 &matrix)
+{
+	// `copyDataTo()` is row-major like the `QMatrix4x4(const float *)`
+	// constructor that is used during execution
+	float values[16];
+	matrix.copyDataTo(values);
+	appendCmd(SetViewMatrixCmd).args[0] = appendFloats(values, 16);
+}
+
+void CommandList::setProjectionMatrix(const QMatrix4x4 &matrix)
+{
+	float values[16];
+	matrix.copyDataTo(values);
+	appendCmd(SetProjectionMatrixCmd).args[0] = appendFloats(values, 16);
+}
+
+void CommandList::setUserRenderTarget(Texture *texA, Texture *texB)
+{
+	appendCmd(SetUserRenderTargetCmd).args[0] = m_ptrs.size();
+	m_ptrs.append(texA);
+	m_ptrs.append(texB);
+}
+
+void CommandList::setUserRenderTargetViewport(const QRect &rect)
+{
+	Command &cmd = appendCmd(SetUserRenderTargetViewportCmd);
+	cmd.args[0] = rect.x();
+	cmd.args[1] = rect.y();
+	cmd.args[2] = rect.width();
+	cmd.args[3] = rect.height();
+}
+
+void CommandList::setUserRenderTargetViewport(const QSize &size)
+{
+	setUserRenderTargetViewport(QRect(QPoint(0, 0), size));
+}
+
+void CommandList::setResizeLayerRect(const QRectF &rect)
+{
+	float values[4] = {
+		(float)rect.x(), (float)rect.y(),
+		(float)rect.width(), (float)rect.height() };
+	appendCmd(SetResizeLayerRectCmd).args[0] = appendFloats(values, 4);
+}
+
+void CommandList::setRgbNv16PxSize(const QPointF &size)
+{
+	float values[2] = { (float)size.x(), (float)size.y() };
+	appendCmd(SetRgbNv16PxSizeCmd).args[0] = appendFloats(values, 2);
+}
+
+void CommandList::setTexDecalModColor(const QColor &color)
+{
+	appendCmd(SetTexDecalModColorCmd).args[0] = appendColor(color);
+}
+
+void CommandList::setTexDecalEffects(
+	float gamma, float brightness, float contrast, float saturation)
+{
+	float values[4] = { gamma, brightness, contrast, saturation };
+	appendCmd(SetTexDecalEffectsCmd).args[0] = appendFloats(values, 4);
+}
+
+void CommandList::setTexDecalSrgb(bool decodeSrgb)
+{
+	appendCmd(SetTexDecalSrgbCmd).args[0] = decodeSrgb ? 1 : 0;
+}
+
+void CommandList::setRenderTarget(VidgfxRendTarget target)
+{
+	appendCmd(SetRenderTargetCmd).args[0] = (int)target;
+}
+
+void CommandList::setShader(VidgfxShader shader)
+{
+	appendCmd(SetShaderCmd).args[0] = (int)shader;
+}
+
+void CommandList::setTopology(VidgfxTopology topology)
+{
+	appendCmd(SetTopologyCmd).args[0] = (int)topology;
+}
+
+void CommandList::setBlending(VidgfxBlending blending)
+{
+	appendCmd(SetBlendingCmd).args[0] = (int)blending;
+}
+
+void CommandList::setTexture(Texture *texA, Texture *texB, Texture *texC)
+{
+	appendCmd(SetTextureCmd).args[0] = m_ptrs.size();
+	m_ptrs.append(texA);
+	m_ptrs.append(texB);
+	m_ptrs.append(texC);
+}
+
+void CommandList::setTextureFilter(VidgfxFilter filter)
+{
+	appendCmd(SetTextureFilterCmd).args[0] = (int)filter;
+}
+
+void CommandList::setScissorRect(const QRect &rect)
+{
+	Command &cmd = appendCmd(SetScissorRectCmd);
+	cmd.args[0] = rect.x();
+	cmd.args[1] = rect.y();
+	cmd.args[2] = rect.width();
+	cmd.args[3] = rect.height();
+}
+
+void CommandList::clear(const QColor &color)
+{
+	appendCmd(ClearCmd).args[0] = appendColor(color);
+}
+
+void CommandList::drawBuffer(
+	VertexBuffer *buf, int numVertices, int startVertex)
+{
+	if(buf == NULL)
+		return; // Nothing to render
+	Command &cmd = appendCmd(DrawBufferCmd);
+	cmd.args[0] = m_ptrs.size();
+	cmd.args[1] = numVertices;
+	cmd.args[2] = startVertex;
+	m_ptrs.append(buf);
+}
+
+void CommandList::drawInstanced(
+	VertexBuffer *instBuf, int numInstances, int startInstance)
+{
+	if(instBuf == NULL)
+		return; // Nothing to render
+	Command &cmd = appendCmd(DrawInstancedCmd);
+	cmd.args[0] = m_ptrs.size();
+	cmd.args[1] = numInstances;
+	cmd.args[2] = startInstance;
+	m_ptrs.append(instBuf);
+}
+
+CommandList::Command &CommandList::appendCmd(CommandType type)
+{
+	Command cmd;
+	cmd.type = type;
+	memset(cmd.args, 0, sizeof(cmd.args));
+	m_cmds.append(cmd);
+	return m_cmds.last();
+}
+
+/// <returns>The index of the first value in `m_floats`</returns>
+int CommandList::appendFloats(const float *values, int num)
+{
+	int index = m_floats.size();
+	m_floats.resize(index + num);
+	memcpy(&m_floats[index], values, num * sizeof(float));
+	return index;
+}
+
+int CommandList::appendColor(const QColor &color)
+{
+	float values[4] = {
+		(float)color.redF(), (float)color.greenF(), (float)color.blueF(),
+		(float)color.alphaF() };
+	return appendFloats(values, 4);
+}
+
+QColor CommandList::colorAt(int index) const
+{
+	const float *f = &m_floats.at(index);
+	return QColor::fromRgbF(f[0], f[1], f[2], f[3]);
+}
@@ -0,0 +1,126 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#ifndef COMMANDLIST_H
+#define COMMANDLIST_H
+
+#include "graphicscontext.h"
+#include <QtCore/QVector>
+
+//=============================================================================
+/// <summary>
+/// Records the drawing calls of `GraphicsContext` into a compact buffer so
+/// that they can be replayed later with `execute()`. As recording never
+/// touches the graphics device a list can be built on any thread, however it
+/// must only be executed on the thread that owns the context and a single list
+/// must not be used by multiple threads at the same time.
+///
+/// Textures and vertex buffers are recorded by pointer only. They must be
+/// created on the thread that owns the context and must remain valid until
+/// the list has been executed. Recording threads may fill the data of vertex
+/// buffers that they own but must not modify them while the list executes.
+/// </summary>
+class CommandList
+{
+private: // Datatypes ---------------------------------------------------------
+	enum CommandType {
+		SetViewMatrixCmd = 0,
+		SetProjectionMatrixCmd,
+		SetUserRenderTargetCmd,
+		SetUserRenderTargetViewportCmd,
+		SetResizeLayerRectCmd,
+		SetRgbNv16PxSizeCmd,
+		SetTexDecalModColorCmd,
+		SetTexDecalEffectsCmd,
+		SetTexDecalSrgbCmd,
+		SetRenderTargetCmd,
+		SetShaderCmd,
+		SetTopologyCmd,
+		SetBlendingCmd,
+		SetTextureCmd,
+		SetTextureFilterCmd,
+		SetScissorRectCmd,
+		ClearCmd,
+		DrawBufferCmd,
+		DrawInstancedCmd
+	};
+
+	struct Command {
+		CommandType	type;
+		int			args[4]; // Values or indices into `m_floats`/`m_ptrs`
+	};
+
+protected: // Members ---------------------------------------------------------
+	QVector<Command>	m_cmds;
+	QVector<float>		m_floats;
+	QVector<void *>		m_ptrs;
+
+public: // Constructor/destructor ---------------------------------------------
+	CommandList();
+	virtual ~CommandList();
+
+public: // Methods ------------------------------------------------------------
+	int		getNumCommands() const;
+	bool	isEmpty() const;
+	void	reset();
+	void	execute(GraphicsContext *context) const;
+
+	// Recording, see `GraphicsContext` for details
+	void	setViewMatrix(const QMatrix4x4 &matrix);
+	void	setProjectionMatrix(const QMatrix4x4 &matrix);
+	void	setUserRenderTarget(Texture *texA, Texture *texB = NULL);
+	void	setUserRenderTargetViewport(const QRect &rect);
+	void	setUserRenderTargetViewport(const QSize &size);
+	void	setResizeLayerRect(const QRectF &rect);
+	void	setRgbNv16PxSize(const QPointF &size);
+	void	setTexDecalModColor(const QColor &color);
+	void	setTexDecalEffects(
+		float gamma, float brightness, float contrast, float saturation);
+	void	setTexDecalSrgb(bool decodeSrgb);
+	void	setRenderTarget(VidgfxRendTarget target);
+	void	setShader(VidgfxShader shader);
+	void	setTopology(VidgfxTopology topology);
+	void	setBlending(VidgfxBlending blending);
+	void	setTexture(
+		Texture *texA, Texture *texB = NULL, Texture *texC = NULL);
+	void	setTextureFilter(VidgfxFilter filter);
+	void	setScissorRect(const QRect &rect);
+	void	clear(const QColor &color);
+	void	drawBuffer(
+		VertexBuffer *buf, int numVertices = -1, int startVertex = 0);
+	void	drawInstanced(
+		VertexBuffer *instBuf, int numInstances = -1, int startInstance = 0);
+
+private:
+	Command &	appendCmd(CommandType type);
+	int			appendFloats(const float *values, int num);
+	int			appendColor(const QColor &color);
+	QColor		colorAt(int index) const;
+};
+//=============================================================================
+
+inline int CommandList::getNumCommands() const
+{
+	return m_cmds.size();
+}
+
+inline bool CommandList::isEmpty() const
+{
+	return m_cmds.isEmpty();
+}
+
+#endif // COMMANDLIST_H
@@ -0,0 +1,5397 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#include "d3d11context.h"
+#include "gfxlog.h"
+#include "versionhelpers.h"
+#include <d3d11.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/qmath.h>
+#include <QtGui/QImage>
+
+// Set this definition to "1" in order to test how Mishira would behave on
+// hardware that only supports feature level 10.0 and therefore cannot use the
+// compute shader conversion path.
+#define FORCE_DIRECTX_11_LEVEL_10_0 0
+
+// Set this definition to "1" in order to test how Mishira would behave if
+// BGRA textures were not supported.
+#define FORCE_NO_BGRA_SUPPORT 0
+
+static const QString LOG_CAT = QStringLiteral("Gfx");
+
+// Function pointer to `CreateDXGIFactory1()`
+typedef HRESULT (WINAPI* PFN_DXGI_CREATE_DXGI_FACTORY1)(REFIID, void **);
+
+// Size of each context's dynamic vertex ring and the largest vertex buffer
+// that is sub-allocated from it. Larger buffers get their own hardware buffer.
+static const int VERTEX_RING_BYTES = 1024 * 1024;
+static const int VERTEX_RING_MAX_ALLOC_BYTES = 64 * 1024;
+
+// Maximum number of taps of a single `resampleTexture()` pass. Downscales
+// that need more than this are filtered with a narrower kernel.
+static const int MAX_RESAMPLE_TAPS = 64;
+
+// Number of weight textures that `resampleTexture()` keeps around for reuse
+static const int MAX_RESAMPLE_WEIGHTS = 8;
+
+// Thread group size of the RGB to YUV compute shaders, must match the
+// `numthreads` attribute in "rgb-*-cs.hlsl"
+static const int YUV_CS_GROUP_SIZE = 8;
+
+// Defined in "d3dcontext.cpp"
+extern QString numberToHexString(quint64 num);
+extern QString getDXErrorCode(HRESULT res);
+
+//=============================================================================
+// Helpers
+
+static bool createDX11Buffer(
+	ID3D11Device *device, D3D11_BUFFER_DESC *desc, void *initialData,
+	ID3D11Buffer **buffer)
+{
+	// Initial buffer contents
+	D3D11_SUBRESOURCE_DATA data;
+	if(initialData != NULL) {
+		data.pSysMem = initialData;
+		data.SysMemPitch = 0;
+		data.SysMemSlicePitch = 0;
+	}
+
+	HRESULT res;
+	if(initialData == NULL)
+		res = device->CreateBuffer(desc, NULL, buffer);
+	else
+		res = device->CreateBuffer(desc, &data, buffer);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to allocate DirectX buffer of " << desc->ByteWidth
+			<< " bytes. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Replaces the contents of a dynamic buffer. Deferred contexts require the
+/// first map of a dynamic resource in every command list to discard so this
+/// is always safe to call on them.
+/// </summary>
+static bool updateDX11Buffer(
+	ID3D11DeviceContext *dc, ID3D11Buffer *buffer, void *newData,
+	int numBytes)
+{
+	// Map buffer to CPU RAM
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT res = dc->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to map DirectX buffer into RAM. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	// Copy data
+	memcpy(mapped.pData, newData, numBytes);
+
+	// Unmap buffer
+	dc->Unmap(buffer, 0);
+
+	return true;
+}
+
+/// <summary>
+/// Loads `CreateDXGIFactory1()` dynamically so that we don't need to link
+/// against "dxgi.lib". Direct3D 11 always requires DXGI 1.1 so unlike
+/// `D3DContext` we never fall back to a DXGI 1.0 factory. As DXGI 1.0 and 1.1
+/// factories cannot coexist in a process on Windows 7 a `D3D11Context` must
+/// not be initialized in a process that also uses a `D3DContext` without
+/// DXGI 1.1.
+/// </summary>
+static HRESULT createDXGIFactory1(IDXGIFactory1 **factoryOut)
+{
+	*factoryOut = NULL;
+	HMODULE dxgiDll = GetModuleHandle(TEXT("dxgi.dll"));
+	if(dxgiDll == NULL)
+		dxgiDll = LoadLibrary(TEXT("dxgi.dll"));
+	if(dxgiDll == NULL)
+		return E_FAIL;
+	PFN_DXGI_CREATE_DXGI_FACTORY1 createFactory1 =
+		(PFN_DXGI_CREATE_DXGI_FACTORY1)GetProcAddress(
+		dxgiDll, "CreateDXGIFactory1");
+	if(createFactory1 == NULL)
+		return E_NOINTERFACE;
+	return createFactory1(__uuidof(IDXGIFactory1), (void **)factoryOut);
+}
+
+//=============================================================================
+// D3D11VertexBuffer class
+
+D3D11VertexBuffer::D3D11VertexBuffer(D3D11Context *context, int numFloats)
+	: VertexBuffer(numFloats)
+	, m_context(context)
+	, m_buffer(NULL)
+	, m_uploadContext(NULL)
+	, m_uploadCmdList(0)
+	, m_useRing(false)
+	, m_ringOffset(0)
+	, m_ringNumFloats(0)
+	, m_ringGeneration(0)
+{
+	createResources();
+}
+
+D3D11VertexBuffer::~D3D11VertexBuffer()
+{
+	releaseResources();
+}
+
+void D3D11VertexBuffer::createResources()
+{
+	// Small buffers that are rewritten every frame are sub-allocated from the
+	// context's vertex ring instead of each being renamed by the driver
+	m_useRing = false;
+	if(m_context->getVertexRing() != NULL &&
+		m_numFloats * (int)sizeof(float) <= VERTEX_RING_MAX_ALLOC_BYTES)
+	{
+		m_useRing = true;
+		return;
+	}
+
+	// Get device
+	ID3D11Device *device = m_context->getDevice();
+
+	// Create hardware buffer
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = m_numFloats * sizeof(float);
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	if(!createDX11Buffer(device, &desc, m_data, &m_buffer)) {
+		// Failed to create buffer
+		m_buffer = NULL;
+		return;
+	}
+
+	// Created with the current data which is visible to every context
+	m_dirty = false;
+	m_uploadContext = NULL;
+}
+
+void D3D11VertexBuffer::releaseResources()
+{
+	if(m_buffer)
+		m_buffer->Release();
+	m_buffer = NULL;
+}
+
+/// <summary>
+/// Returns true if the hardware has the current vertex data for drawing with
+/// `context`. Dynamic data that was uploaded by a deferred context is only
+/// valid within the command list that it was uploaded in as every command
+/// list must begin by discarding the dynamic resources that it maps.
+/// </summary>
+bool D3D11VertexBuffer::isUploaded(D3D11Context *context) const
+{
+	if(m_dirty)
+		return false;
+	if(m_uploadContext == NULL)
+		return !m_useRing; // Created with the current data
+	if(m_uploadContext != context)
+		return false; // Uploaded by another context
+	if(context->isDeferred() &&
+		m_uploadCmdList != context->getCommandListCounter())
+	{
+		return false; // Uploaded in an earlier command list
+	}
+	if(m_useRing && m_ringGeneration != context->getVertexRingGeneration())
+		return false; // Ring has wrapped since
+	return true;
+}
+
+void D3D11VertexBuffer::update(D3D11Context *context)
+{
+	if(m_useRing) {
+		// Only the vertices that are actually in use are uploaded. The
+		// allocation is lost whenever the ring wraps so reupload then as well.
+		int numFloats = m_numVerts * m_vertSize;
+		if(numFloats <= 0 || numFloats > m_numFloats)
+			numFloats = m_numFloats;
+		if(isUploaded(context) && numFloats <= m_ringNumFloats)
+			return; // Allocation is up-to-date
+		if(!context->appendToVertexRing(
+			m_data, numFloats * sizeof(float), m_ringOffset))
+		{
+			// Failed to update buffer contents
+			return;
+		}
+		m_ringNumFloats = numFloats;
+		m_ringGeneration = context->getVertexRingGeneration();
+		m_uploadContext = context;
+		m_uploadCmdList = context->getCommandListCounter();
+		m_dirty = false;
+		return;
+	}
+
+	if(m_buffer == NULL)
+		return; // Buffer doesn't exist
+	if(isUploaded(context))
+		return; // Buffer is up-to-date
+
+	// Update hardware buffer
+	int bufSize = m_numFloats * sizeof(float);
+	if(!updateDX11Buffer(
+		context->getDeviceContext(), m_buffer, m_data, bufSize))
+	{
+		// Failed to update buffer contents
+		return;
+	}
+	m_uploadContext = context;
+	m_uploadCmdList = context->getCommandListCounter();
+	m_dirty = false;
+}
+
+void D3D11VertexBuffer::bind(D3D11Context *context, uint slot)
+{
+	if(m_useRing) {
+		// Make sure the allocation is valid, the ring may have wrapped since
+		update(context);
+		if(!isUploaded(context))
+			return; // Failed to upload
+	} else {
+		if(m_buffer == NULL)
+			return; // Buffer doesn't exist
+
+		// Make sure the buffer isn't dirty
+		update(context);
+	}
+
+	// Bind the buffer
+	if(m_vertSize <= 0)
+		return; // Invalid stride
+	uint stride = m_vertSize * sizeof(float);
+	uint offset = m_useRing ? m_ringOffset : 0;
+	ID3D11Buffer *buffer = m_useRing ? context->getVertexRing() : m_buffer;
+	context->getDeviceContext()->IASetVertexBuffers(
+		slot, 1, &buffer, &stride, &offset);
+}
+
+/// <summary>
+/// Returns the hardware buffer of the vertex buffer or NULL if it is
+/// sub-allocated from the vertex ring of the context that uploads it.
+/// </summary>
+ID3D11Buffer *D3D11VertexBuffer::getBuffer() const
+{
+	return m_buffer;
+}
+
+/// <summary>
+/// Returns the number of vertices that the graphics hardware has valid data
+/// for when drawing with `context`. Vertex ring allocations only contain the
+/// vertices that were in use when they were uploaded, drawing past them would
+/// read another buffer's data.
+/// </summary>
+int D3D11VertexBuffer::getNumUploadedVerts(D3D11Context *context) const
+{
+	if(m_vertSize <= 0)
+		return 0;
+	if(m_useRing) {
+		if(!isUploaded(context))
+			return 0; // Allocation is no longer valid
+		return m_ringNumFloats / m_vertSize;
+	}
+	if(m_buffer == NULL)
+		return 0;
+	return m_numFloats / m_vertSize;
+}
+
+//=============================================================================
+// D3D11Texture class
+
+D3D11Texture::D3D11Texture(
+	D3D11Context *context, VidgfxTexFlags flags, const QSize &size,
+	DXGI_FORMAT format, void *initialData, int stride)
+	: Texture(flags, size)
+	, m_context(context)
+	, m_tex(NULL)
+	, m_view(NULL)
+	, m_target(NULL)
+	, m_uav(NULL)
+	, m_doBgraSwizzle(false)
+	, m_isSrgb(false)
+	, m_isExternal(false)
+	, m_requestedFlags(flags)
+	, m_requestedFormat(format)
+
+	// Shared textures only
+	, m_sharedHandle(NULL)
+
+	// Shared textures with a keyed mutex only
+	, m_keyedMutex(NULL)
+	, m_syncAcquired(false)
+	, m_hasReleaseKey(false)
+	, m_releaseKey(0)
+
+	// GDI-compatible textures only
+	, m_surface(NULL)
+	, m_hdc(NULL)
+{
+	m_isValid = createResources(initialData, stride);
+}
+
+bool D3D11Texture::createResources(void *initialData, int stride)
+{
+	// Get device
+	ID3D11Device *device = m_context->getDevice();
+	DXGI_FORMAT format = m_requestedFormat;
+	VidgfxTexFlags flags = m_requestedFlags;
+	QSize size = m_size;
+
+	// If the device doesn't support BGRA textures but the pixel format was
+	// requested we instead use an RGBA pixel format and do a swizzle in the
+	// pixel shader.
+	m_doBgraSwizzle = false;
+	if(!m_context->hasBgraTexSupport()) {
+		if(format == DXGI_FORMAT_B8G8R8A8_UNORM) {
+			format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			m_doBgraSwizzle = true;
+		} else if(format == DXGI_FORMAT_B8G8R8X8_UNORM) {
+			format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBX format doesn't exist
+			m_doBgraSwizzle = true;
+		}
+	}
+
+	// Render targets can also be written to by compute shaders if the device
+	// supports typed unordered access views of the format. Shared and GDI
+	// textures are excluded as the flag isn't allowed on them.
+	bool useUav = false;
+	if(isTargetable() && m_context->hasComputeSupport() &&
+		!(flags & (GfxGDIFlag | GfxSharedFlag | GfxKeyedMutexFlag)))
+	{
+		UINT support = 0;
+		HRESULT res = device->CheckFormatSupport(format, &support);
+		if(SUCCEEDED(res) &&
+			(support & D3D11_FORMAT_SUPPORT_TYPED_UNORDERED_ACCESS_VIEW))
+		{
+			useUav = true;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Create texture object
+
+	m_isSrgb = isSrgbFormat(format);
+
+	D3D11_TEXTURE2D_DESC desc;
+	desc.Width = size.width();
+	desc.Height = size.height();
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	if(isStaging()) {
+		// Used for reading back data only
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.BindFlags = 0;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	} else {
+		desc.Usage = isWritable() ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+		desc.BindFlags = isTargetable()
+			? (D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET)
+			: (D3D11_BIND_SHADER_RESOURCE);
+		if(useUav)
+			desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = isWritable() ? D3D11_CPU_ACCESS_WRITE : 0;
+	}
+	desc.MiscFlags = 0;
+	if(flags & GfxGDIFlag)
+		desc.MiscFlags |= D3D11_RESOURCE_MISC_GDI_COMPATIBLE;
+	if(flags & GfxKeyedMutexFlag)
+		desc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
+	else if(flags & GfxSharedFlag)
+		desc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED;
+
+	HRESULT res;
+	if(stride <= 0)
+		stride = size.width() * 4; // Each pixel = 32 bits = 4 bytes
+	if(initialData != NULL) {
+		D3D11_SUBRESOURCE_DATA data;
+		data.pSysMem = initialData;
+		data.SysMemPitch = stride;
+		data.SysMemSlicePitch = 0;
+		res = device->CreateTexture2D(&desc, &data, &m_tex);
+	}
+	else
+		res = device->CreateTexture2D(&desc, NULL, &m_tex);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to create DirectX texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_context->checkDeviceRemoved(res);
+		return false;
+	}
+
+	//-------------------------------------------------------------------------
+	// Create shader resource view
+
+	if(!isStaging()) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+		viewDesc.Format = desc.Format;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MostDetailedMip = 0;
+		viewDesc.Texture2D.MipLevels = desc.MipLevels;
+		res = device->CreateShaderResourceView(m_tex, &viewDesc, &m_view);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX shader resource view. "
+				<< "Reason = " << getDXErrorCode(res);
+			return false;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Create render target and unordered access views
+
+	if(isTargetable()) {
+		res = device->CreateRenderTargetView(m_tex, NULL, &m_target);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX render target view. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_flags &= ~GfxTargetableFlag; // Unset flag
+			return false;
+		}
+	}
+	if(useUav) {
+		res = device->CreateUnorderedAccessView(m_tex, NULL, &m_uav);
+		if(FAILED(res)) {
+			// Not fatal, the pixel shader path is used instead
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX unordered access view. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_uav = NULL;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Get shared handle and keyed mutex
+
+	if(flags & (GfxSharedFlag | GfxKeyedMutexFlag)) {
+		if(!querySharedHandle())
+			return false;
+	}
+	if(flags & GfxKeyedMutexFlag) {
+		res = m_tex->QueryInterface(
+			__uuidof(IDXGIKeyedMutex), (void **)&m_keyedMutex);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to get the keyed mutex of a shared texture. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_keyedMutex = NULL;
+			return false;
+		}
+	}
+
+	// Texture was successfully created
+	return true;
+}
+
+/// <summary>
+/// Wraps a texture that was created outside of libvidgfx on the same device,
+/// such as a capture or encoder surface. The texture object takes ownership of
+/// the reference to `tex`.
+/// </summary>
+D3D11Texture::D3D11Texture(D3D11Context *context, ID3D11Texture2D *tex)
+	: Texture(0, QSize(0, 0)) // We update the size later
+	, m_context(context)
+	, m_tex(tex)
+	, m_view(NULL)
+	, m_target(NULL)
+	, m_uav(NULL)
+	, m_doBgraSwizzle(false)
+	, m_isSrgb(false)
+	, m_isExternal(true)
+	, m_requestedFlags(0)
+	, m_requestedFormat(DXGI_FORMAT_UNKNOWN)
+
+	// Shared textures only
+	, m_sharedHandle(NULL)
+
+	// Shared textures with a keyed mutex only
+	, m_keyedMutex(NULL)
+	, m_syncAcquired(false)
+	, m_hasReleaseKey(false)
+	, m_releaseKey(0)
+
+	// GDI-compatible textures only
+	, m_surface(NULL)
+	, m_hdc(NULL)
+{
+	if(m_tex == NULL)
+		return;
+
+	// Get device
+	ID3D11Device *device = context->getDevice();
+
+	// Query texture information
+	D3D11_TEXTURE2D_DESC desc;
+	m_tex->GetDesc(&desc);
+	m_size = QSize(desc.Width, desc.Height);
+	m_requestedFormat = desc.Format;
+	m_isSrgb = isSrgbFormat(desc.Format);
+	if(desc.Usage == D3D11_USAGE_STAGING)
+		m_flags |= GfxStagingFlag;
+	if(desc.Usage == D3D11_USAGE_DYNAMIC)
+		m_flags |= GfxWritableFlag;
+	if(desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+		m_flags |= GfxTargetableFlag;
+	if(desc.MiscFlags & D3D11_RESOURCE_MISC_GDI_COMPATIBLE)
+		m_flags |= GfxGDIFlag;
+	m_requestedFlags = m_flags;
+
+	// Remember the shared handle so that the texture can be passed on to
+	// other devices
+	if(desc.MiscFlags & (D3D11_RESOURCE_MISC_SHARED |
+		D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX))
+	{
+		querySharedHandle();
+	}
+
+	// Get the keyed mutex if the producer created the texture with one so
+	// that we can safely sample the texture directly instead of copying it
+	if(desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX) {
+		HRESULT res = m_tex->QueryInterface(
+			__uuidof(IDXGIKeyedMutex), (void **)&m_keyedMutex);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to get the keyed mutex of a shared texture. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_keyedMutex = NULL;
+		}
+	}
+
+	// Create shader resource view. Typeless formats cannot be viewed without
+	// knowing what the producer intended so they can only be copied.
+	if(!isStaging() && (desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+		viewDesc.Format = desc.Format;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MostDetailedMip = 0;
+		viewDesc.Texture2D.MipLevels = desc.MipLevels;
+		HRESULT res =
+			device->CreateShaderResourceView(m_tex, &viewDesc, &m_view);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX shader resource view. "
+				<< "Reason = " << getDXErrorCode(res);
+			return;
+		}
+	}
+
+	// Create render target view so that we can also render into the texture
+	if(isTargetable()) {
+		HRESULT res = device->CreateRenderTargetView(m_tex, NULL, &m_target);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX render target view. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_target = NULL;
+			m_flags &= ~GfxTargetableFlag; // Unset flag
+		}
+	}
+
+	// Texture was successfully created
+	m_isValid = true;
+}
+
+D3D11Texture::~D3D11Texture()
+{
+	releaseResources();
+}
+
+void D3D11Texture::releaseResources()
+{
+	if(m_keyedMutex) {
+		if(m_syncAcquired) {
+			// Hand the mutex to the peer with the same key that we released
+			// it with last time. Releasing with the acquire key would give it
+			// back to ourselves and leave the peer waiting forever.
+			if(m_hasReleaseKey) {
+				m_keyedMutex->ReleaseSync(m_releaseKey);
+			} else {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Deleting a shared texture that was never released with "
+					<< "releaseSync(), the peer may stay blocked";
+			}
+		}
+		m_keyedMutex->Release();
+	}
+	if(m_surface) {
+		m_surface->ReleaseDC(NULL);
+		m_surface->Release();
+	}
+	if(m_uav)
+		m_uav->Release();
+	if(m_view)
+		m_view->Release();
+	if(m_tex)
+		m_tex->Release();
+	if(m_target)
+		m_target->Release();
+	m_keyedMutex = NULL;
+	m_syncAcquired = false;
+	m_surface = NULL;
+	m_hdc = NULL;
+	m_uav = NULL;
+	m_view = NULL;
+	m_tex = NULL;
+	m_target = NULL;
+	m_sharedHandle = NULL;
+	m_mappedData = NULL;
+	m_stride = 0;
+	m_isValid = false;
+}
+
+void *D3D11Texture::map()
+{
+	return map(false);
+}
+
+/// <summary>
+/// Maps the texture into CPU memory. If `doNotWait` is true and the graphics
+/// hardware is still using the texture then NULL is returned immediately
+/// instead of stalling the calling thread until the texture is available.
+///
+/// Textures are always mapped with the immediate context as mapping with a
+/// deferred context cannot read back data or update non-dynamic resources.
+/// It is therefore only safe to call this from the thread that owns the
+/// context that `initialize()` was called on.
+/// </summary>
+void *D3D11Texture::map(bool doNotWait)
+{
+	if(m_tex == NULL)
+		return NULL; // Texture doesn't exist
+
+	D3D11_MAPPED_SUBRESOURCE mapInfo;
+	D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD;
+	if(isStaging())
+		mapType = D3D11_MAP_READ;
+	UINT mapFlags = doNotWait ? D3D11_MAP_FLAG_DO_NOT_WAIT : 0;
+	HRESULT res = m_context->getImmediateContext()->Map(
+		m_tex, D3D11CalcSubresource(0, 0, 0), mapType, mapFlags, &mapInfo);
+	if(res == DXGI_ERROR_WAS_STILL_DRAWING)
+		return NULL; // Only returned when `doNotWait` is true, not an error
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to map texture buffer into RAM. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_context->checkDeviceRemoved(res);
+		return NULL;
+	}
+
+	m_mappedData = mapInfo.pData;
+	m_stride = mapInfo.RowPitch;
+
+	return m_mappedData;
+}
+
+void D3D11Texture::unmap()
+{
+	if(m_tex == NULL)
+		return; // Texture doesn't exist
+	if(!isMapped())
+		return;
+
+	m_mappedData = NULL;
+	m_stride = 0;
+	m_context->getImmediateContext()->Unmap(
+		m_tex, D3D11CalcSubresource(0, 0, 0));
+	if(!isStaging())
+		markModified();
+}
+
+DXGI_FORMAT D3D11Texture::getPixelFormat()
+{
+	D3D11_TEXTURE2D_DESC desc;
+	m_tex->GetDesc(&desc);
+	return desc.Format;
+}
+
+/// <summary>
+/// Returns the approximate amount of video memory used by this texture in
+/// bytes.
+/// </summary>
+qint64 D3D11Texture::getMemoryUsage()
+{
+	if(m_tex == NULL)
+		return 0;
+	return (qint64)m_size.width() * (qint64)m_size.height() *
+		(qint64)getBitsPerPixel(getPixelFormat()) / 8LL;
+}
+
+/// <summary>
+/// Returns the number of bits that a single pixel of `format` uses in video
+/// memory. Block-compressed formats return their average rate.
+/// </summary>
+int D3D11Texture::getBitsPerPixel(DXGI_FORMAT format)
+{
+	switch(format) {
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+		return 64;
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+	default:
+		return 32; // All other formats that we use are 32 bits per pixel
+	}
+	return 32; // Should never be reached
+}
+
+bool D3D11Texture::isSrgbFormat(DXGI_FORMAT format)
+{
+	switch(format) {
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return true;
+	default:
+		return false;
+	}
+	return false; // Should never be reached
+}
+
+/// <summary>
+/// Returns true if the texture uses a hardware sRGB texture format.
+/// </summary>
+bool D3D11Texture::isSrgbHack()
+{
+	return m_isSrgb;
+}
+
+/// <summary>
+/// WARNING: The usage of the returned HDC must abide by the remarks on the
+/// "IDXGISurface1::GetDC()" documentation page.
+/// http://msdn.microsoft.com/en-us/library/windows/desktop/ff471345%28v=vs.85%29.aspx
+/// </summary>
+HDC D3D11Texture::getDC()
+{
+	if(!(m_flags & GfxGDIFlag))
+		return NULL; // Texture isn't GDI compatible
+	if(m_hdc != NULL)
+		return m_hdc;
+	HRESULT res = m_tex->QueryInterface(
+		__uuidof(IDXGISurface1), (void **)&m_surface);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to get the DXGI 1.1 surface for a texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_surface = NULL;
+		return NULL;
+	}
+	res = m_surface->GetDC(TRUE, &m_hdc);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to get the device context for a texture surface. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_surface->Release();
+		m_surface = NULL;
+		m_hdc = NULL;
+		return NULL;
+	}
+	return m_hdc;
+}
+
+/// <summary>
+/// Fetches the DXGI shared handle of the texture. The handle is owned by the
+/// resource and doesn't need to be closed.
+/// </summary>
+bool D3D11Texture::querySharedHandle()
+{
+	IDXGIResource *resource = NULL;
+	HRESULT res = m_tex->QueryInterface(
+		__uuidof(IDXGIResource), (void **)&resource);
+	if(SUCCEEDED(res)) {
+		res = resource->GetSharedHandle(&m_sharedHandle);
+		resource->Release();
+	}
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to get the shared handle of a texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_sharedHandle = NULL;
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Acquires the keyed mutex of a shared texture so that it can be safely
+/// sampled while the producer isn't writing to it. `key` must match the key
+/// that the producer released the texture with. The texture must be released
+/// with `releaseSync()` using the key that the producer expects to acquire
+/// with as soon as rendering with it has been queued. If the texture is deleted
+/// while still acquired it is released with the key of the previous
+/// `releaseSync()` call.
+///
+/// Rendering with the texture in a deferred context counts as queued once the
+/// command list has been executed by the immediate context.
+/// </summary>
+VidgfxSyncResult D3D11Texture::acquireSync(quint64 key, int timeoutMsec)
+{
+	if(m_keyedMutex == NULL)
+		return GfxSyncNoMutex;
+	if(m_syncAcquired)
+		return GfxSyncAcquired; // Already acquired
+
+	HRESULT res = m_keyedMutex->AcquireSync(
+		key, timeoutMsec < 0 ? INFINITE : (DWORD)timeoutMsec);
+	if(res == WAIT_TIMEOUT)
+		return GfxSyncTimeout; // Not an error
+	if(res == WAIT_ABANDONED) {
+		// We still own the mutex but the contents are undefined. The producer
+		// may have written to it before it went away.
+		m_syncAcquired = true;
+		markModified();
+		return GfxSyncAbandoned;
+	}
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to acquire the keyed mutex of a shared texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		return GfxSyncFailed;
+	}
+	m_syncAcquired = true;
+	markModified(); // The producer has most likely written a new frame
+	return GfxSyncAcquired;
+}
+
+/// <summary>
+/// Releases the keyed mutex that was acquired with `acquireSync()` so that
+/// the next owner that waits on `key` can acquire it.
+/// </summary>
+bool D3D11Texture::releaseSync(quint64 key)
+{
+	if(m_keyedMutex == NULL || !m_syncAcquired)
+		return false;
+	HRESULT res = m_keyedMutex->ReleaseSync(key);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to release the keyed mutex of a shared texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	m_syncAcquired = false;
+	m_hasReleaseKey = true;
+	m_releaseKey = key;
+	return true;
+}
+
+void D3D11Texture::releaseDC()
+{
+	if(m_surface == NULL)
+		return;
+	m_surface->ReleaseDC(NULL);
+	m_surface->Release();
+	m_surface = NULL;
+	m_hdc = NULL;
+	markModified();
+}
+
+//=============================================================================
+// D3D11ReadbackQueue class
+
+/// <summary>
+/// Readback queues can only be created by the immediate context as their
+/// queries and staging textures are polled and mapped with it.
+/// </summary>
+D3D11ReadbackQueue::D3D11ReadbackQueue(
+	D3D11Context *context, const QSize &size, int depth)
+	: ReadbackQueue(size, depth)
+	, m_context(context)
+	, m_slots()
+	, m_nextWrite(0)
+	, m_nextRead(0)
+	, m_dequeued(-1)
+	, m_isValid(false)
+{
+	// Create a staging texture for every slot in the ring
+	m_slots.reserve(m_depth);
+	for(int i = 0; i < m_depth; i++) {
+		Slot slot;
+		slot.tex = static_cast<D3D11Texture *>(
+			m_context->createStagingTexture(m_size));
+		slot.query = NULL;
+		slot.pending = false;
+		if(slot.tex == NULL)
+			return; // Error already logged
+		m_slots.append(slot);
+	}
+
+	// Queue was successfully created if all of its queries were
+	m_isValid = createQueries();
+}
+
+D3D11ReadbackQueue::~D3D11ReadbackQueue()
+{
+	releaseDequeued();
+	for(int i = 0; i < m_slots.size(); i++) {
+		const Slot &slot = m_slots.at(i);
+		if(slot.query)
+			slot.query->Release();
+		m_context->deleteTexture(slot.tex);
+	}
+	m_slots.clear();
+}
+
+/// <summary>
+/// Creates an event query for every slot in the ring. The query is used to
+/// determine when the GPU has finished copying into the staging texture
+/// without having to attempt to map it.
+/// </summary>
+bool D3D11ReadbackQueue::createQueries()
+{
+	// Get device
+	ID3D11Device *device = m_context->getDevice();
+
+	D3D11_QUERY_DESC queryDesc;
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	queryDesc.MiscFlags = 0;
+	for(int i = 0; i < m_slots.size(); i++) {
+		if(m_slots.at(i).query != NULL)
+			continue; // Already exists
+		HRESULT res = device->CreateQuery(&queryDesc, &m_slots[i].query);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX event query. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_slots[i].query = NULL;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool D3D11ReadbackQueue::isValid() const
+{
+	return m_isValid;
+}
+
+/// <summary>
+/// Queues a copy of the `getSize()` area at `srcPos` of the texture `src` into
+/// the next free staging texture in the ring. The source texture must have the
+/// same pixel format as the textures returned by `createStagingTexture()`.
+/// </summary>
+/// <returns>
+/// True if the copy was queued or false if the ring is full or on failure.
+/// </returns>
+bool D3D11ReadbackQueue::enqueue(Texture *src, const QPoint &srcPos)
+{
+	if(!m_isValid || src == NULL)
+		return false;
+	if(isFull())
+		return false; // The caller must dequeue or release first
+	Slot &slot = m_slots[m_nextWrite];
+	if(slot.pending || m_nextWrite == m_dequeued)
+		return false; // Slot is still in use, `isFull()` prevents this
+
+	// Queue the copy followed by the event that signals its completion
+	if(!m_context->copyTextureData(
+		slot.tex, src, QPoint(0, 0), QRect(srcPos, m_size)))
+	{
+		return false; // Error already logged
+	}
+	m_context->getDeviceContext()->End(slot.query);
+	slot.pending = true;
+
+	m_nextWrite = (m_nextWrite + 1) % m_depth;
+	m_numPending++;
+	return true;
+}
+
+/// <summary>
+/// Returns the oldest queued frame if the graphics hardware has finished
+/// copying it into its staging texture. The returned texture is already mapped
+/// and remains valid until `releaseDequeued()` is called, the next call to
+/// `tryDequeue()` or the queue is deleted.
+/// </summary>
+/// <returns>
+/// The mapped staging texture or NULL if the oldest frame isn't ready yet.
+/// </returns>
+Texture *D3D11ReadbackQueue::tryDequeue()
+{
+	if(!m_isValid || m_numPending <= 0)
+		return NULL; // Nothing to dequeue
+	releaseDequeued();
+	Slot &slot = m_slots[m_nextRead];
+
+	// Test the event first as it's cheaper than a failed map. The first poll
+	// is allowed to flush the command buffer so that the copy is guaranteed to
+	// be submitted to the graphics hardware.
+	HRESULT res = m_context->getDeviceContext()->GetData(
+		slot.query, NULL, 0, 0);
+	if(res == S_FALSE)
+		return NULL; // Still processing
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to query DirectX event state. "
+			<< "Reason = " << getDXErrorCode(res);
+		if(m_context->checkDeviceRemoved(res))
+			return NULL;
+		// Attempt to map anyway
+	}
+	if(slot.tex->map(true) == NULL)
+		return NULL; // Still processing
+
+	slot.pending = false;
+	m_dequeued = m_nextRead;
+	m_hasDequeued = true;
+	m_nextRead = (m_nextRead + 1) % m_depth;
+	m_numPending--;
+	return slot.tex;
+}
+
+/// <summary>
+/// Unmaps the texture that was returned by `tryDequeue()` so that its slot can
+/// be reused.
+/// </summary>
+void D3D11ReadbackQueue::releaseDequeued()
+{
+	if(m_dequeued < 0)
+		return; // Nothing dequeued
+	m_slots[m_dequeued].tex->unmap();
+	m_dequeued = -1;
+	m_hasDequeued = false;
+}
+
+//=============================================================================
+// D3D11Context class
+
+// Every context takes a unique command list counter whenever it begins
+// recording a new command list so that vertex data that was uploaded by a
+// deleted context can never be mistaken for data of a new one
+static QAtomicInt cmdListCounter;
+
+static quint32 nextCmdListCounter()
+{
+	return (quint32)cmdListCounter.fetchAndAddOrdered(1) + 1;
+}
+
+/// <summary>
+/// Returns the adapter at the specified index of a DXGI 1.1 factory. If this
+/// method returns non-NULL then the caller must manually release the object
+/// when it is finished with it.
+/// </summary>
+static IDXGIAdapter *getDxgi11Adapter(int index)
+{
+	if(index < 0)
+		return NULL;
+	IDXGIFactory1 *factory = NULL;
+	HRESULT res = createDXGIFactory1(&factory);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning) << QStringLiteral(
+			"Failed to create DXGI 1.1 factory. Reason = %1")
+			.arg(getDXErrorCode(res));
+		return NULL;
+	}
+	IDXGIAdapter1 *adapter = NULL;
+	res = factory->EnumAdapters1(index, &adapter);
+	if(FAILED(res) || adapter == NULL) {
+		gfxLog(LOG_CAT, GfxLog::Warning) << QStringLiteral(
+			"Graphics adapter %1 doesn't exist").arg(index);
+		adapter = NULL;
+	}
+	factory->Release();
+	return adapter;
+}
+
+static QString getFeatureLevelString(D3D_FEATURE_LEVEL level)
+{
+	switch(level) {
+	case D3D_FEATURE_LEVEL_11_0:
+		return QStringLiteral("11.0");
+	case D3D_FEATURE_LEVEL_10_1:
+		return QStringLiteral("10.1");
+	case D3D_FEATURE_LEVEL_10_0:
+		return QStringLiteral("10.0");
+	case D3D_FEATURE_LEVEL_9_3:
+		return QStringLiteral("9.3");
+	default:
+		return numberToHexString((uint)level);
+	}
+}
+
+D3D11Context::D3D11Context()
+	: GraphicsContext()
+	, m_parent(NULL)
+	, m_hasBgraTexSupport(false)
+	, m_hasBgraTexSupportValid(false)
+	, m_hasFeatureLevel10(false)
+	, m_hasFeatureLevel11(false)
+	, m_hasNoOverwriteRing(false)
+	, m_adapterIndex(-1)
+	, m_isDeviceLost(false)
+	, m_swapChain(NULL)
+	, m_device(NULL)
+	, m_dc(NULL)
+	, m_rasterizerState(NULL)
+	, m_scissorRasterizerState(NULL)
+	, m_scissorRect()
+	, m_boundScissorEnabled(false)
+	, m_boundScissorRect()
+	, m_pointClampSampler(NULL)
+	, m_bilinearClampSampler(NULL)
+	, m_resizeSampler(NULL)
+	, m_noBlend(NULL)
+	, m_alphaBlend(NULL)
+	, m_premultiBlend(NULL)
+
+	// Deferred contexts
+	, m_cmdLists()
+	, m_cmdListCounter(nextCmdListCounter())
+
+	// Render targets
+	, m_screenTarget(NULL)
+	, m_screenTargetSize(0, 0)
+	, m_canvas1Texture(NULL)
+	, m_canvas2Texture(NULL)
+	, m_canvasTargetSize(0, 0)
+	, m_scratch1Texture(NULL)
+	, m_scratch2Texture(NULL)
+	, m_scratchTargetSize(0, 0)
+	, m_scratchNextTarget(0)
+
+	// Constant buffers
+	//, m_cameraConstantsLocal() // Compiler warning if this is uncommented
+	//, m_cameraConstants()
+	//, m_cameraUploadedVersions()
+	//, m_resizeConstantsLocal()
+	, m_resizeConstants(NULL)
+	//, m_rgbNv16ConstantsLocal()
+	, m_rgbNv16Constants(NULL)
+	//, m_convConstants()
+	//, m_texDecalConstantsLocal()
+	, m_texDecalConstants(NULL)
+	, m_texDecalFlags(0)
+
+	// Vertex ring
+	, m_vertRing(NULL)
+	, m_vertRingPos(VERTEX_RING_BYTES) // First append discards
+	, m_vertRingGeneration(0)
+
+	// Shaders
+	//, m_boundTargetViews()
+	, m_boundViewport()
+	, m_boundTopology(-1)
+	, m_boundBlendState(NULL)
+	//, m_boundResourceViews()
+	, m_numBoundResourceViews(-1)
+	, m_boundSampler(NULL)
+	, m_boundVSConstants(NULL)
+	, m_boundPSConstants(NULL)
+	, m_numRedundantStateCalls(0)
+	, m_boundShader(GfxNoShader)
+	, m_boundPixelShader(-1)
+	, m_solidVS(NULL)
+	, m_solidIL(NULL)
+	, m_texDecalVS(NULL)
+	, m_texDecalIL(NULL)
+	, m_resizeVS(NULL)
+	, m_resizeIL(NULL)
+	//, m_pixelShaders()
+	//, m_pixelShaderFailed()
+	//, m_computeShaders()
+	//, m_computeShaderFailed()
+	, m_hasInstancing(false)
+	, m_instancedVSBound(false)
+	, m_unitQuadBuf(NULL)
+	, m_solidInstVS(NULL)
+	, m_solidInstIL(NULL)
+	, m_texDecalInstVS(NULL)
+	, m_texDecalInstIL(NULL)
+
+	// Advanced rendering
+	, m_mipmapBuf(NULL)
+	, m_scaleCache()
+	, m_scaleCacheMaxSize(32)
+	, m_scaleCacheUseCounter(0)
+	, m_resampleWeights()
+
+	, m_hwnd(NULL)
+	, m_resizeBorderCol()
+{
+	memset(m_cameraConstantsLocal, 0, sizeof(m_cameraConstantsLocal));
+	memset(m_resizeConstantsLocal, 0, sizeof(m_resizeConstantsLocal));
+	memset(m_rgbNv16ConstantsLocal, 0, sizeof(m_rgbNv16ConstantsLocal));
+	memset(m_cameraConstants, 0, sizeof(m_cameraConstants));
+	memset(m_cameraUploadedVersions, 0, sizeof(m_cameraUploadedVersions));
+	memset(m_convConstants, 0, sizeof(m_convConstants));
+	memset(m_boundTargetViews, 0, sizeof(m_boundTargetViews));
+	memset(m_boundResourceViews, 0, sizeof(m_boundResourceViews));
+	memset(m_texDecalConstantsLocal, 0, sizeof(m_texDecalConstantsLocal));
+	memset(m_pixelShaders, 0, sizeof(m_pixelShaders));
+	memset(m_pixelShaderFailed, 0, sizeof(m_pixelShaderFailed));
+	memset(m_computeShaders, 0, sizeof(m_computeShaders));
+	memset(m_computeShaderFailed, 0, sizeof(m_computeShaderFailed));
+}
+
+D3D11Context::~D3D11Context()
+{
+	// Only continue if DirectX actually initialized
+	if(m_device == NULL)
+		return;
+
+	// Emit destroyed signal so that other parts of the application can cleanly
+	// release their hardware resources
+	if(m_parent == NULL) {
+		callDestroyingCallbacks();
+		emit destroying(this);
+	}
+
+	releaseDeviceObjects();
+}
+
+/// <summary>
+/// Releases every object that was created by `createDeviceObjects()` or
+/// `createDeferredObjects()`. Objects that are shared with the immediate
+/// context are only released by the context that owns the last reference to
+/// them. Safe to call on a partially created context.
+/// </summary>
+void D3D11Context::releaseDeviceObjects()
+{
+	// Unbind render targets
+	if(m_dc != NULL) {
+		ID3D11RenderTargetView *nullView[2] = { NULL, NULL };
+		m_dc->OMSetRenderTargets(2, nullView, NULL);
+	}
+
+	// Release command lists that were never executed
+	for(int i = 0; i < m_cmdLists.size(); i++)
+		m_cmdLists.at(i)->Release();
+	m_cmdLists.clear();
+
+	// Release advanced rendering objects
+	deleteVertexBuffer(m_mipmapBuf);
+	m_mipmapBuf = NULL;
+	purgeScaleCache();
+
+	// Release constant buffers
+	for(int i = 0; i < NUM_CAMERA_SETS; i++) {
+		if(m_cameraConstants[i])
+			m_cameraConstants[i]->Release();
+		m_cameraConstants[i] = NULL;
+	}
+	if(m_resizeConstants)
+		m_resizeConstants->Release();
+	m_resizeConstants = NULL;
+	if(m_rgbNv16Constants)
+		m_rgbNv16Constants->Release();
+	m_rgbNv16Constants = NULL;
+	for(int i = 0; i < NumConversionShaders; i++) {
+		if(m_convConstants[i].buffer)
+			m_convConstants[i].buffer->Release();
+		m_convConstants[i].buffer = NULL;
+		m_convConstants[i].isUploaded = false;
+	}
+	if(m_texDecalConstants)
+		m_texDecalConstants->Release();
+	m_texDecalConstants = NULL;
+
+	// Release vertex ring. Changing the generation invalidates every existing
+	// sub-allocation.
+	if(m_vertRing)
+		m_vertRing->Release();
+	m_vertRing = NULL;
+	m_vertRingPos = VERTEX_RING_BYTES;
+	m_vertRingGeneration++;
+
+	// Release shaders
+	if(m_solidVS)
+		m_solidVS->Release();
+	if(m_solidIL)
+		m_solidIL->Release();
+	if(m_texDecalVS)
+		m_texDecalVS->Release();
+	if(m_texDecalIL)
+		m_texDecalIL->Release();
+	if(m_resizeVS)
+		m_resizeVS->Release();
+	if(m_resizeIL)
+		m_resizeIL->Release();
+	if(m_unitQuadBuf)
+		m_unitQuadBuf->Release();
+	if(m_solidInstVS)
+		m_solidInstVS->Release();
+	if(m_solidInstIL)
+		m_solidInstIL->Release();
+	if(m_texDecalInstVS)
+		m_texDecalInstVS->Release();
+	if(m_texDecalInstIL)
+		m_texDecalInstIL->Release();
+	m_solidVS = NULL;
+	m_solidIL = NULL;
+	m_texDecalVS = NULL;
+	m_texDecalIL = NULL;
+	m_resizeVS = NULL;
+	m_resizeIL = NULL;
+	m_unitQuadBuf = NULL;
+	m_solidInstVS = NULL;
+	m_solidInstIL = NULL;
+	m_texDecalInstVS = NULL;
+	m_texDecalInstIL = NULL;
+	for(int i = 0; i < NumPixelShaders; i++) {
+		if(m_pixelShaders[i])
+			m_pixelShaders[i]->Release();
+		m_pixelShaders[i] = NULL;
+	}
+	memset(m_pixelShaderFailed, 0, sizeof(m_pixelShaderFailed));
+	for(int i = 0; i < NumComputeShaders; i++) {
+		if(m_computeShaders[i])
+			m_computeShaders[i]->Release();
+		m_computeShaders[i] = NULL;
+	}
+	memset(m_computeShaderFailed, 0, sizeof(m_computeShaderFailed));
+	m_hasInstancing = false;
+	m_instancedVSBound = false;
+
+	// Release render targets
+	if(m_screenTarget)
+		m_screenTarget->Release();
+	m_screenTarget = NULL;
+
+	// Release textures
+	delete m_canvas1Texture;
+	delete m_canvas2Texture;
+	delete m_scratch1Texture;
+	delete m_scratch2Texture;
+	m_canvas1Texture = NULL;
+	m_canvas2Texture = NULL;
+	m_scratch1Texture = NULL;
+	m_scratch2Texture = NULL;
+
+	// Release sampler states
+	if(m_pointClampSampler)
+		m_pointClampSampler->Release();
+	if(m_bilinearClampSampler)
+		m_bilinearClampSampler->Release();
+	if(m_resizeSampler)
+		m_resizeSampler->Release();
+	m_pointClampSampler = NULL;
+	m_bilinearClampSampler = NULL;
+	m_resizeSampler = NULL;
+
+	// Release blend states
+	if(m_noBlend)
+		m_noBlend->Release();
+	if(m_alphaBlend)
+		m_alphaBlend->Release();
+	if(m_premultiBlend)
+		m_premultiBlend->Release();
+	m_noBlend = NULL;
+	m_alphaBlend = NULL;
+	m_premultiBlend = NULL;
+
+	// Release rasterizer
+	if(m_rasterizerState)
+		m_rasterizerState->Release();
+	if(m_scissorRasterizerState)
+		m_scissorRasterizerState->Release();
+	m_rasterizerState = NULL;
+	m_scissorRasterizerState = NULL;
+
+	// Release device context, device and swap chain
+	if(m_dc)
+		m_dc->Release();
+	if(m_device)
+		m_device->Release();
+	if(m_swapChain)
+		m_swapChain->Release();
+	m_dc = NULL;
+	m_device = NULL;
+	m_swapChain = NULL;
+
+	// Nothing is bound anymore
+	invalidateStateCache();
+	m_boundScissorEnabled = false;
+	m_boundScissorRect = QRect();
+}
+
+/// <summary>
+/// Creates the device, its immediate context and the swap chain. If
+/// `adapterIndex` is the index of a DXGI adapter then the device is created on
+/// that adapter, otherwise the first adapter of the system is used.
+/// </summary>
+bool D3D11Context::initialize(
+	HWND hwnd, const QSize &size, const QColor &resizeBorderCol,
+	int adapterIndex)
+{
+	if(m_parent != NULL)
+		return false; // Deferred contexts are initialized on creation
+
+	m_hwnd = hwnd;
+	m_resizeBorderCol = resizeBorderCol;
+	m_adapterIndex = adapterIndex;
+
+	if(!createDeviceObjects(size))
+		return false;
+
+	//-------------------------------------------------------------------------
+	// Emit initialized signal
+
+	// The context is now fully initialized and other parts of the application
+	// can begin to create hardware resources. Emit a signal so they know.
+	callInitializedCallbacks();
+	emit initialized(this);
+
+	return true;
+}
+
+/// <summary>
+/// Creates the device, the swap chain, every object that is shared with
+/// deferred contexts and every object that the immediate context itself owns.
+/// </summary>
+bool D3D11Context::createDeviceObjects(const QSize &size)
+{
+	//-------------------------------------------------------------------------
+	// Create device and swap chain
+
+	// Dynamically load Direct3D 11 so that the application still runs on
+	// systems that don't have it installed
+	HMODULE d3d11Mod = LoadLibrary(TEXT("d3d11.dll"));
+	PFN_D3D11_CREATE_DEVICE_AND_SWAP_CHAIN
+		D3D11CreateDeviceAndSwapChainDyn = NULL;
+	if(d3d11Mod != NULL) {
+		D3D11CreateDeviceAndSwapChainDyn =
+			(PFN_D3D11_CREATE_DEVICE_AND_SWAP_CHAIN)
+			GetProcAddress(d3d11Mod, "D3D11CreateDeviceAndSwapChain");
+	}
+	if(D3D11CreateDeviceAndSwapChainDyn == NULL) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "DirectX 11 is not available, cannot continue.";
+		return false;
+	}
+
+	// Setup swap chain description
+	DXGI_SWAP_CHAIN_DESC swapChainDesc;
+	memset(&swapChainDesc, 0, sizeof(swapChainDesc));
+	swapChainDesc.BufferDesc.Width = size.width();
+	swapChainDesc.BufferDesc.Height = size.height();
+	swapChainDesc.BufferDesc.RefreshRate.Numerator = 0; // We're never fullscreen
+	swapChainDesc.BufferDesc.RefreshRate.Denominator = 0;
+	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	swapChainDesc.BufferDesc.ScanlineOrdering =
+		DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+	swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+	swapChainDesc.SampleDesc.Count = 1; // No anti-aliasing
+	swapChainDesc.SampleDesc.Quality = 0;
+	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	swapChainDesc.BufferCount = 2;
+	swapChainDesc.OutputWindow = m_hwnd;
+	swapChainDesc.Windowed = TRUE;
+	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+	swapChainDesc.Flags = 0;
+
+	// Use the explicitly selected adapter if there is one
+	IDXGIAdapter *explicitAdapter = getDxgi11Adapter(m_adapterIndex);
+	if(explicitAdapter == NULL)
+		m_adapterIndex = -1;
+	if(explicitAdapter != NULL) {
+		DXGI_ADAPTER_DESC desc;
+		if(SUCCEEDED(explicitAdapter->GetDesc(&desc))) {
+			gfxLog(LOG_CAT) << QStringLiteral("Using graphics adapter %1: %2")
+				.arg(m_adapterIndex)
+				.arg(QString::fromUtf16(desc.Description));
+		}
+	}
+
+	// We require a minimum of feature level 9.3 as level 9.2 isn't
+	// guarenteed to support multiple render targets. The device is not
+	// single-threaded so that deferred contexts can record on other threads.
+	const D3D_FEATURE_LEVEL featureLevels[] = {
+#if !FORCE_DIRECTX_11_LEVEL_10_0
+		D3D_FEATURE_LEVEL_11_0,
+		D3D_FEATURE_LEVEL_10_1,
+#endif // FORCE_DIRECTX_11_LEVEL_10_0
+		D3D_FEATURE_LEVEL_10_0,
+		D3D_FEATURE_LEVEL_9_3
+	};
+	const int numFeatureLevels =
+		sizeof(featureLevels) / sizeof(featureLevels[0]);
+#if FORCE_DIRECTX_11_LEVEL_10_0
+	gfxLog(LOG_CAT, GfxLog::Warning) << "Forcing DirectX 11 Level 10.0";
+#endif // FORCE_DIRECTX_11_LEVEL_10_0
+	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_9_3;
+	HRESULT res = D3D11CreateDeviceAndSwapChainDyn(
+		explicitAdapter, // _In_ IDXGIAdapter *pAdapter
+		explicitAdapter != NULL // _In_ D3D_DRIVER_TYPE DriverType
+		? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE,
+		NULL, // _In_ HMODULE Software
+		0, // _In_ UINT Flags
+		featureLevels, // _In_ const D3D_FEATURE_LEVEL *pFeatureLevels
+		numFeatureLevels, // _In_ UINT FeatureLevels
+		D3D11_SDK_VERSION, // _In_ UINT SDKVersion
+		&swapChainDesc, // _In_ const DXGI_SWAP_CHAIN_DESC *pSwapChainDesc
+		&m_swapChain, // _Out_ IDXGISwapChain **ppSwapChain
+		&m_device, // _Out_ ID3D11Device **ppDevice
+		&featureLevel, // _Out_ D3D_FEATURE_LEVEL *pFeatureLevel
+		&m_dc); // _Out_ ID3D11DeviceContext **ppImmediateContext
+	if(explicitAdapter != NULL)
+		explicitAdapter->Release();
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create DirectX 11 device and swap chain, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		m_swapChain = NULL;
+		m_device = NULL;
+		m_dc = NULL;
+		return false;
+	}
+	gfxLog(LOG_CAT) << QStringLiteral("Using DirectX 11 Level %1")
+		.arg(getFeatureLevelString(featureLevel));
+	m_hasFeatureLevel10 = (featureLevel >= D3D_FEATURE_LEVEL_10_0);
+	m_hasFeatureLevel11 = (featureLevel >= D3D_FEATURE_LEVEL_11_0);
+	m_hasNoOverwriteRing = true; // Always allowed on the immediate context
+
+	// Log whether or not the driver records command lists natively. If it
+	// doesn't the runtime emulates them which still moves command generation
+	// off the rendering thread but costs more to execute.
+	D3D11_FEATURE_DATA_THREADING threading;
+	res = m_device->CheckFeatureSupport(
+		D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+	if(SUCCEEDED(res)) {
+		gfxLog(LOG_CAT) << QStringLiteral("Driver command lists: %1")
+			.arg(threading.DriverCommandLists
+			? QStringLiteral("Supported") : QStringLiteral("Emulated"));
+	}
+
+	//-------------------------------------------------------------------------
+	// Initial state
+
+	// Create a render target for the swap chain buffer
+	m_screenTargetSize = size;
+	if(!createScreenTarget())
+		return false;
+
+	// Create rasterizer state
+	D3D11_RASTERIZER_DESC desc;
+	desc.FillMode = D3D11_FILL_SOLID;
+	desc.CullMode = D3D11_CULL_NONE; // Makes it easier to display stuff
+	desc.FrontCounterClockwise = FALSE;
+	desc.DepthBias = 0;
+	desc.DepthBiasClamp = 0.0f;
+	desc.SlopeScaledDepthBias = 0.0f;
+	desc.DepthClipEnable = TRUE; // Must be true for feature level 9 support
+	desc.ScissorEnable = FALSE;
+	desc.MultisampleEnable = FALSE;
+	desc.AntialiasedLineEnable = FALSE;
+	res = m_device->CreateRasterizerState(&desc, &m_rasterizerState);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create rasterizer state, cannot continue. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	// Identical rasterizer state for partial redraws
+	desc.ScissorEnable = TRUE;
+	res = m_device->CreateRasterizerState(&desc, &m_scissorRasterizerState);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create scissor rasterizer state, cannot continue. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	// Create sampler states
+	D3D11_SAMPLER_DESC sampDesc;
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.MipLODBias = 0.0f;
+	sampDesc.MaxAnisotropy = 0;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sampDesc.BorderColor[0] = 0.0f;
+	sampDesc.BorderColor[1] = 0.0f;
+	sampDesc.BorderColor[2] = 0.0f;
+	sampDesc.BorderColor[3] = 0.0f;
+	sampDesc.MinLOD = 0.0f;
+	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	res = m_device->CreateSamplerState(&sampDesc, &m_pointClampSampler);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create clamped point sampler state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+	res = m_device->CreateSamplerState(&sampDesc, &m_bilinearClampSampler);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create clamped bilinear sampler state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.BorderColor[0] = m_resizeBorderCol.redF();
+	sampDesc.BorderColor[1] = m_resizeBorderCol.greenF();
+	sampDesc.BorderColor[2] = m_resizeBorderCol.blueF();
+	sampDesc.BorderColor[3] = m_resizeBorderCol.alphaF();
+	res = m_device->CreateSamplerState(&sampDesc, &m_resizeSampler);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create resize layer sampler state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	// Create blend states. Every render target uses the same blending.
+	D3D11_BLEND_DESC blendDesc;
+	blendDesc.AlphaToCoverageEnable = FALSE;
+	blendDesc.IndependentBlendEnable = FALSE;
+	D3D11_RENDER_TARGET_BLEND_DESC &rtBlend = blendDesc.RenderTarget[0];
+	rtBlend.BlendEnable = FALSE;
+	rtBlend.SrcBlend = D3D11_BLEND_ONE;
+	rtBlend.DestBlend = D3D11_BLEND_ZERO;
+	rtBlend.BlendOp = D3D11_BLEND_OP_ADD;
+	rtBlend.SrcBlendAlpha = D3D11_BLEND_ONE;
+	rtBlend.DestBlendAlpha = D3D11_BLEND_ZERO;
+	rtBlend.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	rtBlend.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	for(int i = 1; i < 8; i++)
+		blendDesc.RenderTarget[i] = rtBlend;
+	res = m_device->CreateBlendState(&blendDesc, &m_noBlend);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create default blending state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	rtBlend.BlendEnable = TRUE;
+	rtBlend.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	rtBlend.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	res = m_device->CreateBlendState(&blendDesc, &m_alphaBlend);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create alpha blending state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	rtBlend.SrcBlend = D3D11_BLEND_ONE;
+	rtBlend.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	res = m_device->CreateBlendState(&blendDesc, &m_premultiBlend);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create premultiplied alpha blending state, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	gfxLog(LOG_CAT) << "Successfully initialized DirectX";
+
+	//-------------------------------------------------------------------------
+	// Create shader objects
+
+	if(!createShaders())
+		return false;
+
+	// Shaders that use `SV_InstanceID` require feature level 10.0 and are
+	// optional
+	if(m_hasFeatureLevel10) {
+		m_hasInstancing = createInstancingResources();
+		if(!m_hasInstancing) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create instancing resources, instancing disabled";
+		}
+	}
+
+	return createContextObjects();
+}
+
+/// <summary>
+/// Turns a newly constructed context into a deferred context of `parent` by
+/// creating a deferred device context and taking a reference to every object
+/// that it shares with the immediate context. Only used by
+/// `createDeferredContext()`.
+/// </summary>
+bool D3D11Context::createDeferredObjects(D3D11Context *parent)
+{
+	m_parent = parent;
+	m_hasBgraTexSupport = parent->hasBgraTexSupport();
+	m_hasBgraTexSupportValid = true;
+	m_hasFeatureLevel10 = parent->m_hasFeatureLevel10;
+	m_hasFeatureLevel11 = parent->m_hasFeatureLevel11;
+	m_adapterIndex = parent->m_adapterIndex;
+	m_hwnd = parent->m_hwnd;
+	m_resizeBorderCol = parent->m_resizeBorderCol;
+	m_scaleCacheMaxSize = parent->m_scaleCacheMaxSize;
+
+	// Deferred contexts cannot map a dynamic buffer with `NO_OVERWRITE`
+	// before the Direct3D 11.1 runtime which first shipped with Windows 8
+	m_hasNoOverwriteRing = IsWindows8OrGreater();
+
+	m_device = m_parent->m_device;
+	m_device->AddRef();
+	HRESULT res = m_device->CreateDeferredContext(0, &m_dc);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to create DirectX deferred context. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_dc = NULL;
+		return false;
+	}
+
+	// State objects, vertex shaders and input layouts are immutable and can
+	// be bound to any context of the device
+	m_rasterizerState = m_parent->m_rasterizerState;
+	m_rasterizerState->AddRef();
+	m_scissorRasterizerState = m_parent->m_scissorRasterizerState;
+	m_scissorRasterizerState->AddRef();
+	m_pointClampSampler = m_parent->m_pointClampSampler;
+	m_pointClampSampler->AddRef();
+	m_bilinearClampSampler = m_parent->m_bilinearClampSampler;
+	m_bilinearClampSampler->AddRef();
+	m_resizeSampler = m_parent->m_resizeSampler;
+	m_resizeSampler->AddRef();
+	m_noBlend = m_parent->m_noBlend;
+	m_noBlend->AddRef();
+	m_alphaBlend = m_parent->m_alphaBlend;
+	m_alphaBlend->AddRef();
+	m_premultiBlend = m_parent->m_premultiBlend;
+	m_premultiBlend->AddRef();
+	m_solidVS = m_parent->m_solidVS;
+	m_solidVS->AddRef();
+	m_solidIL = m_parent->m_solidIL;
+	m_solidIL->AddRef();
+	m_texDecalVS = m_parent->m_texDecalVS;
+	m_texDecalVS->AddRef();
+	m_texDecalIL = m_parent->m_texDecalIL;
+	m_texDecalIL->AddRef();
+	m_resizeVS = m_parent->m_resizeVS;
+	m_resizeVS->AddRef();
+	m_resizeIL = m_parent->m_resizeIL;
+	m_resizeIL->AddRef();
+	m_hasInstancing = m_parent->m_hasInstancing;
+	if(m_hasInstancing) {
+		m_unitQuadBuf = m_parent->m_unitQuadBuf;
+		m_unitQuadBuf->AddRef();
+		m_solidInstVS = m_parent->m_solidInstVS;
+		m_solidInstVS->AddRef();
+		m_solidInstIL = m_parent->m_solidInstIL;
+		m_solidInstIL->AddRef();
+		m_texDecalInstVS = m_parent->m_texDecalInstVS;
+		m_texDecalInstVS->AddRef();
+		m_texDecalInstIL = m_parent->m_texDecalInstIL;
+		m_texDecalInstIL->AddRef();
+	}
+
+	return createContextObjects();
+}
+
+/// <summary>
+/// Creates the objects that every context owns for itself as they are
+/// written to by the thread that records with the context and binds the
+/// default state.
+/// </summary>
+bool D3D11Context::createContextObjects()
+{
+	m_dc->RSSetState(m_rasterizerState);
+	setTextureFilter(GfxBilinearFilter); // Bilinear by default
+	setBlending(GfxNoBlending); // No blending by default
+
+	// If we ever need a depth stencil view or depth stencil create them here
+
+	// Bind the screen render target by default
+	setRenderTarget(GfxScreenTarget);
+
+	//-------------------------------------------------------------------------
+	// Create camera cbuffers, one for each set of camera matrices
+
+	D3D11_BUFFER_DESC bufDesc;
+	bufDesc.ByteWidth = sizeof(m_cameraConstantsLocal);
+	bufDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufDesc.MiscFlags = 0;
+	bufDesc.StructureByteStride = 0;
+	for(int i = 0; i < NUM_CAMERA_SETS; i++) {
+		// Create hardware buffer with the current matrices
+		fillCameraConstants((CameraSet)i);
+		if(!createDX11Buffer(m_device, &bufDesc, m_cameraConstantsLocal,
+			&m_cameraConstants[i])) {
+				// Failed to create buffer
+				return false;
+		}
+		m_cameraUploadedVersions[i] = m_cameraVersions[i];
+	}
+
+	//-------------------------------------------------------------------------
+	// Create resize layer cbuffer
+
+	// Upload local RAM
+	m_resizeConstantsDirty = true; // Force update
+	updateResizeConstants();
+
+	// Create hardware buffer
+	bufDesc.ByteWidth = sizeof(m_resizeConstantsLocal);
+	if(!createDX11Buffer(m_device, &bufDesc, m_resizeConstantsLocal,
+		&m_resizeConstants)) {
+			// Failed to create buffer
+			return false;
+	}
+
+	//-------------------------------------------------------------------------
+	// Create RGB->NV16 converter cbuffer
+
+	// Upload local RAM
+	m_rgbNv16ConstantsDirty = true; // Force update
+	updateRgbNv16Constants();
+
+	// Create hardware buffer
+	bufDesc.ByteWidth = sizeof(m_rgbNv16ConstantsLocal);
+	if(!createDX11Buffer(m_device, &bufDesc, m_rgbNv16ConstantsLocal,
+		&m_rgbNv16Constants)) {
+			// Failed to create buffer
+			return false;
+	}
+
+	//-------------------------------------------------------------------------
+	// Create format conversion cbuffers
+
+	// Create hardware buffers. The contents are updated immediately before use
+	// by `convertToBgrx()`, `convertFromRgb()` and `scaleToNv16()`
+	bufDesc.ByteWidth = sizeof(m_convConstants[0].local);
+	for(int i = 0; i < NumConversionShaders; i++) {
+		ConversionConstants &consts = m_convConstants[i];
+		if(!createDX11Buffer(m_device, &bufDesc, consts.local,
+			&consts.buffer)) {
+				// Failed to create buffer
+				return false;
+		}
+		consts.isUploaded = false; // Always upload on first use
+	}
+
+	//-------------------------------------------------------------------------
+	// Create texture decal cbuffer
+
+	// Upload local RAM
+	m_texDecalConstantsDirty = true; // Force update
+	updateTexDecalConstants();
+
+	// Create hardware buffer
+	bufDesc.ByteWidth = sizeof(m_texDecalConstantsLocal);
+	if(!createDX11Buffer(m_device, &bufDesc, m_texDecalConstantsLocal,
+		&m_texDecalConstants)) {
+			// Failed to create buffer
+			return false;
+	}
+
+	//-------------------------------------------------------------------------
+	// Create the vertex ring
+
+	// This is not fatal as vertex buffers fall back to individual hardware
+	// buffers if the ring doesn't exist
+	bufDesc.ByteWidth = VERTEX_RING_BYTES;
+	bufDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	if(!createDX11Buffer(m_device, &bufDesc, NULL, &m_vertRing))
+		m_vertRing = NULL;
+
+	//-------------------------------------------------------------------------
+	// Set the scratch target's initial size
+
+	m_scratchNextTarget = 0;
+	resizeScratchTarget(QSize(512, 512));
+
+	//-------------------------------------------------------------------------
+	// Create advanced rendering objects
+
+	m_mipmapBuf = createVertexBuffer(TexDecalRectBufSize);
+
+	return true;
+}
+
+/// <summary>
+/// Returns the context that owns the device, the swap chain and the canvas.
+/// </summary>
+D3D11Context *D3D11Context::getRootContext()
+{
+	if(m_parent != NULL)
+		return m_parent;
+	return this;
+}
+
+/// <summary>
+/// Returns true if the device supports compute shaders that can write to
+/// textures. This requires feature level 11.0.
+/// </summary>
+bool D3D11Context::hasComputeSupport()
+{
+	return m_hasFeatureLevel11;
+}
+
+bool D3D11Context::hasBgraTexSupport()
+{
+	if(m_hasBgraTexSupportValid)
+		return m_hasBgraTexSupport;
+	if(m_device == NULL)
+		return false;
+
+	// Test if BGRA textures are supported. Always true on Direct3D 11
+	// hardware but not necessarily on feature level 9 and 10 hardware.
+	UINT support = 0;
+	HRESULT res =
+		m_device->CheckFormatSupport(DXGI_FORMAT_B8G8R8A8_UNORM, &support);
+	if(FAILED(res))
+		support = 0; // Should never happen
+	if(support & D3D11_FORMAT_SUPPORT_TEXTURE2D) {
+		m_hasBgraTexSupport = true;
+		gfxLog(LOG_CAT) << QStringLiteral("BGRA textures: Supported");
+	} else {
+		m_hasBgraTexSupport = false;
+		gfxLog(LOG_CAT) << QStringLiteral("BGRA textures: Not supported");
+	}
+	m_hasBgraTexSupportValid = true;
+
+#if FORCE_NO_BGRA_SUPPORT
+	gfxLog(LOG_CAT, GfxLog::Critical)
+		<< QStringLiteral("Forcing no BGRA texture support");
+	m_hasBgraTexSupport = false;
+#endif // FORCE_NO_BGRA_SUPPORT
+
+	return m_hasBgraTexSupport;
+}
+
+bool D3D11Context::createScreenTarget()
+{
+	ID3D11Texture2D *backBuf;
+	HRESULT res = m_swapChain->GetBuffer(
+		0, __uuidof(backBuf), reinterpret_cast<void **>(&backBuf));
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to get the DirectX back buffer, cannot continue. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	res = m_device->CreateRenderTargetView(backBuf, NULL, &m_screenTarget);
+	if(FAILED(res)) {
+		backBuf->Release();
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create a render target for the back buffer, cannot "
+			<< "continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	backBuf->Release();
+	return true;
+}
+
+/// <summary>
+/// Creates the vertex shaders and their input layouts. There are only three
+/// of them and their input layouts are validated against the shader so they
+/// are created up front. Pixel shaders are created on first use by
+/// `getPixelShader()`.
+/// </summary>
+bool D3D11Context::createShaders()
+{
+	// Solid colour shaders
+	const D3D11_INPUT_ELEMENT_DESC solidILDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	};
+	if(!createVertexShaderAndInputLayout(
+		"solid-vs", &m_solidVS, &m_solidIL, solidILDesc, 2))
+		return false;
+
+	// Texture decal shaders. Also used by all the colour conversion shaders
+	const D3D11_INPUT_ELEMENT_DESC texDecalILDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	};
+	if(!createVertexShaderAndInputLayout(
+		"texDecal-vs", &m_texDecalVS, &m_texDecalIL, texDecalILDesc, 2))
+		return false;
+
+	// Resize layer shaders
+	const D3D11_INPUT_ELEMENT_DESC resizeILDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0}
+	};
+	if(!createVertexShaderAndInputLayout(
+		"resize-vs", &m_resizeVS, &m_resizeIL, resizeILDesc, 1))
+		return false;
+
+	return true;
+}
+
+/// <summary>
+/// Creates the unit quad and the instanced vertex shaders that are used by
+/// `drawInstanced()`. Slot 0 is the unit quad and slot 1 is the per-instance
+/// buffer where each instance is shared by 4 consecutive copies of the quad.
+/// </summary>
+bool D3D11Context::createInstancingResources()
+{
+	// Unit quad for `TriangleStripTopology`
+	float quad[8] = {
+		0.0f, 0.0f, // Top-left
+		1.0f, 0.0f, // Top-right
+		0.0f, 1.0f, // Bottom-left
+		1.0f, 1.0f }; // Bottom-right
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = sizeof(quad);
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	if(!createDX11Buffer(m_device, &desc, quad, &m_unitQuadBuf))
+		return false;
+
+	// Shader expects instance format: L, T, R, B, U1, V1, U2, V2, R, G, B, A,
+	// P1, P2, P3, P4
+	const D3D11_INPUT_ELEMENT_DESC instILDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"RECT",     0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D11_INPUT_PER_INSTANCE_DATA, 4},
+		{"UVRECT",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 4},
+		{"COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 4},
+		{"PARAMS",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 4},
+	};
+	if(!createVertexShaderAndInputLayout(
+		"solidInst-vs", &m_solidInstVS, &m_solidInstIL, instILDesc, 5))
+		return false;
+	if(!createVertexShaderAndInputLayout(
+		"texDecalInst-vs", &m_texDecalInstVS, &m_texDecalInstIL,
+		instILDesc, 5))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool D3D11Context::createVertexShaderAndInputLayout(
+	const QString &shaderName, ID3D11VertexShader **shader,
+	ID3D11InputLayout **layout, const D3D11_INPUT_ELEMENT_DESC *layoutDesc,
+	int layoutDescSize)
+{
+	QByteArray data = getShaderFileData(shaderName);
+	if(data.isEmpty()) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to read vertex shader \"" << shaderName
+			<< "\", cannot continue";
+		return false;
+	}
+
+	HRESULT res = m_device->CreateVertexShader(
+		data.data(), data.length(), NULL, shader);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to load vertex shader \"" << shaderName
+			<< "\", cannot continue. Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
+	// Shader created, create matching input layout
+	res = m_device->CreateInputLayout(
+		layoutDesc, layoutDescSize, data.data(), data.length(),
+		layout);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create input layout for \"" << shaderName
+			<< "\", cannot continue. Reason = " << getDXErrorCode(res);
+		(*shader)->Release();
+		*shader = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool D3D11Context::createPixelShader(
+	const QString &shaderName, ID3D11PixelShader **shader)
+{
+	QByteArray data = getShaderFileData(shaderName);
+	if(data.isEmpty()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to read pixel shader \"" << shaderName << "\"";
+		return false;
+	}
+
+	HRESULT res = m_device->CreatePixelShader(
+		data.data(), data.length(), NULL, shader);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to load pixel shader \"" << shaderName
+			<< "\". Reason = " << getDXErrorCode(res);
+		*shader = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Reads the entire compiled shader file into memory and returns it as a
+/// `QByteArray` buffer. The Direct3D 10 and 11 backends use the same
+/// bytecode.
+/// </summary>
+QByteArray D3D11Context::getShaderFileData(const QString &shaderName) const
+{
+	// All shader files are stored in the executable as a compressed resource
+	// so it is safe to use Qt's synchronous API to access them
+	QFile file(":/Libvidgfx/Shaders/" + shaderName + ".cso");
+	if(!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray data = file.readAll();
+	file.close();
+	return data;
+}
+
+/// <summary>
+/// Returns the file name of the specified `PixelShader` without its
+/// extension. The tex decal permutations are named after their features in
+/// a fixed order, for example "texDecalPremulGbcsSwz-ps".
+/// </summary>
+QString D3D11Context::getPixelShaderName(int ps)
+{
+	// Must be in the same order as `PixelShader`
+	static const char *FIXED_NAMES[TexDecalPS] = {
+		"solid-ps",
+		"resize-ps",
+		"rgb-nv16-ps",
+		"yv12-rgb-ps",
+		"nv12-rgb-ps",
+		"uyvy-rgb-ps",
+		"hdyc-rgb-ps",
+		"yuy2-rgb-ps",
+		"rgb-y-ps",
+		"rgb-nv12uv-ps",
+		"rgb-i420uv-ps",
+		"rgb-nv16scaled-ps",
+		"rgb-nv16scaled709-ps",
+		"dilute-ps",
+		"resampleHorz-ps",
+		"resampleVert-ps" };
+
+	if(ps < 0 || ps >= NumPixelShaders)
+		return QString();
+	if(ps < TexDecalPS)
+		return QString::fromLatin1(FIXED_NAMES[ps]);
+
+	int perm = ps - TexDecalPS;
+	QString name = QStringLiteral("texDecal");
+	if(perm & TexDecalOpaquePerm)
+		name += QStringLiteral("Rgb");
+	else if(perm & TexDecalPremultipliedPerm)
+		name += QStringLiteral("Premul");
+	if(perm & TexDecalGbcsPerm)
+		name += QStringLiteral("Gbcs");
+	else if(perm & TexDecalBcPerm)
+		name += QStringLiteral("Bc");
+	if(perm & TexDecalSrgbPerm)
+		name += QStringLiteral("Srgb");
+	if(perm & TexDecalSwizzlePerm)
+		name += QStringLiteral("Swz");
+	name += QStringLiteral("-ps");
+	return name;
+}
+
+/// <summary>
+/// Returns the specified pixel shader, creating it if this is the first time
+/// that it has been requested. Each shader is only ever loaded once, even if
+/// it fails to load, so that sessions only pay for the shaders that they
+/// actually use.
+/// </summary>
+/// <returns>NULL if the shader is unavailable</returns>
+ID3D11PixelShader *D3D11Context::getPixelShader(int ps)
+{
+	if(ps < 0 || ps >= NumPixelShaders)
+		return NULL;
+	if(m_pixelShaders[ps] != NULL)
+		return m_pixelShaders[ps];
+	if(m_pixelShaderFailed[ps])
+		return NULL; // Already failed once, don't spam the log
+
+	// Shaders that use `Load()` require feature level 10.0
+	bool needsLevel10 =
+		(ps == DilutePS || ps == ResampleHorzPS || ps == ResampleVertPS);
+	if(needsLevel10 && !m_hasFeatureLevel10) {
+		m_pixelShaderFailed[ps] = true;
+		return NULL;
+	}
+
+	if(!createPixelShader(getPixelShaderName(ps), &m_pixelShaders[ps]))
+		m_pixelShaderFailed[ps] = true;
+	return m_pixelShaders[ps];
+}
+
+/// <summary>
+/// Returns the specified compute shader, creating it if this is the first
+/// time that it has been requested. Like pixel shaders each compute shader is
+/// only ever loaded once, even if it fails to load.
+/// </summary>
+/// <returns>NULL if the shader is unavailable</returns>
+ID3D11ComputeShader *D3D11Context::getComputeShader(int cs)
+{
+	// Must be in the same order as `ComputeShader`
+	static const char *NAMES[NumComputeShaders] = {
+		"rgb-nv12-cs",
+		"rgb-i420-cs" };
+
+	if(cs < 0 || cs >= NumComputeShaders)
+		return NULL;
+	if(m_computeShaders[cs] != NULL)
+		return m_computeShaders[cs];
+	if(m_computeShaderFailed[cs])
+		return NULL; // Already failed once, don't spam the log
+	m_computeShaderFailed[cs] = true; // Cleared on success
+	if(!hasComputeSupport())
+		return NULL;
+
+	QString shaderName = QString::fromLatin1(NAMES[cs]);
+	QByteArray data = getShaderFileData(shaderName);
+	if(data.isEmpty()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to read compute shader \"" << shaderName << "\"";
+		return NULL;
+	}
+	HRESULT res = m_device->CreateComputeShader(
+		data.data(), data.length(), NULL, &m_computeShaders[cs]);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to load compute shader \"" << shaderName
+			<< "\". Reason = " << getDXErrorCode(res);
+		m_computeShaders[cs] = NULL;
+		return NULL;
+	}
+	m_computeShaderFailed[cs] = false;
+	return m_computeShaders[cs];
+}
+
+/// <summary>
+/// Returns the cheapest effects permutation that gives the same result as the
+/// full gamma, brightness, contrast and saturation shader with the current
+/// `getTexDecalEffects()`.
+/// </summary>
+int D3D11Context::getTexDecalEffectsPerm() const
+{
+	// Gamma is stored inverted but 1/1 is exact
+	const float *effects = getTexDecalEffects();
+	if(effects[0] != 1.0f || effects[3] != 1.0f)
+		return TexDecalGbcsPerm;
+	if(effects[1] != 0.0f || effects[2] != 1.0f)
+		return TexDecalBcPerm;
+	return 0; // Identity
+}
+
+/// <summary>
+/// Returns the `PixelShader` that should be used to draw with the specified
+/// shader given the current tex decal state. `GfxTexDecalGbcsShader` only pays
+/// for the effects that actually change the image and unpremultiplying is
+/// skipped when there are no colour effects to apply.
+/// </summary>
+/// <returns>-1 if the shader has no pixel shader</returns>
+int D3D11Context::getPixelShaderForShader(VidgfxShader shader) const
+{
+	int texDecalPerm = m_texDecalFlags; // Swizzle and premultiplied
+	if(m_texDecalSrgb)
+		texDecalPerm |= TexDecalSrgbPerm;
+
+	switch(shader) {
+	default:
+	case GfxNoShader:
+		return -1;
+	case GfxSolidShader:
+		return SolidPS;
+	case GfxTexDecalShader:
+		break;
+	case GfxTexDecalGbcsShader:
+		texDecalPerm |= getTexDecalEffectsPerm();
+		break;
+	case GfxTexDecalRgbShader:
+		texDecalPerm &= ~TexDecalPremultipliedPerm;
+		texDecalPerm |= TexDecalOpaquePerm;
+		break;
+	case GfxResizeLayerShader:
+		return ResizePS;
+	case GfxRgbNv16Shader:
+		return RgbNv16PS;
+	case GfxYv12RgbShader:
+		return Yv12RgbPS;
+	case GfxNv12RgbShader:
+		return Nv12RgbPS;
+	case GfxUyvyRgbShader:
+		return UyvyRgbPS;
+	case GfxHdycRgbShader:
+		return HdycRgbPS;
+	case GfxYuy2RgbShader:
+		return Yuy2RgbPS;
+	case GfxRgbYShader:
+		return RgbYPS;
+	case GfxRgbNv12UvShader:
+		return RgbNv12UvPS;
+	case GfxRgbI420UvShader:
+		return RgbI420UvPS;
+	case GfxRgbNv16ScaledShader:
+		return RgbNv16ScaledPS;
+	case GfxRgbNv16Scaled709Shader:
+		return RgbNv16Scaled709PS;
+	case GfxDiluteShader:
+		return DilutePS;
+	case GfxResampleHorzShader:
+		return ResampleHorzPS;
+	case GfxResampleVertShader:
+		return ResampleVertPS;
+	}
+
+	// Premultiplied and straight alpha are identical without colour effects
+	const int colourPerms =
+		TexDecalSrgbPerm | TexDecalBcPerm | TexDecalGbcsPerm;
+	if(!(texDecalPerm & colourPerms))
+		texDecalPerm &= ~TexDecalPremultipliedPerm;
+	return TexDecalPS + texDecalPerm;
+}
+
+/// <summary>
+/// Binds the pixel shader of the bound shader, creating it if needed. Called
+/// immediately before every draw as the tex decal permutation depends on the
+/// bound texture.
+/// </summary>
+void D3D11Context::bindPixelShader()
+{
+	int ps = getPixelShaderForShader(m_boundShader);
+	if(ps < 0)
+		return; // Shader has no pixel shader
+	if(ps == m_boundPixelShader) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_dc->PSSetShader(getPixelShader(ps), NULL, 0);
+	m_boundPixelShader = ps;
+}
+
+void D3D11Context::fillCameraConstants(CameraSet set)
+{
+	switch(set) {
+	default:
+	case ScreenCameraSet:
+		m_screenViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_screenProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	case CanvasCameraSet:
+		m_canvasViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_canvasProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	case ScratchCameraSet:
+		m_scratchViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_scratchProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	case UserCameraSet:
+		m_userViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_userProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	}
+}
+
+/// <summary>
+/// Uploads the camera matrices of the current render target if they have
+/// changed since they were last uploaded.
+/// </summary>
+/// <returns>The cbuffer of the current render target</returns>
+ID3D11Buffer *D3D11Context::updateCameraConstants()
+{
+	CameraSet set = getCameraSet(m_currentTarget);
+	ID3D11Buffer *buf = m_cameraConstants[set];
+	if(m_cameraUploadedVersions[set] == m_cameraVersions[set])
+		return buf; // Nothing to do
+
+	// Update local memory
+	fillCameraConstants(set);
+
+	// Update hardware buffer
+	if(buf) {
+		if(!updateDX11Buffer(
+			m_dc, buf, m_cameraConstantsLocal,
+			sizeof(m_cameraConstantsLocal)))
+		{
+			return buf; // Update failed
+		}
+	}
+
+	m_cameraUploadedVersions[set] = m_cameraVersions[set];
+	return buf;
+}
+
+void D3D11Context::updateResizeConstants()
+{
+	if(!m_resizeConstantsDirty)
+		return; // Nothing to do
+
+	// Update local memory
+	m_resizeConstantsLocal[0] = m_resizeRect.x();
+	m_resizeConstantsLocal[1] = m_resizeRect.y();
+	m_resizeConstantsLocal[2] = m_resizeRect.width();
+	m_resizeConstantsLocal[3] = m_resizeRect.height();
+
+	// Update hardware buffer
+	if(m_resizeConstants) {
+		if(!updateDX11Buffer(
+			m_dc, m_resizeConstants, m_resizeConstantsLocal,
+			sizeof(m_resizeConstantsLocal)))
+		{
+			return; // Update failed
+		}
+	}
+
+	m_resizeConstantsDirty = false;
+}
+
+void D3D11Context::updateRgbNv16Constants()
+{
+	if(!m_rgbNv16ConstantsDirty)
+		return; // Nothing to do
+
+	// Calculate values
+	float aOff = -1.5f * m_rgbNv16PxSize.x();
+	float bOff = -0.5f * m_rgbNv16PxSize.x();
+	float cOff =  0.5f * m_rgbNv16PxSize.x();
+	float dOff =  1.5f * m_rgbNv16PxSize.x();
+
+	// Update local memory
+	m_rgbNv16ConstantsLocal[0] = aOff;
+	m_rgbNv16ConstantsLocal[1] = bOff;
+	m_rgbNv16ConstantsLocal[2] = cOff;
+	m_rgbNv16ConstantsLocal[3] = dOff;
+
+	// Update hardware buffer
+	if(m_rgbNv16Constants) {
+		if(!updateDX11Buffer(
+			m_dc, m_rgbNv16Constants, m_rgbNv16ConstantsLocal,
+			sizeof(m_rgbNv16ConstantsLocal)))
+		{
+			return; // Update failed
+		}
+	}
+
+	m_rgbNv16ConstantsDirty = false;
+}
+
+void D3D11Context::updateTexDecalConstants()
+{
+	if(!m_texDecalConstantsDirty)
+		return; // Nothing to do
+
+	// Update local memory
+	m_texDecalConstantsLocal[0] = m_texDecalModulate.redF();
+	m_texDecalConstantsLocal[1] = m_texDecalModulate.greenF();
+	m_texDecalConstantsLocal[2] = m_texDecalModulate.blueF();
+	m_texDecalConstantsLocal[3] = m_texDecalModulate.alphaF();
+	uint *uintConstants = (uint *)m_texDecalConstantsLocal;
+	uintConstants[4] = 0; // Features are shader permutations
+	uintConstants[5] = 0;
+	uintConstants[6] = 0;
+	uintConstants[7] = 0;
+	m_texDecalConstantsLocal[8] = m_texDecalEffects[0];
+	m_texDecalConstantsLocal[9] = m_texDecalEffects[1];
+	m_texDecalConstantsLocal[10] = m_texDecalEffects[2];
+	m_texDecalConstantsLocal[11] = m_texDecalEffects[3];
+
+	// Update hardware buffer
+	if(m_texDecalConstants) {
+		if(!updateDX11Buffer(
+			m_dc, m_texDecalConstants, m_texDecalConstantsLocal,
+			sizeof(m_texDecalConstantsLocal)))
+		{
+			return; // Update failed
+		}
+	}
+
+	m_texDecalConstantsDirty = false;
+}
+
+void D3D11Context::setSwizzleInTexDecal(bool doSwizzle)
+{
+	// Selects the permutation in `bindPixelShader()`
+	if(doSwizzle)
+		m_texDecalFlags |= TexDecalSwizzlePerm;
+	else
+		m_texDecalFlags &= ~TexDecalSwizzlePerm;
+}
+
+/// <summary>
+/// Returns the index into `m_convConstants` of the specified shader or -1 if
+/// the shader is not a format conversion shader.
+/// </summary>
+static int getConversionIndex(VidgfxShader shader)
+{
+	switch(shader) {
+	default:
+		return -1;
+	case GfxYv12RgbShader:
+		return 0;
+	case GfxNv12RgbShader:
+		return 1;
+	case GfxUyvyRgbShader:
+		return 2;
+	case GfxHdycRgbShader:
+		return 3;
+	case GfxYuy2RgbShader:
+		return 4;
+	case GfxRgbYShader:
+		return 5;
+	case GfxRgbNv12UvShader:
+		return 6;
+	case GfxRgbI420UvShader:
+		return 7;
+	case GfxRgbNv16ScaledShader:
+		return 8;
+	case GfxRgbNv16Scaled709Shader:
+		return 9;
+	case GfxResampleHorzShader:
+		return 10;
+	case GfxResampleVertShader:
+		return 11;
+	}
+}
+
+/// <summary>
+/// Sets the 8 constants of the specified format conversion shader. The
+/// hardware buffer is only updated if the values differ from the previous
+/// call for the same shader.
+/// </summary>
+bool D3D11Context::updateConversionConstants(
+	VidgfxShader shader, const float *values)
+{
+	int index = getConversionIndex(shader);
+	if(index < 0)
+		return false; // Not a conversion shader
+	ConversionConstants &consts = m_convConstants[index];
+	if(consts.buffer == NULL)
+		return false;
+	if(consts.isUploaded &&
+		memcmp(consts.local, values, sizeof(consts.local)) == 0)
+	{
+		return true; // Unchanged
+	}
+
+	// Update local memory and hardware buffer
+	memcpy(consts.local, values, sizeof(consts.local));
+	consts.isUploaded = updateDX11Buffer(
+		m_dc, consts.buffer, consts.local, sizeof(consts.local));
+	return consts.isUploaded;
+}
+
+ID3D11Buffer *D3D11Context::getConversionConstants(VidgfxShader shader) const
+{
+	int index = getConversionIndex(shader);
+	if(index < 0)
+		return NULL;
+	return m_convConstants[index].buffer;
+}
+
+void D3D11Context::bindVSConstants(ID3D11Buffer *buf)
+{
+	if(m_boundVSConstants == buf && buf != NULL) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_dc->VSSetConstantBuffers(0, 1, &buf);
+	m_boundVSConstants = buf;
+}
+
+void D3D11Context::bindPSConstants(ID3D11Buffer *buf)
+{
+	if(m_boundPSConstants == buf && buf != NULL) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_dc->PSSetConstantBuffers(0, 1, &buf);
+	m_boundPSConstants = buf;
+}
+
+/// <summary>
+/// Uploads the sampling offsets used by the RGB->YUV 4:2:0 shaders. `pxSize`
+/// is the size of a single input pixel in UV coordinates.
+/// </summary>
+bool D3D11Context::updateRgbYuv420Constants(
+	VidgfxShader shader, const QPointF &pxSize)
+{
+	// Horizontal sample positions in input pixels relative to the center of
+	// the output texel. Chroma is left aligned (MPEG-2 style siting).
+	static const float yOffsets[4] = { -1.5f, -0.5f, 0.5f, 1.5f };
+	static const float nv12Offsets[4] = { -1.5f, 0.5f, 0.0f, 0.0f };
+	static const float i420Offsets[4] = { -3.5f, -1.5f, 0.5f, 2.5f };
+	const float *offsets = yOffsets;
+	if(shader == GfxRgbNv12UvShader)
+		offsets = nv12Offsets;
+	else if(shader == GfxRgbI420UvShader)
+		offsets = i420Offsets;
+	// 4 horizontal offsets + 2 vertical offsets + 2 unused
+	float values[8];
+	for(int i = 0; i < 4; i++)
+		values[i] = offsets[i] * (float)pxSize.x();
+
+	// Vertical sample positions of the two input rows that each chroma output
+	// texel covers
+	values[4] = -0.5f * (float)pxSize.y();
+	values[5] = 0.5f * (float)pxSize.y();
+	values[6] = 0.0f;
+	values[7] = 0.0f;
+
+	return updateConversionConstants(shader, values);
+}
+
+/// <summary>
+/// Renders the entire `src` texture into one or two user render targets with
+/// the specified shader. The viewport is set to the size of `targetA`.
+/// </summary>
+bool D3D11Context::drawYuvPlanes(
+	VidgfxShader shader, Texture *src, Texture *targetA, Texture *targetB)
+{
+	QSize outSize = targetA->getSize();
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)outSize.width(), (qreal)outSize.height()));
+
+	// Setup render target
+	setUserRenderTarget(targetA, targetB);
+	setUserRenderTargetViewport(outSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Update the sampling offsets
+	QPointF pxSize(1.0f / (qreal)src->getWidth(), 1.0f / (qreal)src->getHeight());
+	if(!updateRgbYuv420Constants(shader, pxSize))
+		return false;
+
+	// Render the plane(s)
+	setShader(shader);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTexture(src);
+	setTextureFilter(GfxPointFilter);
+	drawBuffer(m_mipmapBuf);
+
+	return true;
+}
+
+/// <summary>
+/// Writes every plane of a YUV 4:2:0 pixel format from the entire `src`
+/// texture with a single dispatch of the compute shader `cs`. `planeA` is the
+/// luminance plane and `planeB` and `planeC` are the chroma planes in the
+/// order that the shader expects. Each thread covers one texel of `planeB`.
+/// </summary>
+/// <returns>False if nothing was dispatched as the device or the planes
+/// don't support compute shaders</returns>
+bool D3D11Context::dispatchYuvPlanes(
+	int cs, Texture *src, Texture *planeA, Texture *planeB, Texture *planeC)
+{
+	if(!hasComputeSupport())
+		return false;
+	int numPlanes = (planeC != NULL) ? 3 : 2;
+	Texture *planes[3] = { planeA, planeB, planeC };
+	ID3D11UnorderedAccessView *uavs[3] = { NULL, NULL, NULL };
+	for(int i = 0; i < numPlanes; i++) {
+		uavs[i] =
+			static_cast<D3D11Texture *>(planes[i])->getUnorderedAccessView();
+		if(uavs[i] == NULL)
+			return false; // Not created with an unordered access view
+	}
+	ID3D11ShaderResourceView *srcView =
+		static_cast<D3D11Texture *>(src)->getResourceView();
+	if(srcView == NULL)
+		return false;
+	ID3D11ComputeShader *shader = getComputeShader(cs);
+	if(shader == NULL)
+		return false;
+
+	// A resource cannot be bound for reading and writing at the same time so
+	// unbind the render targets in case `src` is one of them
+	ID3D11RenderTargetView *nullTarget[2] = { NULL, NULL };
+	m_dc->OMSetRenderTargets(2, nullTarget, NULL);
+	m_boundTargetViews[0] = NULL;
+	m_boundTargetViews[1] = NULL;
+
+	// Dispatch one thread for each chroma texel
+	QSize uvSize = planeB->getSize();
+	m_dc->CSSetShader(shader, NULL, 0);
+	m_dc->CSSetShaderResources(0, 1, &srcView);
+	m_dc->CSSetUnorderedAccessViews(0, numPlanes, uavs, NULL);
+	m_dc->Dispatch(
+		(uvSize.width() + YUV_CS_GROUP_SIZE - 1) / YUV_CS_GROUP_SIZE,
+		(uvSize.height() + YUV_CS_GROUP_SIZE - 1) / YUV_CS_GROUP_SIZE, 1);
+
+	// Unbind everything so that the planes can be read back and `src` can be
+	// rendered to again
+	ID3D11ShaderResourceView *nullView = NULL;
+	ID3D11UnorderedAccessView *nullUavs[3] = { NULL, NULL, NULL };
+	m_dc->CSSetShaderResources(0, 1, &nullView);
+	m_dc->CSSetUnorderedAccessViews(0, numPlanes, nullUavs, NULL);
+	m_dc->CSSetShader(NULL, NULL, 0);
+
+	// Binding the planes as unordered access views unbinds them from the
+	// pixel shader stage
+	m_numBoundResourceViews = -1;
+	setRenderTarget(m_currentTarget);
+
+	for(int i = 0; i < numPlanes; i++)
+		planes[i]->markModified();
+	return true;
+}
+
+/// <summary>
+/// Marks the textures that are bound to the current render target as
+/// modified so that any cached data derived from them is invalidated.
+/// </summary>
+void D3D11Context::markCurrentTargetModified()
+{
+	if(m_currentTarget == GfxUserTarget) {
+		if(m_userTargets[0] != NULL)
+
+		tex->markModified();
+}
+
+/// <summary>
+/// Returns the index of the scale cache entry that matches the specified
+/// `prepareTexture()` parameters or -1 if there is no such entry.
+/// </summary>
+int D3D11Context::findScaleCacheEntry(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter) const
+{
+	for(int i = 0; i < m_scaleCache.size(); i++) {
+		const ScaleCacheEntry &entry = m_scaleCache.at(i);
+		if(entry.src == tex && entry.cropRect == cropRect &&
+			entry.size == size && entry.filter == filter)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+/// Adds an empty scale cache entry for the specified `prepareTexture()`
+/// parameters, evicting the least recently used entry if the cache is full.
+/// </summary>
+/// <returns>The index of the new entry</returns>
+int D3D11Context::addScaleCacheEntry(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter)
+{
+	evictScaleCacheEntries(m_scaleCacheMaxSize - 1);
+	ScaleCacheEntry entry;
+	entry.src = tex;
+	entry.srcGeneration = tex->getGeneration();
+	entry.cropRect = cropRect;
+	entry.size = size;
+	entry.filter = filter;
+	entry.tex = NULL;
+	entry.lastUsed = ++m_scaleCacheUseCounter;
+	m_scaleCache.append(entry);
+	return m_scaleCache.size() - 1;
+}
+
+/// <summary>
+/// Removes all scale cache entries that were created from the texture `src`.
+/// Must be called before the texture is deleted.
+/// </summary>
+void D3D11Context::removeScaleCacheEntries(Texture *src)
+{
+	if(src == NULL)
+		return;
+	for(int i = 0; i < m_scaleCache.size(); i++) {
+		if(m_scaleCache.at(i).src != src)
+			continue;
+		deleteTexture(m_scaleCache.at(i).tex);
+		m_scaleCache.remove(i);
+		i--;
+	}
+}
+
+/// <summary>
+/// Removes the least recently used scale cache entries until there are at
+/// most `maxEntries` remaining.
+/// </summary>
+void D3D11Context::evictScaleCacheEntries(int maxEntries)
+{
+	maxEntries = qMax(0, maxEntries);
+	while(m_scaleCache.size() > maxEntries) {
+		int oldest = 0;
+		for(int i = 1; i < m_scaleCache.size(); i++) {
+			// Unsigned subtraction handles counter wrap around
+			quint32 age = m_scaleCacheUseCounter - m_scaleCache.at(i).lastUsed;
+			quint32 oldestAge =
+				m_scaleCacheUseCounter - m_scaleCache.at(oldest).lastUsed;
+			if(age > oldestAge)
+				oldest = i;
+		}
+		deleteTexture(m_scaleCache.at(oldest).tex);
+		m_scaleCache.remove(oldest);
+	}
+}
+
+/// <summary>
+/// Catmull-Rom cubic, the standard "bicubic" filter. Has a radius of 2.
+/// </summary>
+static double cubicKernel(double x)
+{
+	x = fabs(x);
+	if(x < 1.0)
+		return (1.5 * x - 2.5) * x * x + 1.0;
+	if(x < 2.0)
+		return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+	return 0.0;
+}
+
+/// <summary>
+/// Three lobe Lanczos windowed sinc. Has a radius of 3.
+/// </summary>
+static double lanczosKernel(double x)
+{
+	x = fabs(x);
+	if(x < 1e-8)
+		return 1.0;
+	if(x >= 3.0)
+		return 0.0;
+	double px = M_PI * x;
+	return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+/// <summary>
+/// Returns the filter weights that scale `srcLen` pixels to `dstLen` pixels
+/// along one axis, creating them if they are not in the cache. The weight
+/// texture is `dstLen` texels wide. Row 0 contains the index of the first
+/// input pixel of each output pixel relative to the start of the input and
+/// each following row contains the normalized weights of 4 consecutive taps.
+/// When downscaling the kernel is stretched to cover the footprint of the
+/// output pixel so that every input pixel contributes.
+/// </summary>
+/// <returns>NULL if the weight texture could not be created</returns>
+const D3D11Context::ResampleWeights *D3D11Context::getResampleWeights(
+	VidgfxFilter filter, int srcLen, int dstLen)
+{
+	for(int i = 0; i < m_resampleWeights.size(); i++) {
+		const ResampleWeights &weights = m_resampleWeights.at(i);
+		if(weights.filter == filter && weights.srcLen == srcLen &&
+			weights.dstLen == dstLen)
+		{
+			// Move to the front so that it's evicted last
+			if(i > 0)
+				m_resampleWeights.prepend(m_resampleWeights.takeAt(i));
+			return &m_resampleWeights.first();
+		}
+	}
+
+	// Determine the kernel size
+	double radius = (filter == GfxLanczosFilter) ? 3.0 : 2.0;
+	double ratio = (double)srcLen / (double)dstLen;
+	double scale = qMin(qMax(1.0, ratio),
+		(double)(MAX_RESAMPLE_TAPS - 1) / (2.0 * radius));
+	double support = radius * scale;
+	int numTaps = (int)floor(2.0 * support) + 1;
+	numTaps = (numTaps + 3) & ~3; // Round up to a multiple of 4
+
+	// Calculate the weights of every output pixel
+	const int rows = 1 + numTaps / 4;
+	QVector<float> data(dstLen * rows * 4, 0.0f);
+	for(int x = 0; x < dstLen; x++) {
+		double center = ((double)x + 0.5) * ratio;
+		int first = (int)ceil(center - support - 0.5);
+		data[x * 4] = (float)first;
+
+		double total = 0.0;
+		double tapWeights[MAX_RESAMPLE_TAPS];
+		for(int i = 0; i < numTaps; i++) {
+			double dist = ((double)(first + i) + 0.5 - center) / scale;
+			tapWeights[i] = (filter == GfxLanczosFilter)
+				? lanczosKernel(dist) : cubicKernel(dist);
+			total += tapWeights[i];
+		}
+		if(total == 0.0)
+			total = 1.0;
+		for(int i = 0; i < numTaps; i++) {
+			int row = 1 + i / 4;
+			data[(row * dstLen + x) * 4 + (i % 4)] =
+				(float)(tapWeights[i] / total);
+		}
+	}
+
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), 0, QSize(dstLen, rows), DXGI_FORMAT_R32G32B32A32_FLOAT,
+		data.data(), dstLen * 4 * sizeof(float));
+	if(!tex->isValid()) {
+		delete tex;
+		return NULL;
+	}
+
+	// Add to the cache, evicting the least recently used weights
+	while(m_resampleWeights.size() >= MAX_RESAMPLE_WEIGHTS) {
+		deleteTexture(m_resampleWeights.last().tex);
+		m_resampleWeights.removeLast();
+	}
+	ResampleWeights weights;
+	weights.filter = filter;
+	weights.srcLen = srcLen;
+	weights.dstLen = dstLen;
+	weights.numTaps = numTaps;
+	weights.tex = tex;
+	m_resampleWeights.prepend(weights);
+	return &m_resampleWeights.first();
+}
+
+/// <summary>
+/// Scales `cropRect` of `tex` to exactly `size` using `GfxBicubicFilter` or
+/// `GfxLanczosFilter` as a horizontal pass followed by a vertical pass. Only
+/// the rows that the vertical pass samples are processed by the horizontal
+/// pass. The result is on a scratch target and the caller must restore the
+/// render target.
+/// </summary>
+/// <returns>NULL if resampling is unsupported by the device</returns>
+Texture *D3D11Context::resampleTexture(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter)
+{
+	if(getPixelShader(ResampleHorzPS) == NULL ||
+		getPixelShader(ResampleVertPS) == NULL)
+	{
+		return NULL; // Requires feature level 10.0
+	}
+	if(cropRect.isEmpty() || size.isEmpty())
+		return NULL;
+	const QSize &texSize = tex->getSize();
+
+	// Parts of the crop rectangle that are outside of the texture are clamped
+	// to the edge pixels by the shaders
+	const QRect &srcRect = cropRect;
+
+	// The vertical weights are needed first to determine the rows that the
+	// horizontal pass must output. Copy the entries as the cache may evict.
+	const ResampleWeights *weightsPtr =
+		getResampleWeights(filter, srcRect.height(), size.height());
+	if(weightsPtr == NULL)
+		return NULL;
+	ResampleWeights vertWeights = *weightsPtr;
+	weightsPtr = getResampleWeights(filter, srcRect.width(), size.width());
+	if(weightsPtr == NULL)
+		return NULL;
+	ResampleWeights horzWeights = *weightsPtr;
+
+	// Rows of the input that the vertical pass can sample
+	int margin = vertWeights.numTaps / 2 + 1;
+	int horzTop = qMax(0, srcRect.top() - margin);
+	int horzBottom = qMin(texSize.height(), srcRect.bottom() + 1 + margin);
+	if(horzBottom <= horzTop)
+		return NULL; // Crop rectangle is completely out of bounds
+	QSize horzSize(size.width(), horzBottom - horzTop);
+
+	// Make sure that the scratch targets are large enough for both passes
+	// before rendering so that they are not recreated in between
+	resizeScratchTarget(QSize(
+		size.width(), qMax(size.height(), horzSize.height())));
+
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTextureFilter(GfxPointFilter); // Shaders fetch exact texels
+
+	// Horizontal pass
+	resizeScratchTarget(horzSize);
+	VidgfxRendTarget horzTarget = getNextScratchTarget();
+	setRenderTarget(horzTarget);
+	mat.ortho(
+		0.0f, horzSize.width(), horzSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+	float horzConsts[8] = {
+		(float)horzWeights.numTaps, (float)srcRect.left(), (float)horzTop,
+		static_cast<D3D11Texture *>(tex)->doBgraSwizzle() ? 1.0f : 0.0f,
+		(float)(texSize.width() - 1), (float)(texSize.height() - 1),
+		0.0f, 0.0f };
+	updateConversionConstants(GfxResampleHorzShader, horzConsts);
+	createTexDecalRect(m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)horzSize.width(), (qreal)horzSize.height()));
+	setShader(GfxResampleHorzShader);
+	setTexture(tex, horzWeights.tex);
+	drawBuffer(m_mipmapBuf);
+	Texture *horzTex = getTargetTexture(horzTarget);
+
+	// Vertical pass
+	resizeScratchTarget(size);
+	VidgfxRendTarget vertTarget = getNextScratchTarget();
+	setRenderTarget(vertTarget);
+	mat.setToIdentity();
+	mat.ortho(0.0f, size.width(), size.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+	float vertConsts[8] = {
+		(float)vertWeights.numTaps, (float)(srcRect.top() - horzTop), 0.0f,
+		0.0f, (float)(horzSize.width() - 1), (float)(horzSize.height() - 1),
+		0.0f, 0.0f };
+	updateConversionConstants(GfxResampleVertShader, vertConsts);
+	createTexDecalRect(m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)size.width(), (qreal)size.height()));
+	setShader(GfxResampleVertShader);
+	setTexture(horzTex, vertWeights.tex);
+	drawBuffer(m_mipmapBuf);
+
+	return getTargetTexture(vertTarget);
+}
+
+//=============================================================================
+// D3DContext public interface
+
+
+//=============================================================================
+// D3D11Context deferred contexts
+
+/// <summary>
+/// Creates a context that records into a deferred device context of this
+/// context's device. Deferred contexts have their own render state, constant
+/// buffers, vertex ring and scratch targets so that they can record on another
+/// thread while this context keeps rendering. They render to the canvas and
+/// create textures on behalf of the immediate context but cannot present,
+/// resize the screen or canvas or read back data. Commands are only sent to
+/// the GPU once `finishCommands()` has been called on the deferred context and
+/// the result has been passed to `executeDeferredContext()`.
+/// </summary>
+/// <returns>NULL on failure</returns>
+D3D11Context *D3D11Context::createDeferredContext()
+{
+	if(m_parent != NULL)
+		return m_parent->createDeferredContext(); // Only one level deep
+	if(!isValid())
+		return NULL; // DirectX must be initialized
+
+	D3D11Context *context = new D3D11Context();
+	if(!context->createDeferredObjects(this)) {
+		delete context;
+		return NULL;
+	}
+	return context;
+}
+
+void D3D11Context::deleteDeferredContext(D3D11Context *context)
+{
+	if(context == NULL || context->m_parent == NULL)
+		return; // Not a deferred context
+	delete context;
+}
+
+/// <summary>
+/// Closes the commands that have been recorded since the previous call into a
+/// command list that `executeDeferredContext()` will execute. Recording can
+/// continue immediately with the same render state as before. Only valid on
+/// deferred contexts.
+/// </summary>
+bool D3D11Context::finishCommands()
+{
+	if(m_parent == NULL || m_dc == NULL)
+		return false; // Not a deferred context
+
+	ID3D11CommandList *list = NULL;
+	HRESULT res = m_dc->FinishCommandList(FALSE, &list);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to finish DirectX command list. "
+			<< "Reason = " << getDXErrorCode(res);
+		checkDeviceRemoved(res);
+		return false;
+	}
+	m_cmdLists.append(list);
+
+	// Finishing a command list resets the deferred context to its default
+	// state and makes the contents of every dynamic resource that it mapped
+	// undefined
+	markDynamicDataStale();
+	restoreDeviceState();
+
+	return true;
+}
+
+/// <summary>
+/// Executes every command list that `context` has finished since the previous
+/// call. Must not be called while another thread is recording with `context`
+/// as the list of finished command lists is not synchronized.
+/// </summary>
+void D3D11Context::executeDeferredContext(D3D11Context *context)
+{
+	if(context == NULL || context->m_parent != this || m_dc == NULL)
+		return; // Not one of our deferred contexts
+	if(context->m_cmdLists.isEmpty())
+		return; // Nothing to do
+
+	for(int i = 0; i < context->m_cmdLists.size(); i++) {
+		ID3D11CommandList *list = context->m_cmdLists.at(i);
+		m_dc->ExecuteCommandList(list, FALSE);
+		list->Release();
+	}
+	context->m_cmdLists.clear();
+
+	// `ExecuteCommandList()` resets the immediate context to its default state
+	restoreDeviceState();
+}
+
+/// <summary>
+/// Forces the next draw to upload every cbuffer and vertex buffer again. Used
+/// after a command list has been closed as the data that was mapped while
+/// recording it doesn't carry over to the next command list.
+/// </summary>
+void D3D11Context::markDynamicDataStale()
+{
+	for(int i = 0; i < NUM_CAMERA_SETS; i++)
+		m_cameraUploadedVersions[i] = m_cameraVersions[i] - 1;
+	for(int i = 0; i < NumConversionShaders; i++)
+		m_convConstants[i].isUploaded = false;
+	m_resizeConstantsDirty = true;
+	m_rgbNv16ConstantsDirty = true;
+	m_texDecalConstantsDirty = true;
+
+	// The next ring append discards
+	m_vertRingPos = VERTEX_RING_BYTES;
+	m_vertRingGeneration++;
+
+	// Vertex buffers that are not in the ring compare against this counter
+	m_cmdListCounter = nextCmdListCounter();
+}
+
+/// <summary>
+/// Binds our render state to the device context again after it has been reset
+/// to its default state by `FinishCommandList()` or `ExecuteCommandList()`.
+/// </summary>
+void D3D11Context::restoreDeviceState()
+{
+	VidgfxShader shader = m_boundShader;
+	int topology = m_boundTopology;
+	ID3D11BlendState *blendState = m_boundBlendState;
+	ID3D11SamplerState *sampler = m_boundSampler;
+
+	invalidateStateCache();
+	m_boundScissorEnabled = false;
+	m_boundScissorRect = QRect();
+	m_dc->RSSetState(m_rasterizerState);
+
+	if(blendState != NULL) {
+		m_dc->OMSetBlendState(blendState, NULL, 0xFFFFFFFF);
+		m_boundBlendState = blendState;
+	}
+	if(sampler != NULL) {
+		m_dc->PSSetSamplers(0, 1, &sampler);
+		m_boundSampler = sampler;
+	}
+	if(topology >= 0)
+		setTopology((VidgfxTopology)topology);
+	if(shader != GfxNoShader)
+		setShader(shader);
+	setRenderTarget(m_currentTarget);
+}
+
+//=============================================================================
+// D3D11Context public interface
+
+bool D3D11Context::isValid() const
+{
+	// Deferred contexts don't have a swap chain and share their device's lost
+	// state with the immediate context
+	if(m_parent != NULL)
+		return m_dc != NULL && m_parent->isValid();
+	return m_swapChain != NULL && m_device != NULL && m_dc != NULL &&
+		!m_isDeviceLost;
+}
+
+/// <summary>
+/// Flushes the graphic context's command buffer. Calling this method should be
+/// avoided whenever possible as it has a significant overhead. The context
+/// will automatically flush when required. Does nothing on deferred contexts
+/// as they never submit work to the GPU themselves.
+/// </summary>
+void D3D11Context::flush()
+{
+	if(m_dc == NULL || m_parent != NULL)
+		return;
+	m_dc->Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Buffers
+
+VertexBuffer *D3D11Context::createVertexBuffer(int numFloats)
+{
+	if(!isValid())
+		return NULL; // DirectX must be initialized
+	if(numFloats <= 0)
+		return NULL; // Invalid size
+
+	D3D11VertexBuffer *buf = new D3D11VertexBuffer(this, numFloats);
+	return buf;
+}
+
+void D3D11Context::deleteVertexBuffer(VertexBuffer *buf)
+{
+	if(buf == NULL)
+		return;
+	delete static_cast<D3D11VertexBuffer *>(buf);
+}
+
+/// <summary>
+/// Creates a static texture based off the provided QImage. If `writable` is
+/// true then the texture data can be rewritten at any time. If `targetable` is
+/// true then the texture can be used as a render target.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3D11Context::createTexture(QImage img, bool writable, bool targetable)
+{
+	if(img.isNull())
+		return NULL;
+
+	// Determine format
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	switch(img.format()) {
+	default:
+	case QImage::Format_Invalid:
+		gfxLog(LOG_CAT) << "Invalid image format for texture";
+		return NULL;
+	case QImage::Format_ARGB6666_Premultiplied:
+	case QImage::Format_ARGB32_Premultiplied:
+	case QImage::Format_ARGB8565_Premultiplied:
+	case QImage::Format_ARGB8555_Premultiplied:
+	case QImage::Format_ARGB4444_Premultiplied:
+	case QImage::Format_Mono:
+	case QImage::Format_MonoLSB:
+	case QImage::Format_Indexed8:
+	case QImage::Format_RGB666:
+	case QImage::Format_RGB16: // PF_B5G6R5 results in black textures
+		gfxLog(LOG_CAT)
+			<< "Unoptimal image format for texture, converting to BGRA";
+		img = img.convertToFormat(QImage::Format_ARGB32);
+		// Fall though
+	case QImage::Format_RGB32: // Qt sets the alpha to 0xFF
+	case QImage::Format_ARGB32:
+		format = DXGI_FORMAT_B8G8R8A8_UNORM;
+		break;
+	case QImage::Format_RGB888:
+		format = DXGI_FORMAT_B8G8R8X8_UNORM; // TODO: Correct format?
+		break;
+	case QImage::Format_RGB555:
+		format = DXGI_FORMAT_B5G5R5A1_UNORM;
+		break;
+	case QImage::Format_RGB444:
+		format = DXGI_FORMAT_B4G4R4A4_UNORM;
+		break;
+	}
+
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), flags, img.size(), format, img.bits());
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a rewritable texture buffer of the specified size. `writable` means
+/// writable by the CPU and `targetable` means the texture can be bound to a
+/// render target. It is possible to have a texture that is not writable or
+/// targetable if you're only populating it using `copyTextureData()`. Textures
+/// are in the `RGBA` format unless `useBgra` is true in which case the texture
+/// is in the `BGRA` format.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3D11Context::createTexture(
+	const QSize &size, bool writable, bool targetable, bool useBgra)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	if(useBgra)
+		format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	D3D11Texture *tex =
+		new D3D11Texture(getRootContext(), flags, size, format);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a rewritable texture buffer of the specified size. `writable` means
+/// writable by the CPU and `targetable` means the texture can be bound to a
+/// render target. It is possible to have a texture that is not writable or
+/// targetable if you're only populating it using `copyTextureData()`. The
+/// created texture will have the same pixel format as the texture `sameFormat`
+/// so that it's safe to copy pixel data between the two textures with
+/// `copyTextureData()`.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3D11Context::createTexture(
+	const QSize &size, Texture *sameFormat, bool writable, bool targetable)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(sameFormat == NULL)
+		return NULL;
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	D3D11Texture *fmtTex = static_cast<D3D11Texture *>(sameFormat);
+	DXGI_FORMAT format = fmtTex->getPixelFormat();
+	D3D11Texture *tex =
+		new D3D11Texture(getRootContext(), flags, size, format);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a special texture buffer that cannot be bound with `setTexture()`
+/// but can be used to read back pixel data from the graphics hardware.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3D11Context::createStagingTexture(const QSize &size)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), GfxStagingFlag, size, DXGI_FORMAT_R8G8B8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a texture buffer of the specified size that has only two 8-bit
+/// components per pixel (`R8G8`). This is designed for uploading interleaved
+/// chroma planes such as the UV plane of NV12 without repacking on the CPU.
+/// `writable` and `targetable` have the same meaning as `createTexture()`.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3D11Context::createRgTexture(
+	const QSize &size, bool writable, bool targetable)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), flags, size, DXGI_FORMAT_R8G8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Sets the maximum number of downscaled textures that `prepareTexture()`
+/// keeps alive between calls. Setting this to zero disables the cache.
+/// </summary>
+void D3D11Context::setScaleCacheSize(int maxEntries)
+{
+	m_scaleCacheMaxSize = qMax(0, maxEntries);
+	evictScaleCacheEntries(m_scaleCacheMaxSize);
+}
+
+int D3D11Context::getScaleCacheSize() const
+{
+	return m_scaleCacheMaxSize;
+}
+
+/// <summary>
+/// Releases all textures that are used by the `prepareTexture()` cache.
+/// </summary>
+void D3D11Context::purgeScaleCache()
+{
+	evictScaleCacheEntries(0);
+	for(int i = 0; i < m_resampleWeights.size(); i++)
+		deleteTexture(m_resampleWeights.at(i).tex);
+	m_resampleWeights.clear();
+}
+
+// This method is not a part of the GraphicsContext interface but it placed
+// here as it's related to texture creation.
+Texture *D3D11Context::createGDITexture(const QSize &size)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(!hasBgraTexSupport())
+		return NULL; // GDI compatible textures are always BGRA
+
+	// GDI-compatible textures _MUST_ be in BGRA format and be targetable
+	// otherwise we will receive E_INVALIDARG errors
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), GfxTargetableFlag | GfxGDIFlag, size,
+		DXGI_FORMAT_B8G8R8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a BGRA render target that other devices, including D3D10 devices
+/// and hardware encoders, can open without copying by passing
+/// `D3D11Texture::getSharedHandle()` to their `OpenSharedResource()`. If
+/// `useKeyedMutex` is true then both sides must surround their use of the
+/// texture with `AcquireSync()` and `ReleaseSync()`, see
+/// `D3D11Texture::acquireSync()`.
+/// </summary>
+Texture *D3D11Context::createSharedTexture(
+	const QSize &size, bool useKeyedMutex)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(!hasBgraTexSupport())
+		return NULL; // Only BGRA textures can be shared between devices
+
+	D3D11Texture *tex = new D3D11Texture(
+		getRootContext(), GfxTargetableFlag |
+		(useKeyedMutex ? GfxKeyedMutexFlag : GfxSharedFlag), size,
+		DXGI_FORMAT_B8G8R8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+// This method is not a part of the GraphicsContext interface but it placed
+// here as it's related to texture creation. If the producer created the
+// resource with `D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX` then the returned
+// texture can be sampled directly between `D3D11Texture::acquireSync()` and
+// `D3D11Texture::releaseSync()` calls instead of copying it every frame.
+Texture *D3D11Context::openSharedTexture(HANDLE sharedHandle)
+{
+	if(sharedHandle == NULL)
+		return NULL; // Invalid handle
+	if(m_device == NULL)
+		return NULL; // DirectX must be initialized
+
+	// Open shared resource as a texture
+	ID3D11Texture2D *d3dTex = NULL;
+	HRESULT res = m_device->OpenSharedResource(
+		sharedHandle, __uuidof(ID3D11Texture2D), (void **)(&d3dTex));
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to open DirectX shared resource. "
+			<< "Reason = " << getDXErrorCode(res);
+		return NULL;
+	}
+
+	D3D11Texture *tex = new D3D11Texture(getRootContext(), d3dTex);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Wraps a texture that was created on our device outside of libvidgfx, for
+/// example by a capture API that renders with our `getDevice()`. The returned
+/// texture takes its own reference to `d3dTex`.
+/// </summary>
+Texture *D3D11Context::openDX11Texture(ID3D11Texture2D *d3dTex)
+{
+	if(d3dTex == NULL)
+		return NULL; // Invalid handle
+
+	// Textures of other devices must be shared with `openSharedTexture()`
+	ID3D11Device *texDevice = NULL;
+	d3dTex->GetDevice(&texDevice);
+	if(texDevice != m_device) {
+		if(texDevice != NULL)
+			texDevice->Release();
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot open a DirectX 11 texture of another device";
+		return NULL;
+	}
+	texDevice->Release();
+
+	d3dTex->AddRef();
+	D3D11Texture *tex = new D3D11Texture(getRootContext(), d3dTex);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+void D3D11Context::deleteTexture(Texture *tex)
+{
+	if(tex == NULL)
+		return;
+	removeScaleCacheEntries(tex);
+	delete static_cast<D3D11Texture *>(tex);
+}
+
+/// <summary>
+/// Forgets our copy of the device state so that the next call to each of the
+/// state setting methods is always sent to the device. Must be called if the
+/// device state is modified outside of `D3D11Context` (E.g. by a renderer that
+/// shares our device) or when a bound object is released.
+/// </summary>
+void D3D11Context::invalidateStateCache()
+{
+	m_boundTargetViews[0] = NULL;
+	m_boundTargetViews[1] = NULL;
+	m_boundViewport = QRect();
+	m_boundTopology = -1;
+	m_boundBlendState = NULL;
+	m_numBoundResourceViews = -1;
+	m_boundSampler = NULL;
+	m_boundVSConstants = NULL;
+	m_boundPSConstants = NULL;
+	m_boundShader = GfxNoShader;
+	m_boundPixelShader = -1;
+	m_instancedVSBound = false;
+}
+
+/// <summary>
+/// Updates and binds the camera constants of the current target and the pixel
+/// shader constants of the bound shader. Buffers are only uploaded when their
+/// contents have changed and only rebound when they differ from what is
+/// already bound.
+/// </summary>
+void D3D11Context::bindDrawConstants()
+{
+	bindPixelShader();
+	bindVSConstants(updateCameraConstants());
+
+	// Update and bind our pixel shader constants if needed
+	if(m_boundShader == GfxResizeLayerShader) {
+		updateResizeConstants();
+		bindPSConstants(m_resizeConstants);
+	} else if(m_boundShader == GfxRgbNv16Shader) {
+		updateRgbNv16Constants();
+		bindPSConstants(m_rgbNv16Constants);
+	} else if(m_boundShader == GfxTexDecalShader ||
+		m_boundShader == GfxTexDecalGbcsShader ||
+		m_boundShader == GfxTexDecalRgbShader)
+	{
+		updateTexDecalConstants();
+		bindPSConstants(m_texDecalConstants);
+	} else {
+		// Format conversion shaders are updated by `convertToBgrx()`,
+		// `convertFromRgb()` or `scaleToNv16()`
+		ID3D11Buffer *buf = getConversionConstants(m_boundShader);
+		if(buf != NULL)
+			bindPSConstants(buf);
+	}
+}
+
+/// <summary>
+/// Binds the instanced vertex shader that matches the input of the bound
+/// shader's pixel shader. The pixel shader is left unchanged.
+/// </summary>
+/// <returns>False if the bound shader has no instanced vertex shader</returns>
+bool D3D11Context::bindInstancedShader()
+{
+	if(m_instancedVSBound)
+		return true; // Already bound
+
+	switch(m_boundShader) {
+	case GfxNoShader:
+	case GfxResizeLayerShader:
+		return false;
+	case GfxSolidShader:
+		m_dc->IASetInputLayout(m_solidInstIL);
+		m_dc->VSSetShader(m_solidInstVS, NULL, 0);
+		break;
+	default: // All other shaders share `texDecalVS`
+		m_dc->IASetInputLayout(m_texDecalInstIL);
+		m_dc->VSSetShader(m_texDecalInstVS, NULL, 0);
+		break;
+	}
+	m_instancedVSBound = true;
+	return true;
+}
+
+/// <summary>
+/// Appends `numBytes` of vertex data to the context's vertex ring. The ring is
+/// mapped with `D3D11_MAP_WRITE_NO_OVERWRITE` so that the driver doesn't need
+/// to rename it for every small buffer and is only discarded when it wraps
+/// which invalidates every previous allocation by incrementing
+/// `getVertexRingGeneration()`. Deferred contexts on runtimes older than
+/// Direct3D 11.1 can only discard so every append starts a new ring.
+/// </summary>
+/// <returns>True if the data was uploaded at byte offset `offsetOut`</returns>
+bool D3D11Context::appendToVertexRing(
+	const void *data, int numBytes, int &offsetOut)
+{
+	if(m_vertRing == NULL || data == NULL)
+		return false;
+	if(numBytes <= 0 || numBytes > VERTEX_RING_BYTES)
+		return false;
+
+	// Data previously written to the ring may still be in use by the GPU so
+	// we can only write after it until we run out of space
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if(m_vertRingPos + numBytes > VERTEX_RING_BYTES || !m_hasNoOverwriteRing) {
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_vertRingPos = 0;
+		m_vertRingGeneration++;
+	}
+
+	// Map buffer to CPU RAM
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT res = m_dc->Map(m_vertRing, 0, mapType, 0, &mapped);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to map DirectX vertex ring into RAM. "
+			<< "Reason = " << getDXErrorCode(res);
+		checkDeviceRemoved(res);
+		return false;
+	}
+	quint8 *ptr = reinterpret_cast<quint8 *>(mapped.pData);
+	memcpy(&ptr[m_vertRingPos], data, numBytes);
+	m_dc->Unmap(m_vertRing, 0);
+
+	// Keep allocations 16-byte aligned
+	offsetOut = m_vertRingPos;
+	m_vertRingPos += (numBytes + 15) & ~15;
+
+	return true;
+}
+
+/// <summary>
+/// Tests if the failure `res` was caused by the graphics device being removed
+/// or reset (E.g. a driver update or a GPU timeout). If it was then the
+/// context and all of its deferred contexts become permanently invalid and
+/// the application must create a new context.
+/// </summary>
+/// <returns>True if the device is lost</returns>
+bool D3D11Context::checkDeviceRemoved(HRESULT res)
+{
+	if(m_parent != NULL)
+		return m_parent->checkDeviceRemoved(res);
+	if(SUCCEEDED(res) || m_device == NULL)
+		return false;
+	if(m_isDeviceLost)
+		return true;
+
+	HRESULT reason = m_device->GetDeviceRemovedReason();
+	if(SUCCEEDED(reason)) {
+		if(res != DXGI_ERROR_DEVICE_REMOVED && res != DXGI_ERROR_DEVICE_RESET)
+			return false; // Unrelated failure
+		reason = res;
+	}
+
+	gfxLog(LOG_CAT, GfxLog::Critical)
+		<< "DirectX 11 device was removed. "
+		<< "Reason = " << getDXErrorCode(reason);
+	m_isDeviceLost = true;
+	return true;
+}
+
+		m_liveReadbackQueues.remove(index);
+}
+
+/// <summary>
+/// Copies the texel data from one texture to another.
+/// </summary>
+/// <returns>True if the copy command was queued or false on failure.</returns>
+bool D3D11Context::copyTextureData(
+	Texture *dst, Texture *src, const QPoint &dstPos, const QRect &srcRect)
+{
+	if(dst == NULL || src == NULL)
+		return false;
+	if(dst->isMapped() || src->isMapped()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot copy texture data while mapped";
+		return false;
+	}
+	if(dstPos.x() < 0 || dstPos.y() < 0 ||
+		dstPos.x() + srcRect.width() > dst->getWidth() ||
+		dstPos.y() + srcRect.height() > dst->getHeight())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot copy texture data as the source rectangle doesn't fit "
+			<< "in the destination texture";
+		return false;
+	}
+	if(srcRect.x() < 0 || srcRect.y() < 0 ||
+		srcRect.right() > src->getWidth() ||
+		srcRect.bottom() > src->getHeight())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot copy texture data as the source rectangle doesn't fit "
+			<< "in the source texture";
+		return false;
+	}
+
+	D3D11Texture *dstTex = static_cast<D3D11Texture *>(dst);
+	D3D11Texture *srcTex = static_cast<D3D11Texture *>(src);
+	D3D11_BOX box;
+	box.left = srcRect.left();
+	box.top = srcRect.top();
+	box.front = 0;
+	box.right = srcRect.right() + 1;
+	box.bottom = srcRect.bottom() + 1;
+	box.back = 1;
+	m_dc->CopySubresourceRegion(
+		dstTex->getTexture(), D3D11CalcSubresource(0, 0, 0),
+		dstPos.x(), dstPos.y(), 0,
+		srcTex->getTexture(), D3D11CalcSubresource(0, 0, 0),
+		&box);
+	dst->markModified();
+	return true;
+}
+
+/// <summary>
+/// Creates a queue of `depth` staging textures of the specified size that can
+/// be used to read back pixel data asynchronously.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created queue or NULL on failure.
+/// </returns>
+ReadbackQueue *D3D11Context::createReadbackQueue(const QSize &size, int depth)
+{
+	if(!isValid())
+		return NULL; // DirectX must be initialized
+	if(m_parent != NULL)
+		return NULL; // Queries are only read on the immediate context
+	if(size.isEmpty() || depth <= 0)
+		return NULL; // Invalid size
+
+	D3D11ReadbackQueue *queue = new D3D11ReadbackQueue(this, size, depth);
+	if(queue->isValid())
+		return queue;
+	delete queue;
+	return NULL;
+}
+
+void D3D11Context::deleteReadbackQueue(ReadbackQueue *queue)
+{
+	if(queue == NULL)
+		return;
+	delete static_cast<D3D11ReadbackQueue *>(queue);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Render targets
+
+/// <summary>
+/// Resizes the swap chain buffers. Only valid on the immediate context and
+/// must not be called while a deferred context is recording to the screen.
+/// </summary>
+void D3D11Context::resizeScreenTarget(const QSize &newSize)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(m_parent != NULL)
+		return; // Deferred contexts don't own the swap chain
+	if(m_screenTargetSize == newSize)
+		return; // No change
+
+	// Don't log as we'll spam the log file when the user resizes the window
+	//gfxLog(LOG_CAT) << "Setting screen size to: " << newSize;
+
+	// Unbind the render target if is currently bound
+	if(m_currentTarget == GfxScreenTarget) {
+		ID3D11RenderTargetView *nullTarget[2] = { NULL, NULL };
+		m_dc->OMSetRenderTargets(2, nullTarget, NULL);
+		m_boundTargetViews[0] = NULL;
+		m_boundTargetViews[1] = NULL;
+	}
+
+	// Release the target
+	if(m_screenTarget)
+		m_screenTarget->Release();
+	m_screenTarget = NULL;
+
+	// Actually issue the resize command
+	HRESULT res = m_swapChain->ResizeBuffers(
+		2, newSize.width(), newSize.height(),
+		DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+	if(SUCCEEDED(res))
+		m_screenTargetSize = newSize;
+	else {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to resize swap chain buffer. "
+			<< "Reason = " << getDXErrorCode(res);
+		if(checkDeviceRemoved(res))
+			return;
+	}
+
+	// Recreate render target
+	if(!createScreenTarget()) {
+		// The context is unusable as we'd be rendering to an invalid render
+		// target
+		checkDeviceRemoved(m_device->GetDeviceRemovedReason());
+		return;
+	}
+
+	// Rebind the render target if it was previously bound
+	if(m_currentTarget == GfxScreenTarget)
+		setRenderTarget(m_currentTarget);
+}
+
+/// <summary>
+/// Recreates the canvas textures. Only valid on the immediate context and
+/// must not be called while a deferred context is recording to the canvas.
+/// </summary>
+void D3D11Context::resizeCanvasTarget(const QSize &newSize)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(m_parent != NULL)
+		return; // Deferred contexts share the immediate context's canvas
+	if(m_canvasTargetSize == newSize)
+		return; // No change
+
+	gfxLog(LOG_CAT) << "Setting canvas texture size to: " << newSize;
+
+	// Unbind the render target if is currently bound
+	if(m_currentTarget == GfxCanvas1Target ||
+		m_currentTarget == GfxCanvas2Target)
+	{
+		ID3D11RenderTargetView *nullTarget[2] = { NULL, NULL };
+		m_dc->OMSetRenderTargets(2, nullTarget, NULL);
+		m_boundTargetViews[0] = NULL;
+		m_boundTargetViews[1] = NULL;
+	}
+
+	// Release the old textures and render targets
+	removeScaleCacheEntries(m_canvas1Texture);
+	removeScaleCacheEntries(m_canvas2Texture);
+	delete m_canvas1Texture;
+	delete m_canvas2Texture;
+	m_canvas1Texture = NULL;
+	m_canvas2Texture = NULL;
+
+	// Create brand new textures with render targets
+	m_canvas1Texture = new D3D11Texture(
+		this, GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+	m_canvas2Texture = new D3D11Texture(
+		this, GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+	if(m_canvas1Texture->getTexture() && m_canvas2Texture->getTexture()) {
+		m_canvasTargetSize = newSize;
+		resetCanvasDamage(newSize);
+	}
+	else {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to create two canvas textures.";
+	}
+	if(m_canvas1Texture->getTargetView() == NULL ||
+		m_canvas2Texture->getTargetView() == NULL)
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to create two canvas render targets.";
+	}
+
+	// Rebind the render target if it was previously bound
+	if(m_currentTarget == GfxCanvas1Target ||
+		m_currentTarget == GfxCanvas2Target)
+	{
+		setRenderTarget(m_currentTarget);
+	}
+}
+
+/// <summary>
+/// Resizes the scratch target to the specified size, enlarging its internal
+/// texture if required.
+///
+/// NOTE: `setRenderTarget()` should be called after this method if the calling
+/// code intends to render to it.
+/// </summary>
+void D3D11Context::resizeScratchTarget(const QSize &newSize)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+
+	// Get old size taking into account  NULL pointers
+	QSize oldSize(0, 0);
+	if(m_scratch1Texture != NULL)
+		oldSize = m_scratch1Texture->getSize();
+
+	// Update the scratch texture target size so that the calling code doesn't
+	// need to know the actual scratch texture size when calling
+	// `setRenderTarget()`
+	m_scratchTargetSize = newSize;
+
+	// Do we need to enlarge the actual texture?
+	if(newSize.width() <= oldSize.width() &&
+		newSize.height() <= oldSize.height())
+	{
+		// Scratch texture is already large enough
+		return;
+	}
+	// Scratch texture needs to be enlarged
+
+	// Enlarge to the next largest power of two
+	QSize size(nextPowTwo(newSize.width()), nextPowTwo(newSize.height()));
+	gfxLog(LOG_CAT) << "Setting scratch texture size to: " << size;
+
+	// Recreate scratch textures
+	deleteTexture(m_scratch1Texture);
+	deleteTexture(m_scratch2Texture);
+	m_scratch1Texture =
+		static_cast<D3D11Texture *>(createTexture(size, false, true));
+	m_scratch2Texture =
+		static_cast<D3D11Texture *>(createTexture(size, false, true));
+}
+
+void D3D11Context::swapScreenBuffers()
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(m_parent != NULL)
+		return; // Deferred contexts don't own the swap chain
+
+	HRESULT res = m_swapChain->Present(0, 0);
+	if(FAILED(res)) {
+		if(!checkDeviceRemoved(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to present swap chain. "
+				<< "Reason = " << getDXErrorCode(res);
+		}
+	}
+}
+
+
+Texture *D3D11Context::getTargetTexture(VidgfxRendTarget target)
+{
+	switch(target) {
+	default:
+	case GfxScreenTarget:
+		return NULL;
+	case GfxCanvas1Target:
+		return getRootContext()->m_canvas1Texture;
+	case GfxCanvas2Target:
+		return getRootContext()->m_canvas2Texture;
+	case GfxScratch1Target:
+		return m_scratch1Texture;
+	case GfxScratch2Target:
+		return m_scratch2Texture;
+	case GfxUserTarget:
+		return m_userTargets[0];
+	}
+}
+
+/// <summary>
+/// Returns the next available scratch target so that it's possible to chain
+/// multiple scratch renders back-to-back.
+/// </summary>
+VidgfxRendTarget D3D11Context::getNextScratchTarget()
+{
+	VidgfxRendTarget ret = GfxScratch1Target;
+	if(m_scratchNextTarget == 1)
+		ret = GfxScratch2Target;
+	m_scratchNextTarget ^= 1;
+	return ret;
+}
+
+/// <summary>
+/// Returns the ratio between what the user's requested scratch target size is
+/// and what the actual scratch target texture size is. E.g. if the target size
+/// is (256, 128) and the actual texture size is (512, 512) then the returned
+/// value will be (0.5, 0.25).
+/// </summary>
+/// <returns></returns>
+QPointF D3D11Context::getScratchTargetToTextureRatio()
+{
+	QSize texSize = m_scratchTargetSize;
+	if(m_scratch1Texture != NULL)
+		texSize = m_scratch1Texture->getSize();
+	return QPointF(
+		(float)m_scratchTargetSize.width() / (float)texSize.width(),
+		(float)m_scratchTargetSize.height() / (float)texSize.height());
+}
+
+//-----------------------------------------------------------------------------
+// Advanced rendering
+
+
+Texture *D3D11Context::prepareTexture(
+	Texture *tex, const QSize &size, VidgfxFilter filter, bool setFilter,
+	QPointF &pxSizeOut, QPointF &botRightOut)
+{
+	// Even if the input is invalid still try to provide a sane output
+	if(!isValid() || tex == NULL || size.width() <= 0 || size.height() <= 0) {
+		pxSizeOut = QPointF(1.0f, 1.0f);
+		botRightOut = QPointF(1.0f, 1.0f);
+		if(setFilter) {
+			setTextureFilter((filter == GfxPointFilter)
+				? GfxPointFilter : GfxBilinearFilter);
+		}
+		return tex;
+	}
+
+	// Don't crop anything
+	const QSize &texSize = tex->getSize();
+	QRect cropRect(0, 0, texSize.width(), texSize.height());
+
+	QPointF topLeft;
+	return prepareTexture(tex, cropRect, size, filter, setFilter, pxSizeOut,
+		topLeft, botRightOut);
+}
+
+/// <summary>
+/// Prepares the input texture for rendering at the specified size. The
+/// returned texture is to be rendered using `GfxPointFilter` filtering if this
+/// method was called with `GfxPointFilter` itself or `GfxBilinearFilter` if it
+/// was not, set `setFilter` to true to make this method automatically set up
+/// the texture filtering mode for you. As the returned texture can potentially
+/// be a scratch texture the texture data should be rendered or copied before
+/// any other method that uses a scratch texture is called.
+///
+/// If this method was called with `GfxPointFilter` then it is essentially a
+/// no-op. If this method was called with `GfxBilinearFilter` then it will
+/// automatically create the least amount of mipmaps necessary to render at the
+/// specified size and then return the details of the smallest mipmap. If this
+/// method was called with `GfxBicubicFilter` or `GfxLanczosFilter` then it
+/// will rescale the input to the exact specified size with one horizontal and
+/// one vertical pass regardless of the scaling ratio so the calling code does
+/// not need to worry about how to sample the returned texture. These filters
+/// require feature level 10.0 and fall back to `GfxBilinearFilter` otherwise.
+///
+/// WARNING: Do not use Texture::getSize() or `size` to determine texel size in
+/// later stages! Instead use `pxSizeOut` and `botRightOut` as they take into
+/// account scratch texture sharing and the different filter algorithms.
+///
+/// WARNING: `pxSizeOut` and `botRightOut` are not always the same for the same
+/// input as scratch textures can grow at any time! If you're rendering the
+/// returned texture using a vertex buffer you must always check the result and
+/// update your buffer's UV if it changes between calls.
+///
+/// If the input texture has not been modified since the last call with the
+/// same parameters then the result of the previous call is returned from a
+/// cache without doing any rendering (See `setScaleCacheSize()`). Textures that
+/// are modified outside of libvidgfx must call `Texture::markModified()`.
+/// </summary>
+Texture *D3D11Context::prepareTexture(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter, bool setFilter, QPointF &pxSizeOut,
+	QPointF &topLeftOut, QPointF &botRightOut)
+{
+	// Even if the input is invalid still try to provide a sane output
+	if(!isValid() || tex == NULL || size.width() <= 0 || size.height() <= 0) {
+		pxSizeOut = QPointF(1.0f, 1.0f);
+		topLeftOut = QPointF(0.0f, 0.0f);
+		botRightOut = QPointF(1.0f, 1.0f);
+		if(setFilter) {
+			setTextureFilter((filter == GfxPointFilter)
+				? GfxPointFilter : GfxBilinearFilter);
+		}
+		return tex;
+	}
+
+	// Static textures such as images and text are usually prepared with the
+	// exact same parameters every frame. If the input texture hasn't been
+	// modified since the last call then return the result from last time.
+	// In order to not waste memory on textures that change every frame we
+	// only cache once the texture has been seen unchanged at least once.
+	int cacheIndex = -1;
+	bool doCache = false;
+	if(filter != GfxPointFilter && m_scaleCacheMaxSize > 0 &&
+		!static_cast<D3D11Texture *>(tex)->isExternal())
+	{
+		cacheIndex = findScaleCacheEntry(tex, cropRect, size, filter);
+		if(cacheIndex >= 0) {
+			ScaleCacheEntry &entry = m_scaleCache[cacheIndex];
+			entry.lastUsed = ++m_scaleCacheUseCounter;
+			if(entry.srcGeneration == tex->getGeneration()) {
+				if(entry.tex != NULL) {
+					// Cache hit
+					pxSizeOut = entry.pxSize;
+					topLeftOut = entry.topLeft;
+					botRightOut = entry.botRight;
+					if(setFilter)
+						setTextureFilter(GfxBilinearFilter);
+					return entry.tex;
+				}
+				doCache = true;
+			} else {
+				// Input has been modified, our cached texture is stale
+				deleteTexture(entry.tex);
+				entry.tex = NULL;
+				entry.srcGeneration = tex->getGeneration();
+			}
+		} else {
+			// Remember that we have seen this texture
+			addScaleCacheEntry(tex, cropRect, size, filter);
+		}
+	}
+	D3D11Texture *cacheTex = NULL;
+
+	// The relative size of the output texture pixel data vs the actual
+	// size of the texture buffer. E.g. 0.5 = Half the texture size.
+	QPointF relTexSize(1.0f, 1.0f);
+	Texture *outTex = tex;
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+
+	// TODO: Validate crop rectangle
+
+	// The area of the input texture that `outTex` currently contains in input
+	// texture pixels. This begins as the entire texture but if we need to
+	// create mipmaps then we only render the crop rectangle plus a small
+	// border into the first mipmap, the remaining mipmaps then only contain
+	// that area as well.
+	const QSize &texSize = tex->getSize();
+	QRect sampleRect(QPoint(0, 0), texSize);
+
+	// Determine the area to render into the first mipmap. The border is wide
+	// enough that the bilinear samples of all the following mipmaps and the
+	// final render never read outside of the area that we rendered.
+	QPointF cropRatio( // Number of input pixels per output pixel
+		(qreal)cropRect.width() / (qreal)size.width(),
+		(qreal)cropRect.height() / (qreal)size.height());
+	int border = (int)ceil(2.0f * qMax(1.0,
+		qMax(cropRatio.x(), cropRatio.y()))) + 1;
+	QRect mipRect = cropRect.adjusted(-border, -border, border, border)
+		.intersected(sampleRect);
+	if(mipRect.isEmpty())
+		mipRect = sampleRect; // Crop rectangle is completely out of bounds
+	QSize mipOutSize( // Effective size that the first mipmap area must be
+		ceil((qreal)mipRect.width() / cropRatio.x()),
+		ceil((qreal)mipRect.height() / cropRatio.y()));
+
+	// Apply our per-method scaling algorithm
+	QSize outTexSize; // Size of the data in `outTex` if it's not `tex`
+	switch(filter) {
+	case GfxPointFilter:
+		// We don't need to do any actual texture processing for point sampling
+		break;
+	case GfxBicubicFilter:
+	case GfxLanczosFilter: {
+		// The output contains exactly the crop rectangle at the final size
+		Texture *resampled = resampleTexture(tex, cropRect, size, filter);
+		if(resampled != NULL) {
+			outTex = resampled;
+			outTexSize = size;
+			relTexSize = getScratchTargetToTextureRatio();
+			sampleRect = cropRect;
+			break;
+		}
+		// Not supported by the device, fall back to bilinear
+		}
+		// Fall through
+	default:
+	case GfxBilinearFilter: {
+		// Create mipmaps as required. As the crop rectangle is applied in
+		// the first pass we compare against the size of the crop area only.
+		QSize nextSize = mipRect.size();
+		for(;;) {
+			if(nextSize.width() <= mipOutSize.width() * 2
+				&& nextSize.height() <= mipOutSize.height() * 2)
+			{
+				// We can now sample the texture without any distortion, stop
+				// creating mipmaps
+				break;
+			}
+
+			// Calculate the size of the next mipmap. We must integer ceil() to
+			// prevent going under 50% size due to floor()ing.
+			nextSize = QSize(
+				qMax((nextSize.width() + 1) / 2, mipOutSize.width()),
+				qMax((nextSize.height() + 1) / 2, mipOutSize.height()));
+
+			//gfxLog(LOG_CAT)
+			//	<< "Creating mipmap of " << nextSize << " for target size "
+			//	<< size;
+
+			// Update the vertex buffer. The first mipmap only samples the
+			// cropped area of the input texture
+			QRectF mipRectF(0.0f, 0.0f,
+				(qreal)nextSize.width(), (qreal)nextSize.height());
+			if(outTex == tex && mipRect != sampleRect) {
+				QPointF pxSize(
+					relTexSize.x() / (qreal)texSize.width(),
+					relTexSize.y() / (qreal)texSize.height());
+				qreal left = (qreal)mipRect.left() * pxSize.x();
+				qreal top = (qreal)mipRect.top() * pxSize.y();
+				qreal right = (qreal)(mipRect.right() + 1) * pxSize.x();
+				qreal bottom = (qreal)(mipRect.bottom() + 1) * pxSize.y();
+				createTexDecalRect(
+					m_mipmapBuf, mipRectF, QPointF(left, top),
+					QPointF(right, top), QPointF(left, bottom),
+					QPointF(right, bottom));
+				sampleRect = mipRect;
+			} else
+				createTexDecalRect(m_mipmapBuf, mipRectF, relTexSize);
+
+			// Setup render target
+			resizeScratchTarget(nextSize);
+			VidgfxRendTarget target = getNextScratchTarget();
+			setRenderTarget(target);
+			QMatrix4x4 mat;
+			setViewMatrix(mat);
+			mat.ortho(
+				0.0f, nextSize.width(), nextSize.height(), 0.0f, -1.0f, 1.0f);
+			setProjectionMatrix(mat);
+
+			// Render the mipmap
+			setShader(GfxTexDecalShader);
+			setTopology(GfxTriangleStripTopology);
+			setBlending(GfxNoBlending);
+			setTexture(outTex);
+			setTextureFilter(GfxBilinearFilter);
+			drawBuffer(m_mipmapBuf);
+
+			// Update references
+			outTex = getTargetTexture(target);
+			relTexSize = getScratchTargetToTextureRatio();
+		}
+		outTexSize = nextSize;
+		break; }
+	}
+
+	// Copy the result out of the scratch target so that it is kept for the
+	// next call
+	if(doCache && outTex != tex) {
+		cacheTex = new D3D11Texture(
+			getRootContext(), 0, outTexSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+		if(cacheTex->isValid() && copyTextureData(
+			cacheTex, outTex, QPoint(0, 0), QRect(QPoint(0, 0), outTexSize)))
+		{
+			outTex = cacheTex;
+			relTexSize = QPointF(1.0f, 1.0f);
+		} else {
+			deleteTexture(cacheTex);
+			cacheTex = NULL;
+		}
+	}
+
+	// Restore original state
+	setRenderTarget(origTarget);
+
+	// Adjust top-left and bottom-right points for cropping. The output
+	// texture only contains `sampleRect` of the input texture.
+	topLeftOut = QPointF(0.0f, 0.0f);
+	botRightOut = relTexSize;
+	if(cropRect != sampleRect) {
+		QPointF pxSize(
+			relTexSize.x() / (qreal)sampleRect.width(),
+			relTexSize.y() / (qreal)sampleRect.height());
+		topLeftOut = QPointF(
+			(qreal)(cropRect.left() - sampleRect.left()) * pxSize.x(),
+			(qreal)(cropRect.top() - sampleRect.top()) * pxSize.y());
+		botRightOut = QPointF(
+			(qreal)(cropRect.right() + 1 - sampleRect.left()) * pxSize.x(),
+			(qreal)(cropRect.bottom() + 1 - sampleRect.top()) * pxSize.y());
+	}
+
+	pxSizeOut = QPointF(
+		(botRightOut.x() - topLeftOut.x()) / (qreal)size.width(),
+		(botRightOut.y() - topLeftOut.y()) / (qreal)size.height());
+	if(setFilter) {
+		setTextureFilter(
+			(filter == GfxPointFilter) ? GfxPointFilter : GfxBilinearFilter);
+	}
+
+	// Store the result in the cache. Resizing the scratch targets above can
+	// delete textures which removes their cache entries and shifts the
+	// remaining ones so the entry must be looked up again.
+	if(cacheTex != NULL) {
+		cacheIndex = findScaleCacheEntry(tex, cropRect, size, filter);
+		if(cacheIndex < 0)
+			cacheIndex = addScaleCacheEntry(tex, cropRect, size, filter);
+		ScaleCacheEntry &entry = m_scaleCache[cacheIndex];
+		deleteTexture(entry.tex);
+		entry.tex = cacheTex;
+		entry.pxSize = pxSizeOut;
+		entry.topLeft = topLeftOut;
+		entry.botRight = botRightOut;
+	}
+
+	return outTex;
+}
+
+/// <summary>
+/// Converts the specified input texture data to a BGRX texture. WARNING: The
+/// resulting texture is on the scratch texture, if you want to keep the data
+/// you must copy it elsewhere before the scratch texture is used by another
+/// method.
+/// </summary>
+/// <returns>NULL if the texture could not be converted</returns>
+Texture *D3D11Context::convertToBgrx(
+	VidgfxPixFormat format, Texture *planeA, Texture *planeB, Texture *planeC)
+{
+	if(format >= NUM_PIXEL_FORMAT_TYPES)
+		return NULL;
+	if(format == GfxNoFormat)
+		return NULL;
+	if(format == GfxRGB24Format || format == GfxRGB32Format ||
+		format == GfxARGB32Format)
+	{
+		// RGB24 is not a valid format, RGB32 and ARGB32 don't need conversion
+		return NULL;
+	}
+
+	switch(format) {
+	default:
+		return NULL;
+	case GfxYV12Format: // NxM Y, (N/2)x(M/2) V, (N/2)x(M/2) U
+	case GfxIYUVFormat: { // NxM Y, (N/2)x(M/2) U, (N/2)x(M/2) V
+		if(planeA == NULL || planeB == NULL || planeC == NULL)
+			return NULL;
+		if(planeB->getWidth() != planeA->getWidth() / 2 ||
+			planeB->getHeight() != planeA->getHeight() / 2 ||
+			planeC->getWidth() != planeA->getWidth() / 2 ||
+			planeC->getHeight() != planeA->getHeight() / 2)
+		{
+			return NULL;
+		}
+
+		// The only difference between IYUV and YV12 is the plane order.
+		// Reorder to YV12 always.
+		if(format == GfxIYUVFormat) {
+			Texture *tmp = planeB;
+			planeB = planeC;
+			planeC = tmp;
+		}
+
+		// Determine output texture size
+		QSize outSize(
+			(qreal)(planeA->getWidth() * 4), (qreal)planeA->getHeight());
+
+		//--------------------------------------------------------------------
+
+		// Remember original state
+		VidgfxRendTarget origTarget = m_currentTarget;
+
+		// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+		createTexDecalRect(
+			m_mipmapBuf, QRectF(0.0f, 0.0f,
+			(qreal)outSize.width(), (qreal)outSize.height()));
+
+		// Setup render target
+		resizeScratchTarget(outSize);
+		VidgfxRendTarget target = getNextScratchTarget();
+		setRenderTarget(target);
+		QMatrix4x4 mat;
+		setViewMatrix(mat);
+		mat.ortho(
+			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+		setProjectionMatrix(mat);
+
+		// Update the shader constants
+		float outTexWidth = 1.0f / outSize.width();
+		float values[8] = {
+			outTexWidth * 4.0f, // Inverse 4x Y texel width
+			outTexWidth * 0.125f, // Half Y texel width
+			outTexWidth * 8.0f, // Inverse 4x U/V texel width
+			outTexWidth * 0.0625f, // Half U/V texel width
+			0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(GfxYv12RgbShader, values))
+		{
+			// Update failed. Restore original state and return
+			setRenderTarget(origTarget);
+			return NULL;
+		}
+
+		// Render the mipmap
+		setShader(GfxYv12RgbShader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(planeA, planeB, planeC);
+		setTextureFilter(GfxPointFilter);
+		drawBuffer(m_mipmapBuf);
+
+		// Restore original state
+		setRenderTarget(origTarget);
+
+		//--------------------------------------------------------------------
+
+		return getTargetTexture(target); }
+	case GfxNV12Format: { // NxM Y, Nx(M/2) interleaved UV
+		// The Y plane is a packed RGBA texture like YV12 while the UV plane
+		// is an R8G8 texture (See `createRgTexture()`) of (N/2)x(M/2)
+		if(planeA == NULL || planeB == NULL)
+			return NULL;
+		if(planeB->getWidth() != planeA->getWidth() * 2 ||
+			planeB->getHeight() != planeA->getHeight() / 2)
+		{
+			return NULL;
+		}
+
+		// Determine output texture size
+		QSize outSize(
+			(qreal)(planeA->getWidth() * 4), (qreal)planeA->getHeight());
+
+		//--------------------------------------------------------------------
+
+		// Remember original state
+		VidgfxRendTarget origTarget = m_currentTarget;
+
+		// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+		createTexDecalRect(
+			m_mipmapBuf, QRectF(0.0f, 0.0f,
+			(qreal)outSize.width(), (qreal)outSize.height()));
+
+		// Setup render target
+		resizeScratchTarget(outSize);
+		VidgfxRendTarget target = getNextScratchTarget();
+		setRenderTarget(target);
+		QMatrix4x4 mat;
+		setViewMatrix(mat);
+		mat.ortho(
+			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+		setProjectionMatrix(mat);
+
+		// Update the shader constants
+		float outTexWidth = 1.0f / outSize.width();
+		float values[8] = {
+			outTexWidth * 4.0f, // Inverse 4x Y texel width
+			outTexWidth * 0.125f, // Half Y texel width
+			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(GfxNv12RgbShader, values))
+		{
+			// Update failed. Restore original state and return
+			setRenderTarget(origTarget);
+			return NULL;
+		}
+
+		// Render the mipmap
+		setShader(GfxNv12RgbShader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(planeA, planeB);
+		setTextureFilter(GfxPointFilter);
+		drawBuffer(m_mipmapBuf);
+
+		// Restore original state
+		setRenderTarget(origTarget);
+
+		//--------------------------------------------------------------------
+
+		return getTargetTexture(target); }
+	case GfxUYVYFormat: // UYVY
+	case GfxHDYCFormat: // UYVY with BT.709
+	case GfxYUY2Format: { // YUYV
+		if(planeA == NULL)
+			return NULL;
+
+		// Determine output texture size
+		QSize outSize(
+			(qreal)(planeA->getWidth() * 2), (qreal)planeA->getHeight());
+
+		//--------------------------------------------------------------------
+
+		// Remember original state
+		VidgfxRendTarget origTarget = m_currentTarget;
+
+		// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+		createTexDecalRect(
+			m_mipmapBuf, QRectF(0.0f, 0.0f,
+			(qreal)outSize.width(), (qreal)outSize.height()));
+
+		// Setup render target
+		resizeScratchTarget(outSize);
+		VidgfxRendTarget target = getNextScratchTarget();
+		setRenderTarget(target);
+		QMatrix4x4 mat;
+		setViewMatrix(mat);
+		mat.ortho(
+			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+		setProjectionMatrix(mat);
+
+		// Update the shader constants
+		VidgfxShader shader = GfxUyvyRgbShader; // UYVY
+		if(format == GfxHDYCFormat) // UYVY with BT.709
+			shader = GfxHdycRgbShader;
+		else if(format == GfxYUY2Format) // YUYV
+			shader = GfxYuy2RgbShader;
+		float outTexWidth = 1.0f / outSize.width();
+		float values[8] = {
+			outTexWidth * 2.0f, // 4x Y texel width
+			outTexWidth, // 2x Y texel width
+			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(shader, values))
+		{
+			// Update failed. Restore original state and return
+			setRenderTarget(origTarget);
+			return NULL;
+		}
+
+		// Render the mipmap
+		setShader(shader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(planeA);
+		setTextureFilter(GfxPointFilter);
+		drawBuffer(m_mipmapBuf);
+
+		// Restore original state
+		setRenderTarget(origTarget);
+
+		//--------------------------------------------------------------------
+		return getTargetTexture(target); }
+	}
+
+	// Should never be reached
+	return NULL;
+}
+
+/// <summary>
+/// Converts the entire RGB texture `src` (Usually a canvas target) into the
+/// separate planes of a YUV 4:2:0 pixel format on the graphics hardware,
+/// including the vertical chroma subsampling, so that the result can be read
+/// back and handed directly to an encoder. All planes must be targetable RGBA
+/// textures where each texel contains 4 packed 8-bit samples:
+///
+///  - NV12: `planeA` = (N/4)xM Y, `planeB` = (N/4)x(M/2) interleaved UV
+///  - IYUV: `planeA` = (N/4)xM Y, `planeB` = (N/8)x(M/2) U, `planeC` = V
+///  - YV12: `planeA` = (N/4)xM Y, `planeB` = (N/8)x(M/2) V, `planeC` = U
+///
+/// Where NxM is the size of `src`. The current user render target, its
+/// viewport and the user matrices are restored afterwards. If the device
+/// supports compute shaders and the planes were created with unordered access
+/// views then all planes are written by a single compute dispatch.
+/// </summary>
+/// <returns>True if the conversion was queued or false on failure.</returns>
+bool D3D11Context::convertFromRgb(
+	VidgfxPixFormat format, Texture *src, Texture *planeA, Texture *planeB,
+	Texture *planeC)
+{
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(src == NULL || planeA == NULL || planeB == NULL)
+		return false;
+
+	// Validate plane sizes
+	QSize srcSize = src->getSize();
+	QSize ySize(srcSize.width() / 4, srcSize.height());
+	QSize uvSize;
+	switch(format) {
+	default:
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Unsupported pixel format for RGB conversion: "
+			<< VidgfxPixFormatStrs[qBound(0, (int)format,
+			(int)NUM_PIXEL_FORMAT_TYPES - 1)];
+		return false;
+	case GfxNV12Format: // NxM Y, Nx(M/2) interleaved UV
+		if(srcSize.width() % 4 != 0 || srcSize.height() % 2 != 0)
+			return false;
+		uvSize = QSize(srcSize.width() / 4, srcSize.height() / 2);
+		break;
+	case GfxYV12Format: // NxM Y, (N/2)x(M/2) V, (N/2)x(M/2) U
+	case GfxIYUVFormat: // NxM Y, (N/2)x(M/2) U, (N/2)x(M/2) V
+		if(planeC == NULL)
+			return false;
+		if(srcSize.width() % 8 != 0 || srcSize.height() % 2 != 0)
+			return false;
+		uvSize = QSize(srcSize.width() / 8, srcSize.height() / 2);
+		if(planeC->getSize() != uvSize || !planeC->isTargetable())
+			return false;
+		break;
+	}
+	if(planeA->getSize() != ySize || planeB->getSize() != uvSize ||
+		!planeA->isTargetable() || !planeB->isTargetable())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot convert RGB texture as the output planes are the "
+			<< "wrong size or are not targetable";
+		return false;
+	}
+
+	// The only difference between IYUV and YV12 is the plane order.
+	// Reorder to IYUV always.
+	if(format == GfxYV12Format) {
+		Texture *tmp = planeB;
+		planeB = planeC;
+		planeC = tmp;
+	}
+
+	// Feature level 11.0 devices write every plane in a single compute pass
+	// that reads each input pixel once instead of once per plane
+	int cs = (format == GfxNV12Format) ? RgbNv12CS : RgbI420CS;
+	if(dispatchYuvPlanes(cs, src, planeA, planeB, planeC))
+		return true;
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Luminance
+	bool ret = drawYuvPlanes(GfxRgbYShader, src, planeA, NULL);
+
+	// Chroma
+	if(ret) {
+		if(format == GfxNV12Format)
+			ret = drawYuvPlanes(GfxRgbNv12UvShader, src, planeB, NULL);
+		else
+			ret = drawYuvPlanes(GfxRgbI420UvShader, src, planeB, planeC);
+	}
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return ret;
+}
+
+/// <summary>
+/// Scales the entire `src` texture to the output size, converts it to YUV with
+/// the specified matrix and packs it into NV16 in a single pass. This replaces
+/// using `prepareTexture()` followed by a `GfxRgbNv16Shader` pass. Both planes
+/// must be targetable textures of (N/4)xM where NxM is the output size. As
+/// each output pixel is a box filter of bilinear taps only downscales of up to
+/// 4x are done in a single pass, larger downscales first reduce the input with
+/// `prepareTexture()`.
+/// </summary>
+bool D3D11Context::scaleToNv16(
+	Texture *src, Texture *planeY, Texture *planeUV, VidgfxYuvMatrix matrix)
+{
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(src == NULL || planeY == NULL || planeUV == NULL)
+		return false;
+	if(planeY->getSize() != planeUV->getSize() || planeY->getSize().isEmpty()
+		|| !planeY->isTargetable() || !planeUV->isTargetable())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot convert RGB texture as the output planes are the "
+			<< "wrong size or are not targetable";
+		return false;
+	}
+	QSize outSize(planeY->getWidth() * 4, planeY->getHeight());
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Reduce large downscales to between 2x and 4x with mipmaps. This must be
+	// done before we write to the mipmapping buffer.
+	Texture *tex = src;
+	QPointF botRight(1.0f, 1.0f);
+	if(src->getWidth() > outSize.width() * 4 ||
+		src->getHeight() > outSize.height() * 4)
+	{
+		QPointF pxSize;
+		tex = prepareTexture(
+			src, outSize * 2, GfxBilinearFilter, false, pxSize, botRight);
+	}
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	QSize planeSize = planeY->getSize();
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)planeSize.width(), (qreal)planeSize.height()), botRight);
+
+	// Setup render target
+	setUserRenderTarget(planeY, planeUV);
+	setUserRenderTargetViewport(planeSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, planeSize.width(), planeSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Output pixel size in input UV space. The 4 packed output pixels are
+	// centered around the output texel and each pixel is a 2x2 box of taps
+	// that are half an output pixel apart.
+	VidgfxShader shader = (matrix == GfxBt709Matrix)
+		? GfxRgbNv16Scaled709Shader : GfxRgbNv16ScaledShader;
+	float outPxX = (float)botRight.x() / (float)outSize.width();
+	float outPxY = (float)botRight.y() / (float)outSize.height();
+	float values[8] = {
+		-1.5f * outPxX, -0.5f * outPxX, 0.5f * outPxX, 1.5f * outPxX,
+		0.25f * outPxX, 0.25f * outPxY, 0.0f, 0.0f };
+	bool ret = updateConversionConstants(shader, values);
+
+	// Render both planes
+	if(ret) {
+		setShader(shader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(tex);
+		setTextureFilter(GfxBilinearFilter);
+		drawBuffer(m_mipmapBuf);
+	}
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return ret;
+}
+
+/// <summary>
+/// GPU version of `diluteImage()` for textures that are already resident.
+/// Renders `src` into `dst` with the colour information of nearby pixels
+/// copied to the fully transparent pixels. `dst` must be a targetable texture
+/// of the same size and format, e.g. as created by `createTexture(size, src,
+/// false, true)`.
+/// </summary>
+/// <returns>False if the texture couldn't be diluted, for example because
+/// the device doesn't support feature level 10.0</returns>
+bool D3D11Context::diluteTexture(Texture *src, Texture *dst)
+{
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(getPixelShader(DilutePS) == NULL)
+		return false; // Not supported
+	if(src == NULL || dst == NULL || src == dst)
+		return false;
+	if(dst->getSize() != src->getSize() || !dst->isTargetable()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot dilute texture as the output texture is the wrong "
+			<< "size or is not targetable";
+		return false;
+	}
+	QSize outSize = dst->getSize();
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)outSize.width(), (qreal)outSize.height()));
+
+	// Setup render target
+	setUserRenderTarget(dst);
+	setUserRenderTargetViewport(outSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Render the texture. The shader fetches exact texels itself.
+	setShader(GfxDiluteShader);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTexture(src);
+	setTextureFilter(GfxPointFilter);
+	drawBuffer(m_mipmapBuf);
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Drawing
+
+void D3D11Context::setRenderTarget(VidgfxRendTarget target)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+
+	// WARNING: Do not test if we are already using the requested target as
+	// `resizeScreenTarget()` relies on the current behaviour. Instead we
+	// compare the actual views against what is bound to the device which is
+	// invalidated whenever a target is recreated.
+
+	// Deferred contexts render to the screen and canvas of the immediate
+	// context
+	D3D11Context *root = getRootContext();
+
+	m_currentTarget = target;
+	ID3D11RenderTargetView *targetView[2] = { NULL, NULL };
+	QRect viewRect;
+	switch(target) {
+	default:
+	case GfxScreenTarget:
+		m_currentTarget = GfxScreenTarget; // Because of "default"
+		targetView[0] = root->m_screenTarget;
+		viewRect = QRect(QPoint(0, 0), root->m_screenTargetSize);
+		break;
+	case GfxCanvas1Target:
+		if(root->m_canvas1Texture != NULL)
+			targetView[0] = root->m_canvas1Texture->getTargetView();
+		viewRect = QRect(QPoint(0, 0), root->m_canvasTargetSize);
+		break;
+	case GfxCanvas2Target:
+		if(root->m_canvas2Texture != NULL)
+			targetView[0] = root->m_canvas2Texture->getTargetView();
+		viewRect = QRect(QPoint(0, 0), root->m_canvasTargetSize);
+		break;
+	case GfxScratch1Target:
+		if(m_scratch1Texture != NULL)
+			targetView[0] = m_scratch1Texture->getTargetView();
+		viewRect = QRect(QPoint(0, 0), m_scratchTargetSize);
+		break;
+	case GfxScratch2Target:
+		if(m_scratch2Texture != NULL)
+			targetView[0] = m_scratch2Texture->getTargetView();
+		viewRect = QRect(QPoint(0, 0), m_scratchTargetSize);
+		break;
+	case GfxUserTarget:
+		if(m_userTargets[0] != NULL && m_userTargets[0]->isTargetable()) {
+			targetView[0] =
+				static_cast<D3D11Texture *>(m_userTargets[0])->getTargetView();
+		}
+		if(m_userTargets[1] != NULL && m_userTargets[1]->isTargetable()) {
+			targetView[1] =
+				static_cast<D3D11Texture *>(m_userTargets[1])->getTargetView();
+			// TODO: We don't log a warning if this is not targetable
+		}
+		viewRect = m_userTargetViewport;
+		break;
+	}
+	if(targetView[0] == NULL) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Attempted to select a render target that doesn't exist yet";
+		return;
+	}
+
+	// The partial canvas redraw limit depends on the target
+	applyScissorRect();
+
+	if(targetView[0] == m_boundTargetViews[0] &&
+		targetView[1] == m_boundTargetViews[1] &&
+		viewRect == m_boundViewport)
+	{
+		// Already bound
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_dc->OMSetRenderTargets(2, targetView, NULL);
+	m_boundTargetViews[0] = targetView[0];
+	m_boundTargetViews[1] = targetView[1];
+	m_boundViewport = viewRect;
+
+	// The device automatically unbinds shader resources that are now bound as
+	// a render target so we can no longer trust our copy
+	m_numBoundResourceViews = -1;
+
+	// Setup the viewport as well so that the application doesn't need to worry
+	// about it. Note that for scratch targets we set the viewport size to
+	// match the requested size instead of the actual scratch texture size.
+	D3D11_VIEWPORT vp;
+	vp.TopLeftX = viewRect.x();
+	vp.TopLeftY = viewRect.y();
+	vp.Width = viewRect.width();
+	vp.Height = viewRect.height();
+	vp.MinDepth = 0.0f;
+	vp.MaxDepth = 1.0f;
+	m_dc->RSSetViewports(1, &vp);
+}
+
+void D3D11Context::setShader(VidgfxShader shader)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(m_boundShader == shader) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+
+	// The pixel shader is bound by `bindPixelShader()`
+	switch(shader) {
+	default:
+	case GfxNoShader:
+		m_dc->IASetInputLayout(NULL);
+		m_dc->VSSetShader(NULL, NULL, 0);
+		m_dc->PSSetShader(NULL, NULL, 0);
+		m_boundPixelShader = -1;
+		break;
+	case GfxSolidShader:
+		m_dc->IASetInputLayout(m_solidIL);
+		m_dc->VSSetShader(m_solidVS, NULL, 0);
+		break;
+	case GfxResizeLayerShader:
+		m_dc->IASetInputLayout(m_resizeIL);
+		m_dc->VSSetShader(m_resizeVS, NULL, 0);
+		break;
+	case GfxTexDecalShader:
+	case GfxTexDecalGbcsShader:
+	case GfxTexDecalRgbShader:
+	case GfxRgbNv16Shader:
+	case GfxYv12RgbShader:
+	case GfxNv12RgbShader:
+	case GfxUyvyRgbShader:
+	case GfxHdycRgbShader:
+	case GfxYuy2RgbShader:
+	case GfxRgbYShader:
+	case GfxRgbNv12UvShader:
+	case GfxRgbI420UvShader:
+	case GfxRgbNv16ScaledShader:
+	case GfxRgbNv16Scaled709Shader:
+	case GfxDiluteShader:
+	case GfxResampleHorzShader:
+	case GfxResampleVertShader:
+		m_dc->IASetInputLayout(m_texDecalIL);
+		m_dc->VSSetShader(m_texDecalVS, NULL, 0);
+		break;
+	}
+	m_boundShader = shader;
+	m_instancedVSBound = false;
+}
+
+void D3D11Context::setTopology(VidgfxTopology topology)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(m_boundTopology == (int)topology) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_boundTopology = topology;
+
+	switch(topology) {
+	default:
+	case GfxTriangleListTopology:
+		m_dc->IASetPrimitiveTopology(
+			D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		break;
+	case GfxTriangleStripTopology:
+		m_dc->IASetPrimitiveTopology(
+			D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		break;
+	}
+}
+
+void D3D11Context::setBlending(VidgfxBlending blending)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+
+	// Textures that are drawn with premultiplied blending are assumed to have
+	// premultiplied alpha, selects the permutation in `bindPixelShader()`
+	if(blending == GfxPremultipliedBlending)
+		m_texDecalFlags |= TexDecalPremultipliedPerm;
+	else
+		m_texDecalFlags &= ~TexDecalPremultipliedPerm;
+
+	ID3D11BlendState *state = m_noBlend;
+	switch(blending) {
+	default:
+	case GfxNoBlending:
+		state = m_noBlend;
+		break;
+	case GfxAlphaBlending:
+		state = m_alphaBlend;
+		break;
+	case GfxPremultipliedBlending:
+		state = m_premultiBlend;
+		break;
+	}
+	if(state == m_boundBlendState) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_dc->OMSetBlendState(state, NULL, 0xFFFFFFFF);
+	m_boundBlendState = state;
+}
+
+void D3D11Context::setTexture(Texture *texA, Texture *texB, Texture *texC)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(texA == NULL)
+		return;
+	if(texA->isStaging() || (texB && texB->isStaging()) ||
+		(texC && texC->isStaging()))
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Attempted to bind a staging texture to a shader";
+		return;
+	}
+
+	int num = 1;
+	if(texB != NULL)
+		num = 2;
+	if(texC != NULL)
+		num = 3;
+	D3D11Texture *textureA = static_cast<D3D11Texture *>(texA);
+	D3D11Texture *textureB = texB ? static_cast<D3D11Texture *>(texB) : NULL;
+	D3D11Texture *textureC = texC ? static_cast<D3D11Texture *>(texC) : NULL;
+	ID3D11ShaderResourceView *view[3] = {
+		textureA->getResourceView(),
+		texB ? textureB->getResourceView() : NULL,
+		texC ? textureC->getResourceView() : NULL };
+	bool isBound = (m_numBoundResourceViews >= num);
+	for(int i = 0; i < num && isBound; i++)
+		isBound = (view[i] == m_boundResourceViews[i]);
+	if(isBound)
+		m_numRedundantStateCalls++;
+	else {
+		m_dc->PSSetShaderResources(0, num, view);
+		for(int i = 0; i < num; i++)
+			m_boundResourceViews[i] = view[i];
+		m_numBoundResourceViews = qMax(num, m_numBoundResourceViews);
+	}
+
+	// Do we need to swizzle the RGB components as we're storing BGRA data in
+	// a RGBA texture?
+	setSwizzleInTexDecal(textureA->doBgraSwizzle());
+}
+
+void D3D11Context::setTextureFilter(VidgfxFilter filter)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+
+	ID3D11SamplerState *sampler = m_bilinearClampSampler;
+	switch(filter) {
+	case GfxPointFilter:
+		sampler = m_pointClampSampler;
+		break;
+	default:
+	case GfxBicubicFilter:
+	case GfxLanczosFilter:
+		// These are applied by `prepareTexture()` and the result is sampled
+		// bilinearly
+	case GfxBilinearFilter:
+		sampler = m_bilinearClampSampler;
+		break;
+	case GfxResizeLayerFilter:
+		sampler = m_resizeSampler;
+		break;
+	}
+	if(sampler == m_boundSampler) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_dc->PSSetSamplers(0, 1, &sampler);
+	m_boundSampler = sampler;
+}
+
+/// <summary>
+/// Limits all following draws to `rect` of the current render target in
+/// render target pixels. A null rectangle disables the limit. The rectangle is
+/// not reset when the render target changes and `clear()` is never limited.
+/// While a canvas is being redrawn the rectangle is combined with the redraw
+/// area when rendering to that canvas.
+/// </summary>
+void D3D11Context::setScissorRect(const QRect &rect)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(rect == m_scissorRect) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_scissorRect = rect;
+	applyScissorRect();
+}
+
+/// <summary>
+/// Binds the intersection of the user's scissor rectangle and the partial
+/// canvas redraw area of the current render target.
+/// </summary>
+void D3D11Context::applyScissorRect()
+{
+	QRect rect = m_scissorRect;
+	QRect redrawRect = getRedrawScissorRect();
+	bool enabled = !rect.isNull() || !redrawRect.isNull();
+	if(rect.isNull()) {
+		rect = redrawRect;
+	} else if(!redrawRect.isNull()) {
+		rect &= redrawRect;
+		if(rect.isEmpty())
+			rect = QRect(redrawRect.topLeft(), QSize(0, 0)); // Draw nothing
+	}
+
+	if(enabled == m_boundScissorEnabled &&
+		(!enabled || rect == m_boundScissorRect))
+	{
+		return; // Already bound
+	}
+	m_boundScissorEnabled = enabled;
+	m_boundScissorRect = rect;
+	if(!enabled) {
+		m_dc->RSSetState(m_rasterizerState);
+		return;
+	}
+	D3D11_RECT d3dRect;
+	d3dRect.left = rect.left();
+	d3dRect.top = rect.top();
+	d3dRect.right = rect.left() + rect.width();
+	d3dRect.bottom = rect.top() + rect.height();
+	m_dc->RSSetScissorRects(1, &d3dRect);
+	m_dc->RSSetState(m_scissorRasterizerState);
+}
+
+void D3D11Context::clear(const QColor &color)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+
+	// Get current render target
+	D3D11Context *root = getRootContext();
+	ID3D11RenderTargetView *targetView[2] = { NULL, NULL };
+	switch(m_currentTarget) {
+	default:
+	case GfxScreenTarget:
+		targetView[0] = root->m_screenTarget;
+		break;
+	case GfxCanvas1Target:
+		targetView[0] = root->m_canvas1Texture->getTargetView();
+		break;
+	case GfxCanvas2Target:
+		targetView[0] = root->m_canvas2Texture->getTargetView();
+		break;
+	case GfxScratch1Target:
+		targetView[0] = m_scratch1Texture->getTargetView();
+		break;
+	case GfxScratch2Target:
+		targetView[0] = m_scratch2Texture->getTargetView();
+		break;
+	case GfxUserTarget:
+		if(m_userTargets[0] != NULL && m_userTargets[0]->isTargetable()) {
+			targetView[0] =
+				static_cast<D3D11Texture *>(m_userTargets[0])->getTargetView();
+		}
+		if(m_userTargets[1] != NULL && m_userTargets[1]->isTargetable()) {
+			targetView[1] =
+				static_cast<D3D11Texture *>(m_userTargets[1])->getTargetView();
+		}
+		break;
+	}
+	if(targetView[0] == NULL && targetView[1] == NULL)
+		return;
+
+	float colorF[4];
+	colorF[0] = color.redF();
+	colorF[1] = color.greenF();
+	colorF[2] = color.blueF();
+	colorF[3] = color.alphaF();
+	if(targetView[0] != NULL)
+		m_dc->ClearRenderTargetView(targetView[0], colorF);
+	if(targetView[1] != NULL)
+		m_dc->ClearRenderTargetView(targetView[1], colorF);
+	markCurrentTargetModified();
+}
+
+void D3D11Context::drawBuffer(
+	VertexBuffer *buf, int numVertices, int startVertex)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(buf == NULL)
+		return; // Invalid input
+
+	if(numVertices < 0)
+		numVertices = buf->getNumVerts();
+	if(numVertices == 0)
+		return; // Nothing to render
+
+	// Restore the regular vertex shader if `drawInstanced()` replaced it
+	if(m_instancedVSBound) {
+		VidgfxShader shader = m_boundShader;
+		m_boundShader = GfxNoShader;
+		setShader(shader);
+	}
+
+	// Bind the vertex buffer and never draw past the data that was uploaded
+	D3D11VertexBuffer *buffer = static_cast<D3D11VertexBuffer *>(buf);
+	buffer->bind(this);
+	numVertices = qMin(
+		numVertices, buffer->getNumUploadedVerts(this) - startVertex);
+	if(numVertices <= 0)
+		return; // Nothing valid to render
+
+	// Update and bind all shader constants
+	bindDrawConstants();
+
+	// Actually send the draw command
+	m_dc->Draw(numVertices, startVertex);
+	markCurrentTargetModified();
+}
+
+/// <summary>
+/// Returns true if `drawInstanced()` is available. Requires a feature level
+/// 10.0 device.
+/// </summary>
+bool D3D11Context::hasInstancingSupport() const
+{
+	return m_hasInstancing;
+}
+
+/// <summary>
+/// Draws 4 copies of a unit quad for each instance in `instBuf` using the
+/// instanced version of the bound shader's vertex shader. Instance buffers are
+/// filled with `createTexDecalInstance()` for the texture decal shaders or
+/// `createSolidRectOutlineInstance()` for `GfxSolidShader`. Always renders
+/// with `TriangleStripTopology`.
+/// </summary>
+void D3D11Context::drawInstanced(
+	VertexBuffer *instBuf, int numInstances, int startInstance)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(instBuf == NULL)
+		return; // Invalid input
+	if(!m_hasInstancing)
+		return; // Not supported
+
+	if(numInstances < 0)
+		numInstances = instBuf->getNumVerts();
+	if(numInstances == 0)
+		return; // Nothing to render
+
+	// Replace the vertex shader of the bound shader
+	if(!bindInstancedShader()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Bound shader cannot be used for instanced rendering";
+		return;
+	}
+
+	// Bind the instance buffer followed by the unit quad so that the quad is
+	// always in slot 0 even if the instance buffer failed to bind
+	D3D11VertexBuffer *buffer = static_cast<D3D11VertexBuffer *>(instBuf);
+	buffer->bind(this, 1);
+	numInstances = qMin(
+		numInstances, buffer->getNumUploadedVerts(this) - startInstance);
+	if(numInstances <= 0)
+		return; // Nothing valid to render
+	uint stride = 2 * sizeof(float);
+	uint offset = 0;
+	m_dc->IASetVertexBuffers(0, 1, &m_unitQuadBuf, &stride, &offset);
+	setTopology(GfxTriangleStripTopology);
+
+	// Update and bind all shader constants
+	bindDrawConstants();
+
+	// Actually send the draw command. The per-instance data is stepped every
+	// 4 instances so one instance in the buffer is 4 quads on the GPU.
+	m_dc->DrawInstanced(4, numInstances * 4, 0, startInstance);
+	markCurrentTargetModified();
+}
@@ -0,0 +1,733 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#ifndef D3D11CONTEXT_H
+#define D3D11CONTEXT_H
+
+#include "graphicscontext.h"
+#include <QtCore/QSize>
+#include <windows.h>
+
+struct ID3D11BlendState;
+struct ID3D11Buffer;
+struct ID3D11CommandList;
+struct ID3D11ComputeShader;
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11Query;
+struct ID3D11RasterizerState;
+struct ID3D11RenderTargetView;
+struct ID3D11SamplerState;
+struct ID3D11ShaderResourceView;
+struct ID3D11Texture2D;
+struct ID3D11UnorderedAccessView;
+struct ID3D11VertexShader;
+struct IDXGIAdapter;
+struct IDXGIKeyedMutex; // DXGI 1.1
+struct IDXGISurface1; // DXGI 1.1
+struct IDXGISwapChain;
+struct D3D11_INPUT_ELEMENT_DESC;
+enum DXGI_FORMAT;
+
+class D3D11Context;
+
+//=============================================================================
+class D3D11VertexBuffer : public VertexBuffer
+{
+private: // Members -----------------------------------------------------------
+	D3D11Context *	m_context;
+	ID3D11Buffer *	m_buffer; // NULL if sub-allocated from a vertex ring
+
+	// The context that the data was last uploaded with. Deferred contexts
+	// must upload dynamic data again in every command list.
+	D3D11Context *	m_uploadContext;
+	quint32			m_uploadCmdList;
+
+	// Vertex ring allocation, only valid for the ring generation of the
+	// upload context that it was uploaded in
+	bool			m_useRing;
+	int				m_ringOffset;
+	int				m_ringNumFloats; // Number of floats that were uploaded
+	quint32			m_ringGeneration;
+
+public: // Constructor/destructor ---------------------------------------------
+	D3D11VertexBuffer(D3D11Context *context, int numFloats);
+	virtual ~D3D11VertexBuffer();
+
+public: // Methods ------------------------------------------------------------
+	void			update(D3D11Context *context);
+	void			bind(D3D11Context *context, uint slot = 0);
+	ID3D11Buffer *	getBuffer() const;
+	int				getNumUploadedVerts(D3D11Context *context) const;
+
+private:
+	void			createResources();
+	void			releaseResources();
+	bool			isUploaded(D3D11Context *context) const;
+};
+//=============================================================================
+
+//=============================================================================
+class D3D11Texture : public Texture
+{
+protected: // Members ---------------------------------------------------------
+	D3D11Context *				m_context; // Always the immediate context
+	ID3D11Texture2D *			m_tex;
+	ID3D11ShaderResourceView *	m_view;
+	ID3D11RenderTargetView *	m_target;
+	ID3D11UnorderedAccessView *	m_uav; // Compute shader output only
+	bool						m_doBgraSwizzle;
+	bool						m_isSrgb;
+	bool						m_isExternal;
+	VidgfxTexFlags				m_requestedFlags;
+	DXGI_FORMAT					m_requestedFormat;
+
+	// Shared textures only
+	HANDLE						m_sharedHandle;
+
+	// Shared textures with a keyed mutex only
+	IDXGIKeyedMutex *			m_keyedMutex;
+	bool						m_syncAcquired;
+	bool						m_hasReleaseKey;
+	quint64						m_releaseKey; // Last key of `releaseSync()`
+
+	// GDI-compatible textures only
+	IDXGISurface1 *				m_surface;
+	HDC							m_hdc;
+
+public: // Constructor/destructor ---------------------------------------------
+	D3D11Texture(
+		D3D11Context *context, VidgfxTexFlags flags, const QSize &size,
+		DXGI_FORMAT format, void *initialData = NULL, int stride = 0);
+	D3D11Texture(D3D11Context *context, ID3D11Texture2D *tex);
+	virtual ~D3D11Texture();
+
+public: // Methods ------------------------------------------------------------
+	void *						map(bool doNotWait);
+	ID3D11Texture2D *			getTexture() const;
+	ID3D11ShaderResourceView *	getResourceView() const;
+	ID3D11RenderTargetView *	getTargetView() const;
+	ID3D11UnorderedAccessView *	getUnorderedAccessView() const;
+	bool						doBgraSwizzle() const;
+	bool						isExternal() const;
+	VidgfxTexFlags				getRequestedFlags() const;
+	DXGI_FORMAT					getRequestedFormat() const;
+	qint64						getMemoryUsage();
+
+	HANDLE						getSharedHandle() const;
+	bool						hasKeyedMutex() const;
+	bool						isSyncAcquired() const;
+	VidgfxSyncResult			acquireSync(quint64 key, int timeoutMsec);
+	bool						releaseSync(quint64 key);
+
+	HDC							getDC();
+	void						releaseDC();
+
+	DXGI_FORMAT					getPixelFormat();
+
+private:
+	bool						createResources(
+		void *initialData, int stride);
+	void						releaseResources();
+	bool						isSrgbFormat(DXGI_FORMAT format);
+	static int					getBitsPerPixel(DXGI_FORMAT format);
+	bool						querySharedHandle();
+
+public: // Interface ----------------------------------------------------------
+	virtual void *		map();
+	virtual void		unmap();
+
+	virtual bool		isSrgbHack();
+};
+//=============================================================================
+
+inline ID3D11Texture2D *D3D11Texture::getTexture() const
+{
+	return m_tex;
+}
+
+inline ID3D11ShaderResourceView *D3D11Texture::getResourceView() const
+{
+	return m_view;
+}
+
+inline ID3D11RenderTargetView *D3D11Texture::getTargetView() const
+{
+	return m_target;
+}
+
+/// <summary>
+/// Returns the view that compute shaders write to. Only targetable textures on
+/// feature level 11.0 devices have one.
+/// </summary>
+inline ID3D11UnorderedAccessView *D3D11Texture::getUnorderedAccessView() const
+{
+	return m_uav;
+}
+
+inline bool D3D11Texture::doBgraSwizzle() const
+{
+	return m_doBgraSwizzle;
+}
+
+/// <summary>
+/// Returns true if the texture was created outside of libvidgfx and its
+/// contents can therefore be modified without our knowledge.
+/// </summary>
+inline bool D3D11Texture::isExternal() const
+{
+	return m_isExternal;
+}
+
+inline VidgfxTexFlags D3D11Texture::getRequestedFlags() const
+{
+	return m_requestedFlags;
+}
+
+inline DXGI_FORMAT D3D11Texture::getRequestedFormat() const
+{
+	return m_requestedFormat;
+}
+
+/// <summary>
+/// Returns the DXGI shared handle of the texture that other devices can use
+/// to open the texture with `OpenSharedResource()` without copying it.
+/// </summary>
+/// <returns>NULL if the texture isn't shareable</returns>
+inline HANDLE D3D11Texture::getSharedHandle() const
+{
+	return m_sharedHandle;
+}
+
+inline bool D3D11Texture::hasKeyedMutex() const
+{
+	return m_keyedMutex != NULL;
+}
+
+inline bool D3D11Texture::isSyncAcquired() const
+{
+	return m_syncAcquired;
+}
+
+//=============================================================================
+class D3D11ReadbackQueue : public ReadbackQueue
+{
+private: // Datatypes ---------------------------------------------------------
+	struct Slot {
+		D3D11Texture *	tex;
+		ID3D11Query *	query;
+		bool			pending;
+	};
+
+private: // Members -----------------------------------------------------------
+	D3D11Context *	m_context;
+	QVector<Slot>	m_slots;
+	int				m_nextWrite;
+	int				m_nextRead;
+	int				m_dequeued;
+	bool			m_isValid;
+
+public: // Constructor/destructor ---------------------------------------------
+	D3D11ReadbackQueue(D3D11Context *context, const QSize &size, int depth);
+	virtual ~D3D11ReadbackQueue();
+
+private: // Methods -----------------------------------------------------------
+	bool				createQueries();
+
+public: // Interface ----------------------------------------------------------
+	virtual bool		isValid() const;
+	virtual bool		enqueue(
+		Texture *src, const QPoint &srcPos = QPoint(0, 0));
+	virtual Texture *	tryDequeue();
+	virtual void		releaseDequeued();
+};
+//=============================================================================
+
+//=============================================================================
+/// <summary>
+/// A graphics context that renders with Direct3D 11. The context that is
+/// created with `initialize()` owns the device, the swap chain and the canvas
+/// and renders with the device's immediate context. Additional contexts that
+/// record into a deferred context can be created with
+/// `createDeferredContext()` so that command generation can be spread over
+/// multiple threads. Each deferred context must only be used by a single
+/// thread at a time and its commands are only executed once the immediate
+/// context calls `executeDeferredContext()` with it.
+/// </summary>
+class D3D11Context : public GraphicsContext
+{
+	Q_OBJECT
+
+private: // Datatypes ---------------------------------------------------------
+
+	// Every format conversion shader has its own cbuffer so that the constants
+	// are only uploaded again when they actually change
+	struct ConversionConstants {
+		float			local[8];
+		ID3D11Buffer *	buffer;
+		bool			isUploaded; // `local` matches the hardware buffer
+	};
+
+	struct ScaleCacheEntry {
+		Texture *		src;
+		quint32			srcGeneration;
+		QRect			cropRect;
+		QSize			size;
+		VidgfxFilter	filter;
+		D3D11Texture *	tex; // NULL if the source hasn't been seen unchanged
+		QPointF			pxSize;
+		QPointF			topLeft;
+		QPointF			botRight;
+		quint32			lastUsed;
+	};
+	typedef QVector<ScaleCacheEntry> ScaleCacheList;
+
+	// Filter weights of one axis of `resampleTexture()`
+	struct ResampleWeights {
+		VidgfxFilter	filter;
+		int				srcLen;
+		int				dstLen;
+		int				numTaps; // Always a multiple of 4
+		D3D11Texture *	tex;
+	};
+	typedef QVector<ResampleWeights> ResampleWeightsList; // Most recent first
+
+	// Every pixel shader that `getPixelShader()` can create. The tex decal
+	// shaders are last with one entry for every `TexDecal*Perm` combination.
+	enum PixelShader {
+		SolidPS = 0,
+		ResizePS,
+		RgbNv16PS,
+		Yv12RgbPS,
+		Nv12RgbPS,
+		UyvyRgbPS,
+		HdycRgbPS,
+		Yuy2RgbPS,
+		RgbYPS,
+		RgbNv12UvPS,
+		RgbI420UvPS,
+		RgbNv16ScaledPS,
+		RgbNv16Scaled709PS,
+		DilutePS, // Feature level 10.0 only
+		ResampleHorzPS, // Feature level 10.0 only
+		ResampleVertPS, // Feature level 10.0 only
+		TexDecalPS // Must be last
+	};
+
+	// Every compute shader that `getComputeShader()` can create, all of them
+	// require feature level 11.0
+	enum ComputeShader {
+		RgbNv12CS = 0,
+		RgbI420CS,
+		NumComputeShaders // Must be last
+	};
+
+private: // Constants ---------------------------------------------------------
+
+	// The number of shaders that have their own `ConversionConstants`
+	static const int	NumConversionShaders = 12;
+
+	// Compile-time features of the tex decal pixel shader permutations. Only
+	// the combinations that `getPixelShaderForShader()` can select exist.
+	static const int	TexDecalSwizzlePerm = 0x01;
+	static const int	TexDecalSrgbPerm = 0x02;
+	static const int	TexDecalBcPerm = 0x04; // Subset of `TexDecalGbcsPerm`
+	static const int	TexDecalGbcsPerm = 0x08;
+	static const int	TexDecalOpaquePerm = 0x10;
+	static const int	TexDecalPremultipliedPerm = 0x20;
+	static const int	NumTexDecalPerms = 64;
+
+	static const int	NumPixelShaders = TexDecalPS + NumTexDecalPerms;
+
+private: // Members -----------------------------------------------------------
+	D3D11Context *				m_parent; // NULL for the immediate context
+	bool						m_hasBgraTexSupport;
+	bool						m_hasBgraTexSupportValid;
+	bool						m_hasFeatureLevel10;
+	bool						m_hasFeatureLevel11;
+	bool						m_hasNoOverwriteRing;
+	int							m_adapterIndex; // -1 = Default adapter
+	bool						m_isDeviceLost;
+	IDXGISwapChain *			m_swapChain;
+	ID3D11Device *				m_device;
+	ID3D11DeviceContext *		m_dc; // Immediate or deferred
+	ID3D11RasterizerState *		m_rasterizerState;
+	ID3D11RasterizerState *		m_scissorRasterizerState;
+	QRect						m_scissorRect; // Null = Disabled
+	bool						m_boundScissorEnabled;
+	QRect						m_boundScissorRect;
+	ID3D11SamplerState *		m_pointClampSampler;
+	ID3D11SamplerState *		m_bilinearClampSampler;
+	ID3D11SamplerState *		m_resizeSampler;
+	ID3D11BlendState *			m_noBlend;
+	ID3D11BlendState *			m_alphaBlend;
+	ID3D11BlendState *			m_premultiBlend;
+
+	// Deferred contexts only. Command lists that have been finished but not
+	// yet executed by the immediate context, oldest first.
+	QVector<ID3D11CommandList *>	m_cmdLists;
+	quint32						m_cmdListCounter; // Incremented when finished
+
+	// Render targets. Deferred contexts render to the screen and canvas
+	// targets of the immediate context.
+	ID3D11RenderTargetView *	m_screenTarget;
+	QSize						m_screenTargetSize;
+	D3D11Texture *				m_canvas1Texture;
+	D3D11Texture *				m_canvas2Texture;
+	QSize						m_canvasTargetSize;
+	D3D11Texture *				m_scratch1Texture;
+	D3D11Texture *				m_scratch2Texture;
+	QSize						m_scratchTargetSize;
+	int							m_scratchNextTarget;
+
+	// Constant buffers. Each set of camera matrices has its own cbuffer so
+	// that switching between render targets doesn't require an upload.
+	float						m_cameraConstantsLocal[(4*4)*2]; // 2 4x4 matrices
+	ID3D11Buffer *				m_cameraConstants[NUM_CAMERA_SETS];
+	quint32						m_cameraUploadedVersions[NUM_CAMERA_SETS];
+	float						m_resizeConstantsLocal[4]; // 1 XYWH rectangle
+	ID3D11Buffer *				m_resizeConstants;
+	float						m_rgbNv16ConstantsLocal[4]; // 4 horizontal offsets
+	ID3D11Buffer *				m_rgbNv16Constants;
+	ConversionConstants			m_convConstants[NumConversionShaders];
+	// 1 RGBA colour + 1 integer for flags + 3 unused + 4 effect floats
+	float						m_texDecalConstantsLocal[12];
+	ID3D11Buffer *				m_texDecalConstants;
+	int							m_texDecalFlags; // `TexDecal*Perm` bits
+
+	// Dynamic vertex ring that small vertex buffers sub-allocate from. Every
+	// context has its own as the ring is mapped by the recording thread.
+	ID3D11Buffer *				m_vertRing;
+	int							m_vertRingPos; // In bytes
+	quint32						m_vertRingGeneration;
+
+	// Shadow copy of the device context state so that we can skip redundant
+	// calls. NULL or 0 means unknown.
+	ID3D11RenderTargetView *	m_boundTargetViews[2];
+	QRect						m_boundViewport;
+	int							m_boundTopology; // -1 = Unknown
+	ID3D11BlendState *			m_boundBlendState;
+	ID3D11ShaderResourceView *	m_boundResourceViews[3];
+	int							m_numBoundResourceViews; // -1 = Unknown
+	ID3D11SamplerState *		m_boundSampler;
+	ID3D11Buffer *				m_boundVSConstants;
+	ID3D11Buffer *				m_boundPSConstants;
+	quint32						m_numRedundantStateCalls;
+
+	// Shaders. Vertex shaders are created at initialization and are shared
+	// with deferred contexts while pixel and compute shaders are created by
+	// each context the first time that they are used. The pixel shader is
+	// bound by `bindPixelShader()` at draw time as the tex decal permutation
+	// depends on the bound texture.
+	VidgfxShader				m_boundShader;
+	int							m_boundPixelShader; // -1 = Unknown
+	ID3D11VertexShader *		m_solidVS;
+	ID3D11InputLayout *			m_solidIL;
+	ID3D11VertexShader *		m_texDecalVS; // Shared by most shaders
+	ID3D11InputLayout *			m_texDecalIL;
+	ID3D11VertexShader *		m_resizeVS;
+	ID3D11InputLayout *			m_resizeIL;
+	ID3D11PixelShader *			m_pixelShaders[NumPixelShaders];
+	bool						m_pixelShaderFailed[NumPixelShaders];
+	ID3D11ComputeShader *		m_computeShaders[NumComputeShaders];
+	bool						m_computeShaderFailed[NumComputeShaders];
+
+	// Instanced unit quad rendering, feature level 10.0 only. The instanced
+	// vertex shaders replace the vertex shader of the bound shader during
+	// `drawInstanced()`.
+	bool						m_hasInstancing;
+	bool						m_instancedVSBound;
+	ID3D11Buffer *				m_unitQuadBuf;
+	ID3D11VertexShader *		m_solidInstVS;
+	ID3D11InputLayout *			m_solidInstIL;
+	ID3D11VertexShader *		m_texDecalInstVS;
+	ID3D11InputLayout *			m_texDecalInstIL;
+
+	// Advanced rendering
+	VertexBuffer *				m_mipmapBuf;
+	ScaleCacheList				m_scaleCache;
+	int							m_scaleCacheMaxSize;
+	quint32						m_scaleCacheUseCounter;
+	ResampleWeightsList			m_resampleWeights;
+
+	HWND						m_hwnd;
+	QColor						m_resizeBorderCol;
+
+public: // Constructor/destructor ---------------------------------------------
+	D3D11Context();
+	virtual ~D3D11Context();
+
+public: // Methods ------------------------------------------------------------
+	bool			initialize(
+		HWND hwnd, const QSize &size, const QColor &resizeBorderCol,
+		int adapterIndex = -1);
+	int				getAdapterIndex() const;
+	ID3D11Device *	getDevice() const;
+	ID3D11DeviceContext *	getDeviceContext() const;
+	ID3D11DeviceContext *	getImmediateContext() const;
+	bool			isDeferred() const;
+	bool			hasFeatureLevel11() const;
+	bool			hasComputeSupport();
+	bool			hasBgraTexSupport();
+	Texture *		createGDITexture(const QSize &size);
+	Texture *		createSharedTexture(
+		const QSize &size, bool useKeyedMutex = true);
+	Texture *		openSharedTexture(HANDLE sharedHandle);
+	Texture *		openDX11Texture(ID3D11Texture2D *tex);
+	void			invalidateStateCache();
+	quint32			getNumRedundantStateCalls() const;
+	void			resetNumRedundantStateCalls();
+	bool			checkDeviceRemoved(HRESULT res);
+
+	// Deferred contexts
+	D3D11Context *	createDeferredContext();
+	void			deleteDeferredContext(D3D11Context *context);
+	bool			finishCommands();
+	void			executeDeferredContext(D3D11Context *context);
+	quint32			getCommandListCounter() const;
+
+	// Vertex ring
+	ID3D11Buffer *	getVertexRing() const;
+	quint32			getVertexRingGeneration() const;
+	bool			appendToVertexRing(
+		const void *data, int numBytes, int &offsetOut);
+
+private:
+	bool			createDeviceObjects(const QSize &size);
+	bool			createDeferredObjects(D3D11Context *parent);
+	bool			createContextObjects();
+	void			releaseDeviceObjects();
+	void			restoreDeviceState();
+	D3D11Context *	getRootContext();
+
+	bool			createScreenTarget();
+	bool			createShaders();
+	bool			createInstancingResources();
+	bool			createVertexShaderAndInputLayout(
+		const QString &shaderName, ID3D11VertexShader **shader,
+		ID3D11InputLayout **layout,
+		const D3D11_INPUT_ELEMENT_DESC *layoutDesc, int layoutDescSize);
+	bool			createPixelShader(
+		const QString &shaderName, ID3D11PixelShader **shader);
+	QByteArray		getShaderFileData(const QString &shaderName) const;
+	static QString	getPixelShaderName(int ps);
+	ID3D11PixelShader *	getPixelShader(int ps);
+	ID3D11ComputeShader *	getComputeShader(int cs);
+	int				getTexDecalEffectsPerm() const;
+	int				getPixelShaderForShader(VidgfxShader shader) const;
+	void			bindPixelShader();
+
+	void			fillCameraConstants(CameraSet set);
+	ID3D11Buffer *	updateCameraConstants();
+	void			updateResizeConstants();
+	void			updateRgbNv16Constants();
+	void			updateTexDecalConstants();
+	bool			updateConversionConstants(
+		VidgfxShader shader, const float *values);
+	ID3D11Buffer *	getConversionConstants(VidgfxShader shader) const;
+	bool			updateRgbYuv420Constants(
+		VidgfxShader shader, const QPointF &pxSize);
+	void			bindVSConstants(ID3D11Buffer *buf);
+	void			bindPSConstants(ID3D11Buffer *buf);
+	void			bindDrawConstants();
+	bool			bindInstancedShader();
+	void			applyScissorRect();
+	void			markCurrentTargetModified();
+	void			markDynamicDataStale();
+	int				findScaleCacheEntry(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter) const;
+	int				addScaleCacheEntry(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter);
+	void			removeScaleCacheEntries(Texture *src);
+	void			evictScaleCacheEntries(int maxEntries);
+	const ResampleWeights *	getResampleWeights(
+		VidgfxFilter filter, int srcLen, int dstLen);
+	Texture *		resampleTexture(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter);
+	bool			drawYuvPlanes(
+		VidgfxShader shader, Texture *src, Texture *targetA,
+		Texture *targetB);
+	bool			dispatchYuvPlanes(
+		int cs, Texture *src, Texture *planeA, Texture *planeB,
+		Texture *planeC);
+
+	void			setSwizzleInTexDecal(bool doSwizzle);
+
+public: // Interface ----------------------------------------------------------
+	virtual bool	isValid() const;
+	virtual void	flush();
+
+	// Buffers
+	virtual VertexBuffer *	createVertexBuffer(int size);
+	virtual void			deleteVertexBuffer(VertexBuffer *buf);
+	virtual Texture *		createTexture(
+		QImage img, bool writable = false, bool targetable = false);
+	virtual Texture *		createTexture(
+		const QSize &size, bool writable = false, bool targetable = false,
+		bool useBgra = false);
+	virtual Texture *		createTexture(
+		const QSize &size, Texture *sameFormat, bool writable = false,
+		bool targetable = false);
+	virtual Texture *		createStagingTexture(const QSize &size);
+	virtual Texture *		createRgTexture(
+		const QSize &size, bool writable = false, bool targetable = false);
+	virtual void			setScaleCacheSize(int maxEntries);
+	virtual int				getScaleCacheSize() const;
+	virtual void			purgeScaleCache();
+	virtual void			deleteTexture(Texture *tex);
+	virtual bool			copyTextureData(
+		Texture *dst, Texture *src, const QPoint &dstPos,
+		const QRect &srcRect);
+	virtual ReadbackQueue *	createReadbackQueue(
+		const QSize &size, int depth = 3);
+	virtual void			deleteReadbackQueue(ReadbackQueue *queue);
+
+	// Render targets
+	virtual void				resizeScreenTarget(const QSize &newSize);
+	virtual void				resizeCanvasTarget(const QSize &newSize);
+	virtual void				resizeScratchTarget(const QSize &newSize);
+	virtual void				swapScreenBuffers();
+	virtual	Texture *			getTargetTexture(VidgfxRendTarget target);
+	virtual VidgfxRendTarget	getNextScratchTarget();
+	virtual QPointF				getScratchTargetToTextureRatio();
+
+	// Advanced rendering
+	virtual Texture *	prepareTexture(
+		Texture *tex, const QSize &size, VidgfxFilter filter, bool setFilter,
+		QPointF &pxSizeOut, QPointF &botRightOut);
+	virtual Texture *	prepareTexture(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter, bool setFilter, QPointF &pxSizeOut,
+		QPointF &topLeftOut, QPointF &botRightOut);
+	virtual Texture *	convertToBgrx(
+		VidgfxPixFormat format, Texture *planeA, Texture *planeB,
+		Texture *planeC);
+	virtual bool		convertFromRgb(
+		VidgfxPixFormat format, Texture *src, Texture *planeA,
+		Texture *planeB, Texture *planeC = NULL);
+	virtual bool		scaleToNv16(
+		Texture *src, Texture *planeY, Texture *planeUV,
+		VidgfxYuvMatrix matrix = GfxBt601Matrix);
+	virtual bool		diluteTexture(Texture *src, Texture *dst);
+
+	// Drawing
+	virtual void		setRenderTarget(VidgfxRendTarget target);
+	virtual void		setShader(VidgfxShader shader);
+	virtual void		setTopology(VidgfxTopology topology);
+	virtual void		setBlending(VidgfxBlending blending);
+	virtual void		setTexture(
+		Texture *texA, Texture *texB = NULL, Texture *texC = NULL);
+	virtual void		setTextureFilter(VidgfxFilter filter);
+	virtual void		setScissorRect(const QRect &rect);
+	virtual void		clear(const QColor &color);
+	virtual void		drawBuffer(
+		VertexBuffer *buf, int numVertices = -1, int startVertex = 0);
+	virtual bool		hasInstancingSupport() const;
+	virtual void		drawInstanced(
+		VertexBuffer *instBuf, int numInstances = -1, int startInstance = 0);
+};
+//=============================================================================
+
+/// <summary>
+/// Returns the index of the adapter that was passed to `initialize()` or -1 if
+/// the default adapter is used.
+/// </summary>
+inline int D3D11Context::getAdapterIndex() const
+{
+	return m_adapterIndex;
+}
+
+inline ID3D11Device *D3D11Context::getDevice() const
+{
+	return m_device;
+}
+
+/// <summary>
+/// Returns the device context that this context records into. This is the
+/// device's immediate context unless `isDeferred()` is true.
+/// </summary>
+inline ID3D11DeviceContext *D3D11Context::getDeviceContext() const
+{
+	return m_dc;
+}
+
+/// <summary>
+/// Returns the immediate context of the device. Textures are always mapped
+/// with the immediate context regardless of which context created them.
+/// </summary>
+inline ID3D11DeviceContext *D3D11Context::getImmediateContext() const
+{
+	if(m_parent != NULL)
+		return m_parent->m_dc;
+	return m_dc;
+}
+
+inline bool D3D11Context::isDeferred() const
+{
+	return m_parent != NULL;
+}
+
+inline bool D3D11Context::hasFeatureLevel11() const
+{
+	return m_hasFeatureLevel11;
+}
+
+/// <summary>
+/// Returns the number of state changes that were skipped because the
+/// requested state was already bound to the device context.
+/// </summary>
+inline quint32 D3D11Context::getNumRedundantStateCalls() const
+{
+	return m_numRedundantStateCalls;
+}
+
+inline void D3D11Context::resetNumRedundantStateCalls()
+{
+	m_numRedundantStateCalls = 0;
+}
+
+/// <summary>
+/// Returns a counter that is incremented every time `finishCommands()` closes
+/// a command list. Dynamic data that was uploaded in an earlier command list
+/// must be uploaded again.
+/// </summary>
+inline quint32 D3D11Context::getCommandListCounter() const
+{
+	return m_cmdListCounter;
+}
+
+inline ID3D11Buffer *D3D11Context::getVertexRing() const
+{
+	return m_vertRing;
+}
+
+/// <summary>
+/// Returns a counter that is incremented every time the vertex ring is
+/// discarded. Allocations from a previous generation no longer contain valid
+/// data.
+/// </summary>
+inline quint32 D3D11Context::getVertexRingGeneration() const
+{
+	return m_vertRingGeneration;
+}
+
+#endif // D3D11CONTEXT_H
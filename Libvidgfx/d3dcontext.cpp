@@ -21,6 +21,7 @@
 #include "versionhelpers.h"
 #include <d3d10_1.h>
 #include <QtCore/QFile>
+#include <QtCore/qmath.h>
 #include <QtGui/QImage>
 
 // By default Mishira creates a DirectX 10.1 level 10.0 device. As we want to
@@ -41,6 +42,30 @@ const QString LOG_CAT = QStringLiteral("Gfx");
 // Function pointer to `CreateDXGIFactory1()`
 typedef HRESULT (WINAPI* PFN_DXGI_CREATE_DXGI_FACTORY1)(REFIID, void **);
 
+// Number of frames that the GPU profiler keeps in flight. Results are usually
+// available 2 frames after submission, if the ring fills up before then the
+// oldest frame is dropped instead of stalling.
+static const int NUM_PROFILE_FRAMES = 4;
+
+// Maximum number of scopes in a single profiled frame
+static const int MAX_PROFILE_SCOPES = 128;
+
+// Size of the shared dynamic vertex ring and the largest vertex buffer that
+// is sub-allocated from it. Larger buffers get their own hardware buffer.
+static const int VERTEX_RING_BYTES = 1024 * 1024;
+static const int VERTEX_RING_MAX_ALLOC_BYTES = 64 * 1024;
+
+// Maximum number of taps of a single `resampleTexture()` pass. Downscales
+// that need more than this are filtered with a narrower kernel.
+static const int MAX_RESAMPLE_TAPS = 64;
+
+// Number of weight textures that `resampleTexture()` keeps around for reuse
+static const int MAX_RESAMPLE_WEIGHTS = 8;
+
+// Minimum time between attempts to recreate a removed device so that a
+// driver that is still resetting isn't hammered every frame
+static const int DEVICE_RECOVERY_INTERVAL_MSEC = 500;
+
 //=============================================================================
 // Helpers
 
@@ -247,6 +272,27 @@ bool updateDXBuffer(
 	return true;
 }
 
+/// <summary>
+/// Profiles the GPU time of the enclosing C++ scope when the context's
+/// profiler is enabled.
+/// </summary>
+class ScopedProfile
+{
+private:
+	D3DContext *	m_context;
+
+public:
+	ScopedProfile(D3DContext *context, const char *name)
+		: m_context(context)
+	{
+		m_context->beginProfileScope(name);
+	}
+	~ScopedProfile()
+	{
+		m_context->endProfileScope();
+	}
+};
+
 //=============================================================================
 // D3DVertexBuffer class
 
@@ -254,31 +300,97 @@ D3DVertexBuffer::D3DVertexBuffer(D3DContext *context, int numFloats)
 	: VertexBuffer(numFloats)
 	, m_context(context)
 	, m_buffer(NULL)
+	, m_useRing(false)
+	, m_ringOffset(0)
+	, m_ringNumFloats(0)
+	, m_ringGeneration(0)
+{
+	m_context->addResource(this);
+	createResources();
+}
+
+D3DVertexBuffer::~D3DVertexBuffer()
+{
+	releaseResources();
+	m_context->removeResource(this);
+}
+
+void D3DVertexBuffer::createResources()
 {
+	// Small buffers that are rewritten every frame are sub-allocated from the
+	// context's vertex ring instead of each being renamed by the driver
+	m_useRing = false;
+	if(m_context->getVertexRing() != NULL &&
+		m_numFloats * (int)sizeof(float) <= VERTEX_RING_MAX_ALLOC_BYTES)
+	{
+		m_useRing = true;
+		return;
+	}
+
 	// Get device
 	ID3D10Device *device = m_context->getDevice();
 
 	// Create hardware buffer
 	D3D10_BUFFER_DESC desc;
-	desc.ByteWidth = numFloats * sizeof(float);
+	desc.ByteWidth = m_numFloats * sizeof(float);
 	desc.Usage = D3D10_USAGE_DYNAMIC;
 	desc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
 	desc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
 	desc.MiscFlags = 0;
 	if(!createDXBuffer(device, &desc, m_data, &m_buffer)) {
 		// Failed to create buffer
+		m_buffer = NULL;
 		return;
 	}
+	m_dirty = false; // Created with the current data
 }
 
-D3DVertexBuffer::~D3DVertexBuffer()
+/// <summary>
+/// Releases the hardware buffer when the device is lost. The vertex data is
+/// kept in RAM so that `recreateResources()` can restore it.
+/// </summary>
+void D3DVertexBuffer::releaseResources()
 {
 	if(m_buffer)
 		m_buffer->Release();
+	m_buffer = NULL;
+}
+
+void D3DVertexBuffer::recreateResources()
+{
+	if(m_buffer != NULL)
+		return; // Already exists
+
+	// Ring allocations are invalidated by the ring generation changing
+	createResources();
 }
 
 void D3DVertexBuffer::update()
 {
+	if(m_useRing) {
+		// Only the vertices that are actually in use are uploaded. The
+		// allocation is lost whenever the ring wraps so reupload then as well.
+		int numFloats = m_numVerts * m_vertSize;
+		if(numFloats <= 0 || numFloats > m_numFloats)
+			numFloats = m_numFloats;
+		if(!m_dirty &&
+			m_ringGeneration == m_context->getVertexRingGeneration() &&
+			numFloats <= m_ringNumFloats)
+		{
+			return; // Allocation is up-to-date
+		}
+		if(!m_context->appendToVertexRing(
+			m_data, numFloats * sizeof(float), m_ringOffset))
+		{
+			// Failed to update buffer contents
+			return;
+		}
+		m_ringNumFloats = numFloats;
+		m_ringGeneration = m_context->getVertexRingGeneration();
+		m_dirty = false;
+		return;
+	}
+
 	if(m_buffer == NULL)
 		return; // Buffer doesn't exist
 	if(!m_dirty)
@@ -293,18 +405,26 @@ void D3DVertexBuffer::update()
 		// Failed to update buffer contents
 		return;
 	}
+	m_context->addProfileBytesUploaded(bufSize);
 
 	m_dirty = false;
 }
 
-void D3DVertexBuffer::bind()
+void D3DVertexBuffer::bind(uint slot)
 {
-	if(m_buffer == NULL)
-		return; // Buffer doesn't exist
-
-	// Make sure the buffer isn't dirty
-	if(m_dirty)
+	if(m_useRing) {
+		// Make sure the allocation is valid, the ring may have wrapped since
 		update();
+		if(m_ringGeneration != m_context->getVertexRingGeneration())
+			return; // Failed to upload
+	} else {
+		if(m_buffer == NULL)
+			return; // Buffer doesn't exist
+
+		// Make sure the buffer isn't dirty
+		if(m_dirty)
+			update();
+	}
 
 	// Get device
 	ID3D10Device *device = m_context->getDevice();
@@ -313,8 +433,36 @@ void D3DVertexBuffer::bind()
 	if(m_vertSize <= 0)
 		return; // Invalid stride
 	uint stride = m_vertSize * sizeof(float);
-	uint offset = 0;
-	device->IASetVertexBuffers(0, 1, &m_buffer, &stride, &offset);
+	uint offset = m_useRing ? m_ringOffset : 0;
+	ID3D10Buffer *buffer = getBuffer();
+	device->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+ID3D10Buffer *D3DVertexBuffer::getBuffer() const
+{
+	if(m_useRing)
+		return m_context->getVertexRing();
+	return m_buffer;
+}
+
+/// <summary>
+/// Returns the number of vertices that the graphics hardware has valid data
+/// for. Vertex ring allocations only contain the vertices that were in use
+/// when they were uploaded, drawing past them would read another buffer's
+/// data.
+/// </summary>
+int D3DVertexBuffer::getNumUploadedVerts() const
+{
+	if(m_vertSize <= 0)
+		return 0;
+	if(m_useRing) {
+		if(m_ringGeneration != m_context->getVertexRingGeneration())
+			return 0; // Allocation is no longer valid
+		return m_ringNumFloats / m_vertSize;
+	}
+	if(m_buffer == NULL)
+		return 0;
+	return m_numFloats / m_vertSize;
 }
 
 //=============================================================================
@@ -324,23 +472,46 @@ D3DTexture::D3DTexture(
 	D3DContext *context, VidgfxTexFlags flags, const QSize &size,
 	DXGI_FORMAT format, void *initialData, int stride)
 	: Texture(flags, size)
+	, m_context(context)
 	, m_tex(NULL)
 	, m_view(NULL)
 	, m_target(NULL)
 	, m_doBgraSwizzle(false)
 	, m_isSrgb(false)
+	, m_isExternal(false)
+	, m_requestedFlags(flags)
+	, m_requestedFormat(format)
+
+	// Shared textures only
+	, m_sharedHandle(NULL)
+
+	// Shared textures with a keyed mutex only
+	, m_keyedMutex(NULL)
+	, m_syncAcquired(false)
+	, m_hasReleaseKey(false)
+	, m_releaseKey(0)
 
 	// GDI-compatible textures only
 	, m_surface(NULL)
 	, m_hdc(NULL)
+{
+	m_context->addResource(this);
+	m_isValid = createResources(initialData, stride);
+}
+
+bool D3DTexture::createResources(void *initialData, int stride)
 {
 	// Get device
-	ID3D10Device *device = context->getDevice();
+	ID3D10Device *device = m_context->getDevice();
+	DXGI_FORMAT format = m_requestedFormat;
+	VidgfxTexFlags flags = m_requestedFlags;
+	QSize size = m_size;
 
 	// If the device doesn't support BGRA textures but the pixel format was
 	// requested we instead use an RGBA pixel format and do a swizzle in the
 	// pixel shader.
-	if(!context->hasBgraTexSupport()) {
+	m_doBgraSwizzle = false;
+	if(!m_context->hasBgraTexSupport()) {
 		if(format == DXGI_FORMAT_B8G8R8A8_UNORM) {
 			format = DXGI_FORMAT_R8G8B8A8_UNORM;
 			m_doBgraSwizzle = true;
@@ -375,10 +546,13 @@ D3DTexture::D3DTexture(
 			: (D3D10_BIND_SHADER_RESOURCE);
 		desc.CPUAccessFlags = isWritable() ? D3D10_CPU_ACCESS_WRITE : 0;
 	}
+	desc.MiscFlags = 0;
 	if(flags & GfxGDIFlag)
-		desc.MiscFlags = D3D10_RESOURCE_MISC_GDI_COMPATIBLE;
-	else
-		desc.MiscFlags = 0;
+		desc.MiscFlags |= D3D10_RESOURCE_MISC_GDI_COMPATIBLE;
+	if(flags & GfxKeyedMutexFlag)
+		desc.MiscFlags |= D3D10_RESOURCE_MISC_SHARED_KEYEDMUTEX;
+	else if(flags & GfxSharedFlag)
+		desc.MiscFlags |= D3D10_RESOURCE_MISC_SHARED;
 
 	HRESULT res;
 	if(stride <= 0)
@@ -396,7 +570,7 @@ D3DTexture::D3DTexture(
 		gfxLog(LOG_CAT, GfxLog::Warning)
 			<< "Failed to create DirectX texture. "
 			<< "Reason = " << getDXErrorCode(res);
-		return;
+		return false;
 	}
 
 	//-------------------------------------------------------------------------
@@ -413,7 +587,7 @@ D3DTexture::D3DTexture(
 			gfxLog(LOG_CAT, GfxLog::Warning)
 				<< "Failed to create DirectX shader resource view. "
 				<< "Reason = " << getDXErrorCode(res);
-			return;
+			return false;
 		}
 	}
 
@@ -427,26 +601,59 @@ D3DTexture::D3DTexture(
 				<< "Failed to create DirectX render target view. "
 				<< "Reason = " << getDXErrorCode(res);
 			m_flags &= ~GfxTargetableFlag; // Unset flag
-			return;
+			return false;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Get shared handle and keyed mutex
+
+	if(flags & (GfxSharedFlag | GfxKeyedMutexFlag)) {
+		if(!querySharedHandle())
+			return false;
+	}
+	if(flags & GfxKeyedMutexFlag) {
+		res = m_tex->QueryInterface(
+			__uuidof(IDXGIKeyedMutex), (void **)&m_keyedMutex);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to get the keyed mutex of a shared texture. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_keyedMutex = NULL;
+			return false;
 		}
 	}
 
 	// Texture was successfully created
-	m_isValid = true;
+	return true;
 }
 
 D3DTexture::D3DTexture(D3DContext *context, ID3D10Texture2D *tex)
 	: Texture(0, QSize(0, 0)) // We update the size later
+	, m_context(context)
 	, m_tex(tex)
 	, m_view(NULL)
 	, m_target(NULL)
 	, m_doBgraSwizzle(false)
 	, m_isSrgb(false)
+	, m_isExternal(true)
+	, m_requestedFlags(0)
+	, m_requestedFormat(DXGI_FORMAT_UNKNOWN)
+
+	// Shared textures only
+	, m_sharedHandle(NULL)
+
+	// Shared textures with a keyed mutex only
+	, m_keyedMutex(NULL)
+	, m_syncAcquired(false)
+	, m_hasReleaseKey(false)
+	, m_releaseKey(0)
 
 	// GDI-compatible textures only
 	, m_surface(NULL)
 	, m_hdc(NULL)
 {
+	m_context->addResource(this);
 	if(m_tex == NULL)
 		return;
 
@@ -468,6 +675,27 @@ D3DTexture::D3DTexture(D3DContext *context, ID3D10Texture2D *tex)
 	if(desc.MiscFlags & D3D10_RESOURCE_MISC_GDI_COMPATIBLE)
 		m_flags |= GfxGDIFlag;
 
+	// Remember the shared handle so that the texture can be passed on to
+	// other devices
+	if(desc.MiscFlags & (D3D10_RESOURCE_MISC_SHARED |
+		D3D10_RESOURCE_MISC_SHARED_KEYEDMUTEX))
+	{
+		querySharedHandle();
+	}
+
+	// Get the keyed mutex if the producer created the texture with one so
+	// that we can safely sample the texture directly instead of copying it
+	if(desc.MiscFlags & D3D10_RESOURCE_MISC_SHARED_KEYEDMUTEX) {
+		HRESULT res = m_tex->QueryInterface(
+			__uuidof(IDXGIKeyedMutex), (void **)&m_keyedMutex);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to get the keyed mutex of a shared texture. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_keyedMutex = NULL;
+		}
+	}
+
 	// Create shader resource view
 	if(!isStaging()) {
 		D3D10_SHADER_RESOURCE_VIEW_DESC viewDesc;
@@ -491,6 +719,32 @@ D3DTexture::D3DTexture(D3DContext *context, ID3D10Texture2D *tex)
 
 D3DTexture::~D3DTexture()
 {
+	releaseResources();
+	m_context->removeResource(this);
+}
+
+/// <summary>
+/// Releases every hardware object of the texture when the device is lost. The
+/// texture object itself remains usable but is invalid until
+/// `recreateResources()` succeeds.
+/// </summary>
+void D3DTexture::releaseResources()
+{
+	if(m_keyedMutex) {
+		if(m_syncAcquired) {
+			// Hand the mutex to the peer with the same key that we released
+			// it with last time. Releasing with the acquire key would give it
+			// back to ourselves and leave the peer waiting forever.
+			if(m_hasReleaseKey) {
+				m_keyedMutex->ReleaseSync(m_releaseKey);
+			} else {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Deleting a shared texture that was never released with "
+					<< "releaseSync(), the peer may stay blocked";
+			}
+		}
+		m_keyedMutex->Release();
+	}
 	if(m_surface) {
 		m_surface->ReleaseDC(NULL);
 		m_surface->Release();
@@ -501,9 +755,51 @@ D3DTexture::~D3DTexture()
 		m_tex->Release();
 	if(m_target)
 		m_target->Release();
+	m_keyedMutex = NULL;
+	m_syncAcquired = false;
+	m_surface = NULL;
+	m_hdc = NULL;
+	m_view = NULL;
+	m_tex = NULL;
+	m_target = NULL;
+	m_sharedHandle = NULL;
+	m_mappedData = NULL;
+	m_stride = 0;
+	m_isValid = false;
+}
+
+/// <summary>
+/// Recreates the texture on the current device with the size, flags and
+/// format that it was originally created with. The texel data is undefined
+/// afterwards. Textures that were created outside of libvidgfx cannot be
+/// recreated and remain invalid. Shared textures receive a new shared handle.
+/// </summary>
+/// <returns>True if the texture is valid</returns>
+bool D3DTexture::recreateResources()
+{
+	if(m_tex != NULL)
+		return m_isValid; // Never released
+	if(m_isExternal)
+		return false;
+	m_flags = m_requestedFlags;
+	m_isValid = createResources(NULL, 0);
+	if(!m_isValid)
+		releaseResources(); // Don't keep a partially created texture
+	markModified();
+	return m_isValid;
 }
 
 void *D3DTexture::map()
+{
+	return map(false);
+}
+
+/// <summary>
+/// Maps the texture into CPU memory. If `doNotWait` is true and the graphics
+/// hardware is still using the texture then NULL is returned immediately
+/// instead of stalling the calling thread until the texture is available.
+/// </summary>
+void *D3DTexture::map(bool doNotWait)
 {
 	if(m_tex == NULL)
 		return NULL; // Texture doesn't exist
@@ -512,17 +808,25 @@ void *D3DTexture::map()
 	D3D10_MAP mapType = D3D10_MAP_WRITE_DISCARD;
 	if(isStaging())
 		mapType = D3D10_MAP_READ;
+	UINT mapFlags = doNotWait ? D3D10_MAP_FLAG_DO_NOT_WAIT : 0;
 	HRESULT res = m_tex->Map(
-		D3D10CalcSubresource(0, 0, 0), mapType, 0, &mapInfo);
+		D3D10CalcSubresource(0, 0, 0), mapType, mapFlags, &mapInfo);
+	if(res == DXGI_ERROR_WAS_STILL_DRAWING)
+		return NULL; // Only returned when `doNotWait` is true, not an error
 	if(FAILED(res)) {
 		gfxLog(LOG_CAT, GfxLog::Warning)
 			<< "Failed to map texture buffer into RAM. "
 			<< "Reason = " << getDXErrorCode(res);
+		m_context->checkDeviceRemoved(res);
 		return NULL;
 	}
 
 	m_mappedData = mapInfo.pData;
 	m_stride = mapInfo.RowPitch;
+	if(isStaging()) {
+		m_context->addProfileBytesReadBack(
+			(qint64)m_stride * (qint64)m_size.height());
+	}
 
 	return m_mappedData;
 }
@@ -534,9 +838,15 @@ void D3DTexture::unmap()
 	if(!isMapped())
 		return;
 
+	if(!isStaging()) {
+		m_context->addProfileBytesUploaded(
+			(qint64)m_stride * (qint64)m_size.height());
+	}
 	m_mappedData = NULL;
 	m_stride = 0;
 	m_tex->Unmap(D3D10CalcSubresource(0, 0, 0));
+	if(!isStaging())
+		markModified();
 }
 
 DXGI_FORMAT D3DTexture::getPixelFormat()
@@ -546,6 +856,93 @@ DXGI_FORMAT D3DTexture::getPixelFormat()
 	return desc.Format;
 }
 
+/// <summary>
+/// Returns the approximate amount of video memory used by this texture in
+/// bytes.
+/// </summary>
+qint64 D3DTexture::getMemoryUsage()
+{
+	if(m_tex == NULL)
+		return 0;
+	return (qint64)m_size.width() * (qint64)m_size.height() *
+		(qint64)getBitsPerPixel(getPixelFormat()) / 8LL;
+}
+
+/// <summary>
+/// Returns the number of bits that a single pixel of `format` uses in video
+/// memory. Block-compressed formats return their average rate.
+/// </summary>
+int D3DTexture::getBitsPerPixel(DXGI_FORMAT format)
+{
+	switch(format) {
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+		return 64;
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+	default:
+		return 32; // All other formats that we use are 32 bits per pixel
+	}
+	return 32; // Should never be reached
+}
+
 bool D3DTexture::isSrgbFormat(DXGI_FORMAT format)
 {
 	switch(format) {
@@ -604,6 +1001,88 @@ HDC D3DTexture::getDC()
 	return m_hdc;
 }
 
+/// <summary>
+/// Fetches the DXGI shared handle of the texture. The handle is owned by the
+/// resource and doesn't need to be closed.
+/// </summary>
+bool D3DTexture::querySharedHandle()
+{
+	IDXGIResource *resource = NULL;
+	HRESULT res = m_tex->QueryInterface(
+		__uuidof(IDXGIResource), (void **)&resource);
+	if(SUCCEEDED(res)) {
+		res = resource->GetSharedHandle(&m_sharedHandle);
+		resource->Release();
+	}
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to get the shared handle of a texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		m_sharedHandle = NULL;
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Acquires the keyed mutex of a shared texture so that it can be safely
+/// sampled while the producer isn't writing to it. `key` must match the key
+/// that the producer released the texture with. The texture must be released
+/// with `releaseSync()` using the key that the producer expects to acquire
+/// with as soon as rendering with it has been queued. If the texture is deleted
+/// while still acquired it is released with the key of the previous
+/// `releaseSync()` call.
+/// </summary>
+VidgfxSyncResult D3DTexture::acquireSync(quint64 key, int timeoutMsec)
+{
+	if(m_keyedMutex == NULL)
+		return GfxSyncNoMutex;
+	if(m_syncAcquired)
+		return GfxSyncAcquired; // Already acquired
+
+	HRESULT res = m_keyedMutex->AcquireSync(
+		key, timeoutMsec < 0 ? INFINITE : (DWORD)timeoutMsec);
+	if(res == WAIT_TIMEOUT)
+		return GfxSyncTimeout; // Not an error
+	if(res == WAIT_ABANDONED) {
+		// We still own the mutex but the contents are undefined. The producer
+		// may have written to it before it went away.
+		m_syncAcquired = true;
+		markModified();
+		return GfxSyncAbandoned;
+	}
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to acquire the keyed mutex of a shared texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		return GfxSyncFailed;
+	}
+	m_syncAcquired = true;
+	markModified(); // The producer has most likely written a new frame
+	return GfxSyncAcquired;
+}
+
+/// <summary>
+/// Releases the keyed mutex that was acquired with `acquireSync()` so that
+/// the next owner that waits on `key` can acquire it.
+/// </summary>
+bool D3DTexture::releaseSync(quint64 key)
+{
+	if(m_keyedMutex == NULL || !m_syncAcquired)
+		return false;
+	HRESULT res = m_keyedMutex->ReleaseSync(key);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to release the keyed mutex of a shared texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	m_syncAcquired = false;
+	m_hasReleaseKey = true;
+	m_releaseKey = key;
+	return true;
+}
+
 void D3DTexture::releaseDC()
 {
 	if(m_surface == NULL)
@@ -612,6 +1091,209 @@ void D3DTexture::releaseDC()
 	m_surface->Release();
 	m_surface = NULL;
 	m_hdc = NULL;
+	markModified();
+}
+
+//=============================================================================
+// D3DReadbackQueue class
+
+D3DReadbackQueue::D3DReadbackQueue(
+	D3DContext *context, const QSize &size, int depth)
+	: ReadbackQueue(size, depth)
+	, m_context(context)
+	, m_slots()
+	, m_nextWrite(0)
+	, m_nextRead(0)
+	, m_dequeued(-1)
+	, m_isValid(false)
+{
+	m_context->addResource(this);
+
+	// Create a staging texture for every slot in the ring
+	m_slots.reserve(m_depth);
+	for(int i = 0; i < m_depth; i++) {
+		Slot slot;
+		slot.tex = static_cast<D3DTexture *>(
+			m_context->createStagingTexture(m_size));
+		slot.query = NULL;
+		slot.pending = false;
+		if(slot.tex == NULL)
+			return; // Error already logged
+		m_slots.append(slot);
+	}
+
+	// Queue was successfully created if all of its queries were
+	m_isValid = createQueries();
+}
+
+D3DReadbackQueue::~D3DReadbackQueue()
+{
+	releaseDequeued();
+	for(int i = 0; i < m_slots.size(); i++) {
+		const Slot &slot = m_slots.at(i);
+		if(slot.query)
+			slot.query->Release();
+		m_context->deleteTexture(slot.tex);
+	}
+	m_slots.clear();
+	m_context->removeResource(this);
+}
+
+/// <summary>
+/// Creates an event query for every slot in the ring. The query is used to
+/// determine when the GPU has finished copying into the staging texture
+/// without having to attempt to map it.
+/// </summary>
+bool D3DReadbackQueue::createQueries()
+{
+	// Get device
+	ID3D10Device *device = m_context->getDevice();
+
+	D3D10_QUERY_DESC queryDesc;
+	queryDesc.Query = D3D10_QUERY_EVENT;
+	queryDesc.MiscFlags = 0;
+	for(int i = 0; i < m_slots.size(); i++) {
+		if(m_slots.at(i).query != NULL)
+			continue; // Already exists
+		HRESULT res = device->CreateQuery(&queryDesc, &m_slots[i].query);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create DirectX event query. "
+				<< "Reason = " << getDXErrorCode(res);
+			m_slots[i].query = NULL;
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Releases the event queries and forgets every queued frame when the device
+/// is lost. The staging textures are released by the context separately.
+/// </summary>
+void D3DReadbackQueue::releaseResources()
+{
+	releaseDequeued();
+	for(int i = 0; i < m_slots.size(); i++) {
+		Slot &slot = m_slots[i];
+		if(slot.query)
+			slot.query->Release();
+		slot.query = NULL;
+		slot.pending = false;
+	}
+	m_nextWrite = 0;
+	m_nextRead = 0;
+	m_dequeued = -1;
+	m_hasDequeued = false;
+	m_numPending = 0;
+	m_isValid = false;
+}
+
+/// <summary>
+/// Recreates the event queries after the device has been recreated. Must be
+/// called after the staging textures have been recreated.
+/// </summary>
+bool D3DReadbackQueue::recreateResources()
+{
+	if(m_slots.size() != m_depth)
+		return false; // Failed to create initially
+	for(int i = 0; i < m_slots.size(); i++) {
+		if(!m_slots.at(i).tex->isValid())
+			return false;
+	}
+	m_isValid = createQueries();
+	return m_isValid;
+}
+
+bool D3DReadbackQueue::isValid() const
+{
+	return m_isValid;
+}
+
+/// <summary>
+/// Queues a copy of the `getSize()` area at `srcPos` of the texture `src` into
+/// the next free staging texture in the ring. The source texture must have the
+/// same pixel format as the textures returned by `createStagingTexture()`.
+/// </summary>
+/// <returns>
+/// True if the copy was queued or false if the ring is full or on failure.
+/// </returns>
+bool D3DReadbackQueue::enqueue(Texture *src, const QPoint &srcPos)
+{
+	if(!m_isValid || src == NULL)
+		return false;
+	if(isFull())
+		return false; // The caller must dequeue or release first
+	Slot &slot = m_slots[m_nextWrite];
+	if(slot.pending || m_nextWrite == m_dequeued)
+		return false; // Slot is still in use, `isFull()` prevents this
+
+	// Queue the copy followed by the event that signals its completion
+	if(!m_context->copyTextureData(
+		slot.tex, src, QPoint(0, 0), QRect(srcPos, m_size)))
+	{
+		return false; // Error already logged
+	}
+	slot.query->End();
+	slot.pending = true;
+
+	m_nextWrite = (m_nextWrite + 1) % m_depth;
+	m_numPending++;
+	return true;
+}
+
+/// <summary>
+/// Returns the oldest queued frame if the graphics hardware has finished
+/// copying it into its staging texture. The returned texture is already mapped
+/// and remains valid until `releaseDequeued()` is called, the next call to
+/// `tryDequeue()` or the queue is deleted.
+/// </summary>
+/// <returns>
+/// The mapped staging texture or NULL if the oldest frame isn't ready yet.
+/// </returns>
+Texture *D3DReadbackQueue::tryDequeue()
+{
+	if(!m_isValid || m_numPending <= 0)
+		return NULL; // Nothing to dequeue
+	releaseDequeued();
+	Slot &slot = m_slots[m_nextRead];
+
+	// Test the event first as it's cheaper than a failed map. The first poll
+	// is allowed to flush the command buffer so that the copy is guaranteed to
+	// be submitted to the graphics hardware.
+	HRESULT res = slot.query->GetData(NULL, 0, 0);
+	if(res == S_FALSE)
+		return NULL; // Still processing
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to query DirectX event state. "
+			<< "Reason = " << getDXErrorCode(res);
+		if(m_context->checkDeviceRemoved(res))
+			return NULL;
+		// Attempt to map anyway
+	}
+	if(slot.tex->map(true) == NULL)
+		return NULL; // Still processing
+
+	slot.pending = false;
+	m_dequeued = m_nextRead;
+	m_hasDequeued = true;
+	m_nextRead = (m_nextRead + 1) % m_depth;
+	m_numPending--;
+	return slot.tex;
+}
+
+/// <summary>
+/// Unmaps the texture that was returned by `tryDequeue()` so that its slot can
+/// be reused.
+/// </summary>
+void D3DReadbackQueue::releaseDequeued()
+{
+	if(m_dequeued < 0)
+		return; // Nothing dequeued
+	m_slots[m_dequeued].tex->unmap();
+	m_dequeued = -1;
+	m_hasDequeued = false;
 }
 
 //=============================================================================
@@ -756,15 +1438,242 @@ void D3DContext::logDisplayAdapters()
 		factory->Release();
 }
 
-D3DContext::D3DContext()
+/// <summary>
+/// Creates the same type of DXGI factory as the rest of the process uses,
+/// `IDXGIFactory1` on Windows 8 and later and `IDXGIFactory` otherwise. Only
+/// one of the two outputs is set. See `getFirstDxgi11Adapter()` for why.
+/// </summary>
+static HRESULT createProcessDxgiFactory(
+	IDXGIFactory **factoryOut, IDXGIFactory1 **factory1Out)
+{
+	*factoryOut = NULL;
+	*factory1Out = NULL;
+	HRESULT res = D3DContext::createDXGIFactory1Dynamic(factory1Out);
+	if(*factory1Out == NULL) {
+		res = CreateDXGIFactory(
+			__uuidof(IDXGIFactory), (void **)factoryOut);
+	}
+	return res;
+}
+
+/// <summary>
+/// Returns the adapter at `index` of whichever factory is non-NULL or NULL if
+/// there is no such adapter. The caller must release the returned object.
+/// </summary>
+static IDXGIAdapter *enumDxgiAdapter(
+	IDXGIFactory *factory, IDXGIFactory1 *factory1, uint index)
+{
+	if(factory1 != NULL) {
+		IDXGIAdapter1 *adapter = NULL;
+		if(FAILED(factory1->EnumAdapters1(index, &adapter)))
+			return NULL;
+		return adapter;
+	}
+	if(factory != NULL) {
+		IDXGIAdapter *adapter = NULL;
+		if(FAILED(factory->EnumAdapters(index, &adapter)))
+			return NULL;
+		return adapter;
+	}
+	return NULL;
+}
+
+/// <summary>
+/// Creates a temporary device on `adapter` to determine the highest feature
+/// level that we support and whether or not BGRA textures are supported.
+/// </summary>
+/// <returns>False if no device could be created at all</returns>
+static bool probeAdapter(
+	IDXGIAdapter *adapter, bool &hasLevel10Out, bool &hasBgraOut)
+{
+	hasLevel10Out = false;
+	hasBgraOut = false;
+
+	// Use the DirectX 10.1 API if it's available, see `initialize()`
+	HMODULE d3d101Mod = LoadLibrary(TEXT("d3d10_1.dll"));
+	PFN_D3D10_CREATE_DEVICE1 D3D10CreateDevice1Dyn = NULL;
+	if(d3d101Mod != NULL) {
+		D3D10CreateDevice1Dyn = (PFN_D3D10_CREATE_DEVICE1)
+			GetProcAddress(d3d101Mod, "D3D10CreateDevice1");
+	}
+
+	ID3D10Device *device = NULL;
+	if(D3D10CreateDevice1Dyn != NULL) {
+		ID3D10Device1 *device1 = NULL;
+		HRESULT res = D3D10CreateDevice1Dyn(
+			adapter, D3D10_DRIVER_TYPE_HARDWARE, NULL, 0,
+			D3D10_FEATURE_LEVEL_10_0, D3D10_1_SDK_VERSION, &device1);
+		if(SUCCEEDED(res))
+			hasLevel10Out = true;
+		else {
+			res = D3D10CreateDevice1Dyn(
+				adapter, D3D10_DRIVER_TYPE_HARDWARE, NULL, 0,
+				D3D10_FEATURE_LEVEL_9_3, D3D10_1_SDK_VERSION, &device1);
+		}
+		if(SUCCEEDED(res)) {
+			device1->QueryInterface(
+				__uuidof(ID3D10Device), (void **)&device);
+			device1->Release();
+		}
+	} else {
+		HRESULT res = D3D10CreateDevice(
+			adapter, D3D10_DRIVER_TYPE_HARDWARE, NULL, 0, D3D10_SDK_VERSION,
+			&device);
+		if(SUCCEEDED(res))
+			hasLevel10Out = true;
+	}
+	if(d3d101Mod != NULL)
+		FreeLibrary(d3d101Mod);
+	if(device == NULL)
+		return false;
+
+	UINT support = 0;
+	HRESULT res =
+		device->CheckFormatSupport(DXGI_FORMAT_B8G8R8A8_UNORM, &support);
+	if(SUCCEEDED(res) && (support & D3D10_FORMAT_SUPPORT_TEXTURE2D))
+		hasBgraOut = true;
+	device->Release();
+	return true;
+}
+
+/// <summary>
+/// Returns a score for how suitable an adapter is for compositing. Hardware
+/// that supports feature level 10.0 always beats hardware that doesn't and
+/// dedicated video memory is used as a rough measure of performance so that
+/// discrete GPUs are preferred over integrated ones.
+/// </summary>
+static int scoreAdapter(const VidgfxD3DAdapterInfo &info)
+{
+	if(!info.is_usable)
+		return 0;
+	int score = 1;
+	if(info.has_feature_level_10)
+		score += 4096;
+	if(info.has_bgra_tex_support)
+		score += 1024;
+	score += (int)(qMin<qint64>(
+		info.dedicated_video_memory / (1024 * 1024), 8192) / 8);
+	if(info.num_outputs > 0)
+		score += 16; // Presenting the screen target doesn't cross adapters
+	return score;
+}
+
+/// <summary>
+/// Queries every display adapter on the system along with its capabilities.
+/// This creates a temporary device on each adapter so it is not cheap. The
+/// index of each adapter can be passed to `initialize()`.
+/// </summary>
+QVector<VidgfxD3DAdapterInfo> D3DContext::queryAdapters()
+{
+	QVector<VidgfxD3DAdapterInfo> ret;
+
+	IDXGIFactory *factory = NULL;
+	IDXGIFactory1 *factory1 = NULL;
+	HRESULT res = createProcessDxgiFactory(&factory, &factory1);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning) << QStringLiteral(
+			"Failed to create DXGI factory. Reason = %1")
+			.arg(getDXErrorCode(res));
+		return ret;
+	}
+
+	for(uint i = 0;; i++) {
+		IDXGIAdapter *adapter = enumDxgiAdapter(factory, factory1, i);
+		if(adapter == NULL)
+			break;
+		DXGI_ADAPTER_DESC desc;
+		if(FAILED(adapter->GetDesc(&desc))) {
+			adapter->Release();
+			continue;
+		}
+
+		VidgfxD3DAdapterInfo info;
+		memset(&info, 0, sizeof(info));
+		info.index = i;
+		QByteArray name = QString::fromUtf16(desc.Description).toUtf8();
+		qstrncpy(info.description, name.constData(),
+			sizeof(info.description));
+		info.vendor_id = desc.VendorId;
+		info.device_id = desc.DeviceId;
+		info.sub_sys_id = desc.SubSysId;
+		info.revision = desc.Revision;
+		info.dedicated_video_memory = desc.DedicatedVideoMemory;
+		info.shared_system_memory = desc.SharedSystemMemory;
+		info.luid_low = desc.AdapterLuid.LowPart;
+		info.luid_high = desc.AdapterLuid.HighPart;
+
+		// Count attached monitors
+		IDXGIOutput *output = NULL;
+		while(adapter->EnumOutputs(info.num_outputs, &output) !=
+			DXGI_ERROR_NOT_FOUND)
+		{
+			output->Release();
+			info.num_outputs++;
+		}
+
+		bool hasLevel10, hasBgra;
+		info.is_usable = probeAdapter(adapter, hasLevel10, hasBgra);
+		info.has_feature_level_10 = hasLevel10;
+		info.has_bgra_tex_support = hasBgra;
+		info.score = scoreAdapter(info);
+		adapter->Release();
+
+		ret.append(info);
+	}
+
+	if(factory1 != NULL)
+		factory1->Release();
+	if(factory != NULL)
+		factory->Release();
+	return ret;
+}
+
+/// <summary>
+/// Returns the index of the adapter with the highest score. If
+/// `preferVendorId` is non-zero then adapters of that PCI vendor are preferred
+/// so that compositing can be placed on the same GPU as a hardware encoder.
+/// </summary>
+/// <returns>-1 if there are no usable adapters</returns>
+int D3DContext::getRecommendedAdapter(
+	const QVector<VidgfxD3DAdapterInfo> &adapters, quint32 preferVendorId)
+{
+	int best = -1;
+	int bestScore = 0;
+	bool bestIsPreferred = false;
+	for(int i = 0; i < adapters.size(); i++) {
+		const VidgfxD3DAdapterInfo &info = adapters.at(i);
+		if(info.score <= 0)
+			continue; // Not usable
+		bool isPreferred =
+			(preferVendorId != 0 && info.vendor_id == preferVendorId);
+		if(best >= 0) {
+			if(bestIsPreferred && !isPreferred)
+				continue;
+			if(bestIsPreferred == isPreferred && info.score <= bestScore)
+				continue;
+		}
+		best = info.index;
+		bestScore = info.score;
+		bestIsPreferred = isPreferred;
+	}
+	return best;
+}
+
+D3DContext::D3DContext()
 	: GraphicsContext()
 	, m_hasDxgi11(false)
 	, m_hasDxgi11Valid(false)
 	, m_hasBgraTexSupport(false)
 	, m_hasBgraTexSupportValid(false)
+	, m_hasFeatureLevel10(false)
+	, m_adapterIndex(-1)
 	, m_swapChain(NULL)
 	, m_device(NULL)
 	, m_rasterizerState(NULL)
+	, m_scissorRasterizerState(NULL)
+	, m_scissorRect()
+	, m_boundScissorEnabled(false)
+	, m_boundScissorRect()
 	, m_pointClampSampler(NULL)
 	, m_bilinearClampSampler(NULL)
 	, m_resizeSampler(NULL)
@@ -775,6 +1684,9 @@ D3DContext::D3DContext()
 	// Render targets
 	, m_screenTarget(NULL)
 	, m_screenTargetSize(0, 0)
+	//, m_presentMode()
+	, m_presentCounter(0)
+	, m_numDroppedPresents(0)
 	, m_canvas1Texture(NULL)
 	, m_canvas2Texture(NULL)
 	, m_canvasTargetSize(0, 0)
@@ -785,45 +1697,102 @@ D3DContext::D3DContext()
 
 	// Constant buffers
 	//, m_cameraConstantsLocal() // Compiler warning if this is uncommented
-	, m_cameraConstants(NULL)
+	//, m_cameraConstants()
+	//, m_cameraUploadedVersions()
 	//, m_resizeConstantsLocal()
 	, m_resizeConstants(NULL)
 	//, m_rgbNv16ConstantsLocal()
 	, m_rgbNv16Constants(NULL)
+	//, m_convConstants()
 	//, m_texDecalConstantsLocal()
 	, m_texDecalConstants(NULL)
 	, m_texDecalFlags(0)
 
+	// Vertex ring
+	, m_vertRing(NULL)
+	, m_vertRingPos(VERTEX_RING_BYTES) // First append discards
+	, m_vertRingGeneration(0)
+
 	// Shaders
+	//, m_boundTargetViews()
+	, m_boundViewport()
+	, m_boundTopology(-1)
+	, m_boundBlendState(NULL)
+	//, m_boundResourceViews()
+	, m_numBoundResourceViews(-1)
+	, m_boundSampler(NULL)
+	, m_boundVSConstants(NULL)
+	, m_boundPSConstants(NULL)
+	, m_numRedundantStateCalls(0)
 	, m_boundShader(GfxNoShader)
+	, m_boundPixelShader(-1)
 	, m_solidVS(NULL)
-	, m_solidPS(NULL)
 	, m_solidIL(NULL)
 	, m_texDecalVS(NULL)
-	, m_texDecalPS(NULL)
-	, m_texDecalGbcsPS(NULL)
-	, m_texDecalRgbPS(NULL)
 	, m_texDecalIL(NULL)
 	, m_resizeVS(NULL)
-	, m_resizePS(NULL)
 	, m_resizeIL(NULL)
-	, m_rgbNv16PS(NULL)
-	, m_yv12RgbPS(NULL)
-	, m_UyvyRgbPS(NULL)
-	, m_HdycRgbPS(NULL)
-	, m_Yuy2RgbPS(NULL)
+	//, m_pixelShaders()
+	//, m_pixelShaderFailed()
+	, m_hasInstancing(false)
+	, m_instancedVSBound(false)
+	, m_unitQuadBuf(NULL)
+	, m_solidInstVS(NULL)
+	, m_solidInstIL(NULL)
+	, m_texDecalInstVS(NULL)
+	, m_texDecalInstIL(NULL)
 
 	// Advanced rendering
 	, m_mipmapBuf(NULL)
+	, m_scaleCache()
+	, m_scaleCacheMaxSize(32)
+	, m_scaleCacheUseCounter(0)
+	, m_resampleWeights()
+	, m_texPool()
+	, m_texPoolMaxBytes(128 * 1024 * 1024)
+	//, m_texPoolStats()
+
+	// GPU profiler
+	, m_profilingEnabled(false)
+	, m_profFrames()
+	, m_profCurFrame(0)
+	, m_profInFrame(false)
+	, m_profScopeStack()
+	, m_profFrameCounter(0)
+	, m_profNumDropped(0)
+
+	// Device loss
+	, m_hwnd(NULL)
+	, m_resizeBorderCol()
+	, m_isDeviceLost(false)
+	, m_lastRecoveryTick(0)
+	, m_numDeviceResets(0)
+	, m_liveTextures()
+	, m_liveVertexBufs()
+	, m_liveReadbackQueues()
 
 	// Callbacks
 	, m_dxgi11ChangedCallbackList()
 	, m_bgraTexSupportChangedCallbackList()
+	, m_profileFrameCallbackList()
 {
 	memset(m_cameraConstantsLocal, 0, sizeof(m_cameraConstantsLocal));
 	memset(m_resizeConstantsLocal, 0, sizeof(m_resizeConstantsLocal));
 	memset(m_rgbNv16ConstantsLocal, 0, sizeof(m_rgbNv16ConstantsLocal));
+	memset(m_cameraConstants, 0, sizeof(m_cameraConstants));
+	memset(m_cameraUploadedVersions, 0, sizeof(m_cameraUploadedVersions));
+	memset(m_convConstants, 0, sizeof(m_convConstants));
+	memset(&m_texPoolStats, 0, sizeof(m_texPoolStats));
+	m_presentMode.buffer_count = 2;
+	m_presentMode.sync_interval = 0;
+	m_presentMode.skip_if_busy = false;
+	m_presentMode.max_frame_latency = 0;
+	m_presentMode.present_divisor = 1;
+	memset(m_boundTargetViews, 0, sizeof(m_boundTargetViews));
+	memset(m_boundResourceViews, 0, sizeof(m_boundResourceViews));
 	memset(m_texDecalConstantsLocal, 0, sizeof(m_texDecalConstantsLocal));
+	memset(m_pixelShaders, 0, sizeof(m_pixelShaders));
+	memset(m_pixelShaderFailed, 0, sizeof(m_pixelShaderFailed));
 }
 
 D3DContext::~D3DContext()
@@ -837,64 +1806,126 @@ D3DContext::~D3DContext()
 	callDestroyingCallbacks();
 	emit destroying(this);
 
+	releaseDeviceObjects();
+}
+
+/// <summary>
+/// Releases the device, the swap chain and every object that was created by
+/// `createDeviceObjects()`. Resources that are owned by the application are
+/// released but kept so that they can be recreated by `recoverDevice()`. Safe
+/// to call on a partially created device.
+/// </summary>
+void D3DContext::releaseDeviceObjects()
+{
+	// Unbind render targets
+	if(m_device != NULL) {
+		ID3D10RenderTargetView *nullView[2] = { NULL, NULL };
+		m_device->OMSetRenderTargets(2, nullView, NULL);
+	}
+
 	// Release advanced rendering objects
 	deleteVertexBuffer(m_mipmapBuf);
+	m_mipmapBuf = NULL;
+	purgeScaleCache();
+	releaseProfileQueries();
 
 	// Release constant buffers
-	if(m_cameraConstants)
-		m_cameraConstants->Release();
+	for(int i = 0; i < NUM_CAMERA_SETS; i++) {
+		if(m_cameraConstants[i])
+			m_cameraConstants[i]->Release();
+		m_cameraConstants[i] = NULL;
+	}
 	if(m_resizeConstants)
 		m_resizeConstants->Release();
+	m_resizeConstants = NULL;
 	if(m_rgbNv16Constants)
 		m_rgbNv16Constants->Release();
+	m_rgbNv16Constants = NULL;
+	for(int i = 0; i < NumConversionShaders; i++) {
+		if(m_convConstants[i].buffer)
+			m_convConstants[i].buffer->Release();
+		m_convConstants[i].buffer = NULL;
+		m_convConstants[i].isUploaded = false;
+	}
 	if(m_texDecalConstants)
 		m_texDecalConstants->Release();
+	m_texDecalConstants = NULL;
+
+	// Release vertex ring. Changing the generation invalidates every existing
+	// sub-allocation.
+	if(m_vertRing)
+		m_vertRing->Release();
+	m_vertRing = NULL;
+	m_vertRingPos = VERTEX_RING_BYTES;
+	m_vertRingGeneration++;
 
 	// Release shaders
 	if(m_solidVS)
 		m_solidVS->Release();
-	if(m_solidPS)
-		m_solidPS->Release();
 	if(m_solidIL)
 		m_solidIL->Release();
 	if(m_texDecalVS)
 		m_texDecalVS->Release();
-	if(m_texDecalPS)
-		m_texDecalPS->Release();
-	if(m_texDecalGbcsPS)
-		m_texDecalGbcsPS->Release();
-	if(m_texDecalRgbPS)
-		m_texDecalRgbPS->Release();
 	if(m_texDecalIL)
 		m_texDecalIL->Release();
 	if(m_resizeVS)
 		m_resizeVS->Release();
-	if(m_resizePS)
-		m_resizePS->Release();
 	if(m_resizeIL)
 		m_resizeIL->Release();
-	if(m_rgbNv16PS)
-		m_rgbNv16PS->Release();
-	if(m_yv12RgbPS)
-		m_yv12RgbPS->Release();
-	if(m_UyvyRgbPS)
-		m_UyvyRgbPS->Release();
-	if(m_HdycRgbPS)
-		m_HdycRgbPS->Release();
-	if(m_Yuy2RgbPS)
-		m_Yuy2RgbPS->Release();
+	if(m_unitQuadBuf)
+		m_unitQuadBuf->Release();
+	if(m_solidInstVS)
+		m_solidInstVS->Release();
+	if(m_solidInstIL)
+		m_solidInstIL->Release();
+	if(m_texDecalInstVS)
+		m_texDecalInstVS->Release();
+	if(m_texDecalInstIL)
+		m_texDecalInstIL->Release();
+	m_solidVS = NULL;
+	m_solidIL = NULL;
+	m_texDecalVS = NULL;
+	m_texDecalIL = NULL;
+	m_resizeVS = NULL;
+	m_resizeIL = NULL;
+	m_unitQuadBuf = NULL;
+	m_solidInstVS = NULL;
+	m_solidInstIL = NULL;
+	m_texDecalInstVS = NULL;
+	m_texDecalInstIL = NULL;
+	for(int i = 0; i < NumPixelShaders; i++) {
+		if(m_pixelShaders[i])
+			m_pixelShaders[i]->Release();
+		m_pixelShaders[i] = NULL;
+	}
+	memset(m_pixelShaderFailed, 0, sizeof(m_pixelShaderFailed));
+	m_hasInstancing = false;
+	m_instancedVSBound = false;
 
 	// Release render targets
-	ID3D10RenderTargetView *nullView[2] = { NULL, NULL };
-	m_device->OMSetRenderTargets(2, nullView, NULL);
 	if(m_screenTarget)
 		m_screenTarget->Release();
+	m_screenTarget = NULL;
 
 	// Release textures
 	delete m_canvas1Texture;
 	delete m_canvas2Texture;
 	delete m_scratch1Texture;
 	delete m_scratch2Texture;
+	m_canvas1Texture = NULL;
+	m_canvas2Texture = NULL;
+	m_scratch1Texture = NULL;
+	m_scratch2Texture = NULL;
+	trimTexturePool(0);
+
+	// Release the hardware objects of resources that are still owned by the
+	// application. Queues first as they unmap their staging textures.
+	for(int i = 0; i < m_liveReadbackQueues.size(); i++)
+		m_liveReadbackQueues.at(i)->releaseResources();
+	for(int i = 0; i < m_liveTextures.size(); i++)
+		m_liveTextures.at(i)->releaseResources();
+	for(int i = 0; i < m_liveVertexBufs.size(); i++)
+		m_liveVertexBufs.at(i)->releaseResources();
 
 	// Release sampler states
 	if(m_pointClampSampler)
@@ -903,6 +1934,9 @@ D3DContext::~D3DContext()
 		m_bilinearClampSampler->Release();
 	if(m_resizeSampler)
 		m_resizeSampler->Release();
+	m_pointClampSampler = NULL;
+	m_bilinearClampSampler = NULL;
+	m_resizeSampler = NULL;
 
 	// Release blend states
 	if(m_noBlend)
@@ -911,16 +1945,31 @@ D3DContext::~D3DContext()
 		m_alphaBlend->Release();
 	if(m_premultiBlend)
 		m_premultiBlend->Release();
+	m_noBlend = NULL;
+	m_alphaBlend = NULL;
+	m_premultiBlend = NULL;
 
 	// Release rasterizer
 	if(m_rasterizerState)
 		m_rasterizerState->Release();
+	if(m_scissorRasterizerState)
+		m_scissorRasterizerState->Release();
+	m_rasterizerState = NULL;
+	m_scissorRasterizerState = NULL;
 
 	// Release device and swap chain
-	m_device->Release();
-	m_swapChain->Release();
+	if(m_device)
+		m_device->Release();
+	if(m_swapChain)
+		m_swapChain->Release();
 	m_device = NULL;
 	m_swapChain = NULL;
+
+	// Nothing is bound anymore. The new device starts with the regular
+	// rasterizer state.
+	invalidateStateCache();
+	m_boundScissorEnabled = false;
+	m_boundScissorRect = QRect();
 }
 
 /// <summary>
@@ -971,8 +2020,123 @@ IDXGIAdapter *D3DContext::getFirstDxgi11Adapter()
 	return adapter;
 }
 
+/// <summary>
+/// Returns the adapter at the specified index of `queryAdapters()` which is
+/// constructed from the same type of factory as the rest of the process. If
+/// this method returns non-NULL then the caller must manually release the
+/// object when it is finished with it.
+/// </summary>
+IDXGIAdapter *D3DContext::getDxgiAdapter(int index)
+{
+	if(index < 0)
+		return NULL;
+	IDXGIFactory *factory = NULL;
+	IDXGIFactory1 *factory1 = NULL;
+	HRESULT res = createProcessDxgiFactory(&factory, &factory1);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning) << QStringLiteral(
+			"Failed to create DXGI factory. Reason = %1")
+			.arg(getDXErrorCode(res));
+		return NULL;
+	}
+	IDXGIAdapter *adapter = enumDxgiAdapter(factory, factory1, index);
+	if(adapter == NULL) {
+		gfxLog(LOG_CAT, GfxLog::Warning) << QStringLiteral(
+			"Graphics adapter %1 doesn't exist").arg(index);
+	}
+	if(factory1 != NULL)
+		factory1->Release();
+	if(factory != NULL)
+		factory->Release();
+	return adapter;
+}
+
+/// <summary>
+/// Returns a texture with the specified properties, reusing an unused texture
+/// from the texture pool if possible so that we don't hitch due to driver
+/// allocations when targets are resized back and forth. The texture must be
+/// released with `deletePooledTexture()`. The texel data of a reused texture
+/// is undefined.
+/// </summary>
+D3DTexture *D3DContext::createPooledTexture(
+	VidgfxTexFlags flags, const QSize &size, DXGI_FORMAT format)
+{
+	// Search newest first as they are the most likely to still be resident
+	for(int i = m_texPool.size() - 1; i >= 0; i--) {
+		D3DTexture *tex = m_texPool.at(i);
+		if(tex->getSize() != size || tex->getRequestedFlags() != flags ||
+			tex->getRequestedFormat() != format)
+		{
+			continue;
+		}
+		m_texPool.remove(i);
+		m_texPoolStats.num_textures--;
+		m_texPoolStats.num_bytes -= tex->getMemoryUsage();
+		m_texPoolStats.num_hits++;
+		tex->markModified(); // Texel data is now unrelated to the old data
+		return tex;
+	}
+
+	m_texPoolStats.num_misses++;
+	return new D3DTexture(this, flags, size, format);
+}
+
+/// <summary>
+/// Returns the texture to the texture pool so that it can be reused by a
+/// later call to `createPooledTexture()`. Textures that cannot be safely
+/// reused are deleted immediately.
+/// </summary>
+void D3DContext::deletePooledTexture(D3DTexture *tex)
+{
+	if(tex == NULL)
+		return;
+	if(!tex->isValid() || tex->isExternal() || tex->isMapped() ||
+		(tex->getRequestedFlags() &
+		(GfxGDIFlag | GfxSharedFlag | GfxKeyedMutexFlag)) ||
+		tex->getMemoryUsage() > m_texPoolMaxBytes)
+	{
+		delete tex;
+		return;
+	}
+	m_texPool.append(tex);
+	m_texPoolStats.num_textures++;
+	m_texPoolStats.num_bytes += tex->getMemoryUsage();
+	trimTexturePool(m_texPoolMaxBytes);
+}
+
+/// <summary>
+/// Creates the device and swap chain. If `adapterIndex` is the index of an
+/// adapter returned by `queryAdapters()` then the device is created on that
+/// adapter, otherwise the first adapter of the system is used.
+/// </summary>
 bool D3DContext::initialize(
-	HWND hwnd, const QSize &size, const QColor &resizeBorderCol)
+	HWND hwnd, const QSize &size, const QColor &resizeBorderCol,
+	int adapterIndex)
+{
+	// Remember everything that is required to recreate the device later
+	m_hwnd = hwnd;
+	m_resizeBorderCol = resizeBorderCol;
+	m_adapterIndex = adapterIndex;
+
+	if(!createDeviceObjects(size))
+		return false;
+
+	//-------------------------------------------------------------------------
+	// Emit initialized signal
+
+	// The context is now fully initialized and other parts of the application
+	// can begin to create hardware resources. Emit a signal so they know.
+	callInitializedCallbacks();
+	emit initialized(this);
+
+	return true;
+}
+
+/// <summary>
+/// Creates the device, the swap chain and every object that the context itself
+/// owns. Used by both `initialize()` and `recoverDevice()`.
+/// </summary>
+bool D3DContext::createDeviceObjects(const QSize &size)
 {
 	// Notes about compatibility:
 	//
@@ -1027,13 +2191,26 @@ bool D3DContext::initialize(
 	swapChainDesc.SampleDesc.Count = 1; // No anti-aliasing
 	swapChainDesc.SampleDesc.Quality = 0;
 	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapChainDesc.BufferCount = 2;
-	swapChainDesc.OutputWindow = hwnd;
+	swapChainDesc.BufferCount = m_presentMode.buffer_count;
+	swapChainDesc.OutputWindow = m_hwnd;
 	swapChainDesc.Windowed = TRUE;
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
 	swapChainDesc.Flags = 0;
 
-	// Create device and swap chain. Currently always uses the primary adapter
+	// Use the explicitly selected adapter if there is one
+	IDXGIAdapter *explicitAdapter = getDxgiAdapter(m_adapterIndex);
+	if(explicitAdapter == NULL)
+		m_adapterIndex = -1;
+	if(explicitAdapter != NULL) {
+		DXGI_ADAPTER_DESC desc;
+		if(SUCCEEDED(explicitAdapter->GetDesc(&desc))) {
+			gfxLog(LOG_CAT) << QStringLiteral("Using graphics adapter %1: %2")
+				.arg(m_adapterIndex)
+				.arg(QString::fromUtf16(desc.Description));
+		}
+	}
+
+	// Create device and swap chain
 	UINT deviceFlags = D3D10_CREATE_DEVICE_SINGLETHREADED;
 	HRESULT reason10level10 = S_OK;
 	HRESULT reason10level9 = S_OK;
@@ -1048,7 +2225,11 @@ bool D3DContext::initialize(
 		// older versions of Windows or if there was an error getting an
 		// adapter. If we attempt to create a device with a NULL adapter then
 		// the OS will automatically find the "first adapter" for us.
-		IDXGIAdapter *adapter = getFirstDxgi11Adapter();
+		IDXGIAdapter *adapter = explicitAdapter;
+		if(adapter != NULL)
+			adapter->AddRef();
+		else
+			adapter = getFirstDxgi11Adapter();
 
 		// Attempt to create a feature level 10.0 device first
 		ID3D10Device1 *d3d101Dev = NULL;
@@ -1100,6 +2281,8 @@ bool D3DContext::initialize(
 					gfxLog(LOG_CAT) << "Using DirectX 10.1 Level 9.3";
 				else
 					gfxLog(LOG_CAT) << "Using DirectX 10.1 Level 10.0";
+
+				m_hasFeatureLevel10 = !attempted10level9;
 			} else {
 				m_device->Release();
 				m_swapChain->Release();
@@ -1115,7 +2298,7 @@ bool D3DContext::initialize(
 		// DirectX 10.1 is not available or creating a DirectX 10.1 device
 		// failed, use DirectX 10.0
 		HRESULT res = D3D10CreateDeviceAndSwapChain(
-			NULL, // _In_ IDXGIAdapter *pAdapter,
+			explicitAdapter, // _In_ IDXGIAdapter *pAdapter,
 			D3D10_DRIVER_TYPE_HARDWARE, // _In_ D3D10_DRIVER_TYPE DriverType,
 			NULL, // _In_ HMODULE Software,
 			deviceFlags, // _In_ UINT Flags,
@@ -1143,12 +2326,20 @@ bool D3DContext::initialize(
 		} else {
 			// Log what sort of device we created
 			gfxLog(LOG_CAT) << "Using DirectX 10.0";
+			m_hasFeatureLevel10 = true;
 		}
 	}
 
+	if(explicitAdapter != NULL)
+		explicitAdapter->Release();
+	if(m_device == NULL)
+		return false; // Already logged
+
 	//-------------------------------------------------------------------------
 	// Initial state
 
+	applyMaxFrameLatency();
+
 	// Create a render target for the swap chain buffer
 	m_screenTargetSize = size;
 	if(!createScreenTarget())
@@ -1175,6 +2366,16 @@ bool D3DContext::initialize(
 	}
 	m_device->RSSetState(m_rasterizerState);
 
+	// Identical rasterizer state for partial redraws
+	desc.ScissorEnable = TRUE;
+	res = m_device->CreateRasterizerState(&desc, &m_scissorRasterizerState);
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Critical)
+			<< "Failed to create scissor rasterizer state, cannot continue. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+
 	// Create sampler states
 	D3D10_SAMPLER_DESC sampDesc;
 	sampDesc.Filter = D3D10_FILTER_MIN_MAG_MIP_POINT;
@@ -1208,10 +2409,10 @@ bool D3DContext::initialize(
 	sampDesc.AddressU = D3D10_TEXTURE_ADDRESS_BORDER;
 	sampDesc.AddressV = D3D10_TEXTURE_ADDRESS_BORDER;
 	sampDesc.AddressW = D3D10_TEXTURE_ADDRESS_BORDER;
-	sampDesc.BorderColor[0] = resizeBorderCol.redF();
-	sampDesc.BorderColor[1] = resizeBorderCol.greenF();
-	sampDesc.BorderColor[2] = resizeBorderCol.blueF();
-	sampDesc.BorderColor[3] = resizeBorderCol.alphaF();
+	sampDesc.BorderColor[0] = m_resizeBorderCol.redF();
+	sampDesc.BorderColor[1] = m_resizeBorderCol.greenF();
+	sampDesc.BorderColor[2] = m_resizeBorderCol.blueF();
+	sampDesc.BorderColor[3] = m_resizeBorderCol.alphaF();
 	res = m_device->CreateSamplerState(&sampDesc, &m_resizeSampler);
 	if(FAILED(res)) {
 		gfxLog(LOG_CAT, GfxLog::Critical)
@@ -1277,24 +2478,34 @@ bool D3DContext::initialize(
 		return false;
 	//gfxLog(LOG_CAT) << "Successfully created DirectX shaders";
 
-	//-------------------------------------------------------------------------
-	// Create camera cbuffer
+	// Shaders that use `SV_InstanceID` require feature level 10.0 and are
+	// optional
+	if(m_hasFeatureLevel10) {
+		m_hasInstancing = createInstancingResources();
+		if(!m_hasInstancing) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create instancing resources, instancing disabled";
+		}
+	}
 
-	// Upload local RAM
-	m_cameraConstantsDirty = true; // Force update
-	updateCameraConstants();
+	//-------------------------------------------------------------------------
+	// Create camera cbuffers, one for each set of camera matrices
 
-	// Create hardware buffer
 	D3D10_BUFFER_DESC bufDesc;
 	bufDesc.ByteWidth = sizeof(m_cameraConstantsLocal);
 	bufDesc.Usage = D3D10_USAGE_DYNAMIC;
 	bufDesc.BindFlags = D3D10_BIND_CONSTANT_BUFFER;
 	bufDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
 	bufDesc.MiscFlags = 0;
-	if(!createDXBuffer(m_device, &bufDesc, m_cameraConstantsLocal,
-		&m_cameraConstants)) {
-			// Failed to create buffer
-			return false;
+	for(int i = 0; i < NUM_CAMERA_SETS; i++) {
+		// Create hardware buffer with the current matrices
+		fillCameraConstants((CameraSet)i);
+		if(!createDXBuffer(m_device, &bufDesc, m_cameraConstantsLocal,
+			&m_cameraConstants[i])) {
+				// Failed to create buffer
+				return false;
+		}
+		m_cameraUploadedVersions[i] = m_cameraVersions[i];
 	}
 
 	//-------------------------------------------------------------------------
@@ -1335,6 +2546,26 @@ bool D3DContext::initialize(
 			return false;
 	}
 
+	//-------------------------------------------------------------------------
+	// Create format conversion cbuffers
+
+	// Create hardware buffers. The contents are updated immediately before use
+	// by `convertToBgrx()`, `convertFromRgb()` and `scaleToNv16()`
+	bufDesc.ByteWidth = sizeof(m_convConstants[0].local);
+	bufDesc.Usage = D3D10_USAGE_DYNAMIC;
+	bufDesc.BindFlags = D3D10_BIND_CONSTANT_BUFFER;
+	bufDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
+	bufDesc.MiscFlags = 0;
+	for(int i = 0; i < NumConversionShaders; i++) {
+		ConversionConstants &consts = m_convConstants[i];
+		if(!createDXBuffer(m_device, &bufDesc, consts.local,
+			&consts.buffer)) {
+				// Failed to create buffer
+				return false;
+		}
+		consts.isUploaded = false; // Always upload on first use
+	}
+
 	//-------------------------------------------------------------------------
 	// Create texture decal cbuffer
 
@@ -1354,6 +2585,19 @@ bool D3DContext::initialize(
 			return false;
 	}
 
+	//-------------------------------------------------------------------------
+	// Create the shared vertex ring
+
+	// This is not fatal as vertex buffers fall back to individual hardware
+	// buffers if the ring doesn't exist
+	bufDesc.ByteWidth = VERTEX_RING_BYTES;
+	bufDesc.Usage = D3D10_USAGE_DYNAMIC;
+	bufDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
+	bufDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
+	bufDesc.MiscFlags = 0;
+	if(!createDXBuffer(m_device, &bufDesc, NULL, &m_vertRing))
+		m_vertRing = NULL;
+
 	//-------------------------------------------------------------------------
 	// Set the scratch target's initial size
 
@@ -1365,14 +2609,6 @@ bool D3DContext::initialize(
 
 	m_mipmapBuf = createVertexBuffer(TexDecalRectBufSize);
 
-	//-------------------------------------------------------------------------
-	// Emit initialized signal
-
-	// The context is now fully initialized and other parts of the application
-	// can begin to create hardware resources. Emit a signal so they know.
-	callInitializedCallbacks();
-	emit initialized(this);
-
 	return true;
 }
 
@@ -1478,6 +2714,12 @@ bool D3DContext::createScreenTarget()
 	return true;
 }
 
+/// <summary>
+/// Creates the vertex shaders and their input layouts. There are only three
+/// of them and their input layouts are validated against the shader so they
+/// are created up front. Pixel shaders are created on first use by
+/// `getPixelShader()`.
+/// </summary>
 bool D3DContext::createShaders()
 {
 	// Solid colour shaders
@@ -1488,10 +2730,8 @@ bool D3DContext::createShaders()
 	if(!createVertexShaderAndInputLayout(
 		"solid-vs", &m_solidVS, &m_solidIL, solidILDesc, 2))
 		return false;
-	if(!createPixelShader("solid-ps", &m_solidPS))
-		return false;
 
-	// Texture decal shaders
+	// Texture decal shaders. Also used by all the colour conversion shaders
 	const D3D10_INPUT_ELEMENT_DESC texDecalILDesc[] = {
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D10_INPUT_PER_VERTEX_DATA, 0},
 		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, D3D10_INPUT_PER_VERTEX_DATA, 0},
@@ -1499,12 +2739,6 @@ bool D3DContext::createShaders()
 	if(!createVertexShaderAndInputLayout(
 		"texDecal-vs", &m_texDecalVS, &m_texDecalIL, texDecalILDesc, 2))
 		return false;
-	if(!createPixelShader("texDecal-ps", &m_texDecalPS))
-		return false;
-	if(!createPixelShader("texDecalGbcs-ps", &m_texDecalGbcsPS))
-		return false;
-	if(!createPixelShader("texDecalRgb-ps", &m_texDecalRgbPS))
-		return false;
 
 	// Resize layer shaders
 	const D3D10_INPUT_ELEMENT_DESC resizeILDesc[] = {
@@ -1513,20 +2747,50 @@ bool D3DContext::createShaders()
 	if(!createVertexShaderAndInputLayout(
 		"resize-vs", &m_resizeVS, &m_resizeIL, resizeILDesc, 1))
 		return false;
-	if(!createPixelShader("resize-ps", &m_resizePS))
-		return false;
 
-	// Colour conversion shaders
-	if(!createPixelShader("rgb-nv16-ps", &m_rgbNv16PS))
-		return false;
-	if(!createPixelShader("yv12-rgb-ps", &m_yv12RgbPS))
-		return false;
-	if(!createPixelShader("uyvy-rgb-ps", &m_UyvyRgbPS))
+	return true;
+}
+
+/// <summary>
+/// Creates the unit quad and the instanced vertex shaders that are used by
+/// `drawInstanced()`. Slot 0 is the unit quad and slot 1 is the per-instance
+/// buffer where each instance is shared by 4 consecutive copies of the quad.
+/// </summary>
+bool D3DContext::createInstancingResources()
+{
+	// Unit quad for `TriangleStripTopology`
+	float quad[8] = {
+		0.0f, 0.0f, // Top-left
+		1.0f, 0.0f, // Top-right
+		0.0f, 1.0f, // Bottom-left
+		1.0f, 1.0f }; // Bottom-right
+	D3D10_BUFFER_DESC desc;
+	desc.ByteWidth = sizeof(quad);
+	desc.Usage = D3D10_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	if(!createDXBuffer(m_device, &desc, quad, &m_unitQuadBuf))
 		return false;
-	if(!createPixelShader("hdyc-rgb-ps", &m_HdycRgbPS))
+
+	// Shader expects instance format: L, T, R, B, U1, V1, U2, V2, R, G, B, A,
+	// P1, P2, P3, P4
+	const D3D10_INPUT_ELEMENT_DESC instILDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0,  0, D3D10_INPUT_PER_VERTEX_DATA, 0},
+		{"RECT",     0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D10_INPUT_PER_INSTANCE_DATA, 4},
+		{"UVRECT",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D10_INPUT_PER_INSTANCE_DATA, 4},
+		{"COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D10_INPUT_PER_INSTANCE_DATA, 4},
+		{"PARAMS",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D10_INPUT_PER_INSTANCE_DATA, 4},
+	};
+	if(!createVertexShaderAndInputLayout(
+		"solidInst-vs", &m_solidInstVS, &m_solidInstIL, instILDesc, 5))
 		return false;
-	if(!createPixelShader("yuy2-rgb-ps", &m_Yuy2RgbPS))
+	if(!createVertexShaderAndInputLayout(
+		"texDecalInst-vs", &m_texDecalInstVS, &m_texDecalInstIL,
+		instILDesc, 5))
+	{
 		return false;
+	}
 
 	return true;
 }
@@ -1574,18 +2838,18 @@ bool D3DContext::createPixelShader(
 {
 	QByteArray data = getShaderFileData(shaderName);
 	if(data.isEmpty()) {
-		gfxLog(LOG_CAT, GfxLog::Critical)
-			<< "Failed to read pixel shader \"" << shaderName
-			<< "\", cannot continue";
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to read pixel shader \"" << shaderName << "\"";
 		return false;
 	}
 
 	HRESULT res =
 		m_device->CreatePixelShader(data.data(), data.length(), shader);
 	if(FAILED(res)) {
-		gfxLog(LOG_CAT, GfxLog::Critical)
+		gfxLog(LOG_CAT, GfxLog::Warning)
 			<< "Failed to load pixel shader \"" << shaderName
-			<< "\", cannot continue. Reason = " << getDXErrorCode(res);
+			<< "\". Reason = " << getDXErrorCode(res);
+		*shader = NULL;
 		return false;
 	}
 
@@ -1608,45 +2872,236 @@ QByteArray D3DContext::getShaderFileData(const QString &shaderName) const
 	return data;
 }
 
-void D3DContext::updateCameraConstants()
+/// <summary>
+/// Returns the file name of the specified `PixelShader` without its
+/// extension. The tex decal permutations are named after their features in
+/// a fixed order, for example "texDecalPremulGbcsSwz-ps".
+/// </summary>
+QString D3DContext::getPixelShaderName(int ps)
 {
-	if(!m_cameraConstantsDirty)
-		return; // Nothing to do
+	// Must be in the same order as `PixelShader`
+	static const char *FIXED_NAMES[TexDecalPS] = {
+		"solid-ps",
+		"resize-ps",
+		"rgb-nv16-ps",
+		"yv12-rgb-ps",
+		"nv12-rgb-ps",
+		"uyvy-rgb-ps",
+		"hdyc-rgb-ps",
+		"yuy2-rgb-ps",
+		"rgb-y-ps",
+		"rgb-nv12uv-ps",
+		"rgb-i420uv-ps",
+		"rgb-nv16scaled-ps",
+		"rgb-nv16scaled709-ps",
+		"dilute-ps",
+		"resampleHorz-ps",
+		"resampleVert-ps" };
+
+	if(ps < 0 || ps >= NumPixelShaders)
+		return QString();
+	if(ps < TexDecalPS)
+		return QString::fromLatin1(FIXED_NAMES[ps]);
+
+	int perm = ps - TexDecalPS;
+	QString name = QStringLiteral("texDecal");
+	if(perm & TexDecalOpaquePerm)
+		name += QStringLiteral("Rgb");
+	else if(perm & TexDecalPremultipliedPerm)
+		name += QStringLiteral("Premul");
+	if(perm & TexDecalGbcsPerm)
+		name += QStringLiteral("Gbcs");
+	else if(perm & TexDecalBcPerm)
+		name += QStringLiteral("Bc");
+	if(perm & TexDecalSrgbPerm)
+		name += QStringLiteral("Srgb");
+	if(perm & TexDecalSwizzlePerm)
+		name += QStringLiteral("Swz");
+	name += QStringLiteral("-ps");
+	return name;
+}
 
-	// Update local memory
-	switch(m_currentTarget) {
-	default:
-	case GfxScreenTarget:
-		m_screenViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
-		m_screenProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
-		break;
-	case GfxCanvas1Target:
-	case GfxCanvas2Target:
-		m_canvasViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
-		m_canvasProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
-		break;
-	case GfxScratch1Target:
-	case GfxScratch2Target:
+/// <summary>
+/// Returns the specified pixel shader, creating it if this is the first time
+/// that it has been requested. Each shader is only ever loaded once, even if
+/// it fails to load, so that sessions only pay for the shaders that they
+/// actually use.
+/// </summary>
+/// <returns>NULL if the shader is unavailable</returns>
+ID3D10PixelShader *D3DContext::getPixelShader(int ps)
+{
+	if(ps < 0 || ps >= NumPixelShaders)
+		return NULL;
+	if(m_pixelShaders[ps] != NULL)
+		return m_pixelShaders[ps];
+	if(m_pixelShaderFailed[ps])
+		return NULL; // Already failed once, don't spam the log
+
+	// Shaders that use `Load()` require feature level 10.0
+	bool needsLevel10 =
+		(ps == DilutePS || ps == ResampleHorzPS || ps == ResampleVertPS);
+	if(needsLevel10 && !m_hasFeatureLevel10) {
+		m_pixelShaderFailed[ps] = true;
+		return NULL;
+	}
+
+	if(!createPixelShader(getPixelShaderName(ps), &m_pixelShaders[ps]))
+		m_pixelShaderFailed[ps] = true;
+	return m_pixelShaders[ps];
+}
+
+/// <summary>
+/// Returns the cheapest effects permutation that gives the same result as the
+/// full gamma, brightness, contrast and saturation shader with the current
+/// `getTexDecalEffects()`.
+/// </summary>
+int D3DContext::getTexDecalEffectsPerm() const
+{
+	// Gamma is stored inverted but 1/1 is exact
+	const float *effects = getTexDecalEffects();
+	if(effects[0] != 1.0f || effects[3] != 1.0f)
+		return TexDecalGbcsPerm;
+	if(effects[1] != 0.0f || effects[2] != 1.0f)
+		return TexDecalBcPerm;
+	return 0; // Identity
+}
+
+/// <summary>
+/// Returns the `PixelShader` that should be used to draw with the specified
+/// shader given the current tex decal state. `GfxTexDecalGbcsShader` only pays
+/// for the effects that actually change the image and unpremultiplying is
+/// skipped when there are no colour effects to apply.
+/// </summary>
+/// <returns>-1 if the shader has no pixel shader</returns>
+int D3DContext::getPixelShaderForShader(VidgfxShader shader) const
+{
+	int texDecalPerm = m_texDecalFlags; // Swizzle and premultiplied
+	if(m_texDecalSrgb)
+		texDecalPerm |= TexDecalSrgbPerm;
+
+	switch(shader) {
+	default:
+	case GfxNoShader:
+		return -1;
+	case GfxSolidShader:
+		return SolidPS;
+	case GfxTexDecalShader:
+		break;
+	case GfxTexDecalGbcsShader:
+		texDecalPerm |= getTexDecalEffectsPerm();
+		break;
+	case GfxTexDecalRgbShader:
+		texDecalPerm &= ~TexDecalPremultipliedPerm;
+		texDecalPerm |= TexDecalOpaquePerm;
+		break;
+	case GfxResizeLayerShader:
+		return ResizePS;
+	case GfxRgbNv16Shader:
+		return RgbNv16PS;
+	case GfxYv12RgbShader:
+		return Yv12RgbPS;
+	case GfxNv12RgbShader:
+		return Nv12RgbPS;
+	case GfxUyvyRgbShader:
+		return UyvyRgbPS;
+	case GfxHdycRgbShader:
+		return HdycRgbPS;
+	case GfxYuy2RgbShader:
+		return Yuy2RgbPS;
+	case GfxRgbYShader:
+		return RgbYPS;
+	case GfxRgbNv12UvShader:
+		return RgbNv12UvPS;
+	case GfxRgbI420UvShader:
+		return RgbI420UvPS;
+	case GfxRgbNv16ScaledShader:
+		return RgbNv16ScaledPS;
+	case GfxRgbNv16Scaled709Shader:
+		return RgbNv16Scaled709PS;
+	case GfxDiluteShader:
+		return DilutePS;
+	case GfxResampleHorzShader:
+		return ResampleHorzPS;
+	case GfxResampleVertShader:
+		return ResampleVertPS;
+	}
+
+	// Premultiplied and straight alpha are identical without colour effects
+	const int colourPerms =
+		TexDecalSrgbPerm | TexDecalBcPerm | TexDecalGbcsPerm;
+	if(!(texDecalPerm & colourPerms))
+		texDecalPerm &= ~TexDecalPremultipliedPerm;
+	return TexDecalPS + texDecalPerm;
+}
+
+/// <summary>
+/// Binds the pixel shader of the bound shader, creating it if needed. Called
+/// immediately before every draw as the tex decal permutation depends on the
+/// bound texture.
+/// </summary>
+void D3DContext::bindPixelShader()
+{
+	int ps = getPixelShaderForShader(m_boundShader);
+	if(ps < 0)
+		return; // Shader has no pixel shader
+	if(ps == m_boundPixelShader) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_device->PSSetShader(getPixelShader(ps));
+	m_boundPixelShader = ps;
+}
+
+void D3DContext::fillCameraConstants(CameraSet set)
+{
+	switch(set) {
+	default:
+	case ScreenCameraSet:
+		m_screenViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_screenProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	case CanvasCameraSet:
+		m_canvasViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
+		m_canvasProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
+		break;
+	case ScratchCameraSet:
 		m_scratchViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
 		m_scratchProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
 		break;
-	case GfxUserTarget:
+	case UserCameraSet:
 		m_userViewMat.copyDataTo(&m_cameraConstantsLocal[0]);
 		m_userProjMat.copyDataTo(&m_cameraConstantsLocal[16]);
 		break;
 	}
+}
+
+/// <summary>
+/// Uploads the camera matrices of the current render target if they have
+/// changed since they were last uploaded.
+/// </summary>
+/// <returns>The cbuffer of the current render target</returns>
+ID3D10Buffer *D3DContext::updateCameraConstants()
+{
+	CameraSet set = getCameraSet(m_currentTarget);
+	ID3D10Buffer *buf = m_cameraConstants[set];
+	if(m_cameraUploadedVersions[set] == m_cameraVersions[set])
+		return buf; // Nothing to do
+
+	// Update local memory
+	fillCameraConstants(set);
 
 	// Update hardware buffer
-	if(m_cameraConstants) {
+	if(buf) {
 		if(!updateDXBuffer(
-			m_device, m_cameraConstants, m_cameraConstantsLocal,
+			m_device, buf, m_cameraConstantsLocal,
 			sizeof(m_cameraConstantsLocal)))
 		{
-			return; // Update failed
+			return buf; // Update failed
 		}
 	}
 
-	m_cameraConstantsDirty = false;
+	m_cameraUploadedVersions[set] = m_cameraVersions[set];
+	return buf;
 }
 
 void D3DContext::updateResizeConstants()
@@ -1714,7 +3169,7 @@ void D3DContext::updateTexDecalConstants()
 	m_texDecalConstantsLocal[2] = m_texDecalModulate.blueF();
 	m_texDecalConstantsLocal[3] = m_texDecalModulate.alphaF();
 	uint *uintConstants = (uint *)m_texDecalConstantsLocal;
-	uintConstants[4] = m_texDecalFlags;
+	uintConstants[4] = 0; // Features are shader permutations
 	uintConstants[5] = 0;
 	uintConstants[6] = 0;
 	uintConstants[7] = 0;
@@ -1738,10 +3193,478 @@ void D3DContext::updateTexDecalConstants()
 
 void D3DContext::setSwizzleInTexDecal(bool doSwizzle)
 {
-	quint32 flag = (doSwizzle ? 0xFFFFFFFF : 0);
-	if(m_texDecalFlags != flag)
-		m_texDecalConstantsDirty = true;
-	m_texDecalFlags = flag;
+	// Selects the permutation in `bindPixelShader()`
+	if(doSwizzle)
+		m_texDecalFlags |= TexDecalSwizzlePerm;
+	else
+		m_texDecalFlags &= ~TexDecalSwizzlePerm;
+}
+
+/// <summary>
+/// Returns the index into `m_convConstants` of the specified shader or -1 if
+/// the shader is not a format conversion shader.
+/// </summary>
+static int getConversionIndex(VidgfxShader shader)
+{
+	switch(shader) {
+	default:
+		return -1;
+	case GfxYv12RgbShader:
+		return 0;
+	case GfxNv12RgbShader:
+		return 1;
+	case GfxUyvyRgbShader:
+		return 2;
+	case GfxHdycRgbShader:
+		return 3;
+	case GfxYuy2RgbShader:
+		return 4;
+	case GfxRgbYShader:
+		return 5;
+	case GfxRgbNv12UvShader:
+		return 6;
+	case GfxRgbI420UvShader:
+		return 7;
+	case GfxRgbNv16ScaledShader:
+		return 8;
+	case GfxRgbNv16Scaled709Shader:
+		return 9;
+	case GfxResampleHorzShader:
+		return 10;
+	case GfxResampleVertShader:
+		return 11;
+	}
+}
+
+/// <summary>
+/// Sets the 8 constants of the specified format conversion shader. The
+/// hardware buffer is only updated if the values differ from the previous
+/// call for the same shader.
+/// </summary>
+bool D3DContext::updateConversionConstants(
+	VidgfxShader shader, const float *values)
+{
+	int index = getConversionIndex(shader);
+	if(index < 0)
+		return false; // Not a conversion shader
+	ConversionConstants &consts = m_convConstants[index];
+	if(consts.buffer == NULL)
+		return false;
+	if(consts.isUploaded &&
+		memcmp(consts.local, values, sizeof(consts.local)) == 0)
+	{
+		return true; // Unchanged
+	}
+
+	// Update local memory and hardware buffer
+	memcpy(consts.local, values, sizeof(consts.local));
+	consts.isUploaded = updateDXBuffer(
+		m_device, consts.buffer, consts.local, sizeof(consts.local));
+	return consts.isUploaded;
+}
+
+ID3D10Buffer *D3DContext::getConversionConstants(VidgfxShader shader) const
+{
+	int index = getConversionIndex(shader);
+	if(index < 0)
+		return NULL;
+	return m_convConstants[index].buffer;
+}
+
+void D3DContext::bindVSConstants(ID3D10Buffer *buf)
+{
+	if(m_boundVSConstants == buf && buf != NULL) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_device->VSSetConstantBuffers(0, 1, &buf);
+	m_boundVSConstants = buf;
+}
+
+void D3DContext::bindPSConstants(ID3D10Buffer *buf)
+{
+	if(m_boundPSConstants == buf && buf != NULL) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_device->PSSetConstantBuffers(0, 1, &buf);
+	m_boundPSConstants = buf;
+}
+
+/// <summary>
+/// Uploads the sampling offsets used by the RGB->YUV 4:2:0 shaders. `pxSize`
+/// is the size of a single input pixel in UV coordinates.
+/// </summary>
+bool D3DContext::updateRgbYuv420Constants(
+	VidgfxShader shader, const QPointF &pxSize)
+{
+	// Horizontal sample positions in input pixels relative to the center of
+	// the output texel. Chroma is left aligned (MPEG-2 style siting).
+	static const float yOffsets[4] = { -1.5f, -0.5f, 0.5f, 1.5f };
+	static const float nv12Offsets[4] = { -1.5f, 0.5f, 0.0f, 0.0f };
+	static const float i420Offsets[4] = { -3.5f, -1.5f, 0.5f, 2.5f };
+	const float *offsets = yOffsets;
+	if(shader == GfxRgbNv12UvShader)
+		offsets = nv12Offsets;
+	else if(shader == GfxRgbI420UvShader)
+		offsets = i420Offsets;
+	// 4 horizontal offsets + 2 vertical offsets + 2 unused
+	float values[8];
+	for(int i = 0; i < 4; i++)
+		values[i] = offsets[i] * (float)pxSize.x();
+
+	// Vertical sample positions of the two input rows that each chroma output
+	// texel covers
+	values[4] = -0.5f * (float)pxSize.y();
+	values[5] = 0.5f * (float)pxSize.y();
+	values[6] = 0.0f;
+	values[7] = 0.0f;
+
+	return updateConversionConstants(shader, values);
+}
+
+/// <summary>
+/// Renders the entire `src` texture into one or two user render targets with
+/// the specified shader. The viewport is set to the size of `targetA`.
+/// </summary>
+bool D3DContext::drawYuvPlanes(
+	VidgfxShader shader, Texture *src, Texture *targetA, Texture *targetB)
+{
+	QSize outSize = targetA->getSize();
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)outSize.width(), (qreal)outSize.height()));
+
+	// Setup render target
+	setUserRenderTarget(targetA, targetB);
+	setUserRenderTargetViewport(outSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Update the sampling offsets
+	QPointF pxSize(1.0f / (qreal)src->getWidth(), 1.0f / (qreal)src->getHeight());
+	if(!updateRgbYuv420Constants(shader, pxSize))
+		return false;
+
+	// Render the plane(s)
+	setShader(shader);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTexture(src);
+	setTextureFilter(GfxPointFilter);
+	drawBuffer(m_mipmapBuf);
+
+	return true;
+}
+
+/// <summary>
+/// Marks the textures that are bound to the current render target as
+/// modified so that any cached data derived from them is invalidated.
+/// </summary>
+void D3DContext::markCurrentTargetModified()
+{
+	if(m_currentTarget == GfxUserTarget) {
+		if(m_userTargets[0] != NULL)
+			m_userTargets[0]->markModified();
+		if(m_userTargets[1] != NULL)
+			m_userTargets[1]->markModified();
+		return;
+	}
+	Texture *tex = getTargetTexture(m_currentTarget);
+	if(tex != NULL)
+		tex->markModified();
+}
+
+/// <summary>
+/// Returns the index of the scale cache entry that matches the specified
+/// `prepareTexture()` parameters or -1 if there is no such entry.
+/// </summary>
+int D3DContext::findScaleCacheEntry(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter) const
+{
+	for(int i = 0; i < m_scaleCache.size(); i++) {
+		const ScaleCacheEntry &entry = m_scaleCache.at(i);
+		if(entry.src == tex && entry.cropRect == cropRect &&
+			entry.size == size && entry.filter == filter)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+/// Adds an empty scale cache entry for the specified `prepareTexture()`
+/// parameters, evicting the least recently used entry if the cache is full.
+/// </summary>
+/// <returns>The index of the new entry</returns>
+int D3DContext::addScaleCacheEntry(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter)
+{
+	evictScaleCacheEntries(m_scaleCacheMaxSize - 1);
+	ScaleCacheEntry entry;
+	entry.src = tex;
+	entry.srcGeneration = tex->getGeneration();
+	entry.cropRect = cropRect;
+	entry.size = size;
+	entry.filter = filter;
+	entry.tex = NULL;
+	entry.lastUsed = ++m_scaleCacheUseCounter;
+	m_scaleCache.append(entry);
+	return m_scaleCache.size() - 1;
+}
+
+/// <summary>
+/// Removes all scale cache entries that were created from the texture `src`.
+/// Must be called before the texture is deleted.
+/// </summary>
+void D3DContext::removeScaleCacheEntries(Texture *src)
+{
+	if(src == NULL)
+		return;
+	for(int i = 0; i < m_scaleCache.size(); i++) {
+		if(m_scaleCache.at(i).src != src)
+			continue;
+		deletePooledTexture(m_scaleCache.at(i).tex);
+		m_scaleCache.remove(i);
+		i--;
+	}
+}
+
+/// <summary>
+/// Removes the least recently used scale cache entries until there are at
+/// most `maxEntries` remaining.
+/// </summary>
+void D3DContext::evictScaleCacheEntries(int maxEntries)
+{
+	maxEntries = qMax(0, maxEntries);
+	while(m_scaleCache.size() > maxEntries) {
+		int oldest = 0;
+		for(int i = 1; i < m_scaleCache.size(); i++) {
+			// Unsigned subtraction handles counter wrap around
+			quint32 age = m_scaleCacheUseCounter - m_scaleCache.at(i).lastUsed;
+			quint32 oldestAge =
+				m_scaleCacheUseCounter - m_scaleCache.at(oldest).lastUsed;
+			if(age > oldestAge)
+				oldest = i;
+		}
+		deletePooledTexture(m_scaleCache.at(oldest).tex);
+		m_scaleCache.remove(oldest);
+	}
+}
+
+/// <summary>
+/// Catmull-Rom cubic, the standard "bicubic" filter. Has a radius of 2.
+/// </summary>
+static double cubicKernel(double x)
+{
+	x = fabs(x);
+	if(x < 1.0)
+		return (1.5 * x - 2.5) * x * x + 1.0;
+	if(x < 2.0)
+		return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+	return 0.0;
+}
+
+/// <summary>
+/// Three lobe Lanczos windowed sinc. Has a radius of 3.
+/// </summary>
+static double lanczosKernel(double x)
+{
+	x = fabs(x);
+	if(x < 1e-8)
+		return 1.0;
+	if(x >= 3.0)
+		return 0.0;
+	double px = M_PI * x;
+	return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+/// <summary>
+/// Returns the filter weights that scale `srcLen` pixels to `dstLen` pixels
+/// along one axis, creating them if they are not in the cache. The weight
+/// texture is `dstLen` texels wide. Row 0 contains the index of the first
+/// input pixel of each output pixel relative to the start of the input and
+/// each following row contains the normalized weights of 4 consecutive taps.
+/// When downscaling the kernel is stretched to cover the footprint of the
+/// output pixel so that every input pixel contributes.
+/// </summary>
+/// <returns>NULL if the weight texture could not be created</returns>
+const D3DContext::ResampleWeights *D3DContext::getResampleWeights(
+	VidgfxFilter filter, int srcLen, int dstLen)
+{
+	for(int i = 0; i < m_resampleWeights.size(); i++) {
+		const ResampleWeights &weights = m_resampleWeights.at(i);
+		if(weights.filter == filter && weights.srcLen == srcLen &&
+			weights.dstLen == dstLen)
+		{
+			// Move to the front so that it's evicted last
+			if(i > 0)
+				m_resampleWeights.prepend(m_resampleWeights.takeAt(i));
+			return &m_resampleWeights.first();
+		}
+	}
+
+	// Determine the kernel size
+	double radius = (filter == GfxLanczosFilter) ? 3.0 : 2.0;
+	double ratio = (double)srcLen / (double)dstLen;
+	double scale = qMin(qMax(1.0, ratio),
+		(double)(MAX_RESAMPLE_TAPS - 1) / (2.0 * radius));
+	double support = radius * scale;
+	int numTaps = (int)floor(2.0 * support) + 1;
+	numTaps = (numTaps + 3) & ~3; // Round up to a multiple of 4
+
+	// Calculate the weights of every output pixel
+	const int rows = 1 + numTaps / 4;
+	QVector<float> data(dstLen * rows * 4, 0.0f);
+	for(int x = 0; x < dstLen; x++) {
+		double center = ((double)x + 0.5) * ratio;
+		int first = (int)ceil(center - support - 0.5);
+		data[x * 4] = (float)first;
+
+		double total = 0.0;
+		double tapWeights[MAX_RESAMPLE_TAPS];
+		for(int i = 0; i < numTaps; i++) {
+			double dist = ((double)(first + i) + 0.5 - center) / scale;
+			tapWeights[i] = (filter == GfxLanczosFilter)
+				? lanczosKernel(dist) : cubicKernel(dist);
+			total += tapWeights[i];
+		}
+		if(total == 0.0)
+			total = 1.0;
+		for(int i = 0; i < numTaps; i++) {
+			int row = 1 + i / 4;
+			data[(row * dstLen + x) * 4 + (i % 4)] =
+				(float)(tapWeights[i] / total);
+		}
+	}
+
+	D3DTexture *tex = new D3DTexture(
+		this, 0, QSize(dstLen, rows), DXGI_FORMAT_R32G32B32A32_FLOAT,
+		data.data(), dstLen * 4 * sizeof(float));
+	if(!tex->isValid()) {
+		delete tex;
+		return NULL;
+	}
+
+	// Add to the cache, evicting the least recently used weights
+	while(m_resampleWeights.size() >= MAX_RESAMPLE_WEIGHTS) {
+		deleteTexture(m_resampleWeights.last().tex);
+		m_resampleWeights.removeLast();
+	}
+	ResampleWeights weights;
+	weights.filter = filter;
+	weights.srcLen = srcLen;
+	weights.dstLen = dstLen;
+	weights.numTaps = numTaps;
+	weights.tex = tex;
+	m_resampleWeights.prepend(weights);
+	return &m_resampleWeights.first();
+}
+
+/// <summary>
+/// Scales `cropRect` of `tex` to exactly `size` using `GfxBicubicFilter` or
+/// `GfxLanczosFilter` as a horizontal pass followed by a vertical pass. Only
+/// the rows that the vertical pass samples are processed by the horizontal
+/// pass. The result is on a scratch target and the caller must restore the
+/// render target.
+/// </summary>
+/// <returns>NULL if resampling is unsupported by the device</returns>
+Texture *D3DContext::resampleTexture(
+	Texture *tex, const QRect &cropRect, const QSize &size,
+	VidgfxFilter filter)
+{
+	if(getPixelShader(ResampleHorzPS) == NULL ||
+		getPixelShader(ResampleVertPS) == NULL)
+	{
+		return NULL; // Requires feature level 10.0
+	}
+	if(cropRect.isEmpty() || size.isEmpty())
+		return NULL;
+	const QSize &texSize = tex->getSize();
+
+	// Parts of the crop rectangle that are outside of the texture are clamped
+	// to the edge pixels by the shaders
+	const QRect &srcRect = cropRect;
+
+	// The vertical weights are needed first to determine the rows that the
+	// horizontal pass must output. Copy the entries as the cache may evict.
+	const ResampleWeights *weightsPtr =
+		getResampleWeights(filter, srcRect.height(), size.height());
+	if(weightsPtr == NULL)
+		return NULL;
+	ResampleWeights vertWeights = *weightsPtr;
+	weightsPtr = getResampleWeights(filter, srcRect.width(), size.width());
+	if(weightsPtr == NULL)
+		return NULL;
+	ResampleWeights horzWeights = *weightsPtr;
+
+	// Rows of the input that the vertical pass can sample
+	int margin = vertWeights.numTaps / 2 + 1;
+	int horzTop = qMax(0, srcRect.top() - margin);
+	int horzBottom = qMin(texSize.height(), srcRect.bottom() + 1 + margin);
+	if(horzBottom <= horzTop)
+		return NULL; // Crop rectangle is completely out of bounds
+	QSize horzSize(size.width(), horzBottom - horzTop);
+
+	// Make sure that the scratch targets are large enough for both passes
+	// before rendering so that they are not recreated in between
+	resizeScratchTarget(QSize(
+		size.width(), qMax(size.height(), horzSize.height())));
+
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTextureFilter(GfxPointFilter); // Shaders fetch exact texels
+
+	// Horizontal pass
+	resizeScratchTarget(horzSize);
+	VidgfxRendTarget horzTarget = getNextScratchTarget();
+	setRenderTarget(horzTarget);
+	mat.ortho(
+		0.0f, horzSize.width(), horzSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+	float horzConsts[8] = {
+		(float)horzWeights.numTaps, (float)srcRect.left(), (float)horzTop,
+		static_cast<D3DTexture *>(tex)->doBgraSwizzle() ? 1.0f : 0.0f,
+		(float)(texSize.width() - 1), (float)(texSize.height() - 1),
+		0.0f, 0.0f };
+	updateConversionConstants(GfxResampleHorzShader, horzConsts);
+	createTexDecalRect(m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)horzSize.width(), (qreal)horzSize.height()));
+	setShader(GfxResampleHorzShader);
+	setTexture(tex, horzWeights.tex);
+	drawBuffer(m_mipmapBuf);
+	Texture *horzTex = getTargetTexture(horzTarget);
+
+	// Vertical pass
+	resizeScratchTarget(size);
+	VidgfxRendTarget vertTarget = getNextScratchTarget();
+	setRenderTarget(vertTarget);
+	mat.setToIdentity();
+	mat.ortho(0.0f, size.width(), size.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+	float vertConsts[8] = {
+		(float)vertWeights.numTaps, (float)(srcRect.top() - horzTop), 0.0f,
+		0.0f, (float)(horzSize.width() - 1), (float)(horzSize.height() - 1),
+		0.0f, 0.0f };
+	updateConversionConstants(GfxResampleVertShader, vertConsts);
+	createTexDecalRect(m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)size.width(), (qreal)size.height()));
+	setShader(GfxResampleVertShader);
+	setTexture(horzTex, vertWeights.tex);
+	drawBuffer(m_mipmapBuf);
+
+	return getTargetTexture(vertTarget);
 }
 
 //=============================================================================
@@ -1749,7 +3672,7 @@ void D3DContext::setSwizzleInTexDecal(bool doSwizzle)
 
 bool D3DContext::isValid() const
 {
-	return m_swapChain != NULL && m_device != NULL;
+	return m_swapChain != NULL && m_device != NULL && !m_isDeviceLost;
 }
 
 /// <summary>
@@ -1849,165 +3772,832 @@ Texture *D3DContext::createTexture(QImage img, bool writable, bool targetable)
 }
 
 /// <summary>
-/// Creates a rewritable texture buffer of the specified size. `writable` means
-/// writable by the CPU and `targetable` means the texture can be bound to a
-/// render target. It is possible to have a texture that is not writable or
-/// targetable if you're only populating it using `copyTextureData()`. Textures
-/// are in the `RGBA` format unless `useBgra` is true in which case the texture
-/// is in the `BGRA` format.
+/// Creates a rewritable texture buffer of the specified size. `writable` means
+/// writable by the CPU and `targetable` means the texture can be bound to a
+/// render target. It is possible to have a texture that is not writable or
+/// targetable if you're only populating it using `copyTextureData()`. Textures
+/// are in the `RGBA` format unless `useBgra` is true in which case the texture
+/// is in the `BGRA` format.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3DContext::createTexture(
+	const QSize &size, bool writable, bool targetable, bool useBgra)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	if(useBgra)
+		format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	D3DTexture *tex = createPooledTexture(flags, size, format);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a rewritable texture buffer of the specified size. `writable` means
+/// writable by the CPU and `targetable` means the texture can be bound to a
+/// render target. It is possible to have a texture that is not writable or
+/// targetable if you're only populating it using `copyTextureData()`. The
+/// created texture will have the same pixel format as the texture `sameFormat`
+/// so that it's safe to copy pixel data between the two textures with
+/// `copyTextureData()`.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3DContext::createTexture(
+	const QSize &size, Texture *sameFormat, bool writable, bool targetable)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(sameFormat == NULL)
+		return NULL;
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	D3DTexture *fmtTex = static_cast<D3DTexture *>(sameFormat);
+	DXGI_FORMAT format = fmtTex->getPixelFormat();
+	D3DTexture *tex = createPooledTexture(flags, size, format);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a special texture buffer that cannot be bound with `setTexture()`
+/// but can be used to read back pixel data from the graphics hardware.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3DContext::createStagingTexture(const QSize &size)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+
+	D3DTexture *tex = createPooledTexture(
+		GfxStagingFlag, size, DXGI_FORMAT_R8G8B8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a texture buffer of the specified size that has only two 8-bit
+/// components per pixel (`R8G8`). This is designed for uploading interleaved
+/// chroma planes such as the UV plane of NV12 without repacking on the CPU.
+/// `writable` and `targetable` have the same meaning as `createTexture()`.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created texture or NULL on failure.
+/// </returns>
+Texture *D3DContext::createRgTexture(
+	const QSize &size, bool writable, bool targetable)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	VidgfxTexFlags flags = 0;
+	if(writable)
+		flags |= GfxWritableFlag;
+	if(targetable)
+		flags |= GfxTargetableFlag;
+
+	D3DTexture *tex =
+		createPooledTexture(flags, size, DXGI_FORMAT_R8G8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Sets the maximum number of downscaled textures that `prepareTexture()`
+/// keeps alive between calls. Setting this to zero disables the cache.
+/// </summary>
+void D3DContext::setScaleCacheSize(int maxEntries)
+{
+	m_scaleCacheMaxSize = qMax(0, maxEntries);
+	evictScaleCacheEntries(m_scaleCacheMaxSize);
+}
+
+int D3DContext::getScaleCacheSize() const
+{
+	return m_scaleCacheMaxSize;
+}
+
+/// <summary>
+/// Releases all textures that are used by the `prepareTexture()` cache.
+/// </summary>
+void D3DContext::purgeScaleCache()
+{
+	evictScaleCacheEntries(0);
+	for(int i = 0; i < m_resampleWeights.size(); i++)
+		deleteTexture(m_resampleWeights.at(i).tex);
+	m_resampleWeights.clear();
+}
+
+// This method is not a part of the GraphicsContext interface but it placed
+// here as it's related to texture creation.
+Texture *D3DContext::createGDITexture(const QSize &size)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(!hasDxgi11())
+		return NULL; // GDI compatible textures are a DXGI 1.1 feature
+	if(!hasBgraTexSupport())
+		return NULL; // GDI compatible textures are always BGRA
+
+	// GDI-compatible textures _MUST_ be in BGRA format and be targetable
+	// otherwise we will receive E_INVALIDARG errors
+	D3DTexture *tex = new D3DTexture(
+		this, GfxTargetableFlag | GfxGDIFlag, size,
+		DXGI_FORMAT_B8G8R8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+/// <summary>
+/// Creates a BGRA render target that other devices, including D3D11 devices
+/// and hardware encoders, can open without copying by passing
+/// `D3DTexture::getSharedHandle()` to their `OpenSharedResource()`. If
+/// `useKeyedMutex` is true then both sides must surround their use of the
+/// texture with `AcquireSync()` and `ReleaseSync()`, see
+/// `D3DTexture::acquireSync()`. Shared textures are never pooled as the other
+/// device may still be holding a reference to them.
+/// </summary>
+Texture *D3DContext::createSharedTexture(
+	const QSize &size, bool useKeyedMutex)
+{
+	if(size.isEmpty())
+		return NULL; // Cannot create empty textures
+	if(!hasBgraTexSupport())
+		return NULL; // Only BGRA textures can be shared between devices
+
+	D3DTexture *tex = new D3DTexture(
+		this, GfxTargetableFlag |
+		(useKeyedMutex ? GfxKeyedMutexFlag : GfxSharedFlag), size,
+		DXGI_FORMAT_B8G8R8A8_UNORM);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+// This method is not a part of the GraphicsContext interface but it placed
+// here as it's related to texture creation. If the producer created the
+// resource with `D3D10_RESOURCE_MISC_SHARED_KEYEDMUTEX` then the returned
+// texture can be sampled directly between `D3DTexture::acquireSync()` and
+// `D3DTexture::releaseSync()` calls instead of copying it every frame.
+Texture *D3DContext::openSharedTexture(HANDLE sharedHandle)
+{
+	if(sharedHandle == NULL)
+		return NULL; // Invalid handle
+
+	// Open shared resource as a texture
+	ID3D10Resource *resource = NULL;
+	HRESULT res = m_device->OpenSharedResource(
+		sharedHandle, __uuidof(ID3D10Resource), (void **)(&resource));
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to open DirectX shared resource. "
+			<< "Reason = " << getDXErrorCode(res);
+		return NULL;
+	}
+	ID3D10Texture2D *d3dTex = NULL;
+	res = resource->QueryInterface(
+		__uuidof(ID3D10Texture2D), (void **)(&d3dTex));
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to convert DirectX shared resource to a texture. "
+			<< "Reason = " << getDXErrorCode(res);
+		resource->Release();
+		return NULL;
+	}
+	resource->Release();
+
+	D3DTexture *tex = new D3DTexture(this, d3dTex);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+Texture *D3DContext::openDX10Texture(ID3D10Texture2D *d3dTex)
+{
+	if(d3dTex == NULL)
+		return NULL; // Invalid handle
+	D3DTexture *tex = new D3DTexture(this, d3dTex);
+	if(tex->isValid())
+		return tex;
+	delete tex;
+	return NULL;
+}
+
+void D3DContext::deleteTexture(Texture *tex)
+{
+	if(tex == NULL)
+		return;
+	removeScaleCacheEntries(tex);
+	deletePooledTexture(static_cast<D3DTexture *>(tex));
+}
+
+/// <summary>
+/// Sets the maximum amount of video memory in bytes that unused textures in
+/// the texture pool can consume. Setting this to zero disables the pool.
+/// </summary>
+void D3DContext::setTexturePoolLimit(qint64 maxBytes)
+{
+	m_texPoolMaxBytes = qMax<qint64>(0, maxBytes);
+	trimTexturePool(m_texPoolMaxBytes);
+}
+
+/// <summary>
+/// Destroys the oldest unused textures in the texture pool until the pool is
+/// using at most `maxBytes` of video memory.
+/// </summary>
+void D3DContext::trimTexturePool(qint64 maxBytes)
+{
+	while(!m_texPool.isEmpty() && m_texPoolStats.num_bytes > maxBytes) {
+		D3DTexture *tex = m_texPool.first();
+		m_texPool.remove(0);
+		m_texPoolStats.num_textures--;
+		m_texPoolStats.num_bytes -= tex->getMemoryUsage();
+		m_texPoolStats.num_trimmed++;
+		delete tex;
+	}
+}
+
+/// <summary>
+/// Sets how `swapScreenBuffers()` presents the screen target. Out of range
+/// values are clamped. Can be called before `initialize()`. Changing the buffer
+/// count recreates the swap chain buffers and the maximum frame latency applies
+/// to the entire device, not just the screen target.
+/// </summary>
+void D3DContext::setPresentMode(const VidgfxD3DPresentMode &mode)
+{
+	VidgfxD3DPresentMode oldMode = m_presentMode;
+	m_presentMode.buffer_count = qBound(1, mode.buffer_count, 8);
+	m_presentMode.sync_interval = qBound(0, mode.sync_interval, 4);
+	m_presentMode.skip_if_busy = mode.skip_if_busy;
+	m_presentMode.max_frame_latency = qBound(0, mode.max_frame_latency, 16);
+	m_presentMode.present_divisor = qMax(1, mode.present_divisor);
+
+	if(!isValid())
+		return; // Applied during initialization
+	if(m_presentMode.buffer_count != oldMode.buffer_count)
+		resizeScreenBuffers(m_screenTargetSize);
+	if(m_presentMode.max_frame_latency != oldMode.max_frame_latency)
+		applyMaxFrameLatency();
+}
+
+/// <summary>
+/// Limits the number of frames that the CPU can queue ahead of the GPU to the
+/// value of the present mode so that the screen target cannot build up a
+/// backlog of frames.
+/// </summary>
+void D3DContext::applyMaxFrameLatency()
+{
+	if(m_device == NULL)
+		return;
+
+	IDXGIDevice1 *dxgiDevice = NULL;
+	HRESULT res = m_device->QueryInterface(
+		__uuidof(IDXGIDevice1), (void **)&dxgiDevice);
+	if(FAILED(res)) {
+		// Requires DXGI 1.1
+		if(m_presentMode.max_frame_latency > 0) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Cannot set maximum frame latency as DXGI 1.1 is "
+				<< "unavailable";
+		}
+		return;
+	}
+	res = dxgiDevice->SetMaximumFrameLatency(
+		m_presentMode.max_frame_latency); // 0 = Default
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to set maximum frame latency. "
+			<< "Reason = " << getDXErrorCode(res);
+	}
+	dxgiDevice->Release();
+}
+
+/// <summary>
+/// Forgets our copy of the device state so that the next call to each of the
+/// state setting methods is always sent to the device. Must be called if the
+/// device state is modified outside of `D3DContext` (E.g. by a renderer that
+/// shares our device) or when a bound object is released.
+/// </summary>
+void D3DContext::invalidateStateCache()
+{
+	m_boundTargetViews[0] = NULL;
+	m_boundTargetViews[1] = NULL;
+	m_boundViewport = QRect();
+	m_boundTopology = -1;
+	m_boundBlendState = NULL;
+	m_numBoundResourceViews = -1;
+	m_boundSampler = NULL;
+	m_boundVSConstants = NULL;
+	m_boundPSConstants = NULL;
+	m_boundShader = GfxNoShader;
+	m_boundPixelShader = -1;
+	m_instancedVSBound = false;
+}
+
+/// <summary>
+/// Updates and binds the camera constants of the current target and the pixel
+/// shader constants of the bound shader. Buffers are only uploaded when their
+/// contents have changed and only rebound when they differ from what is
+/// already bound.
+/// </summary>
+void D3DContext::bindDrawConstants()
+{
+	bindPixelShader();
+	bindVSConstants(updateCameraConstants());
+
+	// Update and bind our pixel shader constants if needed
+	if(m_boundShader == GfxResizeLayerShader) {
+		updateResizeConstants();
+		bindPSConstants(m_resizeConstants);
+	} else if(m_boundShader == GfxRgbNv16Shader) {
+		updateRgbNv16Constants();
+		bindPSConstants(m_rgbNv16Constants);
+	} else if(m_boundShader == GfxTexDecalShader ||
+		m_boundShader == GfxTexDecalGbcsShader ||
+		m_boundShader == GfxTexDecalRgbShader)
+	{
+		updateTexDecalConstants();
+		bindPSConstants(m_texDecalConstants);
+	} else {
+		// Format conversion shaders are updated by `convertToBgrx()`,
+		// `convertFromRgb()` or `scaleToNv16()`
+		ID3D10Buffer *buf = getConversionConstants(m_boundShader);
+		if(buf != NULL)
+			bindPSConstants(buf);
+	}
+}
+
+/// <summary>
+/// Binds the instanced vertex shader that matches the input of the bound
+/// shader's pixel shader. The pixel shader is left unchanged.
+/// </summary>
+/// <returns>False if the bound shader has no instanced vertex shader</returns>
+bool D3DContext::bindInstancedShader()
+{
+	if(m_instancedVSBound)
+		return true; // Already bound
+
+	switch(m_boundShader) {
+	case GfxNoShader:
+	case GfxResizeLayerShader:
+		return false;
+	case GfxSolidShader:
+		m_device->IASetInputLayout(m_solidInstIL);
+		m_device->VSSetShader(m_solidInstVS);
+		break;
+	default: // All other shaders share `texDecalVS`
+		m_device->IASetInputLayout(m_texDecalInstIL);
+		m_device->VSSetShader(m_texDecalInstVS);
+		break;
+	}
+	m_instancedVSBound = true;
+	return true;
+}
+
+/// <summary>
+/// Appends `numBytes` of vertex data to the shared vertex ring. The ring is
+/// mapped with `D3D10_MAP_WRITE_NO_OVERWRITE` so that the driver doesn't need
+/// to rename it for every small buffer and is only discarded when it wraps
+/// which invalidates every previous allocation by incrementing
+/// `getVertexRingGeneration()`.
+/// </summary>
+/// <returns>True if the data was uploaded at byte offset `offsetOut`</returns>
+bool D3DContext::appendToVertexRing(
+	const void *data, int numBytes, int &offsetOut)
+{
+	if(m_vertRing == NULL || data == NULL)
+		return false;
+	if(numBytes <= 0 || numBytes > VERTEX_RING_BYTES)
+		return false;
+
+	// Data previously written to the ring may still be in use by the GPU so
+	// we can only write after it until we run out of space
+	D3D10_MAP mapType = D3D10_MAP_WRITE_NO_OVERWRITE;
+	if(m_vertRingPos + numBytes > VERTEX_RING_BYTES) {
+		mapType = D3D10_MAP_WRITE_DISCARD;
+		m_vertRingPos = 0;
+		m_vertRingGeneration++;
+	}
+
+	// Map buffer to CPU RAM
+	quint8 *ptr;
+	HRESULT res = m_vertRing->Map(
+		mapType, 0, reinterpret_cast<void **>(&ptr));
+	if(FAILED(res)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to map DirectX vertex ring into RAM. "
+			<< "Reason = " << getDXErrorCode(res);
+		return false;
+	}
+	memcpy(&ptr[m_vertRingPos], data, numBytes);
+	m_vertRing->Unmap();
+	addProfileBytesUploaded(numBytes);
+
+	// Keep allocations 16-byte aligned
+	offsetOut = m_vertRingPos;
+	m_vertRingPos += (numBytes + 15) & ~15;
+
+	return true;
+}
+
+/// <summary>
+/// Enables or disables the GPU profiler. While enabled every frame that is
+/// surrounded by `beginProfileFrame()` and `endProfileFrame()` is timed and
+/// its results are delivered to the profile frame callbacks a few frames
+/// later. Disabling the profiler discards any results that haven't been
+/// delivered yet.
+/// </summary>
+void D3DContext::setProfilingEnabled(bool enabled)
+{
+	if(m_profilingEnabled == enabled)
+		return;
+	if(!enabled) {
+		if(m_profInFrame)
+			endProfileFrame();
+		releaseProfileQueries();
+	}
+	m_profilingEnabled = enabled;
+}
+
+void D3DContext::beginProfileFrame()
+{
+	if(!m_profilingEnabled || m_profInFrame || m_device == NULL)
+		return;
+
+	// Deliver any completed frames first so that their slots can be reused
+	collectProfileResults();
+
+	if(m_profFrames.isEmpty()) {
+		ProfileFrame frame;
+		frame.disjointQuery = NULL;
+		frame.numQueriesUsed = 0;
+		frame.frameNum = 0;
+		frame.numDrawCalls = 0;
+		frame.numBytesUploaded = 0;
+		frame.numBytesReadBack = 0;
+		frame.isPending = false;
+		m_profFrames.fill(frame, NUM_PROFILE_FRAMES);
+		m_profCurFrame = 0;
+	}
+	ProfileFrame &frame = m_profFrames[m_profCurFrame];
+	if(frame.isPending) {
+		// The GPU is too far behind, drop the oldest frame instead of waiting
+		frame.isPending = false;
+		m_profNumDropped++;
+	}
+	if(frame.disjointQuery == NULL) {
+		D3D10_QUERY_DESC desc;
+		desc.Query = D3D10_QUERY_TIMESTAMP_DISJOINT;
+		desc.MiscFlags = 0;
+		HRESULT res = m_device->CreateQuery(&desc, &frame.disjointQuery);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create GPU profiler query. "
+				<< "Reason = " << getDXErrorCode(res);
+			frame.disjointQuery = NULL;
+			return;
+		}
+	}
+
+	frame.numQueriesUsed = 0;
+	frame.scopes.clear();
+	frame.frameNum = m_profFrameCounter++;
+	frame.numDrawCalls = 0;
+	frame.numBytesUploaded = 0;
+	frame.numBytesReadBack = 0;
+	m_profScopeStack.clear();
+
+	frame.disjointQuery->Begin();
+	m_profInFrame = true;
+	if(issueProfileTimestamp() < 0) {
+		frame.disjointQuery->End();
+		m_profInFrame = false;
+	}
+}
+
+void D3DContext::endProfileFrame()
+{
+	if(!m_profInFrame)
+		return;
+
+	// Close any scopes that the caller forgot about
+	while(!m_profScopeStack.isEmpty())
+		endProfileScope();
+
+	ProfileFrame &frame = m_profFrames[m_profCurFrame];
+	bool ok = (issueProfileTimestamp() >= 0);
+	frame.disjointQuery->End();
+	frame.isPending = ok;
+	m_profInFrame = false;
+	m_profCurFrame = (m_profCurFrame + 1) % m_profFrames.size();
+
+	collectProfileResults();
+}
+
+/// <summary>
+/// Begins a named scope within the current profiled frame. Scopes can be
+/// nested and must be ended with `endProfileScope()`. Does nothing if a frame
+/// isn't being profiled.
+/// </summary>
+void D3DContext::beginProfileScope(const char *name)
+{
+	if(!m_profInFrame)
+		return;
+	ProfileFrame &frame = m_profFrames[m_profCurFrame];
+	if(frame.scopes.size() >= MAX_PROFILE_SCOPES) {
+		m_profScopeStack.append(-1); // Keep begin/end balanced
+		return;
+	}
+
+	ProfileScope scope;
+	scope.name = QByteArray(name != NULL ? name : "");
+	scope.depth = m_profScopeStack.size();
+	scope.beginQuery = issueProfileTimestamp();
+	scope.endQuery = -1;
+	if(scope.beginQuery < 0) {
+		m_profScopeStack.append(-1);
+		return;
+	}
+	m_profScopeStack.append(frame.scopes.size());
+	frame.scopes.append(scope);
+}
+
+void D3DContext::endProfileScope()
+{
+	if(!m_profInFrame || m_profScopeStack.isEmpty())
+		return;
+	int id = m_profScopeStack.takeLast();
+	if(id < 0)
+		return; // Scope wasn't recorded
+	ProfileFrame &frame = m_profFrames[m_profCurFrame];
+	frame.scopes[id].endQuery = issueProfileTimestamp();
+}
+
+/// <summary>
+/// Writes a GPU timestamp into the current profiled frame.
+/// </summary>
+/// <returns>The index of the query or -1 on failure</returns>
+int D3DContext::issueProfileTimestamp()
+{
+	ProfileFrame &frame = m_profFrames[m_profCurFrame];
+	if(frame.numQueriesUsed >= frame.queries.size()) {
+		D3D10_QUERY_DESC desc;
+		desc.Query = D3D10_QUERY_TIMESTAMP;
+		desc.MiscFlags = 0;
+		ID3D10Query *query = NULL;
+		HRESULT res = m_device->CreateQuery(&desc, &query);
+		if(FAILED(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create GPU profiler query. "
+				<< "Reason = " << getDXErrorCode(res);
+			return -1;
+		}
+		frame.queries.append(query);
+	}
+	int id = frame.numQueriesUsed++;
+	frame.queries.at(id)->End();
+	return id;
+}
+
+/// <summary>
+/// Delivers the results of every profiled frame that the GPU has finished
+/// processing, oldest first. Never waits for the GPU.
 /// </summary>
-/// <returns>
-/// A pointer to the newly created texture or NULL on failure.
-/// </returns>
-Texture *D3DContext::createTexture(
-	const QSize &size, bool writable, bool targetable, bool useBgra)
+void D3DContext::collectProfileResults()
 {
-	if(size.isEmpty())
-		return NULL; // Cannot create empty textures
-	VidgfxTexFlags flags = 0;
-	if(writable)
-		flags |= GfxWritableFlag;
-	if(targetable)
-		flags |= GfxTargetableFlag;
+	int numFrames = m_profFrames.size();
+	for(int i = 0; i < numFrames; i++) {
+		// The current slot is the oldest one in the ring
+		ProfileFrame &frame = m_profFrames[(m_profCurFrame + i) % numFrames];
+		if(!frame.isPending)
+			continue;
+
+		D3D10_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if(frame.disjointQuery->GetData(
+			&disjoint, sizeof(disjoint), D3D10_ASYNC_GETDATA_DONOTFLUSH)
+			!= S_OK)
+		{
+			return; // Not ready yet, newer frames won't be ready either
+		}
+		QVector<UINT64> stamps(frame.numQueriesUsed);
+		for(int j = 0; j < frame.numQueriesUsed; j++) {
+			if(frame.queries.at(j)->GetData(
+				&stamps[j], sizeof(UINT64), D3D10_ASYNC_GETDATA_DONOTFLUSH)
+				!= S_OK)
+			{
+				return; // Not ready yet
+			}
+		}
+		frame.isPending = false;
+		if(disjoint.Disjoint || disjoint.Frequency == 0) {
+			// The GPU clock changed during the frame, timings are unreliable
+			m_profNumDropped++;
+			continue;
+		}
 
-	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	if(useBgra)
-		format = DXGI_FORMAT_B8G8R8A8_UNORM;
-	D3DTexture *tex = new D3DTexture(this, flags, size, format);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+		// Convert to milliseconds relative to the frame
+		double toMsec = 1000.0 / (double)disjoint.Frequency;
+		QVector<VidgfxD3DProfileScope> scopes(frame.scopes.size());
+		for(int j = 0; j < frame.scopes.size(); j++) {
+			const ProfileScope &scope = frame.scopes.at(j);
+			VidgfxD3DProfileScope &out = scopes[j];
+			out.name = scope.name.constData();
+			out.depth = scope.depth;
+			out.gpu_msec = 0.0f;
+			if(scope.endQuery >= 0) {
+				out.gpu_msec = (float)((double)
+					(stamps.at(scope.endQuery) - stamps.at(scope.beginQuery))
+					* toMsec);
+			}
+		}
+		VidgfxD3DProfileFrame result;
+		result.frame_num = frame.frameNum;
+		result.gpu_msec = (float)((double)
+			(stamps.at(frame.numQueriesUsed - 1) - stamps.at(0)) * toMsec);
+		result.num_draw_calls = frame.numDrawCalls;
+		result.num_bytes_uploaded = frame.numBytesUploaded;
+		result.num_bytes_read_back = frame.numBytesReadBack;
+		result.num_dropped_frames = m_profNumDropped;
+		result.num_scopes = scopes.size();
+		result.scopes = scopes.constData();
+		m_profNumDropped = 0;
+		callProfileFrameCallbacks(&result);
+	}
+}
+
+void D3DContext::releaseProfileQueries()
+{
+	for(int i = 0; i < m_profFrames.size(); i++) {
+		ProfileFrame &frame = m_profFrames[i];
+		if(frame.disjointQuery)
+			frame.disjointQuery->Release();
+		for(int j = 0; j < frame.queries.size(); j++)
+			frame.queries.at(j)->Release();
+	}
+	m_profFrames.clear();
+	m_profScopeStack.clear();
+	m_profInFrame = false;
+	m_profCurFrame = 0;
+	m_profNumDropped = 0;
 }
 
 /// <summary>
-/// Creates a rewritable texture buffer of the specified size. `writable` means
-/// writable by the CPU and `targetable` means the texture can be bound to a
-/// render target. It is possible to have a texture that is not writable or
-/// targetable if you're only populating it using `copyTextureData()`. The
-/// created texture will have the same pixel format as the texture `sameFormat`
-/// so that it's safe to copy pixel data between the two textures with
-/// `copyTextureData()`.
+/// Tests if the failure `res` was caused by the graphics device being removed
+/// or reset (E.g. a driver update or a GPU timeout). If it was then the
+/// context becomes invalid until `recoverDevice()` succeeds which is attempted
+/// automatically by `swapScreenBuffers()`.
 /// </summary>
-/// <returns>
-/// A pointer to the newly created texture or NULL on failure.
-/// </returns>
-Texture *D3DContext::createTexture(
-	const QSize &size, Texture *sameFormat, bool writable, bool targetable)
+/// <returns>True if the device is lost</returns>
+bool D3DContext::checkDeviceRemoved(HRESULT res)
 {
-	if(size.isEmpty())
-		return NULL; // Cannot create empty textures
-	if(sameFormat == NULL)
-		return NULL;
-	VidgfxTexFlags flags = 0;
-	if(writable)
-		flags |= GfxWritableFlag;
-	if(targetable)
-		flags |= GfxTargetableFlag;
+	if(SUCCEEDED(res) || m_device == NULL)
+		return false;
+	if(m_isDeviceLost)
+		return true;
 
-	D3DTexture *fmtTex = static_cast<D3DTexture *>(sameFormat);
-	DXGI_FORMAT format = fmtTex->getPixelFormat();
-	D3DTexture *tex = new D3DTexture(this, flags, size, format);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+	HRESULT reason = m_device->GetDeviceRemovedReason();
+	if(SUCCEEDED(reason)) {
+		if(res != DXGI_ERROR_DEVICE_REMOVED && res != DXGI_ERROR_DEVICE_RESET)
+			return false; // Unrelated failure
+		reason = res;
+	}
+
+	gfxLog(LOG_CAT, GfxLog::Critical)
+		<< "DirectX device was removed, attempting to recover. "
+		<< "Reason = " << getDXErrorCode(reason);
+	m_isDeviceLost = true;
+
+	// Attempt the first recovery immediately
+	m_lastRecoveryTick = GetTickCount() - DEVICE_RECOVERY_INTERVAL_MSEC;
+	return true;
 }
 
 /// <summary>
-/// Creates a special texture buffer that cannot be bound with `setTexture()`
-/// but can be used to read back pixel data from the graphics hardware.
+/// Recreates the device after it was lost. The destroying callbacks are called
+/// before the old device is released and the initialized callbacks once the
+/// new device is ready so that the application can recreate anything it
+/// manages itself. Textures, vertex buffers and readback queues that are still
+/// owned by the application are recreated with their original parameters. The
+/// contents of vertex buffers are restored but the texel data of textures is
+/// undefined. Textures that were not created by libvidgfx (E.g. opened shared
+/// textures) remain invalid and must be recreated by the application.
 /// </summary>
-/// <returns>
-/// A pointer to the newly created texture or NULL on failure.
-/// </returns>
-Texture *D3DContext::createStagingTexture(const QSize &size)
+/// <returns>True if the device is usable</returns>
+bool D3DContext::recoverDevice()
 {
-	if(size.isEmpty())
-		return NULL; // Cannot create empty textures
+	if(!m_isDeviceLost)
+		return true;
+	if(m_hwnd == NULL)
+		return false; // Never initialized
+	m_lastRecoveryTick = GetTickCount();
+
+	// Release the old device. We only notify the application once even if it
+	// takes multiple attempts to recreate the device.
+	if(m_device != NULL) {
+		callDestroyingCallbacks();
+		emit destroying(this);
+		releaseDeviceObjects();
+	}
 
-	D3DTexture *tex =
-		new D3DTexture(this, GfxStagingFlag, size, DXGI_FORMAT_R8G8B8A8_UNORM);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+	// Attempt to create a new device
+	m_isDeviceLost = false;
+	if(!createDeviceObjects(m_screenTargetSize)) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Failed to recreate DirectX device, will retry";
+		releaseDeviceObjects();
+		m_isDeviceLost = true;
+		return false;
+	}
+
+	// Recreate the canvas at its previous size
+	QSize canvasSize = m_canvasTargetSize;
+	m_canvasTargetSize = QSize(0, 0);
+	if(!canvasSize.isEmpty())
+		resizeCanvasTarget(canvasSize);
+
+	// Recreate resources that are owned by the application. Queues last as
+	// they depend on their staging textures.
+	int numFailed = 0;
+	for(int i = 0; i < m_liveTextures.size(); i++) {
+		if(!m_liveTextures.at(i)->recreateResources())
+			numFailed++;
+	}
+	for(int i = 0; i < m_liveVertexBufs.size(); i++)
+		m_liveVertexBufs.at(i)->recreateResources();
+	for(int i = 0; i < m_liveReadbackQueues.size(); i++)
+		m_liveReadbackQueues.at(i)->recreateResources();
+
+	m_numDeviceResets++;
+	gfxLog(LOG_CAT) << QStringLiteral(
+		"Recovered DirectX device, %1 textures could not be recreated")
+		.arg(numFailed);
+
+	callInitializedCallbacks();
+	emit initialized(this);
+	return true;
 }
 
-// This method is not a part of the GraphicsContext interface but it placed
-// here as it's related to texture creation.
-Texture *D3DContext::createGDITexture(const QSize &size)
+void D3DContext::addResource(D3DTexture *tex)
 {
-	if(size.isEmpty())
-		return NULL; // Cannot create empty textures
-	if(!hasDxgi11())
-		return NULL; // GDI compatible textures are a DXGI 1.1 feature
-	if(!hasBgraTexSupport())
-		return NULL; // GDI compatible textures are always BGRA
-
-	// GDI-compatible textures _MUST_ be in BGRA format and be targetable
-	// otherwise we will receive E_INVALIDARG errors
-	D3DTexture *tex = new D3DTexture(
-		this, GfxTargetableFlag | GfxGDIFlag, size,
-		DXGI_FORMAT_B8G8R8A8_UNORM);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+	m_liveTextures.append(tex);
 }
 
-// This method is not a part of the GraphicsContext interface but it placed
-// here as it's related to texture creation.
-Texture *D3DContext::openSharedTexture(HANDLE sharedHandle)
+void D3DContext::removeResource(D3DTexture *tex)
 {
-	if(sharedHandle == NULL)
-		return NULL; // Invalid handle
+	int index = m_liveTextures.lastIndexOf(tex);
+	if(index >= 0)
+		m_liveTextures.remove(index);
+}
 
-	// Open shared resource as a texture
-	ID3D10Resource *resource = NULL;
-	HRESULT res = m_device->OpenSharedResource(
-		sharedHandle, __uuidof(ID3D10Resource), (void **)(&resource));
-	if(FAILED(res)) {
-		gfxLog(LOG_CAT, GfxLog::Warning)
-			<< "Failed to open DirectX shared resource. "
-			<< "Reason = " << getDXErrorCode(res);
-		return NULL;
-	}
-	ID3D10Texture2D *d3dTex = NULL;
-	res = resource->QueryInterface(
-		__uuidof(ID3D10Texture2D), (void **)(&d3dTex));
-	if(FAILED(res)) {
-		gfxLog(LOG_CAT, GfxLog::Warning)
-			<< "Failed to convert DirectX shared resource to a texture. "
-			<< "Reason = " << getDXErrorCode(res);
-		resource->Release();
-		return NULL;
-	}
-	resource->Release();
+void D3DContext::addResource(D3DVertexBuffer *buf)
+{
+	m_liveVertexBufs.append(buf);
+}
 
-	D3DTexture *tex = new D3DTexture(this, d3dTex);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+void D3DContext::removeResource(D3DVertexBuffer *buf)
+{
+	int index = m_liveVertexBufs.lastIndexOf(buf);
+	if(index >= 0)
+		m_liveVertexBufs.remove(index);
 }
 
-Texture *D3DContext::openDX10Texture(ID3D10Texture2D *d3dTex)
+void D3DContext::addResource(D3DReadbackQueue *queue)
 {
-	if(d3dTex == NULL)
-		return NULL; // Invalid handle
-	D3DTexture *tex = new D3DTexture(this, d3dTex);
-	if(tex->isValid())
-		return tex;
-	delete tex;
-	return NULL;
+	m_liveReadbackQueues.append(queue);
 }
 
-void D3DContext::deleteTexture(Texture *tex)
+void D3DContext::removeResource(D3DReadbackQueue *queue)
 {
-	if(tex == NULL)
-		return;
-	delete static_cast<D3DTexture *>(tex);
+	int index = m_liveReadbackQueues.lastIndexOf(queue);
+	if(index >= 0)
+		m_liveReadbackQueues.remove(index);
 }
 
 /// <summary>
@@ -2057,14 +4647,48 @@ bool D3DContext::copyTextureData(
 		dstPos.x(), dstPos.y(), 0,
 		srcTex->getTexture(), D3D10CalcSubresource(0, 0, 0),
 		&box);
+	dst->markModified();
 	return true;
 }
 
+/// <summary>
+/// Creates a queue of `depth` staging textures of the specified size that can
+/// be used to read back pixel data asynchronously.
+/// </summary>
+/// <returns>
+/// A pointer to the newly created queue or NULL on failure.
+/// </returns>
+ReadbackQueue *D3DContext::createReadbackQueue(const QSize &size, int depth)
+{
+	if(!isValid())
+		return NULL; // DirectX must be initialized
+	if(size.isEmpty() || depth <= 0)
+		return NULL; // Invalid size
+
+	D3DReadbackQueue *queue = new D3DReadbackQueue(this, size, depth);
+	if(queue->isValid())
+		return queue;
+	delete queue;
+	return NULL;
+}
+
+void D3DContext::deleteReadbackQueue(ReadbackQueue *queue)
+{
+	if(queue == NULL)
+		return;
+	delete static_cast<D3DReadbackQueue *>(queue);
+}
+
 //-----------------------------------------------------------------------------
 // Render targets
 
 void D3DContext::resizeScreenTarget(const QSize &newSize)
 {
+	if(m_isDeviceLost) {
+		// Applied when the device is recreated
+		m_screenTargetSize = newSize;
+		return;
+	}
 	if(!isValid())
 		return; // DirectX must be initialized
 	if(m_screenTargetSize == newSize)
@@ -2073,10 +4697,21 @@ void D3DContext::resizeScreenTarget(const QSize &newSize)
 	// Don't log as we'll spam the log file when the user resizes the window
 	//gfxLog(LOG_CAT) << "Setting screen size to: " << newSize;
 
+	resizeScreenBuffers(newSize);
+}
+
+/// <summary>
+/// Recreates the swap chain buffers at the specified size using the current
+/// buffer count of the present mode.
+/// </summary>
+void D3DContext::resizeScreenBuffers(const QSize &newSize)
+{
 	// Unbind the render target if is currently bound
 	if(m_currentTarget == GfxScreenTarget) {
 		ID3D10RenderTargetView *nullTarget[2] = { NULL, NULL };
 		m_device->OMSetRenderTargets(2, nullTarget, NULL);
+		m_boundTargetViews[0] = NULL;
+		m_boundTargetViews[1] = NULL;
 	}
 
 	// Release the target
@@ -2086,21 +4721,27 @@ void D3DContext::resizeScreenTarget(const QSize &newSize)
 
 	// Actually issue the resize command
 	HRESULT res = m_swapChain->ResizeBuffers(
-		2, newSize.width(), newSize.height(), DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+		m_presentMode.buffer_count, newSize.width(), newSize.height(),
+		DXGI_FORMAT_R8G8B8A8_UNORM, 0);
 	if(SUCCEEDED(res))
 		m_screenTargetSize = newSize;
 	else {
 		gfxLog(LOG_CAT, GfxLog::Warning)
 			<< "Failed to resize swap chain buffer. "
 			<< "Reason = " << getDXErrorCode(res);
+		if(checkDeviceRemoved(res)) {
+			// Recreated at this size by `recoverDevice()`
+			m_screenTargetSize = newSize;
+			return;
+		}
 	}
 
 	// Recreate render target
 	if(!createScreenTarget()) {
-		// This is very bad, we probably need to exit the program as well as
-		// the rest of the application doesn't take into account when this
-		// happens and will most likely lead to more DirectX errors as we'll
-		// be rendering to an invalid render target. TODO
+		// Usually because the device was removed in which case we recover on
+		// the next call to `swapScreenBuffers()`. Otherwise the context is
+		// unusable as we'd be rendering to an invalid render target.
+		checkDeviceRemoved(m_device->GetDeviceRemovedReason());
 		return;
 	}
 
@@ -2124,21 +4765,28 @@ void D3DContext::resizeCanvasTarget(const QSize &newSize)
 	{
 		ID3D10RenderTargetView *nullTarget[2] = { NULL, NULL };
 		m_device->OMSetRenderTargets(2, nullTarget, NULL);
+		m_boundTargetViews[0] = NULL;
+		m_boundTargetViews[1] = NULL;
 	}
 
 	// Release the old textures and render targets
-	delete m_canvas1Texture;
-	delete m_canvas2Texture;
+	removeScaleCacheEntries(m_canvas1Texture);
+	removeScaleCacheEntries(m_canvas2Texture);
+	deletePooledTexture(m_canvas1Texture);
+	deletePooledTexture(m_canvas2Texture);
 	m_canvas1Texture = NULL;
 	m_canvas2Texture = NULL;
 
-	// Create brand new textures with render targets
-	m_canvas1Texture = new D3DTexture(
-		this, GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
-	m_canvas2Texture = new D3DTexture(
-		this, GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
-	if(m_canvas1Texture->getTexture() && m_canvas2Texture->getTexture())
+	// Create brand new textures with render targets. If the canvas was
+	// previously this size then we will reuse the old textures from the pool.
+	m_canvas1Texture = createPooledTexture(
+		GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+	m_canvas2Texture = createPooledTexture(
+		GfxTargetableFlag, newSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+	if(m_canvas1Texture->getTexture() && m_canvas2Texture->getTexture()) {
 		m_canvasTargetSize = newSize;
+		resetCanvasDamage(newSize);
+	}
 	else {
 		gfxLog(LOG_CAT, GfxLog::Warning)
 			<< "Failed to create two canvas textures.";
@@ -2207,10 +4855,39 @@ void D3DContext::resizeScratchTarget(const QSize &newSize)
 
 void D3DContext::swapScreenBuffers()
 {
+	if(m_isDeviceLost) {
+		// Periodically attempt to recreate the device. Nothing is presented
+		// until the next call even if the recovery succeeds.
+		if(GetTickCount() - m_lastRecoveryTick >=
+			(DWORD)DEVICE_RECOVERY_INTERVAL_MSEC)
+		{
+			recoverDevice();
+		}
+		return;
+	}
 	if(!isValid())
 		return; // DirectX must be initialized
 
-	m_swapChain->Present(0, 0);
+	// Only present every Nth call so that the screen can be displayed at a
+	// lower frame rate than the canvas
+	bool isDue = isScreenFrameDue();
+	m_presentCounter++;
+	if(!isDue)
+		return;
+
+	UINT flags = m_presentMode.skip_if_busy ? DXGI_PRESENT_DO_NOT_WAIT : 0;
+	HRESULT res = m_swapChain->Present(m_presentMode.sync_interval, flags);
+	if(res == DXGI_ERROR_WAS_STILL_DRAWING) {
+		// The GPU is still busy with previous frames. Drop this frame instead
+		// of stalling the thread that also renders our output frames
+		m_numDroppedPresents++;
+	} else if(FAILED(res)) {
+		if(!checkDeviceRemoved(res)) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to present swap chain. "
+				<< "Reason = " << getDXErrorCode(res);
+		}
+	}
 }
 
 Texture *D3DContext::getTargetTexture(VidgfxRendTarget target)
@@ -2302,11 +4979,11 @@ Texture *D3DContext::prepareTexture(
 /// no-op. If this method was called with `GfxBilinearFilter` then it will
 /// automatically create the least amount of mipmaps necessary to render at the
 /// specified size and then return the details of the smallest mipmap. If this
-/// method was called with `GfxBicubicFilter` then it will apply bicubic
-/// rescaling of the input to the exact specified size so the calling code does
-/// not need to worry about how to sample the returned texture (This basically
-/// forces another pass on the texture and could potentially be optimized out
-/// at a later date at the expense of more shader permutations).
+/// method was called with `GfxBicubicFilter` or `GfxLanczosFilter` then it
+/// will rescale the input to the exact specified size with one horizontal and
+/// one vertical pass regardless of the scaling ratio so the calling code does
+/// not need to worry about how to sample the returned texture. These filters
+/// require feature level 10.0 and fall back to `GfxBilinearFilter` otherwise.
 ///
 /// WARNING: Do not use Texture::getSize() or `size` to determine texel size in
 /// later stages! Instead use `pxSizeOut` and `botRightOut` as they take into
@@ -2316,12 +4993,19 @@ Texture *D3DContext::prepareTexture(
 /// input as scratch textures can grow at any time! If you're rendering the
 /// returned texture using a vertex buffer you must always check the result and
 /// update your buffer's UV if it changes between calls.
+///
+/// If the input texture has not been modified since the last call with the
+/// same parameters then the result of the previous call is returned from a
+/// cache without doing any rendering (See `setScaleCacheSize()`). Textures that
+/// are modified outside of libvidgfx must call `Texture::markModified()`.
 /// </summary>
 Texture *D3DContext::prepareTexture(
 	Texture *tex, const QRect &cropRect, const QSize &size,
 	VidgfxFilter filter, bool setFilter, QPointF &pxSizeOut,
 	QPointF &topLeftOut, QPointF &botRightOut)
 {
+	ScopedProfile profile(this, "prepareTexture()");
+
 	// Even if the input is invalid still try to provide a sane output
 	if(!isValid() || tex == NULL || size.width() <= 0 || size.height() <= 0) {
 		pxSizeOut = QPointF(1.0f, 1.0f);
@@ -2334,6 +5018,44 @@ Texture *D3DContext::prepareTexture(
 		return tex;
 	}
 
+	// Static textures such as images and text are usually prepared with the
+	// exact same parameters every frame. If the input texture hasn't been
+	// modified since the last call then return the result from last time.
+	// In order to not waste memory on textures that change every frame we
+	// only cache once the texture has been seen unchanged at least once.
+	int cacheIndex = -1;
+	bool doCache = false;
+	if(filter != GfxPointFilter && m_scaleCacheMaxSize > 0 &&
+		!static_cast<D3DTexture *>(tex)->isExternal())
+	{
+		cacheIndex = findScaleCacheEntry(tex, cropRect, size, filter);
+		if(cacheIndex >= 0) {
+			ScaleCacheEntry &entry = m_scaleCache[cacheIndex];
+			entry.lastUsed = ++m_scaleCacheUseCounter;
+			if(entry.srcGeneration == tex->getGeneration()) {
+				if(entry.tex != NULL) {
+					// Cache hit
+					pxSizeOut = entry.pxSize;
+					topLeftOut = entry.topLeft;
+					botRightOut = entry.botRight;
+					if(setFilter)
+						setTextureFilter(GfxBilinearFilter);
+					return entry.tex;
+				}
+				doCache = true;
+			} else {
+				// Input has been modified, our cached texture is stale
+				deletePooledTexture(entry.tex);
+				entry.tex = NULL;
+				entry.srcGeneration = tex->getGeneration();
+			}
+		} else {
+			// Remember that we have seen this texture
+			addScaleCacheEntry(tex, cropRect, size, filter);
+		}
+	}
+	D3DTexture *cacheTex = NULL;
+
 	// The relative size of the output texture pixel data vs the actual
 	// size of the texture buffer. E.g. 0.5 = Half the texture size.
 	QPointF relTexSize(1.0f, 1.0f);
@@ -2344,31 +5066,58 @@ Texture *D3DContext::prepareTexture(
 
 	// TODO: Validate crop rectangle
 
-	// We do cropping inefficiently by resampling the entire texture and then
-	// doing the actual crop at the end of the method. TODO: We should crop
-	// before resampling (Will take a lot of effort though).
-	QSizeF cropRelSize( // Relative size of the crop rect vs texture size
-		(qreal)cropRect.width() / (qreal)tex->getSize().width(),
-		(qreal)cropRect.height() / (qreal)tex->getSize().height());
-	QSize invCropSize( // Effective size that the output must be
-		ceil((qreal)size.width() / cropRelSize.width()),
-		ceil((qreal)size.height() / cropRelSize.height()));
+	// The area of the input texture that `outTex` currently contains in input
+	// texture pixels. This begins as the entire texture but if we need to
+	// create mipmaps then we only render the crop rectangle plus a small
+	// border into the first mipmap, the remaining mipmaps then only contain
+	// that area as well.
+	const QSize &texSize = tex->getSize();
+	QRect sampleRect(QPoint(0, 0), texSize);
+
+	// Determine the area to render into the first mipmap. The border is wide
+	// enough that the bilinear samples of all the following mipmaps and the
+	// final render never read outside of the area that we rendered.
+	QPointF cropRatio( // Number of input pixels per output pixel
+		(qreal)cropRect.width() / (qreal)size.width(),
+		(qreal)cropRect.height() / (qreal)size.height());
+	int border = (int)ceil(2.0f * qMax(1.0,
+		qMax(cropRatio.x(), cropRatio.y()))) + 1;
+	QRect mipRect = cropRect.adjusted(-border, -border, border, border)
+		.intersected(sampleRect);
+	if(mipRect.isEmpty())
+		mipRect = sampleRect; // Crop rectangle is completely out of bounds
+	QSize mipOutSize( // Effective size that the first mipmap area must be
+		ceil((qreal)mipRect.width() / cropRatio.x()),
+		ceil((qreal)mipRect.height() / cropRatio.y()));
 
 	// Apply our per-method scaling algorithm
+	QSize outTexSize; // Size of the data in `outTex` if it's not `tex`
 	switch(filter) {
 	case GfxPointFilter:
 		// We don't need to do any actual texture processing for point sampling
 		break;
-	default:
-#if 0
 	case GfxBicubicFilter:
-#endif // 0
+	case GfxLanczosFilter: {
+		// The output contains exactly the crop rectangle at the final size
+		Texture *resampled = resampleTexture(tex, cropRect, size, filter);
+		if(resampled != NULL) {
+			outTex = resampled;
+			outTexSize = size;
+			relTexSize = getScratchTargetToTextureRatio();
+			sampleRect = cropRect;
+			break;
+		}
+		// Not supported by the device, fall back to bilinear
+		}
+		// Fall through
+	default:
 	case GfxBilinearFilter: {
-		// Create mipmaps as required
-		QSize nextSize = tex->getSize();
+		// Create mipmaps as required. As the crop rectangle is applied in
+		// the first pass we compare against the size of the crop area only.
+		QSize nextSize = mipRect.size();
 		for(;;) {
-			if(nextSize.width() <= invCropSize.width() * 2
-				&& nextSize.height() <= invCropSize.height() * 2)
+			if(nextSize.width() <= mipOutSize.width() * 2
+				&& nextSize.height() <= mipOutSize.height() * 2)
 			{
 				// We can now sample the texture without any distortion, stop
 				// creating mipmaps
@@ -2378,18 +5127,32 @@ Texture *D3DContext::prepareTexture(
 			// Calculate the size of the next mipmap. We must integer ceil() to
 			// prevent going under 50% size due to floor()ing.
 			nextSize = QSize(
-				qMax((nextSize.width() + 1) / 2, invCropSize.width()),
-				qMax((nextSize.height() + 1) / 2, invCropSize.height()));
+				qMax((nextSize.width() + 1) / 2, mipOutSize.width()),
+				qMax((nextSize.height() + 1) / 2, mipOutSize.height()));
 
 			//gfxLog(LOG_CAT)
 			//	<< "Creating mipmap of " << nextSize << " for target size "
 			//	<< size;
 
-			// Update the vertex buffer
-			createTexDecalRect(
-				m_mipmapBuf, QRectF(0.0f, 0.0f,
-				(qreal)nextSize.width(), (qreal)nextSize.height()),
-				relTexSize);
+			// Update the vertex buffer. The first mipmap only samples the
+			// cropped area of the input texture
+			QRectF mipRectF(0.0f, 0.0f,
+				(qreal)nextSize.width(), (qreal)nextSize.height());
+			if(outTex == tex && mipRect != sampleRect) {
+				QPointF pxSize(
+					relTexSize.x() / (qreal)texSize.width(),
+					relTexSize.y() / (qreal)texSize.height());
+				qreal left = (qreal)mipRect.left() * pxSize.x();
+				qreal top = (qreal)mipRect.top() * pxSize.y();
+				qreal right = (qreal)(mipRect.right() + 1) * pxSize.x();
+				qreal bottom = (qreal)(mipRect.bottom() + 1) * pxSize.y();
+				createTexDecalRect(
+					m_mipmapBuf, mipRectF, QPointF(left, top),
+					QPointF(right, top), QPointF(left, bottom),
+					QPointF(right, bottom));
+				sampleRect = mipRect;
+			} else
+				createTexDecalRect(m_mipmapBuf, mipRectF, relTexSize);
 
 			// Setup render target
 			resizeScratchTarget(nextSize);
@@ -2413,27 +5176,43 @@ Texture *D3DContext::prepareTexture(
 			outTex = getTargetTexture(target);
 			relTexSize = getScratchTargetToTextureRatio();
 		}
+		outTexSize = nextSize;
 		break; }
 	}
 
+	// Copy the result out of the scratch target so that it is kept for the
+	// next call
+	if(doCache && outTex != tex) {
+		cacheTex = createPooledTexture(
+			0, outTexSize, DXGI_FORMAT_R8G8B8A8_UNORM);
+		if(cacheTex->isValid() && copyTextureData(
+			cacheTex, outTex, QPoint(0, 0), QRect(QPoint(0, 0), outTexSize)))
+		{
+			outTex = cacheTex;
+			relTexSize = QPointF(1.0f, 1.0f);
+		} else {
+			deletePooledTexture(cacheTex);
+			cacheTex = NULL;
+		}
+	}
+
 	// Restore original state
 	setRenderTarget(origTarget);
 
-	// Adjust top-left and bottom-right points for cropping
+	// Adjust top-left and bottom-right points for cropping. The output
+	// texture only contains `sampleRect` of the input texture.
 	topLeftOut = QPointF(0.0f, 0.0f);
 	botRightOut = relTexSize;
-	if(cropRect.topLeft() != QPoint(0, 0) ||
-		cropRect.size() != tex->getSize())
-	{
+	if(cropRect != sampleRect) {
 		QPointF pxSize(
-			relTexSize.x() / (qreal)tex->getSize().width(),
-			relTexSize.y() / (qreal)tex->getSize().height());
+			relTexSize.x() / (qreal)sampleRect.width(),
+			relTexSize.y() / (qreal)sampleRect.height());
 		topLeftOut = QPointF(
-			(qreal)cropRect.left() * pxSize.x(),
-			(qreal)cropRect.top() * pxSize.y());
+			(qreal)(cropRect.left() - sampleRect.left()) * pxSize.x(),
+			(qreal)(cropRect.top() - sampleRect.top()) * pxSize.y());
 		botRightOut = QPointF(
-			(qreal)(cropRect.right() + 1) * pxSize.x(),
-			(qreal)(cropRect.bottom() + 1) * pxSize.y());
+			(qreal)(cropRect.right() + 1 - sampleRect.left()) * pxSize.x(),
+			(qreal)(cropRect.bottom() + 1 - sampleRect.top()) * pxSize.y());
 	}
 
 	pxSizeOut = QPointF(
@@ -2444,6 +5223,21 @@ Texture *D3DContext::prepareTexture(
 			(filter == GfxPointFilter) ? GfxPointFilter : GfxBilinearFilter);
 	}
 
+	// Store the result in the cache. Resizing the scratch targets above can
+	// delete textures which removes their cache entries and shifts the
+	// remaining ones so the entry must be looked up again.
+	if(cacheTex != NULL) {
+		cacheIndex = findScaleCacheEntry(tex, cropRect, size, filter);
+		if(cacheIndex < 0)
+			cacheIndex = addScaleCacheEntry(tex, cropRect, size, filter);
+		ScaleCacheEntry &entry = m_scaleCache[cacheIndex];
+		deletePooledTexture(entry.tex);
+		entry.tex = cacheTex;
+		entry.pxSize = pxSizeOut;
+		entry.topLeft = topLeftOut;
+		entry.botRight = botRightOut;
+	}
+
 	return outTex;
 }
 
@@ -2457,6 +5251,8 @@ Texture *D3DContext::prepareTexture(
 Texture *D3DContext::convertToBgrx(
 	VidgfxPixFormat format, Texture *planeA, Texture *planeB, Texture *planeC)
 {
+	ScopedProfile profile(this, "convertToBgrx()");
+
 	if(format >= NUM_PIXEL_FORMAT_TYPES)
 		return NULL;
 	if(format == GfxNoFormat)
@@ -2483,12 +5279,76 @@ Texture *D3DContext::convertToBgrx(
 			return NULL;
 		}
 
-		// The only difference between IYUV and YV12 is the plane order.
-		// Reorder to YV12 always.
-		if(format == GfxIYUVFormat) {
-			Texture *tmp = planeB;
-			planeB = planeC;
-			planeC = tmp;
+		// The only difference between IYUV and YV12 is the plane order.
+		// Reorder to YV12 always.
+		if(format == GfxIYUVFormat) {
+			Texture *tmp = planeB;
+			planeB = planeC;
+			planeC = tmp;
+		}
+
+		// Determine output texture size
+		QSize outSize(
+			(qreal)(planeA->getWidth() * 4), (qreal)planeA->getHeight());
+
+		//--------------------------------------------------------------------
+
+		// Remember original state
+		VidgfxRendTarget origTarget = m_currentTarget;
+
+		// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+		createTexDecalRect(
+			m_mipmapBuf, QRectF(0.0f, 0.0f,
+			(qreal)outSize.width(), (qreal)outSize.height()));
+
+		// Setup render target
+		resizeScratchTarget(outSize);
+		VidgfxRendTarget target = getNextScratchTarget();
+		setRenderTarget(target);
+		QMatrix4x4 mat;
+		setViewMatrix(mat);
+		mat.ortho(
+			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+		setProjectionMatrix(mat);
+
+		// Update the shader constants
+		float outTexWidth = 1.0f / outSize.width();
+		float values[8] = {
+			outTexWidth * 4.0f, // Inverse 4x Y texel width
+			outTexWidth * 0.125f, // Half Y texel width
+			outTexWidth * 8.0f, // Inverse 4x U/V texel width
+			outTexWidth * 0.0625f, // Half U/V texel width
+			0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(GfxYv12RgbShader, values))
+		{
+			// Update failed. Restore original state and return
+			setRenderTarget(origTarget);
+			return NULL;
+		}
+
+		// Render the mipmap
+		setShader(GfxYv12RgbShader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(planeA, planeB, planeC);
+		setTextureFilter(GfxPointFilter);
+		drawBuffer(m_mipmapBuf);
+
+		// Restore original state
+		setRenderTarget(origTarget);
+
+		//--------------------------------------------------------------------
+
+		return getTargetTexture(target); }
+	case GfxNV12Format: { // NxM Y, Nx(M/2) interleaved UV
+		// The Y plane is a packed RGBA texture like YV12 while the UV plane
+		// is an R8G8 texture (See `createRgTexture()`) of (N/2)x(M/2)
+		if(planeA == NULL || planeB == NULL)
+			return NULL;
+		if(planeB->getWidth() != planeA->getWidth() * 2 ||
+			planeB->getHeight() != planeA->getHeight() / 2)
+		{
+			return NULL;
 		}
 
 		// Determine output texture size
@@ -2515,31 +5375,24 @@ Texture *D3DContext::convertToBgrx(
 			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
 		setProjectionMatrix(mat);
 
-		// HACK: Reuse RgbNv16 shader cbuffer
+		// Update the shader constants
 		float outTexWidth = 1.0f / outSize.width();
-		m_rgbNv16ConstantsLocal[0] = // Inverse 4x Y texel width
-			outTexWidth * 4.0f;
-		m_rgbNv16ConstantsLocal[1] = // Half Y texel width
-			outTexWidth * 0.125f;
-		m_rgbNv16ConstantsLocal[2] = // Inverse 4x U/V texel width
-			outTexWidth * 8.0f;
-		m_rgbNv16ConstantsLocal[3] = // Half U/V texel width
-			outTexWidth * 0.0625f;
-		if(!m_rgbNv16Constants || !updateDXBuffer(
-			m_device, m_rgbNv16Constants, m_rgbNv16ConstantsLocal,
-			sizeof(m_rgbNv16ConstantsLocal)))
+		float values[8] = {
+			outTexWidth * 4.0f, // Inverse 4x Y texel width
+			outTexWidth * 0.125f, // Half Y texel width
+			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(GfxNv12RgbShader, values))
 		{
 			// Update failed. Restore original state and return
 			setRenderTarget(origTarget);
 			return NULL;
 		}
-		m_rgbNv16ConstantsDirty = true;
 
 		// Render the mipmap
-		setShader(GfxYv12RgbShader);
+		setShader(GfxNv12RgbShader);
 		setTopology(GfxTriangleStripTopology);
 		setBlending(GfxNoBlending);
-		setTexture(planeA, planeB, planeC);
+		setTexture(planeA, planeB);
 		setTextureFilter(GfxPointFilter);
 		drawBuffer(m_mipmapBuf);
 
@@ -2549,8 +5402,6 @@ Texture *D3DContext::convertToBgrx(
 		//--------------------------------------------------------------------
 
 		return getTargetTexture(target); }
-	case GfxNV12Format: // NxM Y, Nx(M/2) interleaved UV
-		return NULL; // TODO
 	case GfxUYVYFormat: // UYVY
 	case GfxHDYCFormat: // UYVY with BT.709
 	case GfxYUY2Format: { // YUYV
@@ -2581,36 +5432,26 @@ Texture *D3DContext::convertToBgrx(
 			0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
 		setProjectionMatrix(mat);
 
-		// HACK: Reuse RgbNv16 shader cbuffer
+		// Update the shader constants
+		VidgfxShader shader = GfxUyvyRgbShader; // UYVY
+		if(format == GfxHDYCFormat) // UYVY with BT.709
+			shader = GfxHdycRgbShader;
+		else if(format == GfxYUY2Format) // YUYV
+			shader = GfxYuy2RgbShader;
 		float outTexWidth = 1.0f / outSize.width();
-		m_rgbNv16ConstantsLocal[0] = // 4x Y texel width
-			outTexWidth * 2.0f;
-		m_rgbNv16ConstantsLocal[1] = // 2x Y texel width
-			outTexWidth;
-		m_rgbNv16ConstantsLocal[2] = 0.0f;
-		m_rgbNv16ConstantsLocal[3] = 0.0f;
-		if(!m_rgbNv16Constants || !updateDXBuffer(
-			m_device, m_rgbNv16Constants, m_rgbNv16ConstantsLocal,
-			sizeof(m_rgbNv16ConstantsLocal)))
+		float values[8] = {
+			outTexWidth * 2.0f, // 4x Y texel width
+			outTexWidth, // 2x Y texel width
+			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		if(!updateConversionConstants(shader, values))
 		{
 			// Update failed. Restore original state and return
 			setRenderTarget(origTarget);
 			return NULL;
 		}
-		m_rgbNv16ConstantsDirty = true;
 
 		// Render the mipmap
-		switch(format) {
-		case GfxUYVYFormat: // UYVY
-			setShader(GfxUyvyRgbShader);
-			break;
-		case GfxHDYCFormat: // UYVY with BT.709
-			setShader(GfxHdycRgbShader);
-			break;
-		case GfxYUY2Format: // YUYV
-			setShader(GfxYuy2RgbShader);
-			break;
-		}
+		setShader(shader);
 		setTopology(GfxTriangleStripTopology);
 		setBlending(GfxNoBlending);
 		setTexture(planeA);
@@ -2628,6 +5469,281 @@ Texture *D3DContext::convertToBgrx(
 	return NULL;
 }
 
+/// <summary>
+/// Converts the entire RGB texture `src` (Usually a canvas target) into the
+/// separate planes of a YUV 4:2:0 pixel format on the graphics hardware,
+/// including the vertical chroma subsampling, so that the result can be read
+/// back and handed directly to an encoder. All planes must be targetable RGBA
+/// textures where each texel contains 4 packed 8-bit samples:
+///
+///  - NV12: `planeA` = (N/4)xM Y, `planeB` = (N/4)x(M/2) interleaved UV
+///  - IYUV: `planeA` = (N/4)xM Y, `planeB` = (N/8)x(M/2) U, `planeC` = V
+///  - YV12: `planeA` = (N/4)xM Y, `planeB` = (N/8)x(M/2) V, `planeC` = U
+///
+/// Where NxM is the size of `src`. The current user render target, its
+/// viewport and the user matrices are restored afterwards.
+/// </summary>
+/// <returns>True if the conversion was queued or false on failure.</returns>
+bool D3DContext::convertFromRgb(
+	VidgfxPixFormat format, Texture *src, Texture *planeA, Texture *planeB,
+	Texture *planeC)
+{
+	ScopedProfile profile(this, "convertFromRgb()");
+
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(src == NULL || planeA == NULL || planeB == NULL)
+		return false;
+
+	// Validate plane sizes
+	QSize srcSize = src->getSize();
+	QSize ySize(srcSize.width() / 4, srcSize.height());
+	QSize uvSize;
+	switch(format) {
+	default:
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Unsupported pixel format for RGB conversion: "
+			<< VidgfxPixFormatStrs[qBound(0, (int)format,
+			(int)NUM_PIXEL_FORMAT_TYPES - 1)];
+		return false;
+	case GfxNV12Format: // NxM Y, Nx(M/2) interleaved UV
+		if(srcSize.width() % 4 != 0 || srcSize.height() % 2 != 0)
+			return false;
+		uvSize = QSize(srcSize.width() / 4, srcSize.height() / 2);
+		break;
+	case GfxYV12Format: // NxM Y, (N/2)x(M/2) V, (N/2)x(M/2) U
+	case GfxIYUVFormat: // NxM Y, (N/2)x(M/2) U, (N/2)x(M/2) V
+		if(planeC == NULL)
+			return false;
+		if(srcSize.width() % 8 != 0 || srcSize.height() % 2 != 0)
+			return false;
+		uvSize = QSize(srcSize.width() / 8, srcSize.height() / 2);
+		if(planeC->getSize() != uvSize || !planeC->isTargetable())
+			return false;
+		break;
+	}
+	if(planeA->getSize() != ySize || planeB->getSize() != uvSize ||
+		!planeA->isTargetable() || !planeB->isTargetable())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot convert RGB texture as the output planes are the "
+			<< "wrong size or are not targetable";
+		return false;
+	}
+
+	// The only difference between IYUV and YV12 is the plane order.
+	// Reorder to IYUV always.
+	if(format == GfxYV12Format) {
+		Texture *tmp = planeB;
+		planeB = planeC;
+		planeC = tmp;
+	}
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Luminance
+	bool ret = drawYuvPlanes(GfxRgbYShader, src, planeA, NULL);
+
+	// Chroma
+	if(ret) {
+		if(format == GfxNV12Format)
+			ret = drawYuvPlanes(GfxRgbNv12UvShader, src, planeB, NULL);
+		else
+			ret = drawYuvPlanes(GfxRgbI420UvShader, src, planeB, planeC);
+	}
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return ret;
+}
+
+/// <summary>
+/// Scales the entire `src` texture to the output size, converts it to YUV with
+/// the specified matrix and packs it into NV16 in a single pass. This replaces
+/// using `prepareTexture()` followed by a `GfxRgbNv16Shader` pass. Both planes
+/// must be targetable textures of (N/4)xM where NxM is the output size. As
+/// each output pixel is a box filter of bilinear taps only downscales of up to
+/// 4x are done in a single pass, larger downscales first reduce the input with
+/// `prepareTexture()`.
+/// </summary>
+bool D3DContext::scaleToNv16(
+	Texture *src, Texture *planeY, Texture *planeUV, VidgfxYuvMatrix matrix)
+{
+	ScopedProfile profile(this, "scaleToNv16()");
+
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(src == NULL || planeY == NULL || planeUV == NULL)
+		return false;
+	if(planeY->getSize() != planeUV->getSize() || planeY->getSize().isEmpty()
+		|| !planeY->isTargetable() || !planeUV->isTargetable())
+	{
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot convert RGB texture as the output planes are the "
+			<< "wrong size or are not targetable";
+		return false;
+	}
+	QSize outSize(planeY->getWidth() * 4, planeY->getHeight());
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Reduce large downscales to between 2x and 4x with mipmaps. This must be
+	// done before we write to the mipmapping buffer.
+	Texture *tex = src;
+	QPointF botRight(1.0f, 1.0f);
+	if(src->getWidth() > outSize.width() * 4 ||
+		src->getHeight() > outSize.height() * 4)
+	{
+		QPointF pxSize;
+		tex = prepareTexture(
+			src, outSize * 2, GfxBilinearFilter, false, pxSize, botRight);
+	}
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	QSize planeSize = planeY->getSize();
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)planeSize.width(), (qreal)planeSize.height()), botRight);
+
+	// Setup render target
+	setUserRenderTarget(planeY, planeUV);
+	setUserRenderTargetViewport(planeSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, planeSize.width(), planeSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Output pixel size in input UV space. The 4 packed output pixels are
+	// centered around the output texel and each pixel is a 2x2 box of taps
+	// that are half an output pixel apart.
+	VidgfxShader shader = (matrix == GfxBt709Matrix)
+		? GfxRgbNv16Scaled709Shader : GfxRgbNv16ScaledShader;
+	float outPxX = (float)botRight.x() / (float)outSize.width();
+	float outPxY = (float)botRight.y() / (float)outSize.height();
+	float values[8] = {
+		-1.5f * outPxX, -0.5f * outPxX, 0.5f * outPxX, 1.5f * outPxX,
+		0.25f * outPxX, 0.25f * outPxY, 0.0f, 0.0f };
+	bool ret = updateConversionConstants(shader, values);
+
+	// Render both planes
+	if(ret) {
+		setShader(shader);
+		setTopology(GfxTriangleStripTopology);
+		setBlending(GfxNoBlending);
+		setTexture(tex);
+		setTextureFilter(GfxBilinearFilter);
+		drawBuffer(m_mipmapBuf);
+	}
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return ret;
+}
+
+/// <summary>
+/// GPU version of `diluteImage()` for textures that are already resident.
+/// Renders `src` into `dst` with the colour information of nearby pixels
+/// copied to the fully transparent pixels. `dst` must be a targetable texture
+/// of the same size and format, e.g. as created by `createTexture(size, src,
+/// false, true)`.
+/// </summary>
+/// <returns>False if the texture couldn't be diluted, for example because
+/// the device doesn't support feature level 10.0</returns>
+bool D3DContext::diluteTexture(Texture *src, Texture *dst)
+{
+	ScopedProfile profile(this, "diluteTexture()");
+
+	if(!isValid())
+		return false; // DirectX must be initialized
+	if(getPixelShader(DilutePS) == NULL)
+		return false; // Not supported
+	if(src == NULL || dst == NULL || src == dst)
+		return false;
+	if(dst->getSize() != src->getSize() || !dst->isTargetable()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Cannot dilute texture as the output texture is the wrong "
+			<< "size or is not targetable";
+		return false;
+	}
+	QSize outSize = dst->getSize();
+
+	//------------------------------------------------------------------------
+
+	// Remember original state
+	VidgfxRendTarget origTarget = m_currentTarget;
+	Texture *origUserTargets[2] = { m_userTargets[0], m_userTargets[1] };
+	QRect origUserViewport = m_userTargetViewport;
+	QMatrix4x4 origUserViewMat = m_userViewMat;
+	QMatrix4x4 origUserProjMat = m_userProjMat;
+
+	// Update the vertex buffer. NOTE: We reuse the mipmapping buffer
+	createTexDecalRect(
+		m_mipmapBuf, QRectF(0.0f, 0.0f,
+		(qreal)outSize.width(), (qreal)outSize.height()));
+
+	// Setup render target
+	setUserRenderTarget(dst);
+	setUserRenderTargetViewport(outSize);
+	setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	setViewMatrix(mat);
+	mat.ortho(
+		0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+	setProjectionMatrix(mat);
+
+	// Render the texture. The shader fetches exact texels itself.
+	setShader(GfxDiluteShader);
+	setTopology(GfxTriangleStripTopology);
+	setBlending(GfxNoBlending);
+	setTexture(src);
+	setTextureFilter(GfxPointFilter);
+	drawBuffer(m_mipmapBuf);
+
+	// Restore original state. The user target is still bound so that the
+	// matrix setters update the user camera set and its version.
+	setViewMatrix(origUserViewMat);
+	setProjectionMatrix(origUserProjMat);
+	setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	setUserRenderTargetViewport(origUserViewport);
+	setRenderTarget(origTarget);
+
+	//------------------------------------------------------------------------
+
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // Drawing
 
@@ -2637,7 +5753,9 @@ void D3DContext::setRenderTarget(VidgfxRendTarget target)
 		return; // DirectX must be initialized
 
 	// WARNING: Do not test if we are already using the requested target as
-	// `resizeScreenTarget()` relies on the current behaviour
+	// `resizeScreenTarget()` relies on the current behaviour. Instead we
+	// compare the actual views against what is bound to the device which is
+	// invalidated whenever a target is recreated.
 
 	m_currentTarget = target;
 	ID3D10RenderTargetView *targetView[2] = { NULL, NULL };
@@ -2687,7 +5805,26 @@ void D3DContext::setRenderTarget(VidgfxRendTarget target)
 			<< "Attempted to select a render target that doesn't exist yet";
 		return;
 	}
+
+	// The partial canvas redraw limit depends on the target
+	applyScissorRect();
+
+	if(targetView[0] == m_boundTargetViews[0] &&
+		targetView[1] == m_boundTargetViews[1] &&
+		viewRect == m_boundViewport)
+	{
+		// Already bound
+		m_numRedundantStateCalls++;
+		return;
+	}
 	m_device->OMSetRenderTargets(2, targetView, NULL);
+	m_boundTargetViews[0] = targetView[0];
+	m_boundTargetViews[1] = targetView[1];
+	m_boundViewport = viewRect;
+
+	// The device automatically unbinds shader resources that are now bound as
+	// a render target so we can no longer trust our copy
+	m_numBoundResourceViews = -1;
 
 	// Setup the viewport as well so that the application doesn't need to worry
 	// about it. Note that for scratch targets we set the viewport size to
@@ -2700,83 +5837,68 @@ void D3DContext::setRenderTarget(VidgfxRendTarget target)
 	vp.MinDepth = 0.0f;
 	vp.MaxDepth = 1.0f;
 	m_device->RSSetViewports(1, &vp);
-
-	// Camera constants are per target, do buffer update when needed
-	m_cameraConstantsDirty = true;
 }
 
 void D3DContext::setShader(VidgfxShader shader)
 {
 	if(!isValid())
 		return; // DirectX must be initialized
-	if(m_boundShader == shader)
+	if(m_boundShader == shader) {
+		m_numRedundantStateCalls++;
 		return; // Already bound
+	}
 
+	// The pixel shader is bound by `bindPixelShader()`
 	switch(shader) {
 	default:
 	case GfxNoShader:
 		m_device->IASetInputLayout(NULL);
 		m_device->VSSetShader(NULL);
 		m_device->PSSetShader(NULL);
+		m_boundPixelShader = -1;
 		break;
 	case GfxSolidShader:
 		m_device->IASetInputLayout(m_solidIL);
 		m_device->VSSetShader(m_solidVS);
-		m_device->PSSetShader(m_solidPS);
-		break;
-	case GfxTexDecalShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_texDecalPS);
-		break;
-	case GfxTexDecalGbcsShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_texDecalGbcsPS);
-		break;
-	case GfxTexDecalRgbShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_texDecalRgbPS);
 		break;
 	case GfxResizeLayerShader:
 		m_device->IASetInputLayout(m_resizeIL);
 		m_device->VSSetShader(m_resizeVS);
-		m_device->PSSetShader(m_resizePS);
 		break;
+	case GfxTexDecalShader:
+	case GfxTexDecalGbcsShader:
+	case GfxTexDecalRgbShader:
 	case GfxRgbNv16Shader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_rgbNv16PS);
-		break;
 	case GfxYv12RgbShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_yv12RgbPS);
-		break;
+	case GfxNv12RgbShader:
 	case GfxUyvyRgbShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_UyvyRgbPS);
-		break;
 	case GfxHdycRgbShader:
-		m_device->IASetInputLayout(m_texDecalIL);
-		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_HdycRgbPS);
-		break;
 	case GfxYuy2RgbShader:
+	case GfxRgbYShader:
+	case GfxRgbNv12UvShader:
+	case GfxRgbI420UvShader:
+	case GfxRgbNv16ScaledShader:
+	case GfxRgbNv16Scaled709Shader:
+	case GfxDiluteShader:
+	case GfxResampleHorzShader:
+	case GfxResampleVertShader:
 		m_device->IASetInputLayout(m_texDecalIL);
 		m_device->VSSetShader(m_texDecalVS);
-		m_device->PSSetShader(m_Yuy2RgbPS);
 		break;
 	}
 	m_boundShader = shader;
+	m_instancedVSBound = false;
 }
 
 void D3DContext::setTopology(VidgfxTopology topology)
 {
 	if(!isValid())
 		return; // DirectX must be initialized
+	if(m_boundTopology == (int)topology) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_boundTopology = topology;
 
 	switch(topology) {
 	default:
@@ -2796,18 +5918,32 @@ void D3DContext::setBlending(VidgfxBlending blending)
 	if(!isValid())
 		return; // DirectX must be initialized
 
+	// Textures that are drawn with premultiplied blending are assumed to have
+	// premultiplied alpha, selects the permutation in `bindPixelShader()`
+	if(blending == GfxPremultipliedBlending)
+		m_texDecalFlags |= TexDecalPremultipliedPerm;
+	else
+		m_texDecalFlags &= ~TexDecalPremultipliedPerm;
+
+	ID3D10BlendState *state = m_noBlend;
 	switch(blending) {
 	default:
 	case GfxNoBlending:
-		m_device->OMSetBlendState(m_noBlend, NULL, 0xFFFFFFFF);
+		state = m_noBlend;
 		break;
 	case GfxAlphaBlending:
-		m_device->OMSetBlendState(m_alphaBlend, NULL, 0xFFFFFFFF);
+		state = m_alphaBlend;
 		break;
 	case GfxPremultipliedBlending:
-		m_device->OMSetBlendState(m_premultiBlend, NULL, 0xFFFFFFFF);
+		state = m_premultiBlend;
 		break;
 	}
+	if(state == m_boundBlendState) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_device->OMSetBlendState(state, NULL, 0xFFFFFFFF);
+	m_boundBlendState = state;
 }
 
 void D3DContext::setTexture(Texture *texA, Texture *texB, Texture *texC)
@@ -2836,7 +5972,17 @@ void D3DContext::setTexture(Texture *texA, Texture *texB, Texture *texC)
 		textureA->getResourceView(),
 		texB ? textureB->getResourceView() : NULL,
 		texC ? textureC->getResourceView() : NULL };
-	m_device->PSSetShaderResources(0, num, view);
+	bool isBound = (m_numBoundResourceViews >= num);
+	for(int i = 0; i < num && isBound; i++)
+		isBound = (view[i] == m_boundResourceViews[i]);
+	if(isBound)
+		m_numRedundantStateCalls++;
+	else {
+		m_device->PSSetShaderResources(0, num, view);
+		for(int i = 0; i < num; i++)
+			m_boundResourceViews[i] = view[i];
+		m_numBoundResourceViews = qMax(num, m_numBoundResourceViews);
+	}
 
 	// Do we need to swizzle the RGB components as we're storing BGRA data in
 	// a RGBA texture?
@@ -2848,24 +5994,85 @@ void D3DContext::setTextureFilter(VidgfxFilter filter)
 	if(!isValid())
 		return; // DirectX must be initialized
 
+	ID3D10SamplerState *sampler = m_bilinearClampSampler;
 	switch(filter) {
 	case GfxPointFilter:
-		m_device->PSSetSamplers(0, 1, &m_pointClampSampler);
+		sampler = m_pointClampSampler;
 		break;
 	default:
-#if 0
 	case GfxBicubicFilter:
-		gfxLog(LOG_CAT, GfxLog::Warning)
-			<< "Unsupported texture filter, using bilinear.";
-		// Fall through
-#endif // 0
+	case GfxLanczosFilter:
+		// These are applied by `prepareTexture()` and the result is sampled
+		// bilinearly
 	case GfxBilinearFilter:
-		m_device->PSSetSamplers(0, 1, &m_bilinearClampSampler);
+		sampler = m_bilinearClampSampler;
 		break;
 	case GfxResizeLayerFilter:
-		m_device->PSSetSamplers(0, 1, &m_resizeSampler);
+		sampler = m_resizeSampler;
 		break;
 	}
+	if(sampler == m_boundSampler) {
+		m_numRedundantStateCalls++;
+		return; // Already bound
+	}
+	m_device->PSSetSamplers(0, 1, &sampler);
+	m_boundSampler = sampler;
+}
+
+/// <summary>
+/// Limits all following draws to `rect` of the current render target in
+/// render target pixels. A null rectangle disables the limit. The rectangle is
+/// not reset when the render target changes and `clear()` is never limited.
+/// While a canvas is being redrawn the rectangle is combined with the redraw
+/// area when rendering to that canvas.
+/// </summary>
+void D3DContext::setScissorRect(const QRect &rect)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(rect == m_scissorRect) {
+		m_numRedundantStateCalls++;
+		return;
+	}
+	m_scissorRect = rect;
+	applyScissorRect();
+}
+
+/// <summary>
+/// Binds the intersection of the user's scissor rectangle and the partial
+/// canvas redraw area of the current render target.
+/// </summary>
+void D3DContext::applyScissorRect()
+{
+	QRect rect = m_scissorRect;
+	QRect redrawRect = getRedrawScissorRect();
+	bool enabled = !rect.isNull() || !redrawRect.isNull();
+	if(rect.isNull()) {
+		rect = redrawRect;
+	} else if(!redrawRect.isNull()) {
+		rect &= redrawRect;
+		if(rect.isEmpty())
+			rect = QRect(redrawRect.topLeft(), QSize(0, 0)); // Draw nothing
+	}
+
+	if(enabled == m_boundScissorEnabled &&
+		(!enabled || rect == m_boundScissorRect))
+	{
+		return; // Already bound
+	}
+	m_boundScissorEnabled = enabled;
+	m_boundScissorRect = rect;
+	if(!enabled) {
+		m_device->RSSetState(m_rasterizerState);
+		return;
+	}
+	D3D10_RECT d3dRect;
+	d3dRect.left = rect.left();
+	d3dRect.top = rect.top();
+	d3dRect.right = rect.left() + rect.width();
+	d3dRect.bottom = rect.top() + rect.height();
+	m_device->RSSetScissorRects(1, &d3dRect);
+	m_device->RSSetState(m_scissorRasterizerState);
 }
 
 void D3DContext::clear(const QColor &color)
@@ -2915,6 +6122,7 @@ void D3DContext::clear(const QColor &color)
 		m_device->ClearRenderTargetView(targetView[0], colorF);
 	if(targetView[1] != NULL)
 		m_device->ClearRenderTargetView(targetView[1], colorF);
+	markCurrentTargetModified();
 }
 
 void D3DContext::drawBuffer(
@@ -2930,38 +6138,100 @@ void D3DContext::drawBuffer(
 	if(numVertices == 0)
 		return; // Nothing to render
 
-	// Bind the vertex buffer
+	// Restore the regular vertex shader if `drawInstanced()` replaced it
+	if(m_instancedVSBound) {
+		VidgfxShader shader = m_boundShader;
+		m_boundShader = GfxNoShader;
+		setShader(shader);
+	}
+
+	// Bind the vertex buffer and never draw past the data that was uploaded
 	D3DVertexBuffer *buffer = static_cast<D3DVertexBuffer *>(buf);
 	buffer->bind();
+	numVertices = qMin(
+		numVertices, buffer->getNumUploadedVerts() - startVertex);
+	if(numVertices <= 0)
+		return; // Nothing valid to render
 
-	// Update and bind our camera constants
-	updateCameraConstants();
-	m_device->VSSetConstantBuffers(0, 1, &m_cameraConstants);
+	// Update and bind all shader constants
+	bindDrawConstants();
 
-	// Update and bind our pixel shader constants if needed
-	if(m_boundShader == GfxResizeLayerShader) {
-		updateResizeConstants();
-		m_device->PSSetConstantBuffers(0, 1, &m_resizeConstants);
-	} else if(m_boundShader == GfxRgbNv16Shader) {
-		updateRgbNv16Constants();
-		m_device->PSSetConstantBuffers(0, 1, &m_rgbNv16Constants);
-	} else if(m_boundShader == GfxYv12RgbShader ||
-		m_boundShader == GfxUyvyRgbShader ||
-		m_boundShader == GfxHdycRgbShader ||
-		m_boundShader == GfxYuy2RgbShader)
-	{
-		// HACK: Reuse RgbNv16 shader cbuffer
-		m_device->PSSetConstantBuffers(0, 1, &m_rgbNv16Constants);
-	} else if(m_boundShader == GfxTexDecalShader ||
-		m_boundShader == GfxTexDecalGbcsShader ||
-		m_boundShader == GfxTexDecalRgbShader)
-	{
-		updateTexDecalConstants();
-		m_device->PSSetConstantBuffers(0, 1, &m_texDecalConstants);
-	}
+	// NV16 conversion is driven by the caller so profile it here
+	bool profileNv16 = m_profInFrame && m_boundShader == GfxRgbNv16Shader;
+	if(m_profInFrame)
+		m_profFrames[m_profCurFrame].numDrawCalls++;
+	if(profileNv16)
+		beginProfileScope("RGB to NV16");
 
 	// Actually send the draw command
 	m_device->Draw(numVertices, startVertex);
+	markCurrentTargetModified();
+
+	if(profileNv16)
+		endProfileScope();
+}
+
+/// <summary>
+/// Returns true if `drawInstanced()` is available. Requires a feature level
+/// 10.0 device.
+/// </summary>
+bool D3DContext::hasInstancingSupport() const
+{
+	return m_hasInstancing;
+}
+
+/// <summary>
+/// Draws 4 copies of a unit quad for each instance in `instBuf` using the
+/// instanced version of the bound shader's vertex shader. Instance buffers are
+/// filled with `createTexDecalInstance()` for the texture decal shaders or
+/// `createSolidRectOutlineInstance()` for `GfxSolidShader`. Always renders
+/// with `TriangleStripTopology`.
+/// </summary>
+void D3DContext::drawInstanced(
+	VertexBuffer *instBuf, int numInstances, int startInstance)
+{
+	if(!isValid())
+		return; // DirectX must be initialized
+	if(instBuf == NULL)
+		return; // Invalid input
+	if(!m_hasInstancing)
+		return; // Not supported
+
+	if(numInstances < 0)
+		numInstances = instBuf->getNumVerts();
+	if(numInstances == 0)
+		return; // Nothing to render
+
+	// Replace the vertex shader of the bound shader
+	if(!bindInstancedShader()) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Bound shader cannot be used for instanced rendering";
+		return;
+	}
+
+	// Bind the instance buffer followed by the unit quad so that the quad is
+	// always in slot 0 even if the instance buffer failed to bind
+	D3DVertexBuffer *buffer = static_cast<D3DVertexBuffer *>(instBuf);
+	buffer->bind(1);
+	numInstances = qMin(
+		numInstances, buffer->getNumUploadedVerts() - startInstance);
+	if(numInstances <= 0)
+		return; // Nothing valid to render
+	uint stride = 2 * sizeof(float);
+	uint offset = 0;
+	m_device->IASetVertexBuffers(0, 1, &m_unitQuadBuf, &stride, &offset);
+	setTopology(GfxTriangleStripTopology);
+
+	// Update and bind all shader constants
+	bindDrawConstants();
+
+	if(m_profInFrame)
+		m_profFrames[m_profCurFrame].numDrawCalls++;
+
+	// Actually send the draw command. The per-instance data is stepped every
+	// 4 instances so one instance in the buffer is 4 quads on the GPU.
+	m_device->DrawInstanced(4, numInstances * 4, 0, startInstance);
+	markCurrentTargetModified();
 }
 
 void D3DContext::callDxgi11ChangedCallbacks(bool hasDxgi11)
@@ -3027,3 +6297,35 @@ void D3DContext::removeBgraTexSupportChangedCallback(
 	if(id >= 0)
 		m_bgraTexSupportChangedCallbackList.remove(id);
 }
+
+void D3DContext::callProfileFrameCallbacks(
+	const VidgfxD3DProfileFrame *frame)
+{
+	for(int i = 0; i < m_profileFrameCallbackList.size(); i++) {
+		const ProfileFrameCallback &callback =
+			m_profileFrameCallbackList.at(i);
+		callback.callback(
+			callback.opaque, reinterpret_cast<VidgfxD3DContext *>(this),
+			frame);
+	}
+}
+
+void D3DContext::addProfileFrameCallback(
+	VidgfxD3DContextProfileFrameCallback *profile_frame, void *opaque)
+{
+	ProfileFrameCallback callback;
+	callback.callback = profile_frame;
+	callback.opaque = opaque;
+	m_profileFrameCallbackList.append(callback);
+}
+
+void D3DContext::removeProfileFrameCallback(
+	VidgfxD3DContextProfileFrameCallback *profile_frame, void *opaque)
+{
+	ProfileFrameCallback callback;
+	callback.callback = profile_frame;
+	callback.opaque = opaque;
+	int id = m_profileFrameCallbackList.indexOf(callback);
+	if(id >= 0)
+		m_profileFrameCallbackList.remove(id);
+}
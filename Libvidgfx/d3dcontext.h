@@ -27,6 +27,7 @@ struct ID3D10Buffer;
 struct ID3D10Device;
 struct ID3D10InputLayout;
 struct ID3D10PixelShader;
+struct ID3D10Query;
 struct ID3D10RasterizerState;
 struct ID3D10RenderTargetView;
 struct ID3D10SamplerState;
@@ -35,6 +36,7 @@ struct ID3D10Texture2D;
 struct ID3D10VertexShader;
 struct IDXGIAdapter;
 struct IDXGIFactory1; // DXGI 1.1
+struct IDXGIKeyedMutex; // DXGI 1.1
 struct IDXGISurface1; // DXGI 1.1
 struct IDXGISwapChain;
 struct D3D10_INPUT_ELEMENT_DESC;
@@ -47,7 +49,14 @@ class D3DVertexBuffer : public VertexBuffer
 {
 private: // Members -----------------------------------------------------------
 	D3DContext *	m_context;
-	ID3D10Buffer *	m_buffer;
+	ID3D10Buffer *	m_buffer; // NULL if sub-allocated from the vertex ring
+
+	// Vertex ring allocation, only valid for the ring generation that it was
+	// uploaded in
+	bool			m_useRing;
+	int				m_ringOffset;
+	int				m_ringNumFloats; // Number of floats that were uploaded
+	quint32			m_ringGeneration;
 
 public: // Constructor/destructor ---------------------------------------------
 	D3DVertexBuffer(D3DContext *context, int numFloats);
@@ -55,25 +64,39 @@ public: // Constructor/destructor ---------------------------------------------
 
 public: // Methods ------------------------------------------------------------
 	void			update();
-	void			bind();
+	void			bind(uint slot = 0);
 	ID3D10Buffer *	getBuffer() const;
+	int				getNumUploadedVerts() const;
+
+	void			releaseResources();
+	void			recreateResources();
+private:
+	void			createResources();
 };
 //=============================================================================
 
-inline ID3D10Buffer *D3DVertexBuffer::getBuffer() const
-{
-	return m_buffer;
-}
-
 //=============================================================================
 class D3DTexture : public Texture
 {
 protected: // Members ---------------------------------------------------------
+	D3DContext *				m_context;
 	ID3D10Texture2D *			m_tex;
 	ID3D10ShaderResourceView *	m_view;
 	ID3D10RenderTargetView *	m_target;
 	bool						m_doBgraSwizzle;
 	bool						m_isSrgb;
+	bool						m_isExternal;
+	VidgfxTexFlags				m_requestedFlags;
+	DXGI_FORMAT					m_requestedFormat;
+
+	// Shared textures only
+	HANDLE						m_sharedHandle;
+
+	// Shared textures with a keyed mutex only
+	IDXGIKeyedMutex *			m_keyedMutex;
+	bool						m_syncAcquired;
+	bool						m_hasReleaseKey;
+	quint64						m_releaseKey; // Last key of `releaseSync()`
 
 	// GDI-compatible textures only
 	IDXGISurface1 *				m_surface;
@@ -87,17 +110,35 @@ public: // Constructor/destructor ---------------------------------------------
 	virtual ~D3DTexture();
 
 public: // Methods ------------------------------------------------------------
+	void *						map(bool doNotWait);
 	ID3D10Texture2D *			getTexture() const;
 	ID3D10ShaderResourceView *	getResourceView() const;
 	ID3D10RenderTargetView *	getTargetView() const;
 	bool						doBgraSwizzle() const;
+	bool						isExternal() const;
+	VidgfxTexFlags				getRequestedFlags() const;
+	DXGI_FORMAT					getRequestedFormat() const;
+	qint64						getMemoryUsage();
+
+	HANDLE						getSharedHandle() const;
+	bool						hasKeyedMutex() const;
+	bool						isSyncAcquired() const;
+	VidgfxSyncResult			acquireSync(quint64 key, int timeoutMsec);
+	bool						releaseSync(quint64 key);
 
 	HDC							getDC();
 	void						releaseDC();
 
 	DXGI_FORMAT					getPixelFormat();
+
+	void						releaseResources();
+	bool						recreateResources();
 private:
+	bool						createResources(
+		void *initialData, int stride);
 	bool						isSrgbFormat(DXGI_FORMAT format);
+	static int					getBitsPerPixel(DXGI_FORMAT format);
+	bool						querySharedHandle();
 
 public: // Interface ----------------------------------------------------------
 	virtual void *		map();
@@ -127,6 +168,91 @@ inline bool D3DTexture::doBgraSwizzle() const
 	return m_doBgraSwizzle;
 }
 
+/// <summary>
+/// Returns true if the texture was created outside of libvidgfx and its
+/// contents can therefore be modified without our knowledge.
+/// </summary>
+inline bool D3DTexture::isExternal() const
+{
+	return m_isExternal;
+}
+
+/// <summary>
+/// Returns the flags that the texture was created with. Unlike `m_flags` this
+/// is never modified after the texture has been constructed.
+/// </summary>
+inline VidgfxTexFlags D3DTexture::getRequestedFlags() const
+{
+	return m_requestedFlags;
+}
+
+/// <summary>
+/// Returns the pixel format that the texture was created with which can be
+/// different to the actual format if BGRA textures are not supported.
+/// </summary>
+inline DXGI_FORMAT D3DTexture::getRequestedFormat() const
+{
+	return m_requestedFormat;
+}
+
+/// <summary>
+/// Returns the DXGI shared handle of the texture that other devices,
+/// including D3D11 devices and hardware encoders, can use to open the texture
+/// with `OpenSharedResource()` without copying it.
+/// </summary>
+/// <returns>NULL if the texture isn't shareable</returns>
+inline HANDLE D3DTexture::getSharedHandle() const
+{
+	return m_sharedHandle;
+}
+
+inline bool D3DTexture::hasKeyedMutex() const
+{
+	return m_keyedMutex != NULL;
+}
+
+inline bool D3DTexture::isSyncAcquired() const
+{
+	return m_syncAcquired;
+}
+
+//=============================================================================
+class D3DReadbackQueue : public ReadbackQueue
+{
+private: // Datatypes ---------------------------------------------------------
+	struct Slot {
+		D3DTexture *	tex;
+		ID3D10Query *	query;
+		bool			pending;
+	};
+
+private: // Members -----------------------------------------------------------
+	D3DContext *	m_context;
+	QVector<Slot>	m_slots;
+	int				m_nextWrite;
+	int				m_nextRead;
+	int				m_dequeued;
+	bool			m_isValid;
+
+public: // Constructor/destructor ---------------------------------------------
+	D3DReadbackQueue(D3DContext *context, const QSize &size, int depth);
+	virtual ~D3DReadbackQueue();
+
+public: // Methods ------------------------------------------------------------
+	void				releaseResources();
+	bool				recreateResources();
+private:
+	bool				createQueries();
+
+public: // Interface ----------------------------------------------------------
+	virtual bool		isValid() const;
+	virtual bool		enqueue(
+		Texture *src, const QPoint &srcPos = QPoint(0, 0));
+	virtual Texture *	tryDequeue();
+	virtual void		releaseDequeued();
+};
+//=============================================================================
+
 //=============================================================================
 class D3DContext : public GraphicsContext
 {
@@ -154,14 +280,120 @@ private: // Datatypes ---------------------------------------------------------
 	typedef QVector<BgraTexSupportChangedCallback>
 		BgraTexSupportChangedCallbackList;
 
+	struct ProfileFrameCallback {
+		VidgfxD3DContextProfileFrameCallback *	callback;
+		void *									opaque;
+
+		inline bool operator==(const ProfileFrameCallback &r) const {
+			return callback == r.callback && opaque == r.opaque;
+		};
+	};
+	typedef QVector<ProfileFrameCallback> ProfileFrameCallbackList;
+
+	struct ProfileScope {
+		QByteArray	name;
+		int			depth;
+		int			beginQuery; // Index into `ProfileFrame::queries`
+		int			endQuery; // -1 if the scope hasn't ended
+	};
+
+	struct ProfileFrame {
+		ID3D10Query *			disjointQuery;
+		QVector<ID3D10Query *>	queries; // Timestamps, reused between frames
+		int						numQueriesUsed; // First and last are the frame
+		QVector<ProfileScope>	scopes;
+		quint64					frameNum;
+		int						numDrawCalls;
+		qint64					numBytesUploaded;
+		qint64					numBytesReadBack;
+		bool					isPending; // Waiting for the GPU
+	};
+
+	// Every format conversion shader has its own cbuffer so that the constants
+	// are only uploaded again when they actually change
+	struct ConversionConstants {
+		float			local[8];
+		ID3D10Buffer *	buffer;
+		bool			isUploaded; // `local` matches the hardware buffer
+	};
+
+	struct ScaleCacheEntry {
+		Texture *		src;
+		quint32			srcGeneration;
+		QRect			cropRect;
+		QSize			size;
+		VidgfxFilter	filter;
+		D3DTexture *	tex; // NULL if the source hasn't been seen unchanged
+		QPointF			pxSize;
+		QPointF			topLeft;
+		QPointF			botRight;
+		quint32			lastUsed;
+	};
+	typedef QVector<ScaleCacheEntry> ScaleCacheList;
+
+	// Filter weights of one axis of `resampleTexture()`
+	struct ResampleWeights {
+		VidgfxFilter	filter;
+		int				srcLen;
+		int				dstLen;
+		int				numTaps; // Always a multiple of 4
+		D3DTexture *	tex;
+	};
+	typedef QVector<ResampleWeights> ResampleWeightsList; // Most recent first
+
+	// Every pixel shader that `getPixelShader()` can create. The tex decal
+	// shaders are last with one entry for every `TexDecal*Perm` combination.
+	enum PixelShader {
+		SolidPS = 0,
+		ResizePS,
+		RgbNv16PS,
+		Yv12RgbPS,
+		Nv12RgbPS,
+		UyvyRgbPS,
+		HdycRgbPS,
+		Yuy2RgbPS,
+		RgbYPS,
+		RgbNv12UvPS,
+		RgbI420UvPS,
+		RgbNv16ScaledPS,
+		RgbNv16Scaled709PS,
+		DilutePS, // Feature level 10.0 only
+		ResampleHorzPS, // Feature level 10.0 only
+		ResampleVertPS, // Feature level 10.0 only
+		TexDecalPS // Must be last
+	};
+
+private: // Constants ---------------------------------------------------------
+
+	// The number of shaders that have their own `ConversionConstants`
+	static const int	NumConversionShaders = 12;
+
+	// Compile-time features of the tex decal pixel shader permutations. Only
+	// the combinations that `getPixelShaderForShader()` can select exist.
+	static const int	TexDecalSwizzlePerm = 0x01;
+	static const int	TexDecalSrgbPerm = 0x02;
+	static const int	TexDecalBcPerm = 0x04; // Subset of `TexDecalGbcsPerm`
+	static const int	TexDecalGbcsPerm = 0x08;
+	static const int	TexDecalOpaquePerm = 0x10;
+	static const int	TexDecalPremultipliedPerm = 0x20;
+	static const int	NumTexDecalPerms = 64;
+
+	static const int	NumPixelShaders = TexDecalPS + NumTexDecalPerms;
+
 private: // Members -----------------------------------------------------------
 	bool						m_hasDxgi11;
 	bool						m_hasDxgi11Valid;
 	bool						m_hasBgraTexSupport;
 	bool						m_hasBgraTexSupportValid;
+	bool						m_hasFeatureLevel10;
+	int							m_adapterIndex; // -1 = Default adapter
 	IDXGISwapChain *			m_swapChain;
 	ID3D10Device *				m_device;
 	ID3D10RasterizerState *		m_rasterizerState;
+	ID3D10RasterizerState *		m_scissorRasterizerState;
+	QRect						m_scissorRect; // Null = Disabled
+	bool						m_boundScissorEnabled;
+	QRect						m_boundScissorRect;
 	ID3D10SamplerState *		m_pointClampSampler;
 	ID3D10SamplerState *		m_bilinearClampSampler;
 	ID3D10SamplerState *		m_resizeSampler;
@@ -172,6 +404,9 @@ private: // Members -----------------------------------------------------------
 	// Render targets
 	ID3D10RenderTargetView *	m_screenTarget;
 	QSize						m_screenTargetSize;
+	VidgfxD3DPresentMode		m_presentMode;
+	quint32						m_presentCounter; // Calls to swapScreenBuffers()
+	quint32						m_numDroppedPresents;
 	D3DTexture *				m_canvas1Texture;
 	D3DTexture *				m_canvas2Texture;
 	QSize						m_canvasTargetSize;
@@ -180,48 +415,109 @@ private: // Members -----------------------------------------------------------
 	QSize						m_scratchTargetSize;
 	int							m_scratchNextTarget;
 
-	// Constant buffers
+	// Constant buffers. Each set of camera matrices has its own cbuffer so
+	// that switching between render targets doesn't require an upload.
 	float						m_cameraConstantsLocal[(4*4)*2]; // 2 4x4 matrices
-	ID3D10Buffer *				m_cameraConstants;
+	ID3D10Buffer *				m_cameraConstants[NUM_CAMERA_SETS];
+	quint32						m_cameraUploadedVersions[NUM_CAMERA_SETS];
 	float						m_resizeConstantsLocal[4]; // 1 XYWH rectangle
 	ID3D10Buffer *				m_resizeConstants;
 	float						m_rgbNv16ConstantsLocal[4]; // 4 horizontal offsets
 	ID3D10Buffer *				m_rgbNv16Constants;
+	ConversionConstants			m_convConstants[NumConversionShaders];
 	// 1 RGBA colour + 1 integer for flags + 3 unused + 4 effect floats
 	float						m_texDecalConstantsLocal[12];
 	ID3D10Buffer *				m_texDecalConstants;
-	quint32						m_texDecalFlags;
-
-	// Shaders
+	int							m_texDecalFlags; // `TexDecal*Perm` bits
+
+	// Shared dynamic vertex ring that small vertex buffers sub-allocate from
+	ID3D10Buffer *				m_vertRing;
+	int							m_vertRingPos; // In bytes
+	quint32						m_vertRingGeneration;
+
+	// Shadow copy of the device state so that we can skip redundant calls.
+	// NULL or 0 means unknown.
+	ID3D10RenderTargetView *	m_boundTargetViews[2];
+	QRect						m_boundViewport;
+	int							m_boundTopology; // -1 = Unknown
+	ID3D10BlendState *			m_boundBlendState;
+	ID3D10ShaderResourceView *	m_boundResourceViews[3];
+	int							m_numBoundResourceViews; // -1 = Unknown
+	ID3D10SamplerState *		m_boundSampler;
+	ID3D10Buffer *				m_boundVSConstants;
+	ID3D10Buffer *				m_boundPSConstants;
+	quint32						m_numRedundantStateCalls;
+
+	// Shaders. Vertex shaders are created at initialization while pixel
+	// shaders are created by `getPixelShader()` the first time that they are
+	// drawn with. The pixel shader is bound by `bindPixelShader()` at draw
+	// time as the tex decal permutation depends on the bound texture.
 	VidgfxShader				m_boundShader;
+	int							m_boundPixelShader; // -1 = Unknown
 	ID3D10VertexShader *		m_solidVS;
-	ID3D10PixelShader *			m_solidPS;
 	ID3D10InputLayout *			m_solidIL;
-	ID3D10VertexShader *		m_texDecalVS;
-	ID3D10PixelShader *			m_texDecalPS;
-	ID3D10PixelShader *			m_texDecalGbcsPS;
-	ID3D10PixelShader *			m_texDecalRgbPS;
+	ID3D10VertexShader *		m_texDecalVS; // Shared by most shaders
 	ID3D10InputLayout *			m_texDecalIL;
 	ID3D10VertexShader *		m_resizeVS;
-	ID3D10PixelShader *			m_resizePS;
 	ID3D10InputLayout *			m_resizeIL;
-	// All these share `texDecalVS` and IL
-	ID3D10PixelShader *			m_rgbNv16PS;
-	ID3D10PixelShader *			m_yv12RgbPS;
-	ID3D10PixelShader *			m_UyvyRgbPS;
-	ID3D10PixelShader *			m_HdycRgbPS;
-	ID3D10PixelShader *			m_Yuy2RgbPS;
+	ID3D10PixelShader *			m_pixelShaders[NumPixelShaders];
+	bool						m_pixelShaderFailed[NumPixelShaders];
+
+	// Instanced unit quad rendering, feature level 10.0 only. The instanced
+	// vertex shaders replace the vertex shader of the bound shader during
+	// `drawInstanced()`.
+	bool						m_hasInstancing;
+	bool						m_instancedVSBound;
+	ID3D10Buffer *				m_unitQuadBuf;
+	ID3D10VertexShader *		m_solidInstVS;
+	ID3D10InputLayout *			m_solidInstIL;
+	ID3D10VertexShader *		m_texDecalInstVS;
+	ID3D10InputLayout *			m_texDecalInstIL;
 
 	// Advanced rendering
 	VertexBuffer *				m_mipmapBuf;
+	ScaleCacheList				m_scaleCache;
+	int							m_scaleCacheMaxSize;
+	quint32						m_scaleCacheUseCounter;
+	ResampleWeightsList			m_resampleWeights;
+
+	// Texture pool, oldest first
+	QVector<D3DTexture *>		m_texPool;
+	qint64						m_texPoolMaxBytes;
+	VidgfxD3DTexPoolStats		m_texPoolStats;
+
+	// GPU profiler, a ring of frames that are waiting for their results
+	bool						m_profilingEnabled;
+	QVector<ProfileFrame>		m_profFrames;
+	int							m_profCurFrame;
+	bool						m_profInFrame;
+	QVector<int>				m_profScopeStack;
+	quint64						m_profFrameCounter;
+	int							m_profNumDropped;
+
+	// Device-lost recovery. Every object that owns hardware resources is
+	// tracked so that it can be recreated on a new device.
+	HWND						m_hwnd;
+	QColor						m_resizeBorderCol;
+	bool						m_isDeviceLost;
+	DWORD						m_lastRecoveryTick;
+	quint32						m_numDeviceResets;
+	QVector<D3DTexture *>		m_liveTextures;
+	QVector<D3DVertexBuffer *>	m_liveVertexBufs;
+	QVector<D3DReadbackQueue *>	m_liveReadbackQueues;
 
 	// Callbacks
 	Dxgi11ChangedCallbackList			m_dxgi11ChangedCallbackList;
 	BgraTexSupportChangedCallbackList	m_bgraTexSupportChangedCallbackList;
+	ProfileFrameCallbackList			m_profileFrameCallbackList;
 
 public: // Static methods -----------------------------------------------------
 	static HRESULT	createDXGIFactory1Dynamic(IDXGIFactory1 **factoryOut);
 	static void		logDisplayAdapters();
+	static QVector<VidgfxD3DAdapterInfo>	queryAdapters();
+	static int		getRecommendedAdapter(
+		const QVector<VidgfxD3DAdapterInfo> &adapters,
+		quint32 preferVendorId = 0);
 
 public: // Constructor/destructor ---------------------------------------------
 	D3DContext();
@@ -229,19 +525,70 @@ public: // Constructor/destructor ---------------------------------------------
 
 public: // Methods ------------------------------------------------------------
 	bool			initialize(
-		HWND hwnd, const QSize &size, const QColor &resizeBorderCol);
+		HWND hwnd, const QSize &size, const QColor &resizeBorderCol,
+		int adapterIndex = -1);
+	int				getAdapterIndex() const;
 	ID3D10Device *	getDevice() const;
 	bool			hasDxgi11();
 	bool			hasBgraTexSupport();
 	Texture *		createGDITexture(const QSize &size);
+	Texture *		createSharedTexture(
+		const QSize &size, bool useKeyedMutex = true);
 	Texture *		openSharedTexture(HANDLE sharedHandle);
 	Texture *		openDX10Texture(ID3D10Texture2D *tex);
+	void			setTexturePoolLimit(qint64 maxBytes);
+	qint64			getTexturePoolLimit() const;
+	void			trimTexturePool(qint64 maxBytes = 0);
+	VidgfxD3DTexPoolStats	getTexturePoolStats() const;
+	void			setPresentMode(const VidgfxD3DPresentMode &mode);
+	VidgfxD3DPresentMode	getPresentMode() const;
+	bool			isScreenFrameDue() const;
+	quint32			getNumDroppedPresents() const;
+	void			invalidateStateCache();
+	quint32			getNumRedundantStateCalls() const;
+	void			resetNumRedundantStateCalls();
+
+	bool			isDeviceLost() const;
+	quint32			getNumDeviceResets() const;
+	bool			checkDeviceRemoved(HRESULT res);
+	bool			recoverDevice();
+	void			addResource(D3DTexture *tex);
+	void			removeResource(D3DTexture *tex);
+	void			addResource(D3DVertexBuffer *buf);
+	void			removeResource(D3DVertexBuffer *buf);
+	void			addResource(D3DReadbackQueue *queue);
+	void			removeResource(D3DReadbackQueue *queue);
+
+	void			setProfilingEnabled(bool enabled);
+	bool			isProfilingEnabled() const;
+	void			beginProfileFrame();
+	void			endProfileFrame();
+	void			beginProfileScope(const char *name);
+	void			endProfileScope();
+	void			addProfileBytesUploaded(qint64 numBytes);
+	void			addProfileBytesReadBack(qint64 numBytes);
+
+	// Vertex ring
+	ID3D10Buffer *	getVertexRing() const;
+	quint32			getVertexRingGeneration() const;
+	bool			appendToVertexRing(
+		const void *data, int numBytes, int &offsetOut);
 
 private:
+	bool			createDeviceObjects(const QSize &size);
+	void			releaseDeviceObjects();
 	IDXGIAdapter *	getFirstDxgi11Adapter();
+	IDXGIAdapter *	getDxgiAdapter(int index);
+	void			resizeScreenBuffers(const QSize &newSize);
+	void			applyMaxFrameLatency();
+
+	D3DTexture *	createPooledTexture(
+		VidgfxTexFlags flags, const QSize &size, DXGI_FORMAT format);
+	void			deletePooledTexture(D3DTexture *tex);
 
 	bool			createScreenTarget();
 	bool			createShaders();
+	bool			createInstancingResources();
 	bool			createVertexShaderAndInputLayout(
 		const QString &shaderName, ID3D10VertexShader **shader,
 		ID3D10InputLayout **layout,
@@ -249,14 +596,51 @@ private:
 	bool			createPixelShader(
 		const QString &shaderName, ID3D10PixelShader **shader);
 	QByteArray		getShaderFileData(const QString &shaderName) const;
-
-	void			updateCameraConstants();
+	static QString	getPixelShaderName(int ps);
+	ID3D10PixelShader *	getPixelShader(int ps);
+	int				getTexDecalEffectsPerm() const;
+	int				getPixelShaderForShader(VidgfxShader shader) const;
+	void			bindPixelShader();
+
+	void			fillCameraConstants(CameraSet set);
+	ID3D10Buffer *	updateCameraConstants();
 	void			updateResizeConstants();
 	void			updateRgbNv16Constants();
 	void			updateTexDecalConstants();
+	bool			updateConversionConstants(
+		VidgfxShader shader, const float *values);
+	ID3D10Buffer *	getConversionConstants(VidgfxShader shader) const;
+	bool			updateRgbYuv420Constants(
+		VidgfxShader shader, const QPointF &pxSize);
+	void			bindVSConstants(ID3D10Buffer *buf);
+	void			bindPSConstants(ID3D10Buffer *buf);
+	void			bindDrawConstants();
+	bool			bindInstancedShader();
+	void			applyScissorRect();
+	void			markCurrentTargetModified();
+	int				findScaleCacheEntry(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter) const;
+	int				addScaleCacheEntry(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter);
+	void			removeScaleCacheEntries(Texture *src);
+	void			evictScaleCacheEntries(int maxEntries);
+	const ResampleWeights *	getResampleWeights(
+		VidgfxFilter filter, int srcLen, int dstLen);
+	Texture *		resampleTexture(
+		Texture *tex, const QRect &cropRect, const QSize &size,
+		VidgfxFilter filter);
+	bool			drawYuvPlanes(
+		VidgfxShader shader, Texture *src, Texture *targetA,
+		Texture *targetB);
 
 	void			setSwizzleInTexDecal(bool doSwizzle);
 
+	int				issueProfileTimestamp();
+	void			collectProfileResults();
+	void			releaseProfileQueries();
+
 public: // Interface ----------------------------------------------------------
 	virtual bool	isValid() const;
 	virtual void	flush();
@@ -273,10 +657,18 @@ public: // Interface ----------------------------------------------------------
 		const QSize &size, Texture *sameFormat, bool writable = false,
 		bool targetable = false);
 	virtual Texture *		createStagingTexture(const QSize &size);
+	virtual Texture *		createRgTexture(
+		const QSize &size, bool writable = false, bool targetable = false);
+	virtual void			setScaleCacheSize(int maxEntries);
+	virtual int				getScaleCacheSize() const;
+	virtual void			purgeScaleCache();
 	virtual void			deleteTexture(Texture *tex);
 	virtual bool			copyTextureData(
 		Texture *dst, Texture *src, const QPoint &dstPos,
 		const QRect &srcRect);
+	virtual ReadbackQueue *	createReadbackQueue(
+		const QSize &size, int depth = 3);
+	virtual void			deleteReadbackQueue(ReadbackQueue *queue);
 
 	// Render targets
 	virtual void				resizeScreenTarget(const QSize &newSize);
@@ -298,6 +690,13 @@ public: // Interface ----------------------------------------------------------
 	virtual Texture *	convertToBgrx(
 		VidgfxPixFormat format, Texture *planeA, Texture *planeB,
 		Texture *planeC);
+	virtual bool		convertFromRgb(
+		VidgfxPixFormat format, Texture *src, Texture *planeA,
+		Texture *planeB, Texture *planeC = NULL);
+	virtual bool		scaleToNv16(
+		Texture *src, Texture *planeY, Texture *planeUV,
+		VidgfxYuvMatrix matrix = GfxBt601Matrix);
+	virtual bool		diluteTexture(Texture *src, Texture *dst);
 
 	// Drawing
 	virtual void		setRenderTarget(VidgfxRendTarget target);
@@ -307,9 +706,13 @@ public: // Interface ----------------------------------------------------------
 	virtual void		setTexture(
 		Texture *texA, Texture *texB = NULL, Texture *texC = NULL);
 	virtual void		setTextureFilter(VidgfxFilter filter);
+	virtual void		setScissorRect(const QRect &rect);
 	virtual void		clear(const QColor &color);
 	virtual void		drawBuffer(
 		VertexBuffer *buf, int numVertices = -1, int startVertex = 0);
+	virtual bool		hasInstancingSupport() const;
+	virtual void		drawInstanced(
+		VertexBuffer *instBuf, int numInstances = -1, int startInstance = 0);
 
 public: // Signals ------------------------------------------------------------
 	void	callDxgi11ChangedCallbacks(bool hasDxgi11);
@@ -326,15 +729,128 @@ public: // Signals ------------------------------------------------------------
 		VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
 		void *opaque);
 
+	void	callProfileFrameCallbacks(const VidgfxD3DProfileFrame *frame);
+	void	addProfileFrameCallback(
+		VidgfxD3DContextProfileFrameCallback *profile_frame, void *opaque);
+	void	removeProfileFrameCallback(
+		VidgfxD3DContextProfileFrameCallback *profile_frame, void *opaque);
+
 Q_SIGNALS: // Signals ---------------------------------------------------------
 	void	hasDxgi11Changed(bool hasDxgi11);
 	void	hasBgraTexSupportChanged(bool hasBgraTexSupport);
 };
 //=============================================================================
 
+/// <summary>
+/// Returns the index of the adapter that was passed to `initialize()` or -1 if
+/// the default adapter is used.
+/// </summary>
+inline int D3DContext::getAdapterIndex() const
+{
+	return m_adapterIndex;
+}
+
 inline ID3D10Device *D3DContext::getDevice() const
 {
 	return m_device;
 }
 
+inline qint64 D3DContext::getTexturePoolLimit() const
+{
+	return m_texPoolMaxBytes;
+}
+
+inline VidgfxD3DTexPoolStats D3DContext::getTexturePoolStats() const
+{
+	return m_texPoolStats;
+}
+
+inline VidgfxD3DPresentMode D3DContext::getPresentMode() const
+{
+	return m_presentMode;
+}
+
+/// <summary>
+/// Returns true if the next call to `swapScreenBuffers()` will present the
+/// screen target. When the present divisor is greater than one the caller can
+/// use this to skip rendering the screen target on the frames that will not be
+/// displayed.
+/// </summary>
+inline bool D3DContext::isScreenFrameDue() const
+{
+	return (m_presentCounter % (quint32)m_presentMode.present_divisor) == 0;
+}
+
+/// <summary>
+/// Returns the number of frames that were not presented since the context was
+/// created because the GPU was busy and `skip_if_busy` was set.
+/// </summary>
+inline quint32 D3DContext::getNumDroppedPresents() const
+{
+	return m_numDroppedPresents;
+}
+
+/// <summary>
+/// Returns the number of state changes that were skipped because the
+/// requested state was already bound to the device.
+/// </summary>
+inline quint32 D3DContext::getNumRedundantStateCalls() const
+{
+	return m_numRedundantStateCalls;
+}
+
+inline void D3DContext::resetNumRedundantStateCalls()
+{
+	m_numRedundantStateCalls = 0;
+}
+
+/// <summary>
+/// Returns true if the graphics device was removed or reset and hasn't been
+/// recovered yet. The context is not valid while the device is lost.
+/// </summary>
+inline bool D3DContext::isDeviceLost() const
+{
+	return m_isDeviceLost;
+}
+
+/// <summary>
+/// Returns the number of times that the device was successfully recreated
+/// after it was lost since the context was created.
+/// </summary>
+inline quint32 D3DContext::getNumDeviceResets() const
+{
+	return m_numDeviceResets;
+}
+
+inline bool D3DContext::isProfilingEnabled() const
+{
+	return m_profilingEnabled;
+}
+
+inline void D3DContext::addProfileBytesUploaded(qint64 numBytes)
+{
+	if(m_profInFrame)
+		m_profFrames[m_profCurFrame].numBytesUploaded += numBytes;
+}
+
+inline void D3DContext::addProfileBytesReadBack(qint64 numBytes)
+{
+	if(m_profInFrame)
+		m_profFrames[m_profCurFrame].numBytesReadBack += numBytes;
+}
+
+inline ID3D10Buffer *D3DContext::getVertexRing() const
+{
+	return m_vertRing;
+}
+
+/// <summary>
+/// Returns a counter that is incremented every time the vertex ring wraps.
+/// Allocations from a previous generation no longer contain valid data.
+/// </summary>
+inline quint32 D3DContext::getVertexRingGeneration() const
+{
+	return m_vertRingGeneration;
+}
+
 #endif // D3DCONTEXT_H
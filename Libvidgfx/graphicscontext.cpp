@@ -17,8 +17,16 @@
 
 #include "graphicscontext.h"
 #include "gfxlog.h"
+#include <QtCore/QAtomicInt>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
 #include <QtGui/QImage>
 #include <QtGui/QVector2D>
+#include <emmintrin.h>
 
 const QString LOG_CAT = QStringLiteral("Gfx");
 
@@ -215,15 +223,18 @@ int rectOutlineColor(
 }
 
 /// <summary>
-/// Copies the nearby colour information to the specified pixel.
+/// Searches the rings of pixels around the specified pixel of `src` for colour
+/// information. `stride` is in pixels. Every side of a ring that contains a
+/// non-transparent pixel overwrites the result of the sides before it and
+/// clamping a side to the image affects the sides that follow.
 /// </summary>
-/// <returns>True if the pixel was modified</returns>
-bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
+/// <returns>True if `pixOut` was modified</returns>
+bool dilutePixel(
+	const QRgb *src, int stride, int w, int h, int x, int y, int dMax,
+	QRgb &pixOut)
 {
 	// WARNING: We do a VERY quick and nasty "nearest pixel" algorithm here
 	// that is nowhere near ideal.
-	const int w = imgIn.width();
-	const int h = imgIn.height();
 	bool found = false;
 	for(int d = 1; d <= dMax; d++) {
 		int xStart = x - d;
@@ -234,10 +245,10 @@ bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
 		if(yStart >= 0) { // Top
 			xStart = qMax(xStart, 0);
 			xEnd = qMin(xEnd, w - 1);
+			const QRgb *row = &src[yStart * stride];
 			for(int s = xStart; s <= xEnd; s++) {
-				QRgb pix = imgIn.pixel(s, yStart);
-				if(qAlpha(pix) > 0) {
-					imgOut.setPixel(x, y, pix & RGB_MASK);
+				if(qAlpha(row[s]) > 0) {
+					pixOut = row[s] & RGB_MASK;
 					found = true;
 					break;
 				}
@@ -247,9 +258,9 @@ bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
 			yStart = qMax(yStart, 0);
 			yEnd = qMin(yEnd, h - 1);
 			for(int t = yStart; t <= yEnd; t++) {
-				QRgb pix = imgIn.pixel(xStart, t);
+				QRgb pix = src[t * stride + xStart];
 				if(qAlpha(pix) > 0) {
-					imgOut.setPixel(x, y, pix & RGB_MASK);
+					pixOut = pix & RGB_MASK;
 					found = true;
 					break;
 				}
@@ -259,9 +270,9 @@ bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
 			yStart = qMax(yStart, 0);
 			yEnd = qMin(yEnd, h - 1);
 			for(int t = yStart; t <= yEnd; t++) {
-				QRgb pix = imgIn.pixel(xEnd, t);
+				QRgb pix = src[t * stride + xEnd];
 				if(qAlpha(pix) > 0) {
-					imgOut.setPixel(x, y, pix & RGB_MASK);
+					pixOut = pix & RGB_MASK;
 					found = true;
 					break;
 				}
@@ -270,10 +281,10 @@ bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
 		if(yEnd < h) { // Bottom
 			xStart = qMax(xStart, 0);
 			xEnd = qMin(xEnd, w - 1);
+			const QRgb *row = &src[yEnd * stride];
 			for(int s = xStart; s <= xEnd; s++) {
-				QRgb pix = imgIn.pixel(s, yEnd);
-				if(qAlpha(pix) > 0) {
-					imgOut.setPixel(x, y, pix & RGB_MASK);
+				if(qAlpha(row[s]) > 0) {
+					pixOut = row[s] & RGB_MASK;
 					found = true;
 					break;
 				}
@@ -287,6 +298,100 @@ bool dilutePixel(QImage &imgIn, QImage &imgOut, int x, int y, int dMax)
 	return found;
 }
 
+/// <summary>
+/// Dilutes the rows [`yStart`..`yEnd`) of `src` into the same rows of `dst`.
+/// Strides are in pixels. Spans of 4 pixels that have no fully transparent
+/// pixels are skipped with a single SSE2 compare.
+/// </summary>
+/// <returns>True if any pixel of `dst` was modified</returns>
+bool diluteRows(
+	const QRgb *src, int srcStride, QRgb *dst, int dstStride, int w, int h,
+	int yStart, int yEnd, int dMax)
+{
+	const __m128i zero = _mm_setzero_si128();
+	bool modified = false;
+	for(int y = yStart; y < yEnd; y++) {
+		const QRgb *rowIn = &src[y * srcStride];
+		QRgb *rowOut = &dst[y * dstStride];
+		int x = 0;
+		for(; x + 4 <= w; x += 4) {
+			__m128i pix = _mm_loadu_si128((const __m128i *)&rowIn[x]);
+			__m128i alpha = _mm_srli_epi32(pix, 24);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0)
+				continue; // All 4 pixels have colour information
+			for(int i = x; i < x + 4; i++) {
+				if(qAlpha(rowIn[i]) != 0)
+					continue;
+				if(dilutePixel(src, srcStride, w, h, i, y, dMax, rowOut[i]))
+					modified = true;
+			}
+		}
+		for(; x < w; x++) {
+			if(qAlpha(rowIn[x]) != 0)
+				continue;
+			if(dilutePixel(src, srcStride, w, h, x, y, dMax, rowOut[x]))
+				modified = true;
+		}
+	}
+	return modified;
+}
+
+/// <summary>
+/// A dilution of a whole image that is split into chunks of rows. Chunks are
+/// processed by the calling thread and any `DiluteTask` that it managed to
+/// start in the global thread pool.
+/// </summary>
+struct DiluteJob {
+	const QRgb *	src;
+	int				srcStride;
+	QRgb *			dst;
+	int				dstStride;
+	int				width;
+	int				height;
+	int				dMax;
+	int				rowsPerChunk;
+	int				numChunks;
+	QAtomicInt		nextChunk;
+	QAtomicInt		modified;
+	QSemaphore		numFinished;
+};
+
+void processDiluteJob(DiluteJob *job)
+{
+	for(;;) {
+		int chunk = job->nextChunk.fetchAndAddRelaxed(1);
+		if(chunk >= job->numChunks)
+			break;
+		int yStart = chunk * job->rowsPerChunk;
+		int yEnd = qMin(yStart + job->rowsPerChunk, job->height);
+		if(diluteRows(
+			job->src, job->srcStride, job->dst, job->dstStride, job->width,
+			job->height, yStart, yEnd, job->dMax))
+		{
+			job->modified.fetchAndStoreRelaxed(1);
+		}
+	}
+}
+
+class DiluteTask : public QRunnable
+{
+private:
+	DiluteJob *	m_job;
+
+public:
+	DiluteTask(DiluteJob *job)
+		: QRunnable()
+		, m_job(job)
+	{
+		setAutoDelete(false); // Owned by `diluteImage()`
+	}
+	virtual void run()
+	{
+		processDiluteJob(m_job);
+		m_job->numFinished.release();
+	}
+};
+
 //=============================================================================
 // VertexBuffer class
 
@@ -314,7 +419,9 @@ VertexBuffer::~VertexBuffer()
 TexDecalVertBuf::TexDecalVertBuf(GraphicsContext *context)
 	: m_context(context)
 	, m_vertBuf(NULL)
+	, m_instBuf(NULL)
 	, m_dirty(true)
+	, m_instDirty(true)
 	, m_hasScrolling(false)
 
 	// Position
@@ -334,7 +441,7 @@ TexDecalVertBuf::TexDecalVertBuf(GraphicsContext *context)
 
 TexDecalVertBuf::~TexDecalVertBuf()
 {
-	if(m_vertBuf != NULL)
+	if(m_vertBuf != NULL || m_instBuf != NULL)
 		deleteVertBuf();
 }
 
@@ -380,14 +487,70 @@ VidgfxTopology TexDecalVertBuf::getTopology() const
 	return GfxTriangleStripTopology;
 }
 
+/// <summary>
+/// Retrieves the per-instance buffer for `GraphicsContext::drawInstanced()`,
+/// creating and/or updating it if required. Returns NULL if the context
+/// doesn't support instancing or if the texture UV isn't an axis-aligned
+/// rectangle in which case `getVertBuf()` must be used instead.
+/// </summary>
+VertexBuffer *TexDecalVertBuf::getInstanceBuf()
+{
+	if(!canUseInstancing())
+		return NULL;
+	if(!m_instDirty && m_instBuf != NULL)
+		return m_instBuf;
+
+	// Create the instance buffer object if it doesn't already exist
+	if(m_instBuf == NULL) {
+		m_instBuf = m_context->createVertexBuffer(
+			GraphicsContext::InstanceNumFloats);
+		if(m_instBuf == NULL)
+			return NULL; // Failed to create instance buffer
+	}
+
+	// Update the instance buffer
+	GraphicsContext::createTexDecalInstance(
+		m_instBuf, 0, m_rect, m_tlUv, m_brUv, getRoundedScrollOffset());
+
+	m_instDirty = false;
+	return m_instBuf;
+}
+
+/// <summary>
+/// Draws the rectangle using the currently bound shader, texture and blending
+/// mode. Scrolling rectangles are drawn as a single instance if possible so
+/// that scrolling only rewrites 16 floats instead of all 4 rectangles.
+/// </summary>
+void TexDecalVertBuf::draw()
+{
+	if(m_context == NULL || !m_context->isValid())
+		return; // No context operations can be done
+	if(m_hasScrolling) {
+		VertexBuffer *instBuf = getInstanceBuf();
+		if(instBuf != NULL) {
+			m_context->drawInstanced(instBuf);
+			return;
+		}
+	}
+	VertexBuffer *vertBuf = getVertBuf();
+	if(vertBuf == NULL)
+		return;
+	m_context->setTopology(getTopology());
+	m_context->drawBuffer(vertBuf);
+}
+
 void TexDecalVertBuf::deleteVertBuf()
 {
-	if(m_vertBuf == NULL)
+	if(m_vertBuf == NULL && m_instBuf == NULL)
 		return;
 	if(m_context == NULL || !m_context->isValid())
 		return;
-	m_context->deleteVertexBuffer(m_vertBuf);
+	if(m_vertBuf != NULL)
+		m_context->deleteVertexBuffer(m_vertBuf);
+	if(m_instBuf != NULL)
+		m_context->deleteVertexBuffer(m_instBuf);
 	m_vertBuf = NULL;
+	m_instBuf = NULL;
 }
 
 void TexDecalVertBuf::setRect(const QRectF &rect)
@@ -396,6 +559,7 @@ void TexDecalVertBuf::setRect(const QRectF &rect)
 		return; // Nothing to do
 	m_rect = rect;
 	m_dirty = true;
+	m_instDirty = true;
 }
 
 void TexDecalVertBuf::scrollBy(const QPointF &delta)
@@ -413,6 +577,7 @@ void TexDecalVertBuf::scrollBy(const QPointF &delta)
 	m_scrollOffset.setY(dblRepeat(m_scrollOffset.y(), 1.0));
 
 	m_dirty = true;
+	m_instDirty = true;
 }
 
 void TexDecalVertBuf::resetScrolling()
@@ -424,6 +589,7 @@ void TexDecalVertBuf::resetScrolling()
 	m_hasScrolling = false;
 	m_scrollOffset = QPointF(0.0f, 0.0f);
 	m_dirty = true;
+	m_instDirty = true;
 }
 
 /// <summary>
@@ -437,6 +603,7 @@ void TexDecalVertBuf::setRoundOffset(bool round)
 		return; // Nothing to do
 	m_roundOffset = round;
 	m_dirty = true;
+	m_instDirty = true;
 }
 
 void TexDecalVertBuf::setTextureUv(
@@ -453,6 +620,7 @@ void TexDecalVertBuf::setTextureUv(
 	m_blUv = botLeft;
 	m_brUv = botRight;
 	m_dirty = true;
+	m_instDirty = true;
 }
 
 void TexDecalVertBuf::setTextureUv(
@@ -507,6 +675,41 @@ void TexDecalVertBuf::getTextureUv(
 		*botRight = m_brUv;
 }
 
+/// <summary>
+/// Returns true if the rectangle can be drawn with the instanced texture decal
+/// shader which only supports an axis-aligned texture UV.
+/// </summary>
+bool TexDecalVertBuf::canUseInstancing() const
+{
+	if(m_context == NULL || !m_context->isValid())
+		return false;
+	if(!m_context->hasInstancingSupport())
+		return false;
+	return m_tlUv.y() == m_trUv.y() && m_blUv.y() == m_brUv.y() &&
+		m_tlUv.x() == m_blUv.x() && m_trUv.x() == m_brUv.x();
+}
+
+/// <summary>
+/// Returns the scroll offset in `m_rect` space that the rectangle should be
+/// split at taking into account `m_roundOffset`.
+/// </summary>
+QPointF TexDecalVertBuf::getRoundedScrollOffset() const
+{
+	qreal xLerp = m_scrollOffset.x();
+	qreal yLerp = m_scrollOffset.y();
+	if(m_roundOffset) {
+		// We assume the texture UV is orthogonal
+		if(!m_rect.size().isEmpty()) {
+			QSizeF invRectSize(1.0 / m_rect.width(), 1.0 / m_rect.height());
+			xLerp =
+				(qreal)qRound(xLerp * m_rect.width()) * invRectSize.width();
+			yLerp =
+				(qreal)qRound(yLerp * m_rect.height()) * invRectSize.height();
+		}
+	}
+	return QPointF(xLerp, yLerp);
+}
+
 bool TexDecalVertBuf::createScrollTexDecalRect(VertexBuffer *outBuf)
 {
 	if(outBuf == NULL)
@@ -524,18 +727,9 @@ bool TexDecalVertBuf::createScrollTexDecalRect(VertexBuffer *outBuf)
 	// Shared variables
 	QRectF rect;
 	QPointF tlUv, trUv, blUv, brUv;
-	qreal xLerp = m_scrollOffset.x();
-	qreal yLerp = m_scrollOffset.y();
-	if(m_roundOffset) {
-		// We assume the texture UV is orthogonal
-		if(!m_rect.size().isEmpty()) {
-			QSizeF invRectSize(1.0 / m_rect.width(), 1.0 / m_rect.height());
-			xLerp =
-				(qreal)qRound(xLerp * m_rect.width()) * invRectSize.width();
-			yLerp =
-				(qreal)qRound(yLerp * m_rect.height()) * invRectSize.height();
-		}
-	}
+	const QPointF lerp = getRoundedScrollOffset();
+	const qreal xLerp = lerp.x();
+	const qreal yLerp = lerp.y();
 
 	//-------------------------------------------------------------------------
 	// Write rectangles to the buffer
@@ -685,9 +879,74 @@ int TexDecalVertBuf::writeScrollRect(
 	return i;
 }
 
+/// <summary>
+/// Copies `numRows` rows of `rowBytes` bytes each from `src` to `dst`. If the
+/// strides differ then each row is written with SSE2 non-temporal stores as
+/// the destination is usually write-combined memory of a mapped texture that
+/// we never read back from.
+/// </summary>
+static void copyPlane(
+	quint8 *dst, int dstStride, const quint8 *src, int srcStride,
+	int rowBytes, int numRows)
+{
+	if(rowBytes <= 0 || numRows <= 0)
+		return;
+	if(dstStride == rowBytes && srcStride == rowBytes) {
+		// Strides match, fast copy
+		memcpy(dst, src, rowBytes * numRows);
+		return;
+	}
+
+	// Strides don't match, copy each line separately
+	for(int y = 0; y < numRows; y++) {
+		quint8 *d = dst + y * dstStride;
+		const quint8 *s = src + y * srcStride;
+		int left = rowBytes;
+
+		// Stream stores require an aligned destination
+		int head = (int)((16 - ((quintptr)d & 15)) & 15);
+		if(head > left)
+			head = left;
+		if(head > 0) {
+			memcpy(d, s, head);
+			d += head;
+			s += head;
+			left -= head;
+		}
+		for(; left >= 64; left -= 64, d += 64, s += 64) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(s + 0));
+			__m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+			__m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+			__m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+			_mm_stream_si128((__m128i *)(d + 0), a);
+			_mm_stream_si128((__m128i *)(d + 16), b);
+			_mm_stream_si128((__m128i *)(d + 32), c);
+			_mm_stream_si128((__m128i *)(d + 48), e);
+		}
+		for(; left >= 16; left -= 16, d += 16, s += 16) {
+			_mm_stream_si128(
+				(__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+		}
+		if(left > 0)
+			memcpy(d, s, left);
+	}
+
+	// Make the stream stores visible before the texture is unmapped
+	_mm_sfence();
+}
+
 //=============================================================================
 // Texture class
 
+// Shared by all textures so that generation numbers are never reused. Atomic
+// as deferred contexts can create and render to textures on other threads.
+static QAtomicInt texGenerationCounter;
+
+static quint32 nextTexGeneration()
+{
+	return (quint32)texGenerationCounter.fetchAndAddOrdered(1) + 1;
+}
+
 /// <summary>
 /// WARNING: Create with `GraphicsContext::createTexture()` only!
 /// </summary>
@@ -697,6 +956,7 @@ Texture::Texture(VidgfxTexFlags flags, const QSize &size)
 	, m_size(size)
 	, m_stride(0)
 	, m_isValid(false)
+	, m_generation(nextTexGeneration())
 {
 }
 
@@ -704,6 +964,16 @@ Texture::~Texture()
 {
 }
 
+/// <summary>
+/// Notifies caches that the texel data of this texture has changed. This is
+/// called automatically when the texture is unmapped, copied to or rendered
+/// to but must be called manually if the texture is modified externally.
+/// </summary>
+void Texture::markModified()
+{
+	m_generation = nextTexGeneration();
+}
+
 /// <summary>
 /// Maps the texture and copies the pixel data from the `QImage` to it if the
 /// texture is writable.
@@ -717,25 +987,350 @@ void Texture::updateData(const QImage &img)
 		return;
 
 	// TODO: We always assume each pixel is 32-bit
-	// TODO: There is a chance of overflowing if the image size changes
-	//       between frames
-	// TODO: Use the same copy function as the scaler?
+	// Clamp to the texture size in case the image size changed between frames
 	int stride = getStride();
-	int texLen = stride * getSize().height();
-	if(stride == img.width() * 4) {
-		// Stride matches, fast copy
-		texLen = qMin(texLen, img.byteCount());
-		memcpy(data, img.constBits(), texLen);
-	} else {
-		// Stride doesn't match, copy each line separately
-		texLen = qMin(texLen, img.width() * 4);
-		for(int i = 0; i < img.height(); i++) {
-			char *cData = reinterpret_cast<char *>(data);
-			memcpy(cData + i * stride, img.constScanLine(i), texLen);
+	int rowBytes = qMin(img.width() * 4, stride);
+	int numRows = qMin(img.height(), getHeight());
+	copyPlane(
+		reinterpret_cast<quint8 *>(data), stride, img.constBits(),
+		img.bytesPerLine(), rowBytes, numRows);
+
+	unmap();
+}
+
+/// <summary>
+/// Uploads the raw planes of a `size` frame of the specified pixel format
+/// directly into the writable textures that `convertToBgrx()` expects without
+/// having to build a `QImage` first. `planes` and `strides` must have an entry
+/// for each plane of the format. Textures are only written to if every plane
+/// fits within its texture.
+/// </summary>
+/// <returns>True if all planes were uploaded</returns>
+bool Texture::updatePlanes(
+	VidgfxPixFormat format, const QSize &size, const quint8 * const planes[],
+	const int strides[], Texture *texA, Texture *texB, Texture *texC)
+{
+	if(planes == NULL || strides == NULL || size.isEmpty())
+		return false;
+
+	// Determine the number of bytes per row and number of rows of each plane.
+	// Planes are uploaded into RGBA textures except for the interleaved UV
+	// plane of NV12 which uses an R8G8 texture (See `createRgTexture()`).
+	int numPlanes = 0;
+	int rowBytes[3];
+	int numRows[3];
+	int texelBytes[3] = { 4, 4, 4 };
+	int w = size.width();
+	int h = size.height();
+	switch(format) {
+	default:
+		return false;
+	case GfxRGB32Format:
+	case GfxARGB32Format:
+		numPlanes = 1;
+		rowBytes[0] = w * 4;
+		numRows[0] = h;
+		break;
+	case GfxYV12Format:
+	case GfxIYUVFormat:
+		numPlanes = 3;
+		rowBytes[0] = w;
+		numRows[0] = h;
+		rowBytes[1] = rowBytes[2] = w / 2;
+		numRows[1] = numRows[2] = h / 2;
+		break;
+	case GfxNV12Format:
+		numPlanes = 2;
+		rowBytes[0] = w;
+		numRows[0] = h;
+		rowBytes[1] = w; // Interleaved UV
+		numRows[1] = h / 2;
+		texelBytes[1] = 2;
+		break;
+	case GfxUYVYFormat:
+	case GfxHDYCFormat:
+	case GfxYUY2Format:
+		numPlanes = 1;
+		rowBytes[0] = w * 2;
+		numRows[0] = h;
+		break;
+	}
+
+	// Validate all planes before writing anything
+	Texture *texs[3] = { texA, texB, texC };
+	for(int i = 0; i < numPlanes; i++) {
+		if(texs[i] == NULL || !texs[i]->isWritable() || planes[i] == NULL)
+			return false;
+		if(strides[i] < rowBytes[i])
+			return false;
+		if(texs[i]->getWidth() * texelBytes[i] < rowBytes[i])
+			return false; // Texture is too narrow for the plane
+		if(texs[i]->getHeight() < numRows[i])
+			return false;
+	}
+
+	// Map and copy each plane
+	for(int i = 0; i < numPlanes; i++) {
+		Texture *tex = texs[i];
+		void *data = tex->map();
+		if(data == NULL)
+			return false;
+		copyPlane(
+			reinterpret_cast<quint8 *>(data), tex->getStride(), planes[i],
+			strides[i], rowBytes[i], numRows[i]);
+		tex->unmap();
+	}
+
+	return true;
+}
+
+//=============================================================================
+// ReadbackQueue class
+
+ReadbackQueue::ReadbackQueue(const QSize &size, int depth)
+	: m_size(size)
+	, m_depth(qMax(1, depth))
+	, m_numPending(0)
+	, m_hasDequeued(false)
+{
+}
+
+ReadbackQueue::~ReadbackQueue()
+{
+}
+
+//=============================================================================
+// SpriteBatch class
+
+SpriteBatch::SpriteBatch(GraphicsContext *context, int maxQuads)
+	: m_context(context)
+	, m_vertBuf(NULL)
+	, m_maxQuads(qMax(1, maxQuads))
+	, m_sortingAllowed(false)
+	, m_quads()
+
+	// Statistics
+	, m_numQuadsDrawn(0)
+	, m_numBatchesDrawn(0)
+	, m_numFlushes(0)
+{
+	m_quads.reserve(m_maxQuads);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	if(m_vertBuf != NULL)
+		deleteVertBuf();
+}
+
+void SpriteBatch::deleteVertBuf()
+{
+	if(m_vertBuf == NULL)
+		return;
+	if(m_context == NULL || !m_context->isValid())
+		return;
+	m_context->deleteVertexBuffer(m_vertBuf);
+	m_vertBuf = NULL;
+}
+
+/// <summary>
+/// Queues a filled rectangle that is rendered with `GfxSolidShader`.
+/// </summary>
+void SpriteBatch::addSolidRect(
+	const QRectF &rect, const QColor &col, VidgfxBlending blending)
+{
+	Quad quad;
+	quad.shader = GfxSolidShader;
+	quad.tex = NULL;
+	quad.blending = blending;
+	quad.filter = GfxPointFilter; // Unused
+	quad.color = col;
+	quad.rect = rect;
+	m_quads.append(quad);
+}
+
+/// <summary>
+/// Queues a textured rectangle. `shader` must be one of the tex-decal shaders
+/// and `modColor` is used as the tex-decal modulation colour (See
+/// `GraphicsContext::setTexDecalModColor()`).
+/// </summary>
+void SpriteBatch::addTexDecalRect(
+	Texture *tex, const QRectF &rect, const QPointF &tlUv,
+	const QPointF &brUv, VidgfxShader shader, VidgfxBlending blending,
+	VidgfxFilter filter, const QColor &modColor)
+{
+	if(tex == NULL)
+		return;
+	Quad quad;
+	quad.shader = shader;
+	quad.tex = tex;
+	quad.blending = blending;
+	quad.filter = filter;
+	quad.color = modColor;
+	quad.rect = rect;
+	quad.tlUv = tlUv;
+	quad.brUv = brUv;
+	m_quads.append(quad);
+}
+
+/// <summary>
+/// Renders all queued rectangles to the current render target using the
+/// current matrices and then clears the queue. Consecutive rectangles that
+/// share the same shader, texture, blending, filter and modulation colour are
+/// rendered with a single draw call. The tex-decal modulation colour of the
+/// context is restored afterwards.
+/// </summary>
+void SpriteBatch::flush()
+{
+	if(m_quads.isEmpty())
+		return;
+	if(m_context == NULL || !m_context->isValid()) {
+		m_quads.clear();
+		return;
+	}
+	if(m_vertBuf == NULL) {
+		m_vertBuf = m_context->createVertexBuffer(
+			m_maxQuads * NumFloatsPerQuad);
+		if(m_vertBuf == NULL) {
+			m_quads.clear();
+			return;
 		}
 	}
 
-	unmap();
+	// Group rectangles with the same state together if we are allowed to
+	if(m_sortingAllowed)
+		qStableSort(m_quads.begin(), m_quads.end(), stateLessThan);
+
+	QColor origModColor = m_context->getTexDecalModColor();
+	m_context->setTopology(GfxTriangleListTopology);
+	m_numFlushes++;
+
+	// Fill the vertex buffer as many times as required
+	const Quad *prevState = NULL;
+	int start = 0;
+	while(start < m_quads.size()) {
+		int num = qMin(m_maxQuads, m_quads.size() - start);
+
+		// Write vertex data
+		float *data = m_vertBuf->getDataPtr();
+		int i = 0;
+		for(int j = 0; j < num; j++)
+			i = writeQuad(data, i, m_quads.at(start + j));
+		m_vertBuf->setVertSize(8);
+		m_vertBuf->setNumVerts(num * NumVertsPerQuad);
+		m_vertBuf->setDirty();
+
+		// Render each batch with a single draw call
+		int batchStart = 0;
+		while(batchStart < num) {
+			const Quad &quad = m_quads.at(start + batchStart);
+			int batchEnd = batchStart + 1;
+			while(batchEnd < num &&
+				isSameState(quad, m_quads.at(start + batchEnd)))
+			{
+				batchEnd++;
+			}
+			if(prevState == NULL || !isSameState(*prevState, quad))
+				applyState(quad);
+			prevState = &quad;
+			m_context->drawBuffer(
+				m_vertBuf, (batchEnd - batchStart) * NumVertsPerQuad,
+				batchStart * NumVertsPerQuad);
+			m_numBatchesDrawn++;
+			batchStart = batchEnd;
+		}
+
+		m_numQuadsDrawn += num;
+		start += num;
+	}
+
+	m_context->setTexDecalModColor(origModColor);
+	m_quads.clear();
+}
+
+void SpriteBatch::resetStats()
+{
+	m_numQuadsDrawn = 0;
+	m_numBatchesDrawn = 0;
+	m_numFlushes = 0;
+}
+
+bool SpriteBatch::isSameState(const Quad &a, const Quad &b)
+{
+	if(a.shader != b.shader || a.blending != b.blending)
+		return false;
+	if(a.shader == GfxSolidShader)
+		return true; // Colour is per-vertex
+	return a.tex == b.tex && a.filter == b.filter && a.color == b.color;
+}
+
+bool SpriteBatch::stateLessThan(const Quad &a, const Quad &b)
+{
+	if(a.shader != b.shader)
+		return a.shader < b.shader;
+	if(a.tex != b.tex)
+		return a.tex < b.tex;
+	if(a.blending != b.blending)
+		return a.blending < b.blending;
+	if(a.shader == GfxSolidShader)
+		return false;
+	if(a.filter != b.filter)
+		return a.filter < b.filter;
+	return a.color.rgba() < b.color.rgba();
+}
+
+/// <summary>
+/// Writes the two triangles of the rectangle to `data` starting at float
+/// `i` using the vertex format of the rectangle's shader.
+/// </summary>
+/// <returns>The index of the next float after the written vertices.</returns>
+int SpriteBatch::writeQuad(float *data, int i, const Quad &quad) const
+{
+	const QRectF &rect = quad.rect;
+	qreal ax[NumVertsPerQuad] = {
+		rect.left(), rect.right(), rect.left(),
+		rect.right(), rect.right(), rect.left() };
+	qreal ay[NumVertsPerQuad] = {
+		rect.top(), rect.top(), rect.bottom(),
+		rect.top(), rect.bottom(), rect.bottom() };
+	qreal au[NumVertsPerQuad] = {
+		quad.tlUv.x(), quad.brUv.x(), quad.tlUv.x(),
+		quad.brUv.x(), quad.brUv.x(), quad.tlUv.x() };
+	qreal av[NumVertsPerQuad] = {
+		quad.tlUv.y(), quad.tlUv.y(), quad.brUv.y(),
+		quad.tlUv.y(), quad.brUv.y(), quad.brUv.y() };
+
+	for(int v = 0; v < NumVertsPerQuad; v++) {
+		data[i++] = ax[v];
+		data[i++] = ay[v];
+		data[i++] = 0.0f;
+		data[i++] = 1.0f;
+		if(quad.shader == GfxSolidShader) {
+			// Shader expects vertex format: X, Y, Z, -, R, G, B, A
+			data[i++] = quad.color.redF();
+			data[i++] = quad.color.greenF();
+			data[i++] = quad.color.blueF();
+			data[i++] = quad.color.alphaF();
+		} else {
+			// Shader expects vertex format: X, Y, Z, -, U, V, -, -
+			data[i++] = au[v];
+			data[i++] = av[v];
+			data[i++] = 0.0f;
+			data[i++] = 0.0f;
+		}
+	}
+	return i;
+}
+
+void SpriteBatch::applyState(const Quad &quad)
+{
+	m_context->setShader(quad.shader);
+	m_context->setBlending(quad.blending);
+	if(quad.shader == GfxSolidShader)
+		return;
+	m_context->setTexture(quad.tex);
+	m_context->setTextureFilter(quad.filter);
+	m_context->setTexDecalModColor(quad.color);
 }
 
 //=============================================================================
@@ -752,7 +1347,7 @@ GraphicsContext::GraphicsContext()
 	, m_scratchProjMat()
 	, m_userViewMat()
 	, m_userProjMat()
-	, m_cameraConstantsDirty(false)
+	//, m_cameraVersions() // Done below
 	//, m_userTargets() // Done below
 	, m_userTargetViewport(0, 0, 0, 0)
 	, m_resizeRect()
@@ -762,9 +1357,17 @@ GraphicsContext::GraphicsContext()
 	, m_texDecalModulate(255, 255, 255, 255)
 	//, m_texDecalEffects() // Done below
 	, m_texDecalConstantsDirty(false)
+	, m_texDecalSrgb(false)
+	, m_canvasDamage()
+	//, m_canvasStale()
+	, m_latestCanvas(-1)
+	, m_redrawCanvas(-1)
+	, m_redrawRect()
 	, m_initializedCallbackList()
 	, m_destroyingCallbackList()
 {
+	memset(m_cameraVersions, 0, sizeof(m_cameraVersions));
+
 	m_userTargets[0] = NULL;
 	m_userTargets[1] = NULL;
 
@@ -981,6 +1584,117 @@ bool GraphicsContext::createTexDecalRect(
 	return true;
 }
 
+/// <summary>
+/// Writes a textured rectangle to instance `instance` of a per-instance buffer
+/// that can be rendered with `drawInstanced()` and any of the texture decal
+/// shaders. The rectangle is split at `scrollOffset` (In `rect` space, 0..1)
+/// by the vertex shader in the same way as a scrolling `TexDecalVertBuf`.
+/// Flipped or mirrored textures are represented by swapped UV coordinates.
+/// Writing instance 0 resets the number of instances in the buffer to one.
+/// </summary>
+/// <returns>True if the buffer is valid.</returns>
+bool GraphicsContext::createTexDecalInstance(
+	VertexBuffer *outBuf, int instance, const QRectF &rect,
+	const QPointF &tlUv, const QPointF &brUv, const QPointF &scrollOffset)
+{
+	if(outBuf == NULL || instance < 0)
+		return false;
+	if(outBuf->getNumFloats() < (instance + 1) * InstanceNumFloats)
+		return false;
+	if(instance == 0)
+		outBuf->setNumVerts(1);
+	else
+		outBuf->setNumVerts(qMax(outBuf->getNumVerts(), instance + 1));
+
+	// Shader expects instance format: L, T, R, B, U1, V1, U2, V2, -, -, -, -,
+	// ScrollX, ScrollY, -, -
+	outBuf->setVertSize(InstanceNumFloats);
+	float *data = &(outBuf->getDataPtr()[instance * InstanceNumFloats]);
+	int i = 0;
+
+	// Rectangle
+	data[i++] = rect.left();
+	data[i++] = rect.top();
+	data[i++] = rect.right();
+	data[i++] = rect.bottom();
+
+	// Texture UV
+	data[i++] = tlUv.x();
+	data[i++] = tlUv.y();
+	data[i++] = brUv.x();
+	data[i++] = brUv.y();
+
+	// Colour, unused
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+
+	// Scroll offset, keep within [0..1) so that the pieces don't overlap
+	data[i++] = dblRepeat(scrollOffset.x(), 1.0);
+	data[i++] = dblRepeat(scrollOffset.y(), 1.0);
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+
+	outBuf->setDirty(true);
+	return true;
+}
+
+/// <summary>
+/// Writes a rectangle outline with a single solid colour to instance
+/// `instance` of a per-instance buffer that can be rendered with
+/// `drawInstanced()` and `GfxSolidShader`. The outline is identical to the
+/// one of `createSolidRectOutline()`. Writing instance 0 resets the number of
+/// instances in the buffer to one.
+/// </summary>
+/// <returns>True if the buffer is valid.</returns>
+bool GraphicsContext::createSolidRectOutlineInstance(
+	VertexBuffer *outBuf, int instance, const QRectF &rect,
+	const QColor &col, const QPointF &halfWidth)
+{
+	if(outBuf == NULL || instance < 0)
+		return false;
+	if(outBuf->getNumFloats() < (instance + 1) * InstanceNumFloats)
+		return false;
+	if(instance == 0)
+		outBuf->setNumVerts(1);
+	else
+		outBuf->setNumVerts(qMax(outBuf->getNumVerts(), instance + 1));
+
+	// Shader expects instance format: L, T, R, B, -, -, -, -, R, G, B, A,
+	// HalfWidthX, HalfWidthY, -, -
+	outBuf->setVertSize(InstanceNumFloats);
+	float *data = &(outBuf->getDataPtr()[instance * InstanceNumFloats]);
+	int i = 0;
+
+	// Rectangle
+	data[i++] = rect.left();
+	data[i++] = rect.top();
+	data[i++] = rect.right();
+	data[i++] = rect.bottom();
+
+	// Texture UV, unused
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+
+	// Colour
+	data[i++] = col.redF();
+	data[i++] = col.greenF();
+	data[i++] = col.blueF();
+	data[i++] = col.alphaF();
+
+	// Line width
+	data[i++] = halfWidth.x();
+	data[i++] = halfWidth.y();
+	data[i++] = 0.0f;
+	data[i++] = 0.0f;
+
+	outBuf->setDirty(true);
+	return true;
+}
+
 /// <summary>
 /// Fills a `VertexBuffer` with the required data to draw a the rectangle
 /// outline and handles of the resize layer graphic. Designed to be rendered
@@ -1050,6 +1764,28 @@ quint32 GraphicsContext::nextPowTwo(quint32 n)
 	return n;
 }
 
+/// <summary>
+/// Returns the set of camera matrices that is used by the specified render
+/// target.
+/// </summary>
+GraphicsContext::CameraSet GraphicsContext::getCameraSet(
+	VidgfxRendTarget target)
+{
+	switch(target) {
+	default:
+	case GfxScreenTarget:
+		return ScreenCameraSet;
+	case GfxCanvas1Target:
+	case GfxCanvas2Target:
+		return CanvasCameraSet;
+	case GfxScratch1Target:
+	case GfxScratch2Target:
+		return ScratchCameraSet;
+	case GfxUserTarget:
+		return UserCameraSet;
+	}
+}
+
 /// <summary>
 /// Set the view matrix for the currently selected render target.
 /// WARNING: Unlike the others the user target matrices are shared between
@@ -1062,24 +1798,24 @@ void GraphicsContext::setViewMatrix(const QMatrix4x4 &matrix)
 	default:
 	case GfxScreenTarget:
 		if(m_screenViewMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[ScreenCameraSet]++;
 		m_screenViewMat = matrix;
 		break;
 	case GfxCanvas1Target:
 	case GfxCanvas2Target:
 		if(m_canvasViewMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[CanvasCameraSet]++;
 		m_canvasViewMat = matrix;
 		break;
 	case GfxScratch1Target:
 	case GfxScratch2Target:
 		if(m_scratchViewMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[ScratchCameraSet]++;
 		m_scratchViewMat = matrix;
 		break;
 	case GfxUserTarget:
 		if(m_userViewMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[UserCameraSet]++;
 		m_userViewMat = matrix;
 		break;
 	}
@@ -1117,24 +1853,24 @@ void GraphicsContext::setProjectionMatrix(const QMatrix4x4 &matrix)
 	default:
 	case GfxScreenTarget:
 		if(m_screenProjMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[ScreenCameraSet]++;
 		m_screenProjMat = matrix;
 		break;
 	case GfxCanvas1Target:
 	case GfxCanvas2Target:
 		if(m_canvasProjMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[CanvasCameraSet]++;
 		m_canvasProjMat = matrix;
 		break;
 	case GfxScratch1Target:
 	case GfxScratch2Target:
 		if(m_scratchProjMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[ScratchCameraSet]++;
 		m_scratchProjMat = matrix;
 		break;
 	case GfxUserTarget:
 		if(m_userProjMat != matrix)
-			m_cameraConstantsDirty = true;
+			m_cameraVersions[UserCameraSet]++;
 		m_userProjMat = matrix;
 		break;
 	}
@@ -1166,8 +1902,8 @@ QMatrix4x4 GraphicsContext::getProjectionMatrix() const
 /// </summary>
 void GraphicsContext::setScreenViewMatrix(const QMatrix4x4 &matrix)
 {
-	if(m_currentTarget == GfxScreenTarget && m_screenViewMat != matrix)
-		m_cameraConstantsDirty = true;
+	if(m_screenViewMat != matrix)
+		m_cameraVersions[ScreenCameraSet]++;
 	m_screenViewMat = matrix;
 }
 
@@ -1186,8 +1922,8 @@ QMatrix4x4 GraphicsContext::getScreenViewMatrix() const
 /// </summary>
 void GraphicsContext::setScreenProjectionMatrix(const QMatrix4x4 &matrix)
 {
-	if(m_currentTarget == GfxScreenTarget && m_screenProjMat != matrix)
-		m_cameraConstantsDirty = true;
+	if(m_screenProjMat != matrix)
+		m_cameraVersions[ScreenCameraSet]++;
 	m_screenProjMat = matrix;
 }
 
@@ -1328,16 +2064,57 @@ bool GraphicsContext::diluteImage(QImage &img) const
 	// The maximum distance from the pixel to search for colour information
 	const int MAX_DILUTION = 2;
 
-	bool modified = false;
-	for(int y = 0; y < h; y++) {
-		for(int x = 0; x < w; x++) {
-			QRgb pix = img.pixel(x, y);
-			if(qAlpha(pix) == 0) {
-				if(dilutePixel(img, imgOut, x, y, MAX_DILUTION))
-					modified = true;
-			}
+	// Images that are not 32-bit ARGB are searched in the pixel values that
+	// `QImage::pixel()` returns for them so that the result doesn't depend on
+	// how the image was stored. Premultiplied images must be unpremultiplied
+	// as otherwise darkened colours are copied into the transparent pixels of
+	// the straight alpha output.
+	QImage pixels;
+	if(img.format() == QImage::Format_ARGB32) {
+		pixels = img;
+	} else if(img.format() == QImage::Format_ARGB32_Premultiplied) {
+		pixels = img.convertToFormat(QImage::Format_ARGB32);
+	} else {
+		pixels = QImage(w, h, QImage::Format_ARGB32);
+		for(int y = 0; y < h; y++) {
+			QRgb *row = (QRgb *)pixels.scanLine(y);
+			for(int x = 0; x < w; x++)
+				row[x] = img.pixel(x, y);
+		}
+	}
+
+	// Distribute chunks of rows over the global thread pool if the image is
+	// large enough for it to be worth it
+	const int ROWS_PER_CHUNK = 64;
+	const int MIN_PIXELS_PER_THREAD = 256 * 1024;
+	DiluteJob job;
+	job.src = (const QRgb *)pixels.constBits();
+	job.srcStride = pixels.bytesPerLine() / sizeof(QRgb);
+	job.dst = (QRgb *)imgOut.bits();
+	job.dstStride = imgOut.bytesPerLine() / sizeof(QRgb);
+	job.width = w;
+	job.height = h;
+	job.dMax = MAX_DILUTION;
+	job.rowsPerChunk = ROWS_PER_CHUNK;
+	job.numChunks = (h + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK;
+	int numThreads = qMin(
+		QThread::idealThreadCount(), w * h / MIN_PIXELS_PER_THREAD);
+	numThreads = qMin(numThreads, job.numChunks);
+	QVector<DiluteTask *> tasks;
+	for(int i = 1; i < numThreads; i++) {
+		// Only use threads that are available right now so that we never wait
+		// on a task that hasn't started
+		DiluteTask *task = new DiluteTask(&job);
+		if(!QThreadPool::globalInstance()->tryStart(task)) {
+			delete task;
+			break;
 		}
+		tasks.append(task);
 	}
+	processDiluteJob(&job);
+	job.numFinished.acquire(tasks.size());
+	qDeleteAll(tasks);
+	bool modified = (job.modified.load() != 0);
 
 	if(modified) {
 		// Merge our images together. We cannot use `QPainter::drawImage()` as
@@ -1345,6 +2122,7 @@ bool GraphicsContext::diluteImage(QImage &img) const
 
 		// We can only safely cast scan lines to `QRgb` if we are using a
 		// 32-bit pixel format
+		pixels = QImage(); // Release our reference so `img` needs no copy
 		if(img.format() != QImage::Format_ARGB32)
 			img = img.convertToFormat(QImage::Format_ARGB32);
 
@@ -1361,6 +2139,148 @@ bool GraphicsContext::diluteImage(QImage &img) const
 	return true;
 }
 
+/// <summary>
+/// Returns 0 or 1 for the two canvas targets or -1 for any other target.
+/// </summary>
+int GraphicsContext::getCanvasIndex(VidgfxRendTarget target)
+{
+	switch(target) {
+	case GfxCanvas1Target:
+		return 0;
+	case GfxCanvas2Target:
+		return 1;
+	default:
+		return -1;
+	}
+}
+
+/// <summary>
+/// Marks an area of the canvas in canvas pixels as changed since the last
+/// canvas frame. Usually called with both the old and new bounding rectangle
+/// of every layer that changed.
+/// </summary>
+void GraphicsContext::addCanvasDamage(const QRect &rect)
+{
+	m_canvasDamage += rect;
+}
+
+/// <summary>
+/// Marks the entire canvas as changed.
+/// </summary>
+void GraphicsContext::addCanvasDamage()
+{
+	Texture *canvas = getTargetTexture(GfxCanvas1Target);
+	if(canvas != NULL)
+		addCanvasDamage(QRect(QPoint(0, 0), canvas->getSize()));
+}
+
+/// <summary>
+/// Prepares the specified canvas target for a partial redraw of the damage
+/// added with `addCanvasDamage()`. Selects the canvas as the render target and
+/// limits rendering to the area returned by `getCanvasRedrawRect()` which the
+/// caller must then redraw completely. The limit only applies while the canvas
+/// is the current render target so internal passes that render to scratch or
+/// user targets in between are unaffected. If `carryOver` is true and the other
+/// canvas contains the previous frame then areas that only changed in earlier
+/// frames are copied from it instead of being redrawn.
+///
+/// The canvas must only be rendered to between this method and
+/// `endCanvasRedraw()` as otherwise the tracking becomes invalid. Note that
+/// `clear()` is not limited to the redraw area.
+/// </summary>
+/// <returns>False if the canvas already contains the latest frame in which
+/// case `endCanvasRedraw()` must not be called.</returns>
+bool GraphicsContext::beginCanvasRedraw(
+	VidgfxRendTarget target, bool carryOver)
+{
+	int index = getCanvasIndex(target);
+	if(index < 0 || m_redrawCanvas >= 0)
+		return false; // Not a canvas or already redrawing
+	Texture *canvas = getTargetTexture(target);
+	if(canvas == NULL)
+		return false;
+	QRect canvasRect(QPoint(0, 0), canvas->getSize());
+
+	// Copy the areas that are stale but didn't change in this frame from the
+	// previous frame, this is a lot cheaper than rendering them
+	QRegion redraw = m_canvasStale[index] + m_canvasDamage;
+	int other = 1 - index;
+	if(carryOver && m_latestCanvas == other) {
+		Texture *otherCanvas = getTargetTexture(
+			other == 0 ? GfxCanvas1Target : GfxCanvas2Target);
+		QVector<QRect> rects =
+			((m_canvasStale[index] - m_canvasDamage) & canvasRect).rects();
+		bool copied = (otherCanvas != NULL);
+		for(int i = 0; copied && i < rects.size(); i++) {
+			const QRect &rect = rects.at(i);
+			copied = copyTextureData(canvas, otherCanvas, rect.topLeft(), rect);
+		}
+		if(copied) {
+			m_canvasStale[index] &= m_canvasDamage;
+			redraw = m_canvasDamage;
+		}
+	}
+
+	m_redrawRect = (redraw & canvasRect).boundingRect();
+	if(m_redrawRect.isEmpty()) {
+		// Only the copies were required
+		m_canvasStale[index] = QRegion();
+		m_redrawRect = QRect();
+		return false;
+	}
+	m_redrawCanvas = index;
+	setRenderTarget(target); // Applies `getRedrawScissorRect()`
+	return true;
+}
+
+/// <summary>
+/// Completes the redraw that was started with `beginCanvasRedraw()`. The
+/// redrawn canvas becomes the latest frame and the damage is cleared.
+/// </summary>
+void GraphicsContext::endCanvasRedraw()
+{
+	if(m_redrawCanvas < 0)
+		return; // Not redrawing
+
+	// The other canvas is now missing the changes of this frame
+	m_canvasStale[1 - m_redrawCanvas] += m_canvasDamage;
+	m_canvasStale[m_redrawCanvas] = QRegion();
+	m_canvasDamage = QRegion();
+	m_latestCanvas = m_redrawCanvas;
+	m_redrawCanvas = -1;
+	m_redrawRect = QRect();
+
+	// Rebind the canvas to remove the redraw scissor rectangle
+	if(getCanvasIndex(m_currentTarget) >= 0)
+		setRenderTarget(m_currentTarget);
+}
+
+/// <summary>
+/// Returns the area that rendering must be limited to because of a partial
+/// canvas redraw or a null rectangle if the current render target isn't the
+/// canvas that is being redrawn. Implementations must apply this whenever the
+/// render target is selected.
+/// </summary>
+QRect GraphicsContext::getRedrawScissorRect() const
+{
+	if(m_redrawCanvas < 0 || getCanvasIndex(m_currentTarget) != m_redrawCanvas)
+		return QRect();
+	return m_redrawRect;
+}
+
+/// <summary>
+/// Marks both canvases as completely stale. Called by the implementation
+/// whenever the canvas textures are recreated.
+/// </summary>
+void GraphicsContext::resetCanvasDamage(const QSize &canvasSize)
+{
+	QRect canvasRect(QPoint(0, 0), canvasSize);
+	m_canvasDamage = QRegion();
+	m_canvasStale[0] = canvasRect;
+	m_canvasStale[1] = canvasRect;
+	m_latestCanvas = -1;
+}
+
 void GraphicsContext::callInitializedCallbacks()
 {
 	for(int i = 0; i < m_initializedCallbackList.size(); i++) {
@@ -22,6 +22,7 @@
 #include <QtCore/QObject>
 #include <QtGui/QColor>
 #include <QtGui/QMatrix4x4>
+#include <QtGui/QRegion>
 
 class GraphicsContext;
 class QRectF;
@@ -117,7 +118,9 @@ private: // Constants ---------------------------------------------------------
 protected: // Members ---------------------------------------------------------
 	GraphicsContext *	m_context;
 	VertexBuffer *		m_vertBuf;
+	VertexBuffer *		m_instBuf; // Scrolling with instancing only
 	bool				m_dirty;
+	bool				m_instDirty;
 	bool				m_hasScrolling;
 
 	// Position
@@ -141,6 +144,8 @@ public: // Methods ------------------------------------------------------------
 	void			setContext(GraphicsContext *context);
 	VertexBuffer *	getVertBuf(); // Applies settings
 	VidgfxTopology	getTopology() const;
+	VertexBuffer *	getInstanceBuf(); // Applies settings
+	void			draw();
 	void			deleteVertBuf();
 
 	// Position
@@ -168,6 +173,8 @@ public: // Methods ------------------------------------------------------------
 		QPointF *botRight) const;
 
 private:
+	bool	canUseInstancing() const;
+	QPointF	getRoundedScrollOffset() const;
 	bool	createScrollTexDecalRect(VertexBuffer *outBuf);
 	int		writeScrollRect(
 		float *data, int i, const QRectF &rect, const QPointF &tlUv,
@@ -210,6 +217,7 @@ protected: // Members ---------------------------------------------------------
 	void *			m_mappedData;
 	QSize			m_size;
 	int				m_stride;
+	quint32			m_generation;
 
 protected: // Constructor/destructor ------------------------------------------
 	Texture(VidgfxTexFlags flags, const QSize &size);
@@ -227,8 +235,14 @@ public: // Methods ------------------------------------------------------------
 	QSize			getSize() const;
 	int				getWidth() const;
 	int				getHeight() const;
+	quint32			getGeneration() const;
+	void			markModified();
 
 	void			updateData(const QImage &img);
+	static bool		updatePlanes(
+		VidgfxPixFormat format, const QSize &size,
+		const quint8 * const planes[], const int strides[], Texture *texA,
+		Texture *texB = NULL, Texture *texC = NULL);
 
 public: // Interface ----------------------------------------------------------
 	virtual void *	map() = 0;
@@ -258,6 +272,16 @@ inline int Texture::getStride() const
 	return m_stride;
 }
 
+/// <summary>
+/// Returns a number that changes every time that the texel data of this
+/// texture is modified. The number is unique across all textures so it is
+/// safe to compare values after a texture has been deleted and recreated.
+/// </summary>
+inline quint32 Texture::getGeneration() const
+{
+	return m_generation;
+}
+
 inline bool Texture::isWritable() const
 {
 	return m_flags & GfxWritableFlag;
@@ -288,6 +312,187 @@ inline int Texture::getHeight() const
 	return m_size.height();
 }
 
+//=============================================================================
+/// <summary>
+/// A ring of staging textures that allows pixel data to be read back from the
+/// graphics hardware without stalling the CPU. Frames are copied into the ring
+/// with `enqueue()` and are only made available with `tryDequeue()` once the
+/// graphics hardware has actually finished processing the copy. With a depth
+/// of 3 the CPU reads back frame N-2 while the GPU is rendering frame N.
+/// </summary>
+class ReadbackQueue
+{
+protected: // Members ---------------------------------------------------------
+	QSize	m_size;
+	int		m_depth;
+	int		m_numPending;
+	bool	m_hasDequeued;
+
+protected: // Constructor/destructor ------------------------------------------
+	ReadbackQueue(const QSize &size, int depth);
+	virtual ~ReadbackQueue();
+
+public: // Methods ------------------------------------------------------------
+	QSize			getSize() const;
+	int				getDepth() const;
+	int				getNumPending() const;
+	bool			isFull() const;
+
+public: // Interface ----------------------------------------------------------
+	virtual bool		isValid() const = 0;
+	virtual bool		enqueue(
+		Texture *src, const QPoint &srcPos = QPoint(0, 0)) = 0;
+	virtual Texture *	tryDequeue() = 0;
+	virtual void		releaseDequeued() = 0;
+};
+//=============================================================================
+
+inline QSize ReadbackQueue::getSize() const
+{
+	return m_size;
+}
+
+inline int ReadbackQueue::getDepth() const
+{
+	return m_depth;
+}
+
+inline int ReadbackQueue::getNumPending() const
+{
+	return m_numPending;
+}
+
+/// <summary>
+/// Returns true if every slot in the ring is in use. This includes the slot of
+/// the frame that was returned by `tryDequeue()` until it is released.
+/// </summary>
+inline bool ReadbackQueue::isFull() const
+{
+	return m_numPending + (m_hasDequeued ? 1 : 0) >= m_depth;
+}
+
+//=============================================================================
+/// <summary>
+/// Accumulates solid and tex-decal rectangles and renders all rectangles that
+/// share the same render state with a single draw call from one shared
+/// vertex buffer. It is up to the user to either call `deleteVertBuf()` or
+/// delete the whole object when the graphics context is released.
+/// </summary>
+class SpriteBatch
+{
+public: // Constants ----------------------------------------------------------
+
+	// 2 triangles of 3 vertices where each vertex is 8 floats
+	static const int	NumVertsPerQuad = 6;
+	static const int	NumFloatsPerQuad = NumVertsPerQuad * 8;
+
+private: // Datatypes ---------------------------------------------------------
+	struct Quad {
+		VidgfxShader	shader;
+		Texture *		tex;
+		VidgfxBlending	blending;
+		VidgfxFilter	filter;
+		QColor			color; // Vertex colour or tex-decal modulation
+		QRectF			rect;
+		QPointF			tlUv;
+		QPointF			brUv;
+	};
+
+protected: // Members ---------------------------------------------------------
+	GraphicsContext *	m_context;
+	VertexBuffer *		m_vertBuf;
+	int					m_maxQuads;
+	bool				m_sortingAllowed;
+	QVector<Quad>		m_quads;
+
+	// Statistics
+	quint32				m_numQuadsDrawn;
+	quint32				m_numBatchesDrawn;
+	quint32				m_numFlushes;
+
+public: // Constructor/destructor ---------------------------------------------
+	SpriteBatch(GraphicsContext *context = NULL, int maxQuads = 256);
+	virtual ~SpriteBatch();
+
+public: // Methods ------------------------------------------------------------
+	void	setContext(GraphicsContext *context);
+	void	deleteVertBuf();
+
+	void	setSortingAllowed(bool allowed);
+	bool	isSortingAllowed() const;
+
+	void	addSolidRect(
+		const QRectF &rect, const QColor &col,
+		VidgfxBlending blending = GfxAlphaBlending);
+	void	addTexDecalRect(
+		Texture *tex, const QRectF &rect, const QPointF &tlUv,
+		const QPointF &brUv, VidgfxShader shader = GfxTexDecalShader,
+		VidgfxBlending blending = GfxAlphaBlending,
+		VidgfxFilter filter = GfxBilinearFilter,
+		const QColor &modColor = QColor(255, 255, 255));
+	int		getNumQueuedQuads() const;
+	void	clear();
+	void	flush();
+
+	// Statistics
+	quint32	getNumQuadsDrawn() const;
+	quint32	getNumBatchesDrawn() const;
+	quint32	getNumFlushes() const;
+	void	resetStats();
+
+private:
+	static bool	isSameState(const Quad &a, const Quad &b);
+	static bool	stateLessThan(const Quad &a, const Quad &b);
+	int			writeQuad(float *data, int i, const Quad &quad) const;
+	void		applyState(const Quad &quad);
+};
+//=============================================================================
+
+inline void SpriteBatch::setContext(GraphicsContext *context)
+{
+	m_context = context;
+}
+
+/// <summary>
+/// Allows `flush()` to reorder rectangles so that rectangles with the same
+/// render state are drawn together. Only enable this if the rectangles do not
+/// overlap or blending is disabled as it changes the painting order.
+/// </summary>
+inline void SpriteBatch::setSortingAllowed(bool allowed)
+{
+	m_sortingAllowed = allowed;
+}
+
+inline bool SpriteBatch::isSortingAllowed() const
+{
+	return m_sortingAllowed;
+}
+
+inline int SpriteBatch::getNumQueuedQuads() const
+{
+	return m_quads.size();
+}
+
+inline void SpriteBatch::clear()
+{
+	m_quads.clear();
+}
+
+inline quint32 SpriteBatch::getNumQuadsDrawn() const
+{
+	return m_numQuadsDrawn;
+}
+
+inline quint32 SpriteBatch::getNumBatchesDrawn() const
+{
+	return m_numBatchesDrawn;
+}
+
+inline quint32 SpriteBatch::getNumFlushes() const
+{
+	return m_numFlushes;
+}
+
 //=============================================================================
 class GraphicsContext : public QObject
 {
@@ -314,6 +519,17 @@ private: // Datatypes ---------------------------------------------------------
 	};
 	typedef QVector<DestroyingCallback> DestroyingCallbackList;
 
+protected:
+	// Render targets that share the same camera matrices
+	enum CameraSet {
+		ScreenCameraSet = 0,
+		CanvasCameraSet,
+		ScratchCameraSet,
+		UserCameraSet,
+
+		NUM_CAMERA_SETS // Must be last
+	};
+
 public: // Constants ----------------------------------------------------------
 
 	// The number of vertices required to represent one line
@@ -342,6 +558,11 @@ public: // Constants ----------------------------------------------------------
 	static const int	ResizeRectNumFloats = VIDGFX_RESIZE_RECT_NUM_FLOATS;
 	static const int	ResizeRectBufSize = VIDGFX_RESIZE_RECT_BUF_SIZE;
 
+	// Buffer information for `createTexDecalInstance()` and
+	// `createSolidRectOutlineInstance()` (1 instance = 16 floats)
+	static const int	InstanceNumFloats = VIDGFX_INSTANCE_NUM_FLOATS;
+	static const int	InstanceBufSize = VIDGFX_INSTANCE_BUF_SIZE;
+
 protected: // Members ---------------------------------------------------------
 	VidgfxRendTarget	m_currentTarget;
 
@@ -353,7 +574,7 @@ protected: // Members ---------------------------------------------------------
 	QMatrix4x4		m_scratchProjMat;
 	QMatrix4x4		m_userViewMat;
 	QMatrix4x4		m_userProjMat;
-	bool			m_cameraConstantsDirty;
+	quint32			m_cameraVersions[NUM_CAMERA_SETS]; // Bumped on change
 
 	Texture *		m_userTargets[2];
 	QRect			m_userTargetViewport;
@@ -367,6 +588,15 @@ protected: // Members ---------------------------------------------------------
 	QColor			m_texDecalModulate;
 	float			m_texDecalEffects[4]; // Gamma, brightness, contrast, saturation
 	bool			m_texDecalConstantsDirty;
+	bool			m_texDecalSrgb;
+
+	// Partial canvas redraw. A canvas is "stale" where it differs from the
+	// most recently completed canvas frame.
+	QRegion			m_canvasDamage; // Since the last canvas redraw
+	QRegion			m_canvasStale[2];
+	int				m_latestCanvas; // -1 = Neither canvas is complete
+	int				m_redrawCanvas; // -1 = Not redrawing
+	QRect			m_redrawRect;
 
 	InitializedCallbackList	m_initializedCallbackList;
 	DestroyingCallbackList	m_destroyingCallbackList;
@@ -398,9 +628,21 @@ public: // Static methods -----------------------------------------------------
 		VertexBuffer *outBuf, const QRectF &rect, float handleSize,
 		const QPointF &halfWidth = QPointF(0.5f, 0.5f));
 
+	static bool		createTexDecalInstance(
+		VertexBuffer *outBuf, int instance, const QRectF &rect,
+		const QPointF &tlUv, const QPointF &brUv,
+		const QPointF &scrollOffset = QPointF(0.0f, 0.0f));
+	static bool		createSolidRectOutlineInstance(
+		VertexBuffer *outBuf, int instance, const QRectF &rect,
+		const QColor &col, const QPointF &halfWidth = QPointF(0.5f, 0.5f));
+
 	// Helpers
 	static quint32	nextPowTwo(quint32 n);
 
+protected:
+	static CameraSet	getCameraSet(VidgfxRendTarget target);
+	static int			getCanvasIndex(VidgfxRendTarget target);
+
 public: // Constructor/destructor ---------------------------------------------
 	GraphicsContext();
 	virtual ~GraphicsContext();
@@ -421,6 +663,7 @@ public: // Methods ------------------------------------------------------------
 	void			setUserRenderTargetViewport(const QRect &rect);
 	void			setUserRenderTargetViewport(const QSize &size);
 	QRect			getUserRenderTargetViewport() const;
+	VidgfxRendTarget	getRenderTarget() const;
 
 	void			setResizeLayerRect(const QRectF &rect);
 	QRectF			getResizeLayerRect() const;
@@ -437,8 +680,22 @@ public: // Methods ------------------------------------------------------------
 		float gamma, int brightness, int contrast, int saturation);
 	const float *	getTexDecalEffects() const;
 
+	void			setTexDecalSrgb(bool decodeSrgb);
+	bool			getTexDecalSrgb() const;
+
 	bool			diluteImage(QImage &img) const;
 
+	void			addCanvasDamage(const QRect &rect);
+	void			addCanvasDamage();
+	bool			beginCanvasRedraw(
+		VidgfxRendTarget target, bool carryOver = true);
+	QRect			getCanvasRedrawRect() const;
+	void			endCanvasRedraw();
+
+protected:
+	void			resetCanvasDamage(const QSize &canvasSize);
+	QRect			getRedrawScissorRect() const;
+
 public: // Interface ----------------------------------------------------------
 	virtual bool	isValid() const = 0;
 	virtual void	flush() = 0;
@@ -455,10 +712,18 @@ public: // Interface ----------------------------------------------------------
 		const QSize &size, Texture *sameFormat, bool writable = false,
 		bool targetable = false) = 0;
 	virtual Texture *		createStagingTexture(const QSize &size) = 0;
+	virtual Texture *		createRgTexture(
+		const QSize &size, bool writable = false, bool targetable = false) = 0;
+	virtual void			setScaleCacheSize(int maxEntries) = 0;
+	virtual int				getScaleCacheSize() const = 0;
+	virtual void			purgeScaleCache() = 0;
 	virtual void			deleteTexture(Texture *tex) = 0;
 	virtual bool			copyTextureData(
 		Texture *dst, Texture *src, const QPoint &dstPos,
 		const QRect &srcRect) = 0;
+	virtual ReadbackQueue *	createReadbackQueue(
+		const QSize &size, int depth = 3) = 0;
+	virtual void			deleteReadbackQueue(ReadbackQueue *queue) = 0;
 
 	// Render targets
 	virtual void				resizeScreenTarget(const QSize &newSize) = 0;
@@ -480,6 +745,13 @@ public: // Interface ----------------------------------------------------------
 	virtual Texture *	convertToBgrx(
 		VidgfxPixFormat format, Texture *planeA, Texture *planeB,
 		Texture *planeC) = 0;
+	virtual bool		convertFromRgb(
+		VidgfxPixFormat format, Texture *src, Texture *planeA,
+		Texture *planeB, Texture *planeC = NULL) = 0;
+	virtual bool		scaleToNv16(
+		Texture *src, Texture *planeY, Texture *planeUV,
+		VidgfxYuvMatrix matrix = GfxBt601Matrix) = 0;
+	virtual bool		diluteTexture(Texture *src, Texture *dst) = 0;
 
 	// Drawing
 	virtual void		setRenderTarget(VidgfxRendTarget target) = 0;
@@ -489,9 +761,14 @@ public: // Interface ----------------------------------------------------------
 	virtual void		setTexture(
 		Texture *texA, Texture *texB = NULL, Texture *texC = NULL) = 0;
 	virtual void		setTextureFilter(VidgfxFilter filter) = 0;
+	virtual void		setScissorRect(const QRect &rect) = 0;
 	virtual void		clear(const QColor &color) = 0;
 	virtual void		drawBuffer(
 		VertexBuffer *buf, int numVertices = -1, int startVertex = 0) = 0;
+	virtual bool		hasInstancingSupport() const = 0;
+	virtual void		drawInstanced(
+		VertexBuffer *instBuf, int numInstances = -1,
+		int startInstance = 0) = 0;
 
 public: // Signals ------------------------------------------------------------
 	void	callInitializedCallbacks();
@@ -529,6 +806,11 @@ inline QRect GraphicsContext::getUserRenderTargetViewport() const
 	return m_userTargetViewport;
 }
 
+inline VidgfxRendTarget GraphicsContext::getRenderTarget() const
+{
+	return m_currentTarget;
+}
+
 inline QRectF GraphicsContext::getResizeLayerRect() const
 {
 	return m_resizeRect;
@@ -549,4 +831,28 @@ inline const float *GraphicsContext::getTexDecalEffects() const
 	return m_texDecalEffects;
 }
 
+/// <summary>
+/// Sets whether or not tex decal shaders decode the sRGB transfer function of
+/// the texture into linear light before applying any effects. Disabled by
+/// default.
+/// </summary>
+inline void GraphicsContext::setTexDecalSrgb(bool decodeSrgb)
+{
+	m_texDecalSrgb = decodeSrgb;
+}
+
+inline bool GraphicsContext::getTexDecalSrgb() const
+{
+	return m_texDecalSrgb;
+}
+
+/// <summary>
+/// Returns the rectangle of the canvas that is being redrawn between
+/// `beginCanvasRedraw()` and `endCanvasRedraw()`.
+/// </summary>
+inline QRect GraphicsContext::getCanvasRedrawRect() const
+{
+	return m_redrawRect;
+}
+
 #endif // GRAPHICSCONTEXT_H
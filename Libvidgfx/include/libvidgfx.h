@@ -98,6 +98,9 @@ enum VidgfxPixFormat {
 	GfxHDYCFormat, // UYVY with BT.709, Used by Blackmagic Design
 	GfxYUY2Format, // YUYV (Microsoft HD-3000, MacBook Pro FaceTime HD)
 
+	// YUV 4:2:2 formats with 2 separate planes
+	GfxNV16Format, // NxM Y, NxM interleaved UV (Output only)
+
 	NUM_PIXEL_FORMAT_TYPES // Must be last
 };
 static const char * const VidgfxPixFormatStrs[] = {
@@ -118,7 +121,10 @@ static const char * const VidgfxPixFormatStrs[] = {
 	// YUV 4:2:2 formats with a single packed plane
 	"UYVY",
 	"HDYC",
-	"YUY2"
+	"YUY2",
+
+	// YUV 4:2:2 formats with 2 separate planes
+	"NV16"
 };
 
 enum VidgfxShader {
@@ -132,14 +138,30 @@ enum VidgfxShader {
 	GfxYv12RgbShader,
 	GfxUyvyRgbShader,
 	GfxHdycRgbShader,
-	GfxYuy2RgbShader
+	GfxYuy2RgbShader,
+	GfxRgbYShader,
+	GfxRgbNv12UvShader,
+	GfxRgbI420UvShader,
+	GfxNv12RgbShader,
+	GfxRgbNv16ScaledShader,
+	GfxRgbNv16Scaled709Shader,
+	GfxDiluteShader,
+	GfxResampleHorzShader,
+	GfxResampleVertShader
+};
+
+// The RGB->YUV matrix used when converting RGB to YUV
+enum VidgfxYuvMatrix {
+	GfxBt601Matrix = 0,
+	GfxBt709Matrix
 };
 
 enum VidgfxFilter {
 	// Standard filters shown to the user
 	GfxPointFilter = 0,
 	GfxBilinearFilter,
-	//GfxBicubicFilter,
+	GfxBicubicFilter,
+	GfxLanczosFilter,
 
 	NUM_STANDARD_TEXTURE_FILTERS, // Must be after all standard filters
 
@@ -149,12 +171,14 @@ enum VidgfxFilter {
 static const char * const VidgfxFilterStrs[] = {
 	"Nearest neighbour",
 	"Bilinear",
-	//"Bicubic",
+	"Bicubic",
+	"Lanczos",
 };
 static const char * const VidgfxFilterQualStrs[] = {
 	"Low (Nearest neighbour)",
 	"Medium (Bilinear)",
-	//"High (Bicubic)",
+	"High (Bicubic)",
+	"Very high (Lanczos)",
 };
 
 enum VidgfxBlending {
@@ -168,7 +192,9 @@ enum VidgfxTexFlags_ {
 	GfxWritableFlag = (1 << 0),
 	GfxTargetableFlag = (1 << 1),
 	GfxStagingFlag = (1 << 2),
-	GfxGDIFlag = (1 << 3) // Used by `D3DContext` only
+	GfxGDIFlag = (1 << 3), // Used by `D3DContext` only
+	GfxSharedFlag = (1 << 4), // Used by `D3DContext` only
+	GfxKeyedMutexFlag = (1 << 5) // Used by `D3DContext` only
 };
 
 enum VidgfxOrientation {
@@ -184,6 +210,15 @@ enum VidgfxLogLvl {
 	GfxCritical
 };
 
+// Result of acquiring the keyed mutex of a shared texture
+enum VidgfxSyncResult {
+	GfxSyncAcquired = 0,
+	GfxSyncTimeout, // Producer still owns the texture, try again later
+	GfxSyncAbandoned, // Producer exited while owning the texture
+	GfxSyncNoMutex, // Texture wasn't created with a keyed mutex
+	GfxSyncFailed
+};
+
 //=============================================================================
 // C interface datatypes
 
@@ -192,8 +227,15 @@ DECLARE_OPAQUE(VidgfxContext);
 DECLARE_OPAQUE(VidgfxTex);
 DECLARE_OPAQUE(VidgfxVertBuf);
 DECLARE_OPAQUE(VidgfxTexDecalBuf);
+DECLARE_OPAQUE(VidgfxReadbackQueue);
+DECLARE_OPAQUE(VidgfxSpriteBatch);
+DECLARE_OPAQUE(VidgfxCmdList);
+DECLARE_OPAQUE(VidgfxRenditionScaler);
+DECLARE_OPAQUE(VidgfxTexLoader);
 DECLARE_OPAQUE(VidgfxD3DContext);
 DECLARE_OPAQUE(VidgfxD3DTex);
+DECLARE_OPAQUE(VidgfxD3D11Context);
+DECLARE_OPAQUE(VidgfxD3D11Tex);
 #undef DECLARE_OPAQUE
 
 //=============================================================================
@@ -275,6 +317,10 @@ API_EXPORT VidgfxVertBuf *vidgfx_texdecalbuf_get_vert_buf(
 	VidgfxTexDecalBuf *buf); // Applies settings
 API_EXPORT VidgfxTopology vidgfx_texdecalbuf_get_topology(
 	VidgfxTexDecalBuf *buf);
+API_EXPORT VidgfxVertBuf *vidgfx_texdecalbuf_get_instance_buf(
+	VidgfxTexDecalBuf *buf); // Applies settings
+API_EXPORT void vidgfx_texdecalbuf_draw(
+	VidgfxTexDecalBuf *buf);
 API_EXPORT void vidgfx_texdecalbuf_destroy_vert_buf(
 	VidgfxTexDecalBuf *buf);
 
@@ -351,10 +397,22 @@ API_EXPORT int vidgfx_tex_get_width(
 	VidgfxTex *tex);
 API_EXPORT int vidgfx_tex_get_height(
 	VidgfxTex *tex);
+API_EXPORT quint32 vidgfx_tex_get_generation(
+	VidgfxTex *tex);
+API_EXPORT void vidgfx_tex_mark_modified(
+	VidgfxTex *tex);
 
 API_EXPORT void vidgfx_tex_update_data(
 	VidgfxTex *tex,
 	const QImage &img);
+API_EXPORT bool vidgfx_tex_update_planes(
+	VidgfxPixFormat format,
+	const QSize &size,
+	const quint8 * const planes[],
+	const int strides[],
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b = NULL,
+	VidgfxTex *tex_c = NULL);
 
 //-----------------------------------------------------------------------------
 // Interface
@@ -367,6 +425,318 @@ API_EXPORT void vidgfx_tex_unmap(
 API_EXPORT bool vidgfx_tex_is_srgb_hack(
 	VidgfxTex *tex);
 
+//=============================================================================
+// ReadbackQueue C interface
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT QSize vidgfx_readbackqueue_get_size(
+	VidgfxReadbackQueue *queue);
+API_EXPORT int vidgfx_readbackqueue_get_depth(
+	VidgfxReadbackQueue *queue);
+API_EXPORT int vidgfx_readbackqueue_get_num_pending(
+	VidgfxReadbackQueue *queue);
+API_EXPORT bool vidgfx_readbackqueue_is_full(
+	VidgfxReadbackQueue *queue);
+
+//-----------------------------------------------------------------------------
+// Interface
+
+API_EXPORT bool vidgfx_readbackqueue_is_valid(
+	VidgfxReadbackQueue *queue);
+API_EXPORT bool vidgfx_readbackqueue_enqueue(
+	VidgfxReadbackQueue *queue,
+	VidgfxTex *src,
+	const QPoint &src_pos = QPoint(0, 0));
+API_EXPORT VidgfxTex *vidgfx_readbackqueue_try_dequeue(
+	VidgfxReadbackQueue *queue);
+API_EXPORT void vidgfx_readbackqueue_release_dequeued(
+	VidgfxReadbackQueue *queue);
+
+//=============================================================================
+// SpriteBatch C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxSpriteBatch *vidgfx_spritebatch_new(
+	VidgfxContext *context = NULL,
+	int max_quads = 256);
+API_EXPORT void vidgfx_spritebatch_destroy(
+	VidgfxSpriteBatch *batch);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT void vidgfx_spritebatch_set_context(
+	VidgfxSpriteBatch *batch,
+	VidgfxContext *context);
+API_EXPORT void vidgfx_spritebatch_destroy_vert_buf(
+	VidgfxSpriteBatch *batch);
+
+API_EXPORT void vidgfx_spritebatch_set_sorting_allowed(
+	VidgfxSpriteBatch *batch,
+	bool allowed);
+API_EXPORT bool vidgfx_spritebatch_is_sorting_allowed(
+	VidgfxSpriteBatch *batch);
+
+API_EXPORT void vidgfx_spritebatch_add_solid_rect(
+	VidgfxSpriteBatch *batch,
+	const QRectF &rect,
+	const QColor &col,
+	VidgfxBlending blending = GfxAlphaBlending);
+API_EXPORT void vidgfx_spritebatch_add_tex_decal_rect(
+	VidgfxSpriteBatch *batch,
+	VidgfxTex *tex,
+	const QRectF &rect,
+	const QPointF &tl_uv,
+	const QPointF &br_uv,
+	VidgfxShader shader = GfxTexDecalShader,
+	VidgfxBlending blending = GfxAlphaBlending,
+	VidgfxFilter filter = GfxBilinearFilter,
+	const QColor &mod_color = QColor(255, 255, 255));
+API_EXPORT int vidgfx_spritebatch_get_num_queued_quads(
+	VidgfxSpriteBatch *batch);
+API_EXPORT void vidgfx_spritebatch_clear(
+	VidgfxSpriteBatch *batch);
+API_EXPORT void vidgfx_spritebatch_flush(
+	VidgfxSpriteBatch *batch);
+
+// Statistics
+API_EXPORT quint32 vidgfx_spritebatch_get_num_quads_drawn(
+	VidgfxSpriteBatch *batch);
+API_EXPORT quint32 vidgfx_spritebatch_get_num_batches_drawn(
+	VidgfxSpriteBatch *batch);
+API_EXPORT quint32 vidgfx_spritebatch_get_num_flushes(
+	VidgfxSpriteBatch *batch);
+API_EXPORT void vidgfx_spritebatch_reset_stats(
+	VidgfxSpriteBatch *batch);
+
+//=============================================================================
+// CommandList C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxCmdList *vidgfx_cmdlist_new();
+API_EXPORT void vidgfx_cmdlist_destroy(
+	VidgfxCmdList *cmdlist);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT int vidgfx_cmdlist_get_num_cmds(
+	VidgfxCmdList *cmdlist);
+API_EXPORT bool vidgfx_cmdlist_is_empty(
+	VidgfxCmdList *cmdlist);
+API_EXPORT void vidgfx_cmdlist_reset(
+	VidgfxCmdList *cmdlist);
+API_EXPORT void vidgfx_cmdlist_execute(
+	VidgfxCmdList *cmdlist,
+	VidgfxContext *context);
+
+// Recording
+API_EXPORT void vidgfx_cmdlist_set_view_mat(
+	VidgfxCmdList *cmdlist,
+	const QMatrix4x4 &matrix);
+API_EXPORT void vidgfx_cmdlist_set_proj_mat(
+	VidgfxCmdList *cmdlist,
+	const QMatrix4x4 &matrix);
+API_EXPORT void vidgfx_cmdlist_set_user_render_target(
+	VidgfxCmdList *cmdlist,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b = NULL);
+API_EXPORT void vidgfx_cmdlist_set_user_render_target_viewport(
+	VidgfxCmdList *cmdlist,
+	const QRect &rect);
+API_EXPORT void vidgfx_cmdlist_set_user_render_target_viewport(
+	VidgfxCmdList *cmdlist,
+	const QSize &size);
+API_EXPORT void vidgfx_cmdlist_set_resize_layer_rect(
+	VidgfxCmdList *cmdlist,
+	const QRectF &rect);
+API_EXPORT void vidgfx_cmdlist_set_rgb_nv16_px_size(
+	VidgfxCmdList *cmdlist,
+	const QPointF &size);
+API_EXPORT void vidgfx_cmdlist_set_tex_decal_mod_color(
+	VidgfxCmdList *cmdlist,
+	const QColor &color);
+API_EXPORT void vidgfx_cmdlist_set_tex_decal_effects(
+	VidgfxCmdList *cmdlist,
+	float gamma,
+	float brightness,
+	float contrast,
+	float saturation);
+API_EXPORT void vidgfx_cmdlist_set_tex_decal_srgb(
+	VidgfxCmdList *cmdlist,
+	bool decode_srgb);
+API_EXPORT void vidgfx_cmdlist_set_render_target(
+	VidgfxCmdList *cmdlist,
+	VidgfxRendTarget target);
+API_EXPORT void vidgfx_cmdlist_set_shader(
+	VidgfxCmdList *cmdlist,
+	VidgfxShader shader);
+API_EXPORT void vidgfx_cmdlist_set_topology(
+	VidgfxCmdList *cmdlist,
+	VidgfxTopology topology);
+API_EXPORT void vidgfx_cmdlist_set_blending(
+	VidgfxCmdList *cmdlist,
+	VidgfxBlending blending);
+API_EXPORT void vidgfx_cmdlist_set_tex(
+	VidgfxCmdList *cmdlist,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b = NULL,
+	VidgfxTex *tex_c = NULL);
+API_EXPORT void vidgfx_cmdlist_set_tex_filter(
+	VidgfxCmdList *cmdlist,
+	VidgfxFilter filter);
+API_EXPORT void vidgfx_cmdlist_set_scissor_rect(
+	VidgfxCmdList *cmdlist,
+	const QRect &rect);
+API_EXPORT void vidgfx_cmdlist_clear(
+	VidgfxCmdList *cmdlist,
+	const QColor &color);
+API_EXPORT void vidgfx_cmdlist_draw_buf(
+	VidgfxCmdList *cmdlist,
+	VidgfxVertBuf *buf,
+	int num_vertices = -1,
+	int start_vertex = 0);
+API_EXPORT void vidgfx_cmdlist_draw_instanced(
+	VidgfxCmdList *cmdlist,
+	VidgfxVertBuf *inst_buf,
+	int num_instances = -1,
+	int start_instance = 0);
+
+//=============================================================================
+// RenditionScaler C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxRenditionScaler *vidgfx_renditionscaler_new(
+	VidgfxContext *context = NULL,
+	int readback_depth = 3);
+API_EXPORT void vidgfx_renditionscaler_destroy(
+	VidgfxRenditionScaler *scaler);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT void vidgfx_renditionscaler_set_context(
+	VidgfxRenditionScaler *scaler,
+	VidgfxContext *context);
+API_EXPORT void vidgfx_renditionscaler_destroy_resources(
+	VidgfxRenditionScaler *scaler);
+
+API_EXPORT int vidgfx_renditionscaler_add_rendition(
+	VidgfxRenditionScaler *scaler,
+	const QSize &size,
+	VidgfxPixFormat format,
+	VidgfxFilter filter = GfxBilinearFilter,
+	VidgfxYuvMatrix matrix = GfxBt601Matrix);
+API_EXPORT void vidgfx_renditionscaler_remove_all_renditions(
+	VidgfxRenditionScaler *scaler);
+API_EXPORT int vidgfx_renditionscaler_get_num_renditions(
+	VidgfxRenditionScaler *scaler);
+API_EXPORT QSize vidgfx_renditionscaler_get_rendition_size(
+	VidgfxRenditionScaler *scaler,
+	int rendition);
+API_EXPORT VidgfxPixFormat vidgfx_renditionscaler_get_rendition_format(
+	VidgfxRenditionScaler *scaler,
+	int rendition);
+API_EXPORT int vidgfx_renditionscaler_get_num_planes(
+	VidgfxRenditionScaler *scaler,
+	int rendition);
+API_EXPORT VidgfxTex *vidgfx_renditionscaler_get_plane(
+	VidgfxRenditionScaler *scaler,
+	int rendition,
+	int plane);
+
+API_EXPORT bool vidgfx_renditionscaler_process(
+	VidgfxRenditionScaler *scaler,
+	VidgfxTex *src);
+API_EXPORT bool vidgfx_renditionscaler_try_dequeue(
+	VidgfxRenditionScaler *scaler,
+	int rendition,
+	VidgfxTex *planes_out[]);
+API_EXPORT void vidgfx_renditionscaler_release_dequeued(
+	VidgfxRenditionScaler *scaler,
+	int rendition);
+API_EXPORT quint32 vidgfx_renditionscaler_get_num_dropped(
+	VidgfxRenditionScaler *scaler);
+
+API_EXPORT void vidgfx_renditionscaler_set_preview(
+	VidgfxRenditionScaler *scaler,
+	const QSize &size,
+	int divisor = 1);
+API_EXPORT QSize vidgfx_renditionscaler_get_preview_size(
+	VidgfxRenditionScaler *scaler);
+API_EXPORT int vidgfx_renditionscaler_get_preview_divisor(
+	VidgfxRenditionScaler *scaler);
+API_EXPORT VidgfxTex *vidgfx_renditionscaler_get_preview_tex(
+	VidgfxRenditionScaler *scaler);
+API_EXPORT void vidgfx_renditionscaler_mark_preview_dirty(
+	VidgfxRenditionScaler *scaler,
+	const QRect &rect);
+API_EXPORT void vidgfx_renditionscaler_mark_preview_dirty_all(
+	VidgfxRenditionScaler *scaler);
+
+//=============================================================================
+// TextureLoader C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxTexLoader *vidgfx_texloader_new(
+	VidgfxContext *context = NULL,
+	int max_threads = 2);
+API_EXPORT void vidgfx_texloader_destroy(
+	VidgfxTexLoader *loader);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT void vidgfx_texloader_set_context(
+	VidgfxTexLoader *loader,
+	VidgfxContext *context);
+API_EXPORT int vidgfx_texloader_load_file(
+	VidgfxTexLoader *loader,
+	const QString &filename,
+	bool dilute = true);
+API_EXPORT int vidgfx_texloader_load_img(
+	VidgfxTexLoader *loader,
+	const QImage &img,
+	bool dilute = true);
+API_EXPORT void vidgfx_texloader_cancel(
+	VidgfxTexLoader *loader,
+	int id);
+API_EXPORT void vidgfx_texloader_cancel_all(
+	VidgfxTexLoader *loader);
+API_EXPORT bool vidgfx_texloader_is_pending(
+	VidgfxTexLoader *loader,
+	int id);
+API_EXPORT int vidgfx_texloader_get_num_pending(
+	VidgfxTexLoader *loader);
+API_EXPORT int vidgfx_texloader_process_uploads(
+	VidgfxTexLoader *loader,
+	int budget_usec = 2000);
+
+//-----------------------------------------------------------------------------
+// Signals
+
+typedef void VidgfxTexLoaderLoadedCallback(
+	void *opaque, VidgfxTexLoader *loader, int id, VidgfxTex *tex);
+
+API_EXPORT void vidgfx_texloader_add_loaded_callback(
+	VidgfxTexLoader *loader,
+	VidgfxTexLoaderLoadedCallback *loaded,
+	void *opaque);
+API_EXPORT void vidgfx_texloader_remove_loaded_callback(
+	VidgfxTexLoader *loader,
+	VidgfxTexLoaderLoadedCallback *loaded,
+	void *opaque);
+
 //=============================================================================
 // GraphicsContext C interface
 
@@ -401,6 +771,12 @@ API_EXPORT bool vidgfx_tex_is_srgb_hack(
 #define VIDGFX_RESIZE_RECT_BUF_SIZE \
 	(VIDGFX_RESIZE_RECT_NUM_FLOATS * sizeof(float))
 
+// Buffer information for `createTexDecalInstance()` and
+// `createSolidRectOutlineInstance()` (1 instance = 16 floats)
+#define VIDGFX_INSTANCE_NUM_FLOATS (16)
+#define VIDGFX_INSTANCE_BUF_SIZE \
+	(VIDGFX_INSTANCE_NUM_FLOATS * sizeof(float))
+
 //-----------------------------------------------------------------------------
 // Static methods
 
@@ -451,6 +827,20 @@ API_EXPORT bool vidgfx_create_resize_rect(
 	float handle_size,
 	const QPointF &half_width = QPointF(0.5f, 0.5f));
 
+API_EXPORT bool vidgfx_create_tex_decal_instance(
+	VidgfxVertBuf *out_buf,
+	int instance,
+	const QRectF &rect,
+	const QPointF &tl_uv,
+	const QPointF &br_uv,
+	const QPointF &scroll_offset = QPointF(0.0f, 0.0f));
+API_EXPORT bool vidgfx_create_solid_rect_outline_instance(
+	VidgfxVertBuf *out_buf,
+	int instance,
+	const QRectF &rect,
+	const QColor &col,
+	const QPointF &half_width = QPointF(0.5f, 0.5f));
+
 // Helpers
 API_EXPORT quint32 vidgfx_next_pow_two(
 	quint32 n);
@@ -529,10 +919,30 @@ API_EXPORT bool vidgfx_context_set_tex_decal_effects_helper(
 API_EXPORT const float *vidgfx_context_get_tex_decal_effects(
 	VidgfxContext *context);
 
+API_EXPORT void vidgfx_context_set_tex_decal_srgb(
+	VidgfxContext *context,
+	bool decode_srgb);
+API_EXPORT bool vidgfx_context_get_tex_decal_srgb(
+	VidgfxContext *context);
+
 API_EXPORT bool vidgfx_context_dilute_img(
 	VidgfxContext *context,
 	QImage &img);
 
+API_EXPORT void vidgfx_context_add_canvas_damage(
+	VidgfxContext *context,
+	const QRect &rect);
+API_EXPORT void vidgfx_context_add_canvas_damage_all(
+	VidgfxContext *context);
+API_EXPORT bool vidgfx_context_begin_canvas_redraw(
+	VidgfxContext *context,
+	VidgfxRendTarget target,
+	bool carry_over = true);
+API_EXPORT QRect vidgfx_context_get_canvas_redraw_rect(
+	VidgfxContext *context);
+API_EXPORT void vidgfx_context_end_canvas_redraw(
+	VidgfxContext *context);
+
 //-----------------------------------------------------------------------------
 // Interface
 
@@ -568,6 +978,11 @@ API_EXPORT VidgfxTex *vidgfx_context_new_tex(
 API_EXPORT VidgfxTex *vidgfx_context_new_staging_tex(
 	VidgfxContext *context,
 	const QSize &size);
+API_EXPORT VidgfxTex *vidgfx_context_new_rg_tex(
+	VidgfxContext *context,
+	const QSize &size,
+	bool writable = false,
+	bool targetable = false);
 API_EXPORT void vidgfx_context_destroy_tex(
 	VidgfxContext *context,
 	VidgfxTex *tex);
@@ -577,6 +992,13 @@ API_EXPORT bool vidgfx_context_copy_tex_data(
 	VidgfxTex *src,
 	const QPoint &dst_pos,
 	const QRect &src_rect);
+API_EXPORT VidgfxReadbackQueue *vidgfx_context_new_readbackqueue(
+	VidgfxContext *context,
+	const QSize &size,
+	int depth = 3);
+API_EXPORT void vidgfx_context_destroy_readbackqueue(
+	VidgfxContext *context,
+	VidgfxReadbackQueue *queue);
 
 // Render targets
 API_EXPORT void vidgfx_context_resize_screen_target(
@@ -617,17 +1039,43 @@ API_EXPORT VidgfxTex *vidgfx_context_prepare_tex(
 	QPointF &px_size_out,
 	QPointF &top_left_out,
 	QPointF &bot_right_out);
+API_EXPORT void vidgfx_context_set_scale_cache_size(
+	VidgfxContext *context,
+	int max_entries);
+API_EXPORT int vidgfx_context_get_scale_cache_size(
+	VidgfxContext *context);
+API_EXPORT void vidgfx_context_purge_scale_cache(
+	VidgfxContext *context);
 API_EXPORT VidgfxTex *vidgfx_context_convert_to_bgrx(
 	VidgfxContext *context,
 	VidgfxPixFormat format,
 	VidgfxTex *plane_a,
 	VidgfxTex *plane_b,
 	VidgfxTex *plane_c);
+API_EXPORT bool vidgfx_context_convert_from_rgb(
+	VidgfxContext *context,
+	VidgfxPixFormat format,
+	VidgfxTex *src,
+	VidgfxTex *plane_a,
+	VidgfxTex *plane_b,
+	VidgfxTex *plane_c = NULL);
+API_EXPORT bool vidgfx_context_scale_to_nv16(
+	VidgfxContext *context,
+	VidgfxTex *src,
+	VidgfxTex *plane_y,
+	VidgfxTex *plane_uv,
+	VidgfxYuvMatrix matrix = GfxBt601Matrix);
+API_EXPORT bool vidgfx_context_dilute_tex(
+	VidgfxContext *context,
+	VidgfxTex *src,
+	VidgfxTex *dst);
 
 // Drawing
 API_EXPORT void vidgfx_context_set_render_target(
 	VidgfxContext *context,
 	VidgfxRendTarget target);
+API_EXPORT VidgfxRendTarget vidgfx_context_get_render_target(
+	VidgfxContext *context);
 API_EXPORT void vidgfx_context_set_shader(
 	VidgfxContext *context,
 	VidgfxShader shader);
@@ -645,6 +1093,9 @@ API_EXPORT void vidgfx_context_set_tex(
 API_EXPORT void vidgfx_context_set_tex_filter(
 	VidgfxContext *context,
 	VidgfxFilter filter);
+API_EXPORT void vidgfx_context_set_scissor_rect(
+	VidgfxContext *context,
+	const QRect &rect);
 API_EXPORT void vidgfx_context_clear(
 	VidgfxContext *context,
 	const QColor &color);
@@ -653,6 +1104,13 @@ API_EXPORT void vidgfx_context_draw_buf(
 	VidgfxVertBuf *buf,
 	int num_vertices = -1,
 	int start_vertex = 0);
+API_EXPORT bool vidgfx_context_has_instancing_support(
+	VidgfxContext *context);
+API_EXPORT void vidgfx_context_draw_instanced(
+	VidgfxContext *context,
+	VidgfxVertBuf *inst_buf,
+	int num_instances = -1,
+	int start_instance = 0);
 
 //-----------------------------------------------------------------------------
 // Signals
@@ -700,6 +1158,21 @@ API_EXPORT HDC vidgfx_d3dtex_get_dc(
 API_EXPORT void vidgfx_d3dtex_release_dc(
 	VidgfxD3DTex *tex);
 
+API_EXPORT HANDLE vidgfx_d3dtex_get_shared_handle(
+	VidgfxD3DTex *tex);
+
+API_EXPORT bool vidgfx_d3dtex_has_keyed_mutex(
+	VidgfxD3DTex *tex);
+API_EXPORT bool vidgfx_d3dtex_is_sync_acquired(
+	VidgfxD3DTex *tex);
+API_EXPORT VidgfxSyncResult vidgfx_d3dtex_acquire_sync(
+	VidgfxD3DTex *tex,
+	quint64 key,
+	int timeout_msec);
+API_EXPORT bool vidgfx_d3dtex_release_sync(
+	VidgfxD3DTex *tex,
+	quint64 key);
+
 #endif // VIDGFX_D3D_ENABLED
 
 //=============================================================================
@@ -711,12 +1184,83 @@ struct ID3D10Device;
 struct ID3D10Texture2D;
 struct IDXGIFactory1; // DXGI 1.1
 
+// Statistics of the context's texture pool. `num_textures` and `num_bytes`
+// are the textures that are currently idle in the pool, all other values are
+// totals since the context was created.
+struct VidgfxD3DTexPoolStats {
+	int		num_textures;
+	qint64	num_bytes;
+	quint32	num_hits; // Textures reused from the pool
+	quint32	num_misses; // Textures that needed to be created
+	quint32	num_trimmed; // Textures destroyed to stay under the limit
+};
+
+// A single named scope of a profiled frame. `name` is only valid for the
+// duration of the callback.
+struct VidgfxD3DProfileScope {
+	const char *	name;
+	int				depth; // 0 = Top-level scope
+	float			gpu_msec;
+};
+
+// GPU timings and statistics of a single profiled frame. Delivered a few
+// frames after the frame was submitted so that the CPU never waits on the GPU.
+struct VidgfxD3DProfileFrame {
+	quint64							frame_num;
+	float							gpu_msec; // Entire frame
+	int								num_draw_calls;
+	qint64							num_bytes_uploaded;
+	qint64							num_bytes_read_back;
+	int								num_dropped_frames; // Since last result
+	int								num_scopes;
+	const VidgfxD3DProfileScope *	scopes; // In the order they began
+};
+
+// A display adapter and its capabilities as returned by
+// `vidgfx_d3d_query_adapters()`. `score` is zero for adapters that cannot be
+// used, otherwise higher is more suitable for compositing.
+struct VidgfxD3DAdapterInfo {
+	int		index; // For `vidgfx_d3dcontext_init()`
+	char	description[128]; // UTF-8
+	quint32	vendor_id; // PCI IDs
+	quint32	device_id;
+	quint32	sub_sys_id;
+	quint32	revision;
+	qint64	dedicated_video_memory; // Bytes
+	qint64	shared_system_memory; // Bytes
+	quint32	luid_low; // Locally unique identifier of the adapter
+	qint32	luid_high;
+	int		num_outputs; // Attached monitors
+	bool	is_usable; // A device could be created
+	bool	has_feature_level_10;
+	bool	has_bgra_tex_support;
+	int		score;
+};
+
+// Controls how `vidgfx_context_swap_screen_bufs()` presents the screen target.
+// The default mode blocks until the frame is queued and presents every call
+// without waiting for vertical sync.
+struct VidgfxD3DPresentMode {
+	int		buffer_count; // 1-8 swap chain buffers, default 2
+	int		sync_interval; // 0 = Don't wait for vsync, 1-4 = Vblanks to wait
+	bool	skip_if_busy; // Drop the frame instead of blocking when GPU busy
+	int		max_frame_latency; // 1-16 queued frames, 0 = Driver default
+	int		present_divisor; // Present every Nth call only, default 1
+};
+
 //-----------------------------------------------------------------------------
 // Static methods
 
 API_EXPORT HRESULT vidgfx_d3d_create_dxgifactory1_dyn(
 	IDXGIFactory1 **factory_out);
 API_EXPORT void vidgfx_d3d_log_display_adapters();
+API_EXPORT int vidgfx_d3d_query_adapters(
+	VidgfxD3DAdapterInfo *adapters_out,
+	int max_adapters);
+API_EXPORT int vidgfx_d3d_get_recommended_adapter(
+	const VidgfxD3DAdapterInfo *adapters,
+	int num_adapters,
+	quint32 prefer_vendor_id = 0);
 
 //-----------------------------------------------------------------------------
 // Constructor/destructor
@@ -740,7 +1284,10 @@ API_EXPORT bool vidgfx_d3dcontext_init(
 	VidgfxD3DContext *context,
 	HWND hwnd,
 	const QSize &size,
-	const QColor &resize_border_col);
+	const QColor &resize_border_col,
+	int adapter = -1);
+API_EXPORT int vidgfx_d3dcontext_get_adapter(
+	VidgfxD3DContext *context);
 API_EXPORT ID3D10Device *vidgfx_d3dcontext_get_device(
 	VidgfxD3DContext *context);
 API_EXPORT bool vidgfx_d3dcontext_has_dxgi11(
@@ -750,12 +1297,61 @@ API_EXPORT bool vidgfx_d3dcontext_has_bgra_tex_support(
 API_EXPORT VidgfxTex *vidgfx_d3dcontext_new_gdi_tex(
 	VidgfxD3DContext *context,
 	const QSize &size);
+API_EXPORT VidgfxTex *vidgfx_d3dcontext_new_shared_tex(
+	VidgfxD3DContext *context,
+	const QSize &size,
+	bool use_keyed_mutex = true);
 API_EXPORT VidgfxTex *vidgfx_d3dcontext_open_shared_tex(
 	VidgfxD3DContext *context,
 	HANDLE shared_handle);
 API_EXPORT VidgfxTex *vidgfx_d3dcontext_open_dx10_tex(
 	VidgfxD3DContext *context,
 	ID3D10Texture2D *tex);
+API_EXPORT void vidgfx_d3dcontext_set_tex_pool_limit(
+	VidgfxD3DContext *context,
+	qint64 max_bytes);
+API_EXPORT qint64 vidgfx_d3dcontext_get_tex_pool_limit(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_trim_tex_pool(
+	VidgfxD3DContext *context,
+	qint64 max_bytes = 0);
+API_EXPORT VidgfxD3DTexPoolStats vidgfx_d3dcontext_get_tex_pool_stats(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_set_present_mode(
+	VidgfxD3DContext *context,
+	const VidgfxD3DPresentMode &mode);
+API_EXPORT VidgfxD3DPresentMode vidgfx_d3dcontext_get_present_mode(
+	VidgfxD3DContext *context);
+API_EXPORT bool vidgfx_d3dcontext_is_screen_frame_due(
+	VidgfxD3DContext *context);
+API_EXPORT quint32 vidgfx_d3dcontext_get_num_dropped_presents(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_invalidate_state_cache(
+	VidgfxD3DContext *context);
+API_EXPORT quint32 vidgfx_d3dcontext_get_num_redundant_state_calls(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_reset_num_redundant_state_calls(
+	VidgfxD3DContext *context);
+API_EXPORT bool vidgfx_d3dcontext_is_device_lost(
+	VidgfxD3DContext *context);
+API_EXPORT quint32 vidgfx_d3dcontext_get_num_device_resets(
+	VidgfxD3DContext *context);
+API_EXPORT bool vidgfx_d3dcontext_recover_device(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_set_profiling_enabled(
+	VidgfxD3DContext *context,
+	bool enabled);
+API_EXPORT bool vidgfx_d3dcontext_is_profiling_enabled(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_begin_profile_frame(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_end_profile_frame(
+	VidgfxD3DContext *context);
+API_EXPORT void vidgfx_d3dcontext_begin_profile_scope(
+	VidgfxD3DContext *context,
+	const char *name);
+API_EXPORT void vidgfx_d3dcontext_end_profile_scope(
+	VidgfxD3DContext *context);
 
 //-----------------------------------------------------------------------------
 // Signals
@@ -764,6 +1360,9 @@ typedef void VidgfxD3DContextDxgi11ChangedCallback(
 	void *opaque, VidgfxD3DContext *context, bool has_dxgi11);
 typedef void VidgfxD3DContextBgraTexSupportChangedCallback(
 	void *opaque, VidgfxD3DContext *context, bool has_bgra_tex_support);
+typedef void VidgfxD3DContextProfileFrameCallback(
+	void *opaque, VidgfxD3DContext *context,
+	const VidgfxD3DProfileFrame *frame);
 
 API_EXPORT void vidgfx_d3dcontext_add_dxgi11_changed_callback(
 	VidgfxD3DContext *context,
@@ -781,6 +1380,139 @@ API_EXPORT void vidgfx_d3dcontext_remove_bgra_tex_support_changed_callback(
 	VidgfxD3DContext *context,
 	VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
 	void *opaque);
+API_EXPORT void vidgfx_d3dcontext_add_profile_frame_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextProfileFrameCallback *profile_frame,
+	void *opaque);
+API_EXPORT void vidgfx_d3dcontext_remove_profile_frame_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextProfileFrameCallback *profile_frame,
+	void *opaque);
+
+#endif // VIDGFX_D3D_ENABLED
+
+//=============================================================================
+// D3D11Texture C API
+
+#if VIDGFX_D3D_ENABLED
+
+struct ID3D11Texture2D;
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxD3D11Tex *vidgfx_tex_get_d3d11tex(
+	VidgfxTex *tex);
+API_EXPORT VidgfxTex *vidgfx_d3d11tex_get_tex(
+	VidgfxD3D11Tex *tex);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT ID3D11Texture2D *vidgfx_d3d11tex_get_texture(
+	VidgfxD3D11Tex *tex);
+
+API_EXPORT HDC vidgfx_d3d11tex_get_dc(
+	VidgfxD3D11Tex *tex);
+API_EXPORT void vidgfx_d3d11tex_release_dc(
+	VidgfxD3D11Tex *tex);
+
+API_EXPORT HANDLE vidgfx_d3d11tex_get_shared_handle(
+	VidgfxD3D11Tex *tex);
+
+API_EXPORT bool vidgfx_d3d11tex_has_keyed_mutex(
+	VidgfxD3D11Tex *tex);
+API_EXPORT bool vidgfx_d3d11tex_is_sync_acquired(
+	VidgfxD3D11Tex *tex);
+API_EXPORT VidgfxSyncResult vidgfx_d3d11tex_acquire_sync(
+	VidgfxD3D11Tex *tex,
+	quint64 key,
+	int timeout_msec);
+API_EXPORT bool vidgfx_d3d11tex_release_sync(
+	VidgfxD3D11Tex *tex,
+	quint64 key);
+
+#endif // VIDGFX_D3D_ENABLED
+
+//=============================================================================
+// D3D11Context C API
+
+#if VIDGFX_D3D_ENABLED
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+API_EXPORT VidgfxD3D11Context *vidgfx_d3d11context_new();
+API_EXPORT void vidgfx_d3d11context_destroy(
+	VidgfxD3D11Context *context);
+
+API_EXPORT VidgfxD3D11Context *vidgfx_context_get_d3d11context(
+	VidgfxContext *context);
+API_EXPORT VidgfxContext *vidgfx_d3d11context_get_context(
+	VidgfxD3D11Context *context);
+
+//-----------------------------------------------------------------------------
+// Methods
+
+API_EXPORT bool vidgfx_d3d11context_is_valid(
+	VidgfxD3D11Context *context);
+
+API_EXPORT bool vidgfx_d3d11context_init(
+	VidgfxD3D11Context *context,
+	HWND hwnd,
+	const QSize &size,
+	const QColor &resize_border_col,
+	int adapter = -1);
+API_EXPORT int vidgfx_d3d11context_get_adapter(
+	VidgfxD3D11Context *context);
+API_EXPORT ID3D11Device *vidgfx_d3d11context_get_device(
+	VidgfxD3D11Context *context);
+API_EXPORT ID3D11DeviceContext *vidgfx_d3d11context_get_device_context(
+	VidgfxD3D11Context *context);
+API_EXPORT bool vidgfx_d3d11context_has_feature_level_11(
+	VidgfxD3D11Context *context);
+API_EXPORT bool vidgfx_d3d11context_has_compute_support(
+	VidgfxD3D11Context *context);
+API_EXPORT bool vidgfx_d3d11context_has_bgra_tex_support(
+	VidgfxD3D11Context *context);
+API_EXPORT VidgfxTex *vidgfx_d3d11context_new_gdi_tex(
+	VidgfxD3D11Context *context,
+	const QSize &size);
+API_EXPORT VidgfxTex *vidgfx_d3d11context_new_shared_tex(
+	VidgfxD3D11Context *context,
+	const QSize &size,
+	bool use_keyed_mutex = true);
+API_EXPORT VidgfxTex *vidgfx_d3d11context_open_shared_tex(
+	VidgfxD3D11Context *context,
+	HANDLE shared_handle);
+API_EXPORT VidgfxTex *vidgfx_d3d11context_open_dx11_tex(
+	VidgfxD3D11Context *context,
+	ID3D11Texture2D *tex);
+
+// Deferred contexts
+API_EXPORT VidgfxD3D11Context *vidgfx_d3d11context_new_deferred(
+	VidgfxD3D11Context *context);
+API_EXPORT void vidgfx_d3d11context_delete_deferred(
+	VidgfxD3D11Context *context,
+	VidgfxD3D11Context *deferred);
+API_EXPORT bool vidgfx_d3d11context_is_deferred(
+	VidgfxD3D11Context *context);
+API_EXPORT bool vidgfx_d3d11context_finish_cmds(
+	VidgfxD3D11Context *deferred);
+API_EXPORT void vidgfx_d3d11context_execute_deferred(
+	VidgfxD3D11Context *context,
+	VidgfxD3D11Context *deferred);
+
+// Statistics
+API_EXPORT void vidgfx_d3d11context_invalidate_state_cache(
+	VidgfxD3D11Context *context);
+API_EXPORT quint32 vidgfx_d3d11context_get_num_redundant_state_calls(
+	VidgfxD3D11Context *context);
+API_EXPORT void vidgfx_d3d11context_reset_num_redundant_state_calls(
+	VidgfxD3D11Context *context);
 
 #endif // VIDGFX_D3D_ENABLED
 
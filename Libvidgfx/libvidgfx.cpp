@@ -16,8 +16,12 @@
 //*****************************************************************************
 
 #include "include/libvidgfx.h"
+#include "commandlist.h"
+#include "d3d11context.h"
 #include "d3dcontext.h"
 #include "gfxlog.h"
+#include "renditionscaler.h"
+#include "textureloader.h"
 #include <iostream>
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -228,6 +232,20 @@ VidgfxTopology vidgfx_texdecalbuf_get_topology(
 	return ptr->getTopology();
 }
 
+VidgfxVertBuf *vidgfx_texdecalbuf_get_instance_buf(
+	VidgfxTexDecalBuf *buf)
+{
+	TexDecalVertBuf *ptr = reinterpret_cast<TexDecalVertBuf *>(buf);
+	return reinterpret_cast<VidgfxVertBuf *>(ptr->getInstanceBuf());
+}
+
+void vidgfx_texdecalbuf_draw(
+	VidgfxTexDecalBuf *buf)
+{
+	TexDecalVertBuf *ptr = reinterpret_cast<TexDecalVertBuf *>(buf);
+	ptr->draw();
+}
+
 void vidgfx_texdecalbuf_destroy_vert_buf(
 	VidgfxTexDecalBuf *buf)
 {
@@ -411,6 +429,20 @@ int vidgfx_tex_get_height(
 	return ptr->getHeight();
 }
 
+quint32 vidgfx_tex_get_generation(
+	VidgfxTex *tex)
+{
+	Texture *ptr = reinterpret_cast<Texture *>(tex);
+	return ptr->getGeneration();
+}
+
+void vidgfx_tex_mark_modified(
+	VidgfxTex *tex)
+{
+	Texture *ptr = reinterpret_cast<Texture *>(tex);
+	ptr->markModified();
+}
+
 void vidgfx_tex_update_data(
 	VidgfxTex *tex,
 	const QImage &img)
@@ -419,6 +451,21 @@ void vidgfx_tex_update_data(
 	ptr->updateData(img);
 }
 
+bool vidgfx_tex_update_planes(
+	VidgfxPixFormat format,
+	const QSize &size,
+	const quint8 * const planes[],
+	const int strides[],
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b,
+	VidgfxTex *tex_c)
+{
+	return Texture::updatePlanes(
+		format, size, planes, strides, reinterpret_cast<Texture *>(tex_a),
+		reinterpret_cast<Texture *>(tex_b),
+		reinterpret_cast<Texture *>(tex_c));
+}
+
 //-----------------------------------------------------------------------------
 // Interface
 
@@ -444,632 +491,2010 @@ bool vidgfx_tex_is_srgb_hack(
 }
 
 //=============================================================================
-// GraphicsContext C interface
+// ReadbackQueue C interface
 
 //-----------------------------------------------------------------------------
-// Static methods
+// Methods
 
-bool vidgfx_create_solid_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QColor &col)
+QSize vidgfx_readbackqueue_get_size(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createSolidRect(ptr, rect, col);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	return ptr->getSize();
 }
 
-bool vidgfx_create_solid_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QColor &tl_col,
-	const QColor &tr_col,
-	const QColor &bl_col,
-	const QColor &br_col)
+int vidgfx_readbackqueue_get_depth(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createSolidRect(
-		ptr, rect, tl_col, tr_col, bl_col, br_col);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	return ptr->getDepth();
 }
 
-bool vidgfx_create_solid_rect_outline(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QColor &col,
-	const QPointF &half_width)
+int vidgfx_readbackqueue_get_num_pending(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createSolidRectOutline(
-		ptr, rect, col, half_width);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	return ptr->getNumPending();
 }
 
-bool vidgfx_create_solid_rect_outline(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QColor &tl_col,
-	const QColor &tr_col,
-	const QColor &bl_col,
-	const QColor &br_col,
-	const QPointF &half_width)
+bool vidgfx_readbackqueue_is_full(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createSolidRectOutline(
-		ptr, rect, tl_col, tr_col, bl_col, br_col, half_width);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	return ptr->isFull();
 }
 
-bool vidgfx_create_tex_decal_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect)
-{
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createTexDecalRect(ptr, rect);
-}
+//-----------------------------------------------------------------------------
+// Interface
 
-bool vidgfx_create_tex_decal_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QPointF &br_uv)
+bool vidgfx_readbackqueue_is_valid(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createTexDecalRect(ptr, rect, br_uv);
+	if(queue == NULL)
+		return false;
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	return ptr->isValid();
 }
 
-bool vidgfx_create_tex_decal_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	const QPointF &tl_uv,
-	const QPointF &tr_uv,
-	const QPointF &bl_uv,
-	const QPointF &br_uv)
+bool vidgfx_readbackqueue_enqueue(
+	VidgfxReadbackQueue *queue,
+	VidgfxTex *src,
+	const QPoint &src_pos)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createTexDecalRect(
-		ptr, rect, tl_uv, tr_uv, bl_uv, br_uv);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	Texture *srcTex = reinterpret_cast<Texture *>(src);
+	return ptr->enqueue(srcTex, src_pos);
 }
 
-bool vidgfx_create_resize_rect(
-	VidgfxVertBuf *out_buf,
-	const QRectF &rect,
-	float handle_size,
-	const QPointF &half_width)
+VidgfxTex *vidgfx_readbackqueue_try_dequeue(
+	VidgfxReadbackQueue *queue)
 {
-	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
-	return GraphicsContext::createResizeRect(
-		ptr, rect, handle_size, half_width);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	Texture *ret = ptr->tryDequeue();
+	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-quint32 vidgfx_next_pow_two(
-	quint32 n)
+void vidgfx_readbackqueue_release_dequeued(
+	VidgfxReadbackQueue *queue)
 {
-	return GraphicsContext::nextPowTwo(n);
+	ReadbackQueue *ptr = reinterpret_cast<ReadbackQueue *>(queue);
+	ptr->releaseDequeued();
 }
 
+//=============================================================================
+// SpriteBatch C interface
+
 //-----------------------------------------------------------------------------
-// Methods
+// Constructor/destructor
 
-void vidgfx_context_set_view_mat(
+VidgfxSpriteBatch *vidgfx_spritebatch_new(
 	VidgfxContext *context,
-	const QMatrix4x4 &matrix)
+	int max_quads)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setViewMatrix(matrix);
+	GraphicsContext *con = reinterpret_cast<GraphicsContext *>(context);
+	SpriteBatch *batch = new SpriteBatch(con, max_quads);
+	return reinterpret_cast<VidgfxSpriteBatch *>(batch);
 }
 
-QMatrix4x4 vidgfx_context_get_view_mat(
-	VidgfxContext *context)
+void vidgfx_spritebatch_destroy(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getViewMatrix();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	if(ptr != NULL)
+		delete ptr;
 }
 
-void vidgfx_context_set_proj_mat(
-	VidgfxContext *context,
-	const QMatrix4x4 &matrix)
-{
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setProjectionMatrix(matrix);
-}
+//-----------------------------------------------------------------------------
+// Methods
 
-QMatrix4x4 vidgfx_context_get_proj_mat(
+void vidgfx_spritebatch_set_context(
+	VidgfxSpriteBatch *batch,
 	VidgfxContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getProjectionMatrix();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->setContext(reinterpret_cast<GraphicsContext *>(context));
 }
 
-void vidgfx_context_set_screen_view_mat(
-	VidgfxContext *context,
-	const QMatrix4x4 &matrix)
+void vidgfx_spritebatch_destroy_vert_buf(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setScreenViewMatrix(matrix);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->deleteVertBuf();
 }
 
-QMatrix4x4 vidgfx_context_get_screen_view_mat(
-	VidgfxContext *context)
+void vidgfx_spritebatch_set_sorting_allowed(
+	VidgfxSpriteBatch *batch,
+	bool allowed)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getScreenViewMatrix();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->setSortingAllowed(allowed);
 }
 
-void vidgfx_context_set_screen_proj_mat(
-	VidgfxContext *context,
-	const QMatrix4x4 &matrix)
+bool vidgfx_spritebatch_is_sorting_allowed(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setScreenProjectionMatrix(matrix);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	return ptr->isSortingAllowed();
 }
 
-QMatrix4x4 vidgfx_context_get_screen_proj_mat(
-	VidgfxContext *context)
+void vidgfx_spritebatch_add_solid_rect(
+	VidgfxSpriteBatch *batch,
+	const QRectF &rect,
+	const QColor &col,
+	VidgfxBlending blending)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getScreenProjectionMatrix();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->addSolidRect(rect, col, blending);
 }
 
-void vidgfx_context_set_user_render_target(
-	VidgfxContext *context,
-	VidgfxTex *tex_a,
-	VidgfxTex *tex_b)
+void vidgfx_spritebatch_add_tex_decal_rect(
+	VidgfxSpriteBatch *batch,
+	VidgfxTex *tex,
+	const QRectF &rect,
+	const QPointF &tl_uv,
+	const QPointF &br_uv,
+	VidgfxShader shader,
+	VidgfxBlending blending,
+	VidgfxFilter filter,
+	const QColor &mod_color)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *texA = reinterpret_cast<Texture *>(tex_a);
-	Texture *texB = reinterpret_cast<Texture *>(tex_b);
-	ptr->setUserRenderTarget(texA, texB);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	Texture *texture = reinterpret_cast<Texture *>(tex);
+	ptr->addTexDecalRect(
+		texture, rect, tl_uv, br_uv, shader, blending, filter, mod_color);
 }
 
-VidgfxTex *vidgfx_context_get_user_render_target(
-	VidgfxContext *context,
-	int index)
+int vidgfx_spritebatch_get_num_queued_quads(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->getUserRenderTarget(index);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	return ptr->getNumQueuedQuads();
 }
 
-void vidgfx_context_set_user_render_target_viewport(
-	VidgfxContext *context,
-	const QRect &rect)
+void vidgfx_spritebatch_clear(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setUserRenderTargetViewport(rect);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->clear();
 }
 
-void vidgfx_context_set_user_render_target_viewport(
-	VidgfxContext *context,
-	const QSize &size)
+void vidgfx_spritebatch_flush(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setUserRenderTargetViewport(size);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->flush();
 }
 
-QRect vidgfx_context_get_user_render_target_viewport(
-	VidgfxContext *context)
+// Statistics
+quint32 vidgfx_spritebatch_get_num_quads_drawn(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getUserRenderTargetViewport();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	return ptr->getNumQuadsDrawn();
 }
 
-void vidgfx_context_set_resize_layer_rect(
-	VidgfxContext *context,
-	const QRectF &rect)
+quint32 vidgfx_spritebatch_get_num_batches_drawn(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setResizeLayerRect(rect);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	return ptr->getNumBatchesDrawn();
 }
 
-QRectF vidgfx_context_get_resize_layer_rect(
-	VidgfxContext *context)
+quint32 vidgfx_spritebatch_get_num_flushes(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getResizeLayerRect();
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	return ptr->getNumFlushes();
 }
 
-void vidgfx_context_set_rgb_nv16_px_size(
-	VidgfxContext *context,
-	const QPointF &size)
+void vidgfx_spritebatch_reset_stats(
+	VidgfxSpriteBatch *batch)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setRgbNv16PxSize(size);
+	SpriteBatch *ptr = reinterpret_cast<SpriteBatch *>(batch);
+	ptr->resetStats();
 }
 
-QPointF vidgfx_context_get_rgb_nv16_px_size(
-	VidgfxContext *context)
+//=============================================================================
+// CommandList C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+VidgfxCmdList *vidgfx_cmdlist_new()
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getRgbNv16PxSize();
+	CommandList *cmdlist = new CommandList();
+	return reinterpret_cast<VidgfxCmdList *>(cmdlist);
 }
 
-void vidgfx_context_set_tex_decal_mod_color(
-	VidgfxContext *context,
-	const QColor &color)
+void vidgfx_cmdlist_destroy(
+	VidgfxCmdList *cmdlist)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setTexDecalModColor(color);
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	if(ptr != NULL)
+		delete ptr;
 }
 
-QColor vidgfx_context_get_tex_decal_mod_color(
-	VidgfxContext *context)
+//-----------------------------------------------------------------------------
+// Methods
+
+int vidgfx_cmdlist_get_num_cmds(
+	VidgfxCmdList *cmdlist)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getTexDecalModColor();
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	return ptr->getNumCommands();
 }
 
-void vidgfx_context_set_tex_decal_effects(
-	VidgfxContext *context,
-	float gamma,
-	float brightness,
-	float contrast,
-	float saturation)
+bool vidgfx_cmdlist_is_empty(
+	VidgfxCmdList *cmdlist)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setTexDecalEffects(gamma, brightness, contrast, saturation);
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	return ptr->isEmpty();
 }
 
-bool vidgfx_context_set_tex_decal_effects_helper(
-	VidgfxContext *context,
-	float gamma,
-	int brightness,
-	int contrast,
-	int saturation)
+void vidgfx_cmdlist_reset(
+	VidgfxCmdList *cmdlist)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->setTexDecalEffectsHelper(
-		gamma, brightness, contrast, saturation);
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->reset();
 }
 
-const float *vidgfx_context_get_tex_decal_effects(
+void vidgfx_cmdlist_execute(
+	VidgfxCmdList *cmdlist,
 	VidgfxContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getTexDecalEffects();
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->execute(reinterpret_cast<GraphicsContext *>(context));
 }
 
-bool vidgfx_context_dilute_img(
-	VidgfxContext *context,
-	QImage &img)
+void vidgfx_cmdlist_set_view_mat(
+	VidgfxCmdList *cmdlist,
+	const QMatrix4x4 &matrix)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->diluteImage(img);
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setViewMatrix(matrix);
 }
 
-//-----------------------------------------------------------------------------
-// Interface
+void vidgfx_cmdlist_set_proj_mat(
+	VidgfxCmdList *cmdlist,
+	const QMatrix4x4 &matrix)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setProjectionMatrix(matrix);
+}
+
+void vidgfx_cmdlist_set_user_render_target(
+	VidgfxCmdList *cmdlist,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	Texture *texA = reinterpret_cast<Texture *>(tex_a);
+	Texture *texB = reinterpret_cast<Texture *>(tex_b);
+	ptr->setUserRenderTarget(texA, texB);
+}
+
+void vidgfx_cmdlist_set_user_render_target_viewport(
+	VidgfxCmdList *cmdlist,
+	const QRect &rect)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setUserRenderTargetViewport(rect);
+}
+
+void vidgfx_cmdlist_set_user_render_target_viewport(
+	VidgfxCmdList *cmdlist,
+	const QSize &size)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setUserRenderTargetViewport(size);
+}
+
+void vidgfx_cmdlist_set_resize_layer_rect(
+	VidgfxCmdList *cmdlist,
+	const QRectF &rect)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setResizeLayerRect(rect);
+}
+
+void vidgfx_cmdlist_set_rgb_nv16_px_size(
+	VidgfxCmdList *cmdlist,
+	const QPointF &size)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setRgbNv16PxSize(size);
+}
+
+void vidgfx_cmdlist_set_tex_decal_mod_color(
+	VidgfxCmdList *cmdlist,
+	const QColor &color)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setTexDecalModColor(color);
+}
+
+void vidgfx_cmdlist_set_tex_decal_effects(
+	VidgfxCmdList *cmdlist,
+	float gamma,
+	float brightness,
+	float contrast,
+	float saturation)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setTexDecalEffects(gamma, brightness, contrast, saturation);
+}
+
+void vidgfx_cmdlist_set_tex_decal_srgb(
+	VidgfxCmdList *cmdlist,
+	bool decode_srgb)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setTexDecalSrgb(decode_srgb);
+}
+
+void vidgfx_cmdlist_set_render_target(
+	VidgfxCmdList *cmdlist,
+	VidgfxRendTarget target)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setRenderTarget(target);
+}
+
+void vidgfx_cmdlist_set_shader(
+	VidgfxCmdList *cmdlist,
+	VidgfxShader shader)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setShader(shader);
+}
+
+void vidgfx_cmdlist_set_topology(
+	VidgfxCmdList *cmdlist,
+	VidgfxTopology topology)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setTopology(topology);
+}
+
+void vidgfx_cmdlist_set_blending(
+	VidgfxCmdList *cmdlist,
+	VidgfxBlending blending)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setBlending(blending);
+}
+
+void vidgfx_cmdlist_set_tex(
+	VidgfxCmdList *cmdlist,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b,
+	VidgfxTex *tex_c)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	Texture *texA = reinterpret_cast<Texture *>(tex_a);
+	Texture *texB = reinterpret_cast<Texture *>(tex_b);
+	Texture *texC = reinterpret_cast<Texture *>(tex_c);
+	ptr->setTexture(texA, texB, texC);
+}
+
+void vidgfx_cmdlist_set_tex_filter(
+	VidgfxCmdList *cmdlist,
+	VidgfxFilter filter)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setTextureFilter(filter);
+}
+
+void vidgfx_cmdlist_set_scissor_rect(
+	VidgfxCmdList *cmdlist,
+	const QRect &rect)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->setScissorRect(rect);
+}
+
+void vidgfx_cmdlist_clear(
+	VidgfxCmdList *cmdlist,
+	const QColor &color)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->clear(color);
+}
+
+void vidgfx_cmdlist_draw_buf(
+	VidgfxCmdList *cmdlist,
+	VidgfxVertBuf *buf,
+	int num_vertices,
+	int start_vertex)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->drawBuffer(
+		reinterpret_cast<VertexBuffer *>(buf), num_vertices, start_vertex);
+}
+
+void vidgfx_cmdlist_draw_instanced(
+	VidgfxCmdList *cmdlist,
+	VidgfxVertBuf *inst_buf,
+	int num_instances,
+	int start_instance)
+{
+	CommandList *ptr = reinterpret_cast<CommandList *>(cmdlist);
+	ptr->drawInstanced(
+		reinterpret_cast<VertexBuffer *>(inst_buf), num_instances,
+		start_instance);
+}
+
+//=============================================================================
+// RenditionScaler C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+VidgfxRenditionScaler *vidgfx_renditionscaler_new(
+	VidgfxContext *context,
+	int readback_depth)
+{
+	GraphicsContext *con = reinterpret_cast<GraphicsContext *>(context);
+	RenditionScaler *scaler = new RenditionScaler(con, readback_depth);
+	return reinterpret_cast<VidgfxRenditionScaler *>(scaler);
+}
+
+void vidgfx_renditionscaler_destroy(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	if(ptr != NULL)
+		delete ptr;
+}
+
+//-----------------------------------------------------------------------------
+// Methods
+
+void vidgfx_renditionscaler_set_context(
+	VidgfxRenditionScaler *scaler,
+	VidgfxContext *context)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	GraphicsContext *con = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setContext(con);
+}
+
+void vidgfx_renditionscaler_destroy_resources(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->deleteResources();
+}
+
+int vidgfx_renditionscaler_add_rendition(
+	VidgfxRenditionScaler *scaler,
+	const QSize &size,
+	VidgfxPixFormat format,
+	VidgfxFilter filter,
+	VidgfxYuvMatrix matrix)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->addRendition(size, format, filter, matrix);
+}
+
+void vidgfx_renditionscaler_remove_all_renditions(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->removeAllRenditions();
+}
+
+int vidgfx_renditionscaler_get_num_renditions(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getNumRenditions();
+}
+
+QSize vidgfx_renditionscaler_get_rendition_size(
+	VidgfxRenditionScaler *scaler,
+	int rendition)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getRenditionSize(rendition);
+}
+
+VidgfxPixFormat vidgfx_renditionscaler_get_rendition_format(
+	VidgfxRenditionScaler *scaler,
+	int rendition)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getRenditionFormat(rendition);
+}
+
+int vidgfx_renditionscaler_get_num_planes(
+	VidgfxRenditionScaler *scaler,
+	int rendition)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getNumPlanes(rendition);
+}
+
+VidgfxTex *vidgfx_renditionscaler_get_plane(
+	VidgfxRenditionScaler *scaler,
+	int rendition,
+	int plane)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	Texture *ret = ptr->getPlane(rendition, plane);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+bool vidgfx_renditionscaler_process(
+	VidgfxRenditionScaler *scaler,
+	VidgfxTex *src)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	Texture *srcTex = reinterpret_cast<Texture *>(src);
+	return ptr->process(srcTex);
+}
+
+bool vidgfx_renditionscaler_try_dequeue(
+	VidgfxRenditionScaler *scaler,
+	int rendition,
+	VidgfxTex *planes_out[])
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	Texture **planesOut = reinterpret_cast<Texture **>(planes_out);
+	return ptr->tryDequeue(rendition, planesOut);
+}
+
+void vidgfx_renditionscaler_release_dequeued(
+	VidgfxRenditionScaler *scaler,
+	int rendition)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->releaseDequeued(rendition);
+}
+
+quint32 vidgfx_renditionscaler_get_num_dropped(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getNumDropped();
+}
+
+void vidgfx_renditionscaler_set_preview(
+	VidgfxRenditionScaler *scaler,
+	const QSize &size,
+	int divisor)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->setPreview(size, divisor);
+}
+
+QSize vidgfx_renditionscaler_get_preview_size(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getPreviewSize();
+}
+
+int vidgfx_renditionscaler_get_preview_divisor(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return ptr->getPreviewDivisor();
+}
+
+VidgfxTex *vidgfx_renditionscaler_get_preview_tex(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	return reinterpret_cast<VidgfxTex *>(ptr->getPreviewTexture());
+}
+
+void vidgfx_renditionscaler_mark_preview_dirty(
+	VidgfxRenditionScaler *scaler,
+	const QRect &rect)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->markPreviewDirty(rect);
+}
+
+void vidgfx_renditionscaler_mark_preview_dirty_all(
+	VidgfxRenditionScaler *scaler)
+{
+	RenditionScaler *ptr = reinterpret_cast<RenditionScaler *>(scaler);
+	ptr->markPreviewDirty();
+}
+
+//=============================================================================
+// TextureLoader C interface
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+VidgfxTexLoader *vidgfx_texloader_new(
+	VidgfxContext *context,
+	int max_threads)
+{
+	GraphicsContext *con = reinterpret_cast<GraphicsContext *>(context);
+	TextureLoader *loader = new TextureLoader(con, max_threads);
+	return reinterpret_cast<VidgfxTexLoader *>(loader);
+}
+
+void vidgfx_texloader_destroy(
+	VidgfxTexLoader *loader)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	if(ptr != NULL)
+		delete ptr;
+}
+
+//-----------------------------------------------------------------------------
+// Methods
+
+void vidgfx_texloader_set_context(
+	VidgfxTexLoader *loader,
+	VidgfxContext *context)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	ptr->setContext(reinterpret_cast<GraphicsContext *>(context));
+}
+
+int vidgfx_texloader_load_file(
+	VidgfxTexLoader *loader,
+	const QString &filename,
+	bool dilute)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	return ptr->loadFile(filename, dilute);
+}
+
+int vidgfx_texloader_load_img(
+	VidgfxTexLoader *loader,
+	const QImage &img,
+	bool dilute)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	return ptr->loadImage(img, dilute);
+}
+
+void vidgfx_texloader_cancel(
+	VidgfxTexLoader *loader,
+	int id)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	ptr->cancel(id);
+}
+
+void vidgfx_texloader_cancel_all(
+	VidgfxTexLoader *loader)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	ptr->cancelAll();
+}
+
+bool vidgfx_texloader_is_pending(
+	VidgfxTexLoader *loader,
+	int id)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	return ptr->isPending(id);
+}
+
+int vidgfx_texloader_get_num_pending(
+	VidgfxTexLoader *loader)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	return ptr->getNumPending();
+}
+
+int vidgfx_texloader_process_uploads(
+	VidgfxTexLoader *loader,
+	int budget_usec)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	return ptr->processUploads(budget_usec);
+}
+
+//-----------------------------------------------------------------------------
+// Signals
+
+void vidgfx_texloader_add_loaded_callback(
+	VidgfxTexLoader *loader,
+	VidgfxTexLoaderLoadedCallback *loaded,
+	void *opaque)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	ptr->addLoadedCallback(loaded, opaque);
+}
+
+void vidgfx_texloader_remove_loaded_callback(
+	VidgfxTexLoader *loader,
+	VidgfxTexLoaderLoadedCallback *loaded,
+	void *opaque)
+{
+	TextureLoader *ptr = reinterpret_cast<TextureLoader *>(loader);
+	ptr->removeLoadedCallback(loaded, opaque);
+}
+
+//=============================================================================
+// GraphicsContext C interface
+
+//-----------------------------------------------------------------------------
+// Static methods
+
+bool vidgfx_create_solid_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QColor &col)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createSolidRect(ptr, rect, col);
+}
+
+bool vidgfx_create_solid_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QColor &tl_col,
+	const QColor &tr_col,
+	const QColor &bl_col,
+	const QColor &br_col)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createSolidRect(
+		ptr, rect, tl_col, tr_col, bl_col, br_col);
+}
+
+bool vidgfx_create_solid_rect_outline(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QColor &col,
+	const QPointF &half_width)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createSolidRectOutline(
+		ptr, rect, col, half_width);
+}
+
+bool vidgfx_create_solid_rect_outline(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QColor &tl_col,
+	const QColor &tr_col,
+	const QColor &bl_col,
+	const QColor &br_col,
+	const QPointF &half_width)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createSolidRectOutline(
+		ptr, rect, tl_col, tr_col, bl_col, br_col, half_width);
+}
+
+bool vidgfx_create_tex_decal_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createTexDecalRect(ptr, rect);
+}
+
+bool vidgfx_create_tex_decal_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QPointF &br_uv)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createTexDecalRect(ptr, rect, br_uv);
+}
+
+bool vidgfx_create_tex_decal_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	const QPointF &tl_uv,
+	const QPointF &tr_uv,
+	const QPointF &bl_uv,
+	const QPointF &br_uv)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createTexDecalRect(
+		ptr, rect, tl_uv, tr_uv, bl_uv, br_uv);
+}
+
+bool vidgfx_create_resize_rect(
+	VidgfxVertBuf *out_buf,
+	const QRectF &rect,
+	float handle_size,
+	const QPointF &half_width)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createResizeRect(
+		ptr, rect, handle_size, half_width);
+}
+
+bool vidgfx_create_tex_decal_instance(
+	VidgfxVertBuf *out_buf,
+	int instance,
+	const QRectF &rect,
+	const QPointF &tl_uv,
+	const QPointF &br_uv,
+	const QPointF &scroll_offset)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createTexDecalInstance(
+		ptr, instance, rect, tl_uv, br_uv, scroll_offset);
+}
+
+bool vidgfx_create_solid_rect_outline_instance(
+	VidgfxVertBuf *out_buf,
+	int instance,
+	const QRectF &rect,
+	const QColor &col,
+	const QPointF &half_width)
+{
+	VertexBuffer *ptr = reinterpret_cast<VertexBuffer *>(out_buf);
+	return GraphicsContext::createSolidRectOutlineInstance(
+		ptr, instance, rect, col, half_width);
+}
+
+quint32 vidgfx_next_pow_two(
+	quint32 n)
+{
+	return GraphicsContext::nextPowTwo(n);
+}
+
+//-----------------------------------------------------------------------------
+// Methods
+
+void vidgfx_context_set_view_mat(
+	VidgfxContext *context,
+	const QMatrix4x4 &matrix)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setViewMatrix(matrix);
+}
+
+QMatrix4x4 vidgfx_context_get_view_mat(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getViewMatrix();
+}
+
+void vidgfx_context_set_proj_mat(
+	VidgfxContext *context,
+	const QMatrix4x4 &matrix)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setProjectionMatrix(matrix);
+}
+
+QMatrix4x4 vidgfx_context_get_proj_mat(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getProjectionMatrix();
+}
+
+void vidgfx_context_set_screen_view_mat(
+	VidgfxContext *context,
+	const QMatrix4x4 &matrix)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setScreenViewMatrix(matrix);
+}
+
+QMatrix4x4 vidgfx_context_get_screen_view_mat(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getScreenViewMatrix();
+}
+
+void vidgfx_context_set_screen_proj_mat(
+	VidgfxContext *context,
+	const QMatrix4x4 &matrix)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setScreenProjectionMatrix(matrix);
+}
+
+QMatrix4x4 vidgfx_context_get_screen_proj_mat(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getScreenProjectionMatrix();
+}
+
+void vidgfx_context_set_user_render_target(
+	VidgfxContext *context,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *texA = reinterpret_cast<Texture *>(tex_a);
+	Texture *texB = reinterpret_cast<Texture *>(tex_b);
+	ptr->setUserRenderTarget(texA, texB);
+}
+
+VidgfxTex *vidgfx_context_get_user_render_target(
+	VidgfxContext *context,
+	int index)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->getUserRenderTarget(index);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+void vidgfx_context_set_user_render_target_viewport(
+	VidgfxContext *context,
+	const QRect &rect)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setUserRenderTargetViewport(rect);
+}
+
+void vidgfx_context_set_user_render_target_viewport(
+	VidgfxContext *context,
+	const QSize &size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setUserRenderTargetViewport(size);
+}
+
+QRect vidgfx_context_get_user_render_target_viewport(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getUserRenderTargetViewport();
+}
+
+void vidgfx_context_set_resize_layer_rect(
+	VidgfxContext *context,
+	const QRectF &rect)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setResizeLayerRect(rect);
+}
+
+QRectF vidgfx_context_get_resize_layer_rect(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getResizeLayerRect();
+}
+
+void vidgfx_context_set_rgb_nv16_px_size(
+	VidgfxContext *context,
+	const QPointF &size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setRgbNv16PxSize(size);
+}
+
+QPointF vidgfx_context_get_rgb_nv16_px_size(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getRgbNv16PxSize();
+}
+
+void vidgfx_context_set_tex_decal_mod_color(
+	VidgfxContext *context,
+	const QColor &color)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setTexDecalModColor(color);
+}
+
+QColor vidgfx_context_get_tex_decal_mod_color(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getTexDecalModColor();
+}
+
+void vidgfx_context_set_tex_decal_effects(
+	VidgfxContext *context,
+	float gamma,
+	float brightness,
+	float contrast,
+	float saturation)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setTexDecalEffects(gamma, brightness, contrast, saturation);
+}
+
+bool vidgfx_context_set_tex_decal_effects_helper(
+	VidgfxContext *context,
+	float gamma,
+	int brightness,
+	int contrast,
+	int saturation)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->setTexDecalEffectsHelper(
+		gamma, brightness, contrast, saturation);
+}
+
+const float *vidgfx_context_get_tex_decal_effects(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getTexDecalEffects();
+}
+
+void vidgfx_context_set_tex_decal_srgb(
+	VidgfxContext *context,
+	bool decode_srgb)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setTexDecalSrgb(decode_srgb);
+}
+
+bool vidgfx_context_get_tex_decal_srgb(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getTexDecalSrgb();
+}
+
+bool vidgfx_context_dilute_img(
+	VidgfxContext *context,
+	QImage &img)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->diluteImage(img);
+}
+
+void vidgfx_context_add_canvas_damage(
+	VidgfxContext *context,
+	const QRect &rect)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->addCanvasDamage(rect);
+}
+
+void vidgfx_context_add_canvas_damage_all(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->addCanvasDamage();
+}
+
+bool vidgfx_context_begin_canvas_redraw(
+	VidgfxContext *context,
+	VidgfxRendTarget target,
+	bool carry_over)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->beginCanvasRedraw(target, carry_over);
+}
+
+QRect vidgfx_context_get_canvas_redraw_rect(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getCanvasRedrawRect();
+}
+
+void vidgfx_context_end_canvas_redraw(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->endCanvasRedraw();
+}
+
+//-----------------------------------------------------------------------------
+// Interface
+
+bool vidgfx_context_is_valid(
+	VidgfxContext *context)
+{
+	if(context == NULL)
+		return false;
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->isValid();
+}
+
+void vidgfx_context_flush(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->flush();
+}
+
+VidgfxVertBuf *vidgfx_context_new_vertbuf(
+	VidgfxContext *context,
+	int size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	VertexBuffer *ret = ptr->createVertexBuffer(size);
+	return reinterpret_cast<VidgfxVertBuf *>(ret);
+}
+
+void vidgfx_context_destroy_vertbuf(
+	VidgfxContext *context,
+	VidgfxVertBuf *buf)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	VertexBuffer *vertBuf = reinterpret_cast<VertexBuffer *>(buf);
+	ptr->deleteVertexBuffer(vertBuf);
+}
+
+VidgfxTex *vidgfx_context_new_tex(
+	VidgfxContext *context,
+	QImage img,
+	bool writable,
+	bool targetable)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->createTexture(img, writable, targetable);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_context_new_tex(
+	VidgfxContext *context,
+	const QSize &size,
+	bool writable,
+	bool targetable,
+	bool use_bgra)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->createTexture(size, writable, targetable, use_bgra);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_context_new_tex(
+	VidgfxContext *context,
+	const QSize &size,
+	VidgfxTex *same_format,
+	bool writable,
+	bool targetable)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->createTexture(size, same_format, writable, targetable);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_context_new_staging_tex(
+	VidgfxContext *context,
+	const QSize &size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->createStagingTexture(size);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_context_new_rg_tex(
+	VidgfxContext *context,
+	const QSize &size,
+	bool writable,
+	bool targetable)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->createRgTexture(size, writable, targetable);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+void vidgfx_context_destroy_tex(
+	VidgfxContext *context,
+	VidgfxTex *tex)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *texture = reinterpret_cast<Texture *>(tex);
+	ptr->deleteTexture(texture);
+}
+
+bool vidgfx_context_copy_tex_data(
+	VidgfxContext *context,
+	VidgfxTex *dst,
+	VidgfxTex *src,
+	const QPoint &dst_pos,
+	const QRect &src_rect)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *dest = reinterpret_cast<Texture *>(dst);
+	Texture *source = reinterpret_cast<Texture *>(src);
+	return ptr->copyTextureData(dest, source, dst_pos, src_rect);
+}
+
+VidgfxReadbackQueue *vidgfx_context_new_readbackqueue(
+	VidgfxContext *context,
+	const QSize &size,
+	int depth)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ReadbackQueue *ret = ptr->createReadbackQueue(size, depth);
+	return reinterpret_cast<VidgfxReadbackQueue *>(ret);
+}
+
+void vidgfx_context_destroy_readbackqueue(
+	VidgfxContext *context,
+	VidgfxReadbackQueue *queue)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ReadbackQueue *rbQueue = reinterpret_cast<ReadbackQueue *>(queue);
+	ptr->deleteReadbackQueue(rbQueue);
+}
+
+void vidgfx_context_resize_screen_target(
+	VidgfxContext *context,
+	const QSize &new_size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->resizeScreenTarget(new_size);
+}
+
+void vidgfx_context_resize_canvas_target(
+	VidgfxContext *context,
+	const QSize &new_size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->resizeCanvasTarget(new_size);
+}
+
+void vidgfx_context_resize_scratch_target(
+	VidgfxContext *context,
+	const QSize &new_size)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->resizeScratchTarget(new_size);
+}
+
+void vidgfx_context_swap_screen_bufs(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->swapScreenBuffers();
+}
+
+VidgfxTex *vidgfx_context_get_target_tex(
+	VidgfxContext *context,
+	VidgfxRendTarget target)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *ret = ptr->getTargetTexture(target);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxRendTarget vidgfx_context_get_next_scratch_target(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getNextScratchTarget();
+}
+
+QPointF vidgfx_context_get_scratch_target_to_tex_ratio(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getScratchTargetToTextureRatio();
+}
+
+VidgfxTex *vidgfx_context_prepare_tex(
+	VidgfxContext *context,
+	VidgfxTex *tex,
+	const QSize &size,
+	VidgfxFilter filter,
+	bool set_filter,
+	QPointF &px_size_out,
+	QPointF &bot_right_out)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *texture = reinterpret_cast<Texture *>(tex);
+	Texture *ret = ptr->prepareTexture(
+		texture, size, filter, set_filter, px_size_out, bot_right_out);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_context_prepare_tex(
+	VidgfxContext *context,
+	VidgfxTex *tex,
+	const QRect &crop_rect,
+	const QSize &size,
+	VidgfxFilter filter,
+	bool set_filter,
+	QPointF &px_size_out,
+	QPointF &top_left_out,
+	QPointF &bot_right_out)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *texture = reinterpret_cast<Texture *>(tex);
+	Texture *ret = ptr->prepareTexture(
+		texture, crop_rect, size, filter, set_filter, px_size_out,
+		top_left_out, bot_right_out);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+void vidgfx_context_set_scale_cache_size(
+	VidgfxContext *context,
+	int max_entries)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setScaleCacheSize(max_entries);
+}
+
+int vidgfx_context_get_scale_cache_size(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getScaleCacheSize();
+}
+
+void vidgfx_context_purge_scale_cache(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->purgeScaleCache();
+}
+
+VidgfxTex *vidgfx_context_convert_to_bgrx(
+	VidgfxContext *context,
+	VidgfxPixFormat format,
+	VidgfxTex *plane_a,
+	VidgfxTex *plane_b,
+	VidgfxTex *plane_c)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *planeA = reinterpret_cast<Texture *>(plane_a);
+	Texture *planeB = reinterpret_cast<Texture *>(plane_b);
+	Texture *planeC = reinterpret_cast<Texture *>(plane_c);
+	Texture *ret = ptr->convertToBgrx(format, planeA, planeB, planeC);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+bool vidgfx_context_convert_from_rgb(
+	VidgfxContext *context,
+	VidgfxPixFormat format,
+	VidgfxTex *src,
+	VidgfxTex *plane_a,
+	VidgfxTex *plane_b,
+	VidgfxTex *plane_c)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *srcTex = reinterpret_cast<Texture *>(src);
+	Texture *planeA = reinterpret_cast<Texture *>(plane_a);
+	Texture *planeB = reinterpret_cast<Texture *>(plane_b);
+	Texture *planeC = reinterpret_cast<Texture *>(plane_c);
+	return ptr->convertFromRgb(format, srcTex, planeA, planeB, planeC);
+}
+
+bool vidgfx_context_scale_to_nv16(
+	VidgfxContext *context,
+	VidgfxTex *src,
+	VidgfxTex *plane_y,
+	VidgfxTex *plane_uv,
+	VidgfxYuvMatrix matrix)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *srcTex = reinterpret_cast<Texture *>(src);
+	Texture *planeY = reinterpret_cast<Texture *>(plane_y);
+	Texture *planeUV = reinterpret_cast<Texture *>(plane_uv);
+	return ptr->scaleToNv16(srcTex, planeY, planeUV, matrix);
+}
+
+bool vidgfx_context_dilute_tex(
+	VidgfxContext *context,
+	VidgfxTex *src,
+	VidgfxTex *dst)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *srcTex = reinterpret_cast<Texture *>(src);
+	Texture *dstTex = reinterpret_cast<Texture *>(dst);
+	return ptr->diluteTexture(srcTex, dstTex);
+}
+
+void vidgfx_context_set_render_target(
+	VidgfxContext *context,
+	VidgfxRendTarget target)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setRenderTarget(target);
+}
+
+VidgfxRendTarget vidgfx_context_get_render_target(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->getRenderTarget();
+}
+
+void vidgfx_context_set_shader(
+	VidgfxContext *context,
+	VidgfxShader shader)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setShader(shader);
+}
+
+void vidgfx_context_set_topology(
+	VidgfxContext *context,
+	VidgfxTopology topology)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setTopology(topology);
+}
+
+void vidgfx_context_set_blending(
+	VidgfxContext *context,
+	VidgfxBlending blending)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setBlending(blending);
+}
+
+void vidgfx_context_set_tex(
+	VidgfxContext *context,
+	VidgfxTex *tex_a,
+	VidgfxTex *tex_b,
+	VidgfxTex *tex_c)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	Texture *texA = reinterpret_cast<Texture *>(tex_a);
+	Texture *texB = reinterpret_cast<Texture *>(tex_b);
+	Texture *texC = reinterpret_cast<Texture *>(tex_c);
+	ptr->setTexture(texA, texB, texC);
+}
+
+void vidgfx_context_set_tex_filter(
+	VidgfxContext *context,
+	VidgfxFilter filter)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setTextureFilter(filter);
+}
+
+void vidgfx_context_set_scissor_rect(
+	VidgfxContext *context,
+	const QRect &rect)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->setScissorRect(rect);
+}
+
+void vidgfx_context_clear(
+	VidgfxContext *context,
+	const QColor &color)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->clear(color);
+}
+
+void vidgfx_context_draw_buf(
+	VidgfxContext *context,
+	VidgfxVertBuf *buf,
+	int num_vertices,
+	int start_vertex)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	VertexBuffer *vertBuf = reinterpret_cast<VertexBuffer *>(buf);
+	ptr->drawBuffer(vertBuf, num_vertices, start_vertex);
+}
+
+bool vidgfx_context_has_instancing_support(
+	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	return ptr->hasInstancingSupport();
+}
+
+void vidgfx_context_draw_instanced(
+	VidgfxContext *context,
+	VidgfxVertBuf *inst_buf,
+	int num_instances,
+	int start_instance)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	VertexBuffer *instBuf = reinterpret_cast<VertexBuffer *>(inst_buf);
+	ptr->drawInstanced(instBuf, num_instances, start_instance);
+}
+
+//-----------------------------------------------------------------------------
+// Signals
+
+void vidgfx_context_add_initialized_callback(
+	VidgfxContext *context,
+	VidgfxContextInitializedCallback *initialized,
+	void *opaque)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->addInitializedCallback(initialized, opaque);
+}
+
+void vidgfx_context_remove_initialized_callback(
+	VidgfxContext *context,
+	VidgfxContextInitializedCallback *initialized,
+	void *opaque)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->removeInitializedCallback(initialized, opaque);
+}
+
+void vidgfx_context_add_destroying_callback(
+	VidgfxContext *context,
+	VidgfxContextDestroyingCallback *destroying,
+	void *opaque)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->addDestroyingCallback(destroying, opaque);
+}
+
+void vidgfx_context_remove_destroying_callback(
+	VidgfxContext *context,
+	VidgfxContextDestroyingCallback *destroying,
+	void *opaque)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	ptr->removeDestroyingCallback(destroying, opaque);
+}
+
+//=============================================================================
+// D3DTexture C API
+
+#if VIDGFX_D3D_ENABLED
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+VidgfxD3DTex *vidgfx_tex_get_d3dtex(
+	VidgfxTex *tex)
+{
+	Texture *ptr = reinterpret_cast<Texture *>(tex);
+	D3DTexture *d3dTex = static_cast<D3DTexture *>(ptr);
+	return reinterpret_cast<VidgfxD3DTex *>(d3dTex);
+}
+
+VidgfxTex *vidgfx_d3dtex_get_tex(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	Texture *texture = static_cast<Texture *>(ptr);
+	return reinterpret_cast<VidgfxTex *>(texture);
+}
+
+//-----------------------------------------------------------------------------
+// Methods
+
+HDC vidgfx_d3dtex_get_dc(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->getDC();
+}
+
+void vidgfx_d3dtex_release_dc(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	ptr->releaseDC();
+}
+
+HANDLE vidgfx_d3dtex_get_shared_handle(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->getSharedHandle();
+}
+
+bool vidgfx_d3dtex_has_keyed_mutex(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->hasKeyedMutex();
+}
+
+bool vidgfx_d3dtex_is_sync_acquired(
+	VidgfxD3DTex *tex)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->isSyncAcquired();
+}
+
+VidgfxSyncResult vidgfx_d3dtex_acquire_sync(
+	VidgfxD3DTex *tex,
+	quint64 key,
+	int timeout_msec)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->acquireSync(key, timeout_msec);
+}
+
+bool vidgfx_d3dtex_release_sync(
+	VidgfxD3DTex *tex,
+	quint64 key)
+{
+	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	return ptr->releaseSync(key);
+}
+
+#endif // VIDGFX_D3D_ENABLED
+
+//=============================================================================
+// D3DContext C API
+
+#if VIDGFX_D3D_ENABLED
+
+//-----------------------------------------------------------------------------
+// Static methods
 
-bool vidgfx_context_is_valid(
+HRESULT vidgfx_d3d_create_dxgifactory1_dyn(
+	IDXGIFactory1 **factory_out)
+{
+	return D3DContext::createDXGIFactory1Dynamic(factory_out);
+}
+
+void vidgfx_d3d_log_display_adapters()
+{
+	D3DContext::logDisplayAdapters();
+}
+
+int vidgfx_d3d_query_adapters(
+	VidgfxD3DAdapterInfo *adapters_out,
+	int max_adapters)
+{
+	QVector<VidgfxD3DAdapterInfo> adapters = D3DContext::queryAdapters();
+	int num = qMin(adapters.size(), qMax(0, max_adapters));
+	for(int i = 0; i < num; i++)
+		adapters_out[i] = adapters.at(i);
+	return adapters.size();
+}
+
+int vidgfx_d3d_get_recommended_adapter(
+	const VidgfxD3DAdapterInfo *adapters,
+	int num_adapters,
+	quint32 prefer_vendor_id)
+{
+	QVector<VidgfxD3DAdapterInfo> vec;
+	for(int i = 0; i < num_adapters; i++)
+		vec.append(adapters[i]);
+	return D3DContext::getRecommendedAdapter(vec, prefer_vendor_id);
+}
+
+//-----------------------------------------------------------------------------
+// Constructor/destructor
+
+VidgfxD3DContext *vidgfx_d3dcontext_new()
+{
+	D3DContext *d3dContext = new D3DContext();
+	return reinterpret_cast<VidgfxD3DContext *>(d3dContext);
+}
+
+void vidgfx_d3dcontext_destroy(
+	VidgfxD3DContext *context)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	if(ptr != NULL)
+		delete ptr;
+}
+
+VidgfxD3DContext *vidgfx_context_get_d3dcontext(
 	VidgfxContext *context)
+{
+	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	D3DContext *d3dContext = static_cast<D3DContext *>(ptr);
+	return reinterpret_cast<VidgfxD3DContext *>(d3dContext);
+}
+
+VidgfxContext *vidgfx_d3dcontext_get_context(
+	VidgfxD3DContext *context)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	GraphicsContext *gfx = static_cast<GraphicsContext *>(ptr);
+	return reinterpret_cast<VidgfxContext *>(gfx);
+}
+
+//-----------------------------------------------------------------------------
+// Methods
+
+bool vidgfx_d3dcontext_is_valid(
+	VidgfxD3DContext *context)
 {
 	if(context == NULL)
 		return false;
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
 	return ptr->isValid();
 }
 
-void vidgfx_context_flush(
-	VidgfxContext *context)
+bool vidgfx_d3dcontext_init(
+	VidgfxD3DContext *context,
+	HWND hwnd,
+	const QSize &size,
+	const QColor &resize_border_col,
+	int adapter)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->flush();
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->initialize(hwnd, size, resize_border_col, adapter);
 }
 
-VidgfxVertBuf *vidgfx_context_new_vertbuf(
-	VidgfxContext *context,
-	int size)
+int vidgfx_d3dcontext_get_adapter(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	VertexBuffer *ret = ptr->createVertexBuffer(size);
-	return reinterpret_cast<VidgfxVertBuf *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getAdapterIndex();
 }
 
-void vidgfx_context_destroy_vertbuf(
-	VidgfxContext *context,
-	VidgfxVertBuf *buf)
+ID3D10Device *vidgfx_d3dcontext_get_device(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	VertexBuffer *vertBuf = reinterpret_cast<VertexBuffer *>(buf);
-	ptr->deleteVertexBuffer(vertBuf);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getDevice();
 }
 
-VidgfxTex *vidgfx_context_new_tex(
-	VidgfxContext *context,
-	QImage img,
-	bool writable,
-	bool targetable)
+bool vidgfx_d3dcontext_has_dxgi11(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->createTexture(img, writable, targetable);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->hasDxgi11();
 }
 
-VidgfxTex *vidgfx_context_new_tex(
-	VidgfxContext *context,
-	const QSize &size,
-	bool writable,
-	bool targetable,
-	bool use_bgra)
+bool vidgfx_d3dcontext_has_bgra_tex_support(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->createTexture(size, writable, targetable, use_bgra);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->hasBgraTexSupport();
+}
+
+VidgfxTex *vidgfx_d3dcontext_new_gdi_tex(
+	VidgfxD3DContext *context,
+	const QSize &size)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	Texture *ret = ptr->createGDITexture(size);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-VidgfxTex *vidgfx_context_new_tex(
-	VidgfxContext *context,
+VidgfxTex *vidgfx_d3dcontext_new_shared_tex(
+	VidgfxD3DContext *context,
 	const QSize &size,
-	VidgfxTex *same_format,
-	bool writable,
-	bool targetable)
+	bool use_keyed_mutex)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->createTexture(size, same_format, writable, targetable);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	Texture *ret = ptr->createSharedTexture(size, use_keyed_mutex);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-VidgfxTex *vidgfx_context_new_staging_tex(
-	VidgfxContext *context,
-	const QSize &size)
+VidgfxTex *vidgfx_d3dcontext_open_shared_tex(
+	VidgfxD3DContext *context,
+	HANDLE shared_handle)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->createStagingTexture(size);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	Texture *ret = ptr->openSharedTexture(shared_handle);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-void vidgfx_context_destroy_tex(
-	VidgfxContext *context,
-	VidgfxTex *tex)
+VidgfxTex *vidgfx_d3dcontext_open_dx10_tex(
+	VidgfxD3DContext *context,
+	ID3D10Texture2D *tex)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *texture = reinterpret_cast<Texture *>(tex);
-	ptr->deleteTexture(texture);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	Texture *ret = ptr->openDX10Texture(tex);
+	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-bool vidgfx_context_copy_tex_data(
-	VidgfxContext *context,
-	VidgfxTex *dst,
-	VidgfxTex *src,
-	const QPoint &dst_pos,
-	const QRect &src_rect)
+void vidgfx_d3dcontext_set_tex_pool_limit(
+	VidgfxD3DContext *context,
+	qint64 max_bytes)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *dest = reinterpret_cast<Texture *>(dst);
-	Texture *source = reinterpret_cast<Texture *>(src);
-	return ptr->copyTextureData(dest, source, dst_pos, src_rect);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->setTexturePoolLimit(max_bytes);
 }
 
-void vidgfx_context_resize_screen_target(
-	VidgfxContext *context,
-	const QSize &new_size)
+qint64 vidgfx_d3dcontext_get_tex_pool_limit(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->resizeScreenTarget(new_size);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getTexturePoolLimit();
 }
 
-void vidgfx_context_resize_canvas_target(
-	VidgfxContext *context,
-	const QSize &new_size)
+void vidgfx_d3dcontext_trim_tex_pool(
+	VidgfxD3DContext *context,
+	qint64 max_bytes)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->resizeCanvasTarget(new_size);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->trimTexturePool(max_bytes);
 }
 
-void vidgfx_context_resize_scratch_target(
-	VidgfxContext *context,
-	const QSize &new_size)
+VidgfxD3DTexPoolStats vidgfx_d3dcontext_get_tex_pool_stats(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->resizeScratchTarget(new_size);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getTexturePoolStats();
 }
 
-void vidgfx_context_swap_screen_bufs(
-	VidgfxContext *context)
+void vidgfx_d3dcontext_set_present_mode(
+	VidgfxD3DContext *context,
+	const VidgfxD3DPresentMode &mode)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->swapScreenBuffers();
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->setPresentMode(mode);
 }
 
-VidgfxTex *vidgfx_context_get_target_tex(
-	VidgfxContext *context,
-	VidgfxRendTarget target)
+VidgfxD3DPresentMode vidgfx_d3dcontext_get_present_mode(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *ret = ptr->getTargetTexture(target);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getPresentMode();
 }
 
-VidgfxRendTarget vidgfx_context_get_next_scratch_target(
-	VidgfxContext *context)
+bool vidgfx_d3dcontext_is_screen_frame_due(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getNextScratchTarget();
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->isScreenFrameDue();
 }
 
-QPointF vidgfx_context_get_scratch_target_to_tex_ratio(
-	VidgfxContext *context)
+quint32 vidgfx_d3dcontext_get_num_dropped_presents(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	return ptr->getScratchTargetToTextureRatio();
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getNumDroppedPresents();
 }
 
-VidgfxTex *vidgfx_context_prepare_tex(
-	VidgfxContext *context,
-	VidgfxTex *tex,
-	const QSize &size,
-	VidgfxFilter filter,
-	bool set_filter,
-	QPointF &px_size_out,
-	QPointF &bot_right_out)
+void vidgfx_d3dcontext_invalidate_state_cache(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *texture = reinterpret_cast<Texture *>(tex);
-	Texture *ret = ptr->prepareTexture(
-		texture, size, filter, set_filter, px_size_out, bot_right_out);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->invalidateStateCache();
 }
 
-VidgfxTex *vidgfx_context_prepare_tex(
-	VidgfxContext *context,
-	VidgfxTex *tex,
-	const QRect &crop_rect,
-	const QSize &size,
-	VidgfxFilter filter,
-	bool set_filter,
-	QPointF &px_size_out,
-	QPointF &top_left_out,
-	QPointF &bot_right_out)
+quint32 vidgfx_d3dcontext_get_num_redundant_state_calls(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *texture = reinterpret_cast<Texture *>(tex);
-	Texture *ret = ptr->prepareTexture(
-		texture, crop_rect, size, filter, set_filter, px_size_out,
-		top_left_out, bot_right_out);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getNumRedundantStateCalls();
 }
 
-VidgfxTex *vidgfx_context_convert_to_bgrx(
-	VidgfxContext *context,
-	VidgfxPixFormat format,
-	VidgfxTex *plane_a,
-	VidgfxTex *plane_b,
-	VidgfxTex *plane_c)
+void vidgfx_d3dcontext_reset_num_redundant_state_calls(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *planeA = reinterpret_cast<Texture *>(plane_a);
-	Texture *planeB = reinterpret_cast<Texture *>(plane_b);
-	Texture *planeC = reinterpret_cast<Texture *>(plane_c);
-	Texture *ret = ptr->convertToBgrx(format, planeA, planeB, planeC);
-	return reinterpret_cast<VidgfxTex *>(ret);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->resetNumRedundantStateCalls();
+}
+
+bool vidgfx_d3dcontext_is_device_lost(
+	VidgfxD3DContext *context)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->isDeviceLost();
 }
 
-void vidgfx_context_set_render_target(
-	VidgfxContext *context,
-	VidgfxRendTarget target)
+quint32 vidgfx_d3dcontext_get_num_device_resets(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setRenderTarget(target);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->getNumDeviceResets();
 }
 
-void vidgfx_context_set_shader(
-	VidgfxContext *context,
-	VidgfxShader shader)
+bool vidgfx_d3dcontext_recover_device(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setShader(shader);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->recoverDevice();
 }
 
-void vidgfx_context_set_topology(
-	VidgfxContext *context,
-	VidgfxTopology topology)
+void vidgfx_d3dcontext_set_profiling_enabled(
+	VidgfxD3DContext *context,
+	bool enabled)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setTopology(topology);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->setProfilingEnabled(enabled);
 }
 
-void vidgfx_context_set_blending(
-	VidgfxContext *context,
-	VidgfxBlending blending)
+bool vidgfx_d3dcontext_is_profiling_enabled(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setBlending(blending);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	return ptr->isProfilingEnabled();
 }
 
-void vidgfx_context_set_tex(
-	VidgfxContext *context,
-	VidgfxTex *tex_a,
-	VidgfxTex *tex_b,
-	VidgfxTex *tex_c)
+void vidgfx_d3dcontext_begin_profile_frame(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	Texture *texA = reinterpret_cast<Texture *>(tex_a);
-	Texture *texB = reinterpret_cast<Texture *>(tex_b);
-	Texture *texC = reinterpret_cast<Texture *>(tex_c);
-	ptr->setTexture(texA, texB, texC);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->beginProfileFrame();
 }
 
-void vidgfx_context_set_tex_filter(
-	VidgfxContext *context,
-	VidgfxFilter filter)
+void vidgfx_d3dcontext_end_profile_frame(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->setTextureFilter(filter);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->endProfileFrame();
 }
 
-void vidgfx_context_clear(
-	VidgfxContext *context,
-	const QColor &color)
+void vidgfx_d3dcontext_begin_profile_scope(
+	VidgfxD3DContext *context,
+	const char *name)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->clear(color);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->beginProfileScope(name);
 }
 
-void vidgfx_context_draw_buf(
-	VidgfxContext *context,
-	VidgfxVertBuf *buf,
-	int num_vertices,
-	int start_vertex)
+void vidgfx_d3dcontext_end_profile_scope(
+	VidgfxD3DContext *context)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	VertexBuffer *vertBuf = reinterpret_cast<VertexBuffer *>(buf);
-	ptr->drawBuffer(vertBuf, num_vertices, start_vertex);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->endProfileScope();
 }
 
 //-----------------------------------------------------------------------------
 // Signals
 
-void vidgfx_context_add_initialized_callback(
-	VidgfxContext *context,
-	VidgfxContextInitializedCallback *initialized,
+void vidgfx_d3dcontext_add_dxgi11_changed_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextDxgi11ChangedCallback *dxgi11_changed,
 	void *opaque)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->addInitializedCallback(initialized, opaque);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->addDxgi11ChangedCallback(dxgi11_changed, opaque);
 }
 
-void vidgfx_context_remove_initialized_callback(
-	VidgfxContext *context,
-	VidgfxContextInitializedCallback *initialized,
+void vidgfx_d3dcontext_remove_dxgi11_changed_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextDxgi11ChangedCallback *dxgi11_changed,
 	void *opaque)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->removeInitializedCallback(initialized, opaque);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->removeDxgi11ChangedCallback(dxgi11_changed, opaque);
 }
 
-void vidgfx_context_add_destroying_callback(
-	VidgfxContext *context,
-	VidgfxContextDestroyingCallback *destroying,
+void vidgfx_d3dcontext_add_bgra_tex_support_changed_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
 	void *opaque)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->addDestroyingCallback(destroying, opaque);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->addBgraTexSupportChangedCallback(
+		bgra_tex_support_changed, opaque);
 }
 
-void vidgfx_context_remove_destroying_callback(
-	VidgfxContext *context,
-	VidgfxContextDestroyingCallback *destroying,
+void vidgfx_d3dcontext_remove_bgra_tex_support_changed_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
 	void *opaque)
 {
-	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	ptr->removeDestroyingCallback(destroying, opaque);
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->removeBgraTexSupportChangedCallback(
+		bgra_tex_support_changed, opaque);
+}
+
+void vidgfx_d3dcontext_add_profile_frame_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextProfileFrameCallback *profile_frame,
+	void *opaque)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->addProfileFrameCallback(profile_frame, opaque);
+}
+
+void vidgfx_d3dcontext_remove_profile_frame_callback(
+	VidgfxD3DContext *context,
+	VidgfxD3DContextProfileFrameCallback *profile_frame,
+	void *opaque)
+{
+	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	ptr->removeProfileFrameCallback(profile_frame, opaque);
 }
 
+#endif // VIDGFX_D3D_ENABLED
+
 //=============================================================================
-// D3DTexture C API
+// D3D11Texture C API
 
 #if VIDGFX_D3D_ENABLED
 
 //-----------------------------------------------------------------------------
 // Constructor/destructor
 
-VidgfxD3DTex *vidgfx_tex_get_d3dtex(
+VidgfxD3D11Tex *vidgfx_tex_get_d3d11tex(
 	VidgfxTex *tex)
 {
 	Texture *ptr = reinterpret_cast<Texture *>(tex);
-	D3DTexture *d3dTex = static_cast<D3DTexture *>(ptr);
-	return reinterpret_cast<VidgfxD3DTex *>(d3dTex);
+	D3D11Texture *d3dTex = static_cast<D3D11Texture *>(ptr);
+	return reinterpret_cast<VidgfxD3D11Tex *>(d3dTex);
 }
 
-VidgfxTex *vidgfx_d3dtex_get_tex(
-	VidgfxD3DTex *tex)
+VidgfxTex *vidgfx_d3d11tex_get_tex(
+	VidgfxD3D11Tex *tex)
 {
-	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
 	Texture *texture = static_cast<Texture *>(ptr);
 	return reinterpret_cast<VidgfxTex *>(texture);
 }
@@ -1077,70 +2502,101 @@ VidgfxTex *vidgfx_d3dtex_get_tex(
 //-----------------------------------------------------------------------------
 // Methods
 
-HDC vidgfx_d3dtex_get_dc(
-	VidgfxD3DTex *tex)
+ID3D11Texture2D *vidgfx_d3d11tex_get_texture(
+	VidgfxD3D11Tex *tex)
 {
-	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->getTexture();
+}
+
+HDC vidgfx_d3d11tex_get_dc(
+	VidgfxD3D11Tex *tex)
+{
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
 	return ptr->getDC();
 }
 
-void vidgfx_d3dtex_release_dc(
-	VidgfxD3DTex *tex)
+void vidgfx_d3d11tex_release_dc(
+	VidgfxD3D11Tex *tex)
 {
-	D3DTexture *ptr = reinterpret_cast<D3DTexture *>(tex);
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
 	ptr->releaseDC();
 }
 
-#endif // VIDGFX_D3D_ENABLED
-
-//=============================================================================
-// D3DContext C API
+HANDLE vidgfx_d3d11tex_get_shared_handle(
+	VidgfxD3D11Tex *tex)
+{
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->getSharedHandle();
+}
 
-#if VIDGFX_D3D_ENABLED
+bool vidgfx_d3d11tex_has_keyed_mutex(
+	VidgfxD3D11Tex *tex)
+{
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->hasKeyedMutex();
+}
 
-//-----------------------------------------------------------------------------
-// Static methods
+bool vidgfx_d3d11tex_is_sync_acquired(
+	VidgfxD3D11Tex *tex)
+{
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->isSyncAcquired();
+}
 
-HRESULT vidgfx_d3d_create_dxgifactory1_dyn(
-	IDXGIFactory1 **factory_out)
+VidgfxSyncResult vidgfx_d3d11tex_acquire_sync(
+	VidgfxD3D11Tex *tex,
+	quint64 key,
+	int timeout_msec)
 {
-	return D3DContext::createDXGIFactory1Dynamic(factory_out);
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->acquireSync(key, timeout_msec);
 }
 
-void vidgfx_d3d_log_display_adapters()
+bool vidgfx_d3d11tex_release_sync(
+	VidgfxD3D11Tex *tex,
+	quint64 key)
 {
-	D3DContext::logDisplayAdapters();
+	D3D11Texture *ptr = reinterpret_cast<D3D11Texture *>(tex);
+	return ptr->releaseSync(key);
 }
 
+#endif // VIDGFX_D3D_ENABLED
+
+//=============================================================================
+// D3D11Context C API
+
+#if VIDGFX_D3D_ENABLED
+
 //-----------------------------------------------------------------------------
 // Constructor/destructor
 
-VidgfxD3DContext *vidgfx_d3dcontext_new()
+VidgfxD3D11Context *vidgfx_d3d11context_new()
 {
-	D3DContext *d3dContext = new D3DContext();
-	return reinterpret_cast<VidgfxD3DContext *>(d3dContext);
+	D3D11Context *d3dContext = new D3D11Context();
+	return reinterpret_cast<VidgfxD3D11Context *>(d3dContext);
 }
 
-void vidgfx_d3dcontext_destroy(
-	VidgfxD3DContext *context)
+void vidgfx_d3d11context_destroy(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	if(ptr != NULL)
 		delete ptr;
 }
 
-VidgfxD3DContext *vidgfx_context_get_d3dcontext(
+VidgfxD3D11Context *vidgfx_context_get_d3d11context(
 	VidgfxContext *context)
 {
 	GraphicsContext *ptr = reinterpret_cast<GraphicsContext *>(context);
-	D3DContext *d3dContext = static_cast<D3DContext *>(ptr);
-	return reinterpret_cast<VidgfxD3DContext *>(d3dContext);
+	D3D11Context *d3dContext = static_cast<D3D11Context *>(ptr);
+	return reinterpret_cast<VidgfxD3D11Context *>(d3dContext);
 }
 
-VidgfxContext *vidgfx_d3dcontext_get_context(
-	VidgfxD3DContext *context)
+VidgfxContext *vidgfx_d3d11context_get_context(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	GraphicsContext *gfx = static_cast<GraphicsContext *>(ptr);
 	return reinterpret_cast<VidgfxContext *>(gfx);
 }
@@ -1148,112 +2604,164 @@ VidgfxContext *vidgfx_d3dcontext_get_context(
 //-----------------------------------------------------------------------------
 // Methods
 
-bool vidgfx_d3dcontext_is_valid(
-	VidgfxD3DContext *context)
+bool vidgfx_d3d11context_is_valid(
+	VidgfxD3D11Context *context)
 {
 	if(context == NULL)
 		return false;
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	return ptr->isValid();
 }
 
-bool vidgfx_d3dcontext_init(
-	VidgfxD3DContext *context,
+bool vidgfx_d3d11context_init(
+	VidgfxD3D11Context *context,
 	HWND hwnd,
 	const QSize &size,
-	const QColor &resize_border_col)
+	const QColor &resize_border_col,
+	int adapter)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	return ptr->initialize(hwnd, size, resize_border_col);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->initialize(hwnd, size, resize_border_col, adapter);
 }
 
-ID3D10Device *vidgfx_d3dcontext_get_device(
-	VidgfxD3DContext *context)
+int vidgfx_d3d11context_get_adapter(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->getAdapterIndex();
+}
+
+ID3D11Device *vidgfx_d3d11context_get_device(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	return ptr->getDevice();
 }
 
-bool vidgfx_d3dcontext_has_dxgi11(
-	VidgfxD3DContext *context)
+ID3D11DeviceContext *vidgfx_d3d11context_get_device_context(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	return ptr->hasDxgi11();
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->getDeviceContext();
 }
 
-bool vidgfx_d3dcontext_has_bgra_tex_support(
-	VidgfxD3DContext *context)
+bool vidgfx_d3d11context_has_feature_level_11(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->hasFeatureLevel11();
+}
+
+bool vidgfx_d3d11context_has_compute_support(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->hasComputeSupport();
+}
+
+bool vidgfx_d3d11context_has_bgra_tex_support(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	return ptr->hasBgraTexSupport();
 }
 
-VidgfxTex *vidgfx_d3dcontext_new_gdi_tex(
-	VidgfxD3DContext *context,
+VidgfxTex *vidgfx_d3d11context_new_gdi_tex(
+	VidgfxD3D11Context *context,
 	const QSize &size)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	Texture *ret = ptr->createGDITexture(size);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-VidgfxTex *vidgfx_d3dcontext_open_shared_tex(
-	VidgfxD3DContext *context,
+VidgfxTex *vidgfx_d3d11context_new_shared_tex(
+	VidgfxD3D11Context *context,
+	const QSize &size,
+	bool use_keyed_mutex)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	Texture *ret = ptr->createSharedTexture(size, use_keyed_mutex);
+	return reinterpret_cast<VidgfxTex *>(ret);
+}
+
+VidgfxTex *vidgfx_d3d11context_open_shared_tex(
+	VidgfxD3D11Context *context,
 	HANDLE shared_handle)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
 	Texture *ret = ptr->openSharedTexture(shared_handle);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-VidgfxTex *vidgfx_d3dcontext_open_dx10_tex(
-	VidgfxD3DContext *context,
-	ID3D10Texture2D *tex)
+VidgfxTex *vidgfx_d3d11context_open_dx11_tex(
+	VidgfxD3D11Context *context,
+	ID3D11Texture2D *tex)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	Texture *ret = ptr->openDX10Texture(tex);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	Texture *ret = ptr->openDX11Texture(tex);
 	return reinterpret_cast<VidgfxTex *>(ret);
 }
 
-//-----------------------------------------------------------------------------
-// Signals
+VidgfxD3D11Context *vidgfx_d3d11context_new_deferred(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	D3D11Context *ret = ptr->createDeferredContext();
+	return reinterpret_cast<VidgfxD3D11Context *>(ret);
+}
 
-void vidgfx_d3dcontext_add_dxgi11_changed_callback(
-	VidgfxD3DContext *context,
-	VidgfxD3DContextDxgi11ChangedCallback *dxgi11_changed,
-	void *opaque)
+void vidgfx_d3d11context_delete_deferred(
+	VidgfxD3D11Context *context,
+	VidgfxD3D11Context *deferred)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	ptr->addDxgi11ChangedCallback(dxgi11_changed, opaque);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	ptr->deleteDeferredContext(
+		reinterpret_cast<D3D11Context *>(deferred));
 }
 
-void vidgfx_d3dcontext_remove_dxgi11_changed_callback(
-	VidgfxD3DContext *context,
-	VidgfxD3DContextDxgi11ChangedCallback *dxgi11_changed,
-	void *opaque)
+bool vidgfx_d3d11context_is_deferred(
+	VidgfxD3D11Context *context)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	ptr->removeDxgi11ChangedCallback(dxgi11_changed, opaque);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->isDeferred();
 }
 
-void vidgfx_d3dcontext_add_bgra_tex_support_changed_callback(
-	VidgfxD3DContext *context,
-	VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
-	void *opaque)
+bool vidgfx_d3d11context_finish_cmds(
+	VidgfxD3D11Context *deferred)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	ptr->addBgraTexSupportChangedCallback(
-		bgra_tex_support_changed, opaque);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(deferred);
+	return ptr->finishCommands();
 }
 
-void vidgfx_d3dcontext_remove_bgra_tex_support_changed_callback(
-	VidgfxD3DContext *context,
-	VidgfxD3DContextBgraTexSupportChangedCallback *bgra_tex_support_changed,
-	void *opaque)
+void vidgfx_d3d11context_execute_deferred(
+	VidgfxD3D11Context *context,
+	VidgfxD3D11Context *deferred)
 {
-	D3DContext *ptr = reinterpret_cast<D3DContext *>(context);
-	ptr->removeBgraTexSupportChangedCallback(
-		bgra_tex_support_changed, opaque);
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	ptr->executeDeferredContext(
+		reinterpret_cast<D3D11Context *>(deferred));
+}
+
+void vidgfx_d3d11context_invalidate_state_cache(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	ptr->invalidateStateCache();
+}
+
+quint32 vidgfx_d3d11context_get_num_redundant_state_calls(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	return ptr->getNumRedundantStateCalls();
+}
+
+void vidgfx_d3d11context_reset_num_redundant_state_calls(
+	VidgfxD3D11Context *context)
+{
+	D3D11Context *ptr = reinterpret_cast<D3D11Context *>(context);
+	ptr->resetNumRedundantStateCalls();
 }
 
 #endif // VIDGFX_D3D_ENABLED
@@ -16,16 +16,43 @@
 //*****************************************************************************
 
 #include "pciidparser.h"
-#include <QtCore/QBuffer>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <algorithm>
+
+// Indices that have already been built, keyed by filename. Stored as `void`
+// as `PCIIDParser::Index` is private.
+static QMutex indexCacheMutex;
+static QHash<QString, QSharedPointer<const void> > indexCache;
 
 PCIIDParser::PCIIDParser(const QString &filename)
-	: m_data()
+	: m_index()
+{
+	m_index = loadIndex(filename);
+}
+
+PCIIDParser::~PCIIDParser()
+{
+}
+
+/// <summary>
+/// Returns the index of the specified file, building it if this is the first
+/// time that the file has been loaded by this process.
+/// </summary>
+/// <returns>NULL if the file couldn't be loaded</returns>
+QSharedPointer<const PCIIDParser::Index> PCIIDParser::loadIndex(
+	const QString &filename)
 {
+	QMutexLocker lock(&indexCacheMutex);
+	QSharedPointer<const void> cached = indexCache.value(filename);
+	if(!cached.isNull())
+		return cached.staticCast<const Index>();
+
 	QFile file(filename);
 	if(!file.open(QIODevice::ReadOnly))
-		return;
-	m_data = file.readAll();
+		return QSharedPointer<const Index>();
+	QByteArray data = file.readAll();
 	file.close();
 
 #if COMPRESS_PCI_IDS
@@ -37,94 +64,189 @@ PCIIDParser::PCIIDParser(const QString &filename)
 #endif
 	QString newFilename = App->getDataDirectory().filePath("pci.ids");
 	QFile newFile(newFilename);
-	if(!newFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
-		return;
-	newFile.write(qCompress(m_data));
-	newFile.close();
+	if(newFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		newFile.write(qCompress(data));
+		newFile.close();
+	}
 #else
 	// Decompress file
-	m_data = qUncompress(m_data);
+	data = qUncompress(data);
 #endif // COMPRESS_PCI_IDS
-}
+	if(data.isEmpty())
+		return QSharedPointer<const Index>();
 
-PCIIDParser::~PCIIDParser()
-{
+	// The text is released when `data` goes out of scope
+	QSharedPointer<const Index> index(buildIndex(data));
+	indexCache.insert(filename, index);
+	return index;
 }
 
 /// <summary>
-/// Looks up the vendor and device strings for the specified IDs
+/// Parses the uncompressed text of a "pci.ids" file into an index. Lines that
+/// are not vendor, device or subsystem lines are ignored along with all of
+/// their children which skips the device class list at the end of the file.
 /// </summary>
-/// <returns>True if at least a matching vendor was found</returns>
-bool PCIIDParser::lookup(
-	uint vendorId, uint deviceId, uint subSysId,
-	QString &vendorStrOut, QString &deviceStrOut, QString &subSysStrOut)
+PCIIDParser::Index *PCIIDParser::buildIndex(const QByteArray &data)
 {
-	vendorStrOut = QString();
-	deviceStrOut = QString();
-	subSysStrOut = QString();
-	if(!m_data.size())
-		return false;
-
-	// Create IO buffer for our data
-	QBuffer buf(&m_data);
-	if(!buf.open(QIODevice::ReadOnly))
-		return false;
-
-	// Read each line of the file
-	bool foundVendor = false;
-	bool foundDevice = false;
-	while(!buf.atEnd()) {
-		QByteArray line = buf.readLine();
+	Index *index = new Index;
+	int curVendor = -1;
+	int curDevice = -1;
+	int pos = 0;
+	while(pos < data.size()) {
+		int end = data.indexOf('\n', pos);
+		if(end < 0)
+			end = data.size();
+		QByteArray line = data.mid(pos, end - pos);
+		pos = end + 1;
+		if(line.endsWith('\r'))
+			line.chop(1);
 
 		// Skip comments and empty lines
-		if(line.at(0) == '#' || line.size() == 0)
+		if(line.size() == 0 || line.at(0) == '#')
 			continue;
 
 		// What sort of line is this?
+		bool ok1 = false, ok2 = false;
+		Entry entry;
+		entry.firstChild = 0;
+		entry.numChildren = 0;
 		if(line.size() >= 2 && line.at(0) == '\t' && line.at(1) == '\t') {
 			// It is a subsystem line
-			if(!foundDevice)
-				continue; // Still searching for device
-			if(line.size() < 14)
-				continue; // Line is corrupted, ignore it
+			if(curDevice < 0 || line.size() < 14)
+				continue; // No parent or line is corrupted, ignore it
 
 			// Parse subvendor and subsystem ID
-			uint subven = line.mid(2, 4).toUInt(NULL, 16);
-			uint subsys = line.mid(7, 4).toUInt(NULL, 16);
-			if(((subsys << 16) | subven) == subSysId) {
-				foundDevice = true;
-				subSysStrOut = QString::fromUtf8(line.mid(13));
-			}
-		} else if(line.size() >= 1 && line.at(0) == '\t') {
+			uint subven = line.mid(2, 4).toUInt(&ok1, 16);
+			uint subsys = line.mid(7, 4).toUInt(&ok2, 16);
+			if(!ok1 || !ok2)
+				continue;
+			entry.id = (subsys << 16) | subven;
+			entry.nameOffset = appendString(index->strings, line.mid(13));
+			index->subSystems.append(entry);
+			index->devices[curDevice].numChildren++;
+		} else if(line.at(0) == '\t') {
 			// It is a device line
-			if(foundDevice)
-				break; // No more lines to parse
-			if(!foundVendor)
-				continue; // Still searching for vendor
-			if(line.size() < 8)
-				continue; // Line is corrupted, ignore it
+			curDevice = -1;
+			if(curVendor < 0 || line.size() < 8)
+				continue; // No parent or line is corrupted, ignore it
 
 			// Parse device ID
-			uint dev = line.mid(1, 4).toUInt(NULL, 16);
-			if(dev == deviceId) {
-				foundDevice = true;
-				deviceStrOut = QString::fromUtf8(line.mid(7));
-			}
+			entry.id = line.mid(1, 4).toUInt(&ok1, 16);
+			if(!ok1)
+				continue;
+			entry.nameOffset = appendString(index->strings, line.mid(7));
+			entry.firstChild = index->subSystems.size();
+			index->devices.append(entry);
+			index->vendors[curVendor].numChildren++;
+			curDevice = index->devices.size() - 1;
 		} else {
 			// It is a vendor line
-			if(foundVendor)
-				break; // No more lines to parse
+			curVendor = -1;
+			curDevice = -1;
 			if(line.size() < 7)
 				continue; // Line is corrupted, ignore it
 
 			// Parse vendor ID
-			uint ven = line.mid(0, 4).toUInt(NULL, 16);
-			if(ven == vendorId) {
-				foundVendor = true;
-				vendorStrOut = QString::fromUtf8(line.mid(6));
-			}
+			entry.id = line.mid(0, 4).toUInt(&ok1, 16);
+			if(!ok1)
+				continue; // Device class or corrupted line
+			entry.nameOffset = appendString(index->strings, line.mid(6));
+			entry.firstChild = index->devices.size();
+			index->vendors.append(entry);
+			curVendor = index->vendors.size() - 1;
 		}
 	}
 
-	return foundVendor;
+	// Sort every level so that we can binary search, the children move with
+	// their parents so the ranges remain valid
+	std::sort(index->vendors.begin(), index->vendors.end());
+	sortChildren(index->devices, index->vendors);
+	sortChildren(index->subSystems, index->devices);
+
+	index->vendors.squeeze();
+	index->devices.squeeze();
+	index->subSystems.squeeze();
+	index->strings.squeeze();
+	return index;
+}
+
+/// <summary>
+/// Appends a NUL-terminated copy of `str` to `strings`.
+/// </summary>
+/// <returns>The offset of the copy</returns>
+int PCIIDParser::appendString(QByteArray &strings, const QByteArray &str)
+{
+	int offset = strings.size();
+	strings.append(str);
+	strings.append('\0');
+	return offset;
+}
+
+void PCIIDParser::sortChildren(
+	QVector<Entry> &children, const QVector<Entry> &parents)
+{
+	for(int i = 0; i < parents.size(); i++) {
+		const Entry &parent = parents.at(i);
+		Entry *first = children.data() + parent.firstChild;
+		std::sort(first, first + parent.numChildren);
+	}
+}
+
+/// <summary>
+/// Binary searches the sorted range of `num` entries that begins at `first`.
+/// </summary>
+/// <returns>NULL if there is no entry with the specified ID</returns>
+const PCIIDParser::Entry *PCIIDParser::findEntry(
+	const QVector<Entry> &entries, int first, int num, quint32 id)
+{
+	if(num <= 0)
+		return NULL;
+	Entry key;
+	key.id = id;
+	const Entry *begin = entries.constData() + first;
+	const Entry *end = begin + num;
+	const Entry *it = std::lower_bound(begin, end, key);
+	if(it == end || it->id != id)
+		return NULL;
+	return it;
+}
+
+QString PCIIDParser::getString(int offset) const
+{
+	return QString::fromUtf8(m_index->strings.constData() + offset);
+}
+
+/// <summary>
+/// Looks up the vendor and device strings for the specified IDs
+/// </summary>
+/// <returns>True if at least a matching vendor was found</returns>
+bool PCIIDParser::lookup(
+	uint vendorId, uint deviceId, uint subSysId,
+	QString &vendorStrOut, QString &deviceStrOut, QString &subSysStrOut) const
+{
+	vendorStrOut = QString();
+	deviceStrOut = QString();
+	subSysStrOut = QString();
+	if(m_index.isNull())
+		return false;
+
+	const Entry *vendor = findEntry(
+		m_index->vendors, 0, m_index->vendors.size(), vendorId);
+	if(vendor == NULL)
+		return false;
+	vendorStrOut = getString(vendor->nameOffset);
+
+	const Entry *device = findEntry(
+		m_index->devices, vendor->firstChild, vendor->numChildren, deviceId);
+	if(device == NULL)
+		return true;
+	deviceStrOut = getString(device->nameOffset);
+
+	const Entry *subSys = findEntry(
+		m_index->subSystems, device->firstChild, device->numChildren,
+		subSysId);
+	if(subSys != NULL)
+		subSysStrOut = getString(subSys->nameOffset);
+
+	return true;
 }
@@ -18,8 +18,10 @@
 #ifndef PCIIDPARSER_H
 #define PCIIDPARSER_H
 
-#include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
 
 #define COMPRESS_PCI_IDS 0
 
@@ -28,21 +30,62 @@
 /// A simple compressed "pci.ids" file parser allowing for PCI ID lookups. The
 /// base file can be found at http://pciids.sourceforge.net/ and can be
 /// compressed by setting the `COMPRESS_PCI_IDS` definition to `1`.
+///
+/// The first parser that loads a file converts it into a compact index that
+/// is sorted by vendor, device and subsystem ID so that lookups are binary
+/// searches and the text of the file is released immediately after. The index
+/// is shared by every parser of the same file for the lifetime of the process.
 /// </summary>
 class PCIIDParser
 {
+private: // Datatypes ---------------------------------------------------------
+	struct Entry {
+		quint32	id;
+		int		nameOffset; // Into `Index::strings`
+		int		firstChild; // Index of the first device or subsystem
+		int		numChildren;
+
+		inline bool operator<(const Entry &r) const {
+			return id < r.id;
+		};
+	};
+
+	struct Index {
+		QVector<Entry>	vendors;
+		QVector<Entry>	devices;
+		QVector<Entry>	subSystems; // ID = (Subsystem << 16) | Subvendor
+		QByteArray		strings; // NUL-terminated UTF-8
+	};
+
 protected: // Members ---------------------------------------------------------
-	QByteArray	m_data;
+	QSharedPointer<const Index>	m_index;
 
 public: // Constructor/destructor ---------------------------------------------
 	PCIIDParser(const QString &filename);
 	~PCIIDParser();
 
 public: // Methods ------------------------------------------------------------
+	bool	isValid() const;
 	bool	lookup(
 		uint vendorId, uint deviceId, uint subSysId,
-		QString &vendorStrOut, QString &deviceStrOut, QString &subSysStrOut);
+		QString &vendorStrOut, QString &deviceStrOut,
+		QString &subSysStrOut) const;
+
+private:
+	static QSharedPointer<const Index>	loadIndex(const QString &filename);
+	static Index *	buildIndex(const QByteArray &data);
+	static int		appendString(QByteArray &strings, const QByteArray &str);
+	static void		sortChildren(
+		QVector<Entry> &children, const QVector<Entry> &parents);
+	static const Entry *	findEntry(
+		const QVector<Entry> &entries, int first, int num, quint32 id);
+	QString			getString(int offset) const;
 };
 //=============================================================================
 
+inline bool PCIIDParser::isValid() const
+{
+	return !m_index.isNull();
+}
+
 #endif // PCIIDPARSER_H
@@ -0,0 +1,702 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#include "renditionscaler.h"
+#include "gfxlog.h"
+#include <QtCore/qmath.h>
+
+const QString LOG_CAT = QStringLiteral("Gfx");
+
+RenditionScaler::RenditionScaler(GraphicsContext *context, int readbackDepth)
+	: m_context(context)
+	, m_readbackDepth(qMax(1, readbackDepth))
+	, m_renditions()
+	, m_levels()
+	, m_levelsSrcSize()
+	, m_vertBuf(NULL)
+	, m_numDropped(0)
+	, m_previewSize()
+	, m_previewDivisor(1)
+	, m_previewTarget(NULL)
+	, m_previewSrcSize()
+	, m_previewDirty()
+	, m_previewMarked(false)
+	, m_previewSrcGeneration(0)
+	, m_previewCounter(0)
+{
+}
+
+RenditionScaler::~RenditionScaler()
+{
+	deleteResources();
+}
+
+/// <summary>
+/// Releases every texture, readback queue and vertex buffer that is owned by
+/// the scaler. They are recreated on the next call to `process()`.
+/// </summary>
+void RenditionScaler::deleteResources()
+{
+	if(m_context == NULL || !m_context->isValid())
+		return;
+	for(int i = 0; i < m_renditions.size(); i++)
+		deleteResources(m_renditions[i]);
+	for(int i = 0; i < m_levels.size(); i++)
+		m_context->deleteTexture(m_levels.at(i));
+	m_levels.clear();
+	m_levelsSrcSize = QSize();
+	if(m_previewTarget != NULL)
+		m_context->deleteTexture(m_previewTarget);
+	m_previewTarget = NULL;
+	m_previewSrcSize = QSize(); // Forces a full redraw
+	if(m_vertBuf != NULL)
+		m_context->deleteVertexBuffer(m_vertBuf);
+	m_vertBuf = NULL;
+}
+
+/// <summary>
+/// Adds an output of the specified size and pixel format. `filter` is used
+/// when scaling the source to the output size, point filtered renditions
+/// sample the source directly instead of the shared pyramid and bicubic and
+/// Lanczos renditions are resampled from the source with `prepareTexture()`.
+/// `matrix` is only used by NV16 renditions as the other YUV formats are
+/// always BT.601.
+/// </summary>
+/// <returns>The index of the new rendition or -1 on failure</returns>
+int RenditionScaler::addRendition(
+	const QSize &size, VidgfxPixFormat format, VidgfxFilter filter,
+	VidgfxYuvMatrix matrix)
+{
+	if(size.isEmpty())
+		return -1;
+	if(filter < 0 || filter >= NUM_STANDARD_TEXTURE_FILTERS)
+		return -1;
+
+	// Validate the output size against the packing of the planes
+	int numPlanes = 0;
+	bool aligned = false;
+	switch(format) {
+	default:
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Unsupported pixel format for rendition: "
+			<< VidgfxPixFormatStrs[qBound(0, (int)format,
+			(int)NUM_PIXEL_FORMAT_TYPES - 1)];
+		return -1;
+	case GfxRGB32Format:
+	case GfxARGB32Format:
+		numPlanes = 1;
+		aligned = true;
+		break;
+	case GfxNV12Format: // NxM Y, Nx(M/2) interleaved UV
+		numPlanes = 2;
+		aligned = (size.width() % 4 == 0 && size.height() % 2 == 0);
+		break;
+	case GfxYV12Format: // NxM Y, (N/2)x(M/2) V, (N/2)x(M/2) U
+	case GfxIYUVFormat: // NxM Y, (N/2)x(M/2) U, (N/2)x(M/2) V
+		numPlanes = 3;
+		aligned = (size.width() % 8 == 0 && size.height() % 2 == 0);
+		break;
+	case GfxNV16Format: // NxM Y, NxM interleaved UV
+		numPlanes = 2;
+		aligned = (size.width() % 4 == 0);
+		break;
+	}
+	if(!aligned) {
+		gfxLog(LOG_CAT, GfxLog::Warning)
+			<< "Rendition size " << size.width() << "x" << size.height()
+			<< " is not a multiple of the "
+			<< VidgfxPixFormatStrs[format] << " plane packing";
+		return -1;
+	}
+
+	Rendition rend;
+	rend.size = size;
+	rend.filter = filter;
+	rend.format = format;
+	rend.matrix = matrix;
+	rend.numPlanes = numPlanes;
+	rend.rgbTarget = NULL;
+	for(int i = 0; i < MaxPlanes; i++) {
+		rend.planes[i] = NULL;
+		rend.queues[i] = NULL;
+		rend.dequeued[i] = NULL;
+	}
+	m_renditions.append(rend);
+	return m_renditions.size() - 1;
+}
+
+void RenditionScaler::removeAllRenditions()
+{
+	if(m_context != NULL && m_context->isValid()) {
+		for(int i = 0; i < m_renditions.size(); i++)
+			deleteResources(m_renditions[i]);
+	}
+	m_renditions.clear();
+}
+
+QSize RenditionScaler::getRenditionSize(int rendition) const
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return QSize();
+	return m_renditions.at(rendition).size;
+}
+
+VidgfxPixFormat RenditionScaler::getRenditionFormat(int rendition) const
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return GfxNoFormat;
+	return m_renditions.at(rendition).format;
+}
+
+int RenditionScaler::getNumPlanes(int rendition) const
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return 0;
+	return m_renditions.at(rendition).numPlanes;
+}
+
+/// <summary>
+/// Returns the render target that contains the specified plane of the last
+/// processed frame or NULL if it doesn't exist yet.
+/// </summary>
+Texture *RenditionScaler::getPlane(int rendition, int plane) const
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return NULL;
+	const Rendition &rend = m_renditions.at(rendition);
+	if(plane < 0 || plane >= rend.numPlanes)
+		return NULL;
+	return rend.planes[plane];
+}
+
+/// <summary>
+/// Enables the preview at the specified size or disables it if `size` is
+/// empty. The preview is updated on every `divisor`th call to `process()`.
+/// </summary>
+void RenditionScaler::setPreview(const QSize &size, int divisor)
+{
+	m_previewDivisor = qMax(1, divisor);
+	if(size == m_previewSize)
+		return;
+	m_previewSize = size;
+	if(m_previewTarget != NULL && m_context != NULL && m_context->isValid())
+		m_context->deleteTexture(m_previewTarget);
+	m_previewTarget = NULL;
+	m_previewSrcSize = QSize(); // Forces a full redraw
+}
+
+/// <summary>
+/// Marks the specified area of the source texture as changed so that only the
+/// corresponding area of the preview is redrawn on its next update instead of
+/// the entire preview. Must be called before `process()` and must cover every
+/// change that was made to the source since the previous call to `process()`.
+/// </summary>
+void RenditionScaler::markPreviewDirty(const QRect &rect)
+{
+	m_previewDirty = m_previewDirty.united(rect);
+	m_previewMarked = true;
+}
+
+/// <summary>
+/// Marks the entire source texture as changed.
+/// </summary>
+void RenditionScaler::markPreviewDirty()
+{
+	m_previewSrcSize = QSize(); // Forces a full redraw
+}
+
+/// <summary>
+/// Renders `src` into every rendition and queues the readback of all of them
+/// once all renditions have been rendered. A rendition is only queued if all
+/// of its plane queues have space so that the planes stay in sync. The render
+/// target, user targets, user viewport and tex-decal modulation colour are
+/// restored afterwards. The preview is updated at the same time if it is due
+/// and the source was modified since the last update.
+/// </summary>
+/// <returns>True if every rendition was rendered and queued</returns>
+bool RenditionScaler::process(Texture *src)
+{
+	if(m_context == NULL || !m_context->isValid() || src == NULL)
+		return false;
+	bool updatePreview = isPreviewDue(src);
+	if(m_renditions.isEmpty() && !updatePreview)
+		return true; // Nothing to do
+
+	// Create resources on first use
+	if(m_vertBuf == NULL) {
+		m_vertBuf = m_context->createVertexBuffer(
+			GraphicsContext::TexDecalRectBufSize);
+		if(m_vertBuf == NULL)
+			return false;
+	}
+	for(int i = 0; i < m_renditions.size(); i++) {
+		Rendition &rend = m_renditions[i];
+		if(rend.planes[0] == NULL && !createResources(rend))
+			return false; // Error already logged
+	}
+
+	//------------------------------------------------------------------------
+
+	// Remember original state. The user matrices are shared between all user
+	// targets so they can only be read back if a user target is selected.
+	VidgfxRendTarget origTarget = m_context->getRenderTarget();
+	Texture *origUserTargets[2] = {
+		m_context->getUserRenderTarget(0),
+		m_context->getUserRenderTarget(1) };
+	QRect origUserViewport = m_context->getUserRenderTargetViewport();
+	QColor origModColor = m_context->getTexDecalModColor();
+	QMatrix4x4 origUserViewMat;
+	QMatrix4x4 origUserProjMat;
+	if(origTarget == GfxUserTarget) {
+		origUserViewMat = m_context->getViewMatrix();
+		origUserProjMat = m_context->getProjectionMatrix();
+	}
+	m_context->setTexDecalModColor(QColor(255, 255, 255));
+
+	// Build the shared pyramid once and derive every rendition from it
+	bool ret = updateLevels(src, updatePreview);
+	for(int i = 0; i < m_renditions.size(); i++) {
+		if(!renderRendition(m_renditions[i], src))
+			ret = false;
+	}
+	if(updatePreview && !renderPreview(src))
+		ret = false;
+
+	// Restore original state
+	m_context->setTexDecalModColor(origModColor);
+	m_context->setUserRenderTarget(origUserTargets[0], origUserTargets[1]);
+	m_context->setUserRenderTargetViewport(origUserViewport);
+	m_context->setRenderTarget(origTarget);
+	if(origTarget == GfxUserTarget) {
+		m_context->setViewMatrix(origUserViewMat);
+		m_context->setProjectionMatrix(origUserProjMat);
+	}
+
+	//------------------------------------------------------------------------
+
+	// Queue all readbacks together
+	for(int i = 0; i < m_renditions.size(); i++) {
+		if(!enqueueRendition(m_renditions[i]))
+			ret = false;
+	}
+
+	return ret;
+}
+
+/// <summary>
+/// Returns the oldest queued frame of the specified rendition once every one
+/// of its planes has been read back. `planesOut` must have space for
+/// `getNumPlanes()` entries and the returned textures are already mapped. The
+/// planes remain valid until `releaseDequeued()` is called which must be done
+/// before the next frame can be dequeued.
+/// </summary>
+/// <returns>True if the frame was dequeued</returns>
+bool RenditionScaler::tryDequeue(int rendition, Texture *planesOut[])
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return false;
+	if(planesOut == NULL)
+		return false;
+	Rendition &rend = m_renditions[rendition];
+
+	// Planes that are ready are kept until all of them are as the queues of a
+	// frame might not all complete at the same time
+	bool ready = true;
+	for(int i = 0; i < rend.numPlanes; i++) {
+		if(rend.dequeued[i] != NULL)
+			continue; // Already dequeued
+		if(rend.queues[i] == NULL)
+			return false; // Never processed
+		rend.dequeued[i] = rend.queues[i]->tryDequeue();
+		if(rend.dequeued[i] == NULL)
+			ready = false;
+	}
+	if(!ready)
+		return false;
+
+	for(int i = 0; i < rend.numPlanes; i++)
+		planesOut[i] = rend.dequeued[i];
+	return true;
+}
+
+void RenditionScaler::releaseDequeued(int rendition)
+{
+	if(rendition < 0 || rendition >= m_renditions.size())
+		return;
+	Rendition &rend = m_renditions[rendition];
+	for(int i = 0; i < rend.numPlanes; i++) {
+		if(rend.dequeued[i] == NULL)
+			continue;
+		rend.queues[i]->releaseDequeued();
+		rend.dequeued[i] = NULL;
+	}
+}
+
+/// <summary>
+/// Returns the size of the texture that contains the specified plane. This
+/// matches the plane sizes that `convertFromRgb()` and `scaleToNv16()` expect.
+/// </summary>
+QSize RenditionScaler::getPlaneSize(const Rendition &rend, int plane)
+{
+	int w = rend.size.width();
+	int h = rend.size.height();
+	switch(rend.format) {
+	default:
+	case GfxRGB32Format:
+	case GfxARGB32Format:
+		return rend.size;
+	case GfxNV12Format:
+		if(plane == 0)
+			return QSize(w / 4, h);
+		return QSize(w / 4, h / 2);
+	case GfxYV12Format:
+	case GfxIYUVFormat:
+		if(plane == 0)
+			return QSize(w / 4, h);
+		return QSize(w / 8, h / 2);
+	case GfxNV16Format:
+		return QSize(w / 4, h);
+	}
+}
+
+/// <summary>
+/// Returns true if renditions that use `filter` are resampled from the source
+/// by `prepareTexture()` instead of being derived from the shared pyramid.
+/// </summary>
+bool RenditionScaler::isResampleFilter(VidgfxFilter filter)
+{
+	return filter == GfxBicubicFilter || filter == GfxLanczosFilter;
+}
+
+bool RenditionScaler::createResources(Rendition &rend)
+{
+	bool ok = true;
+
+	// YUV 4:2:0 formats are scaled into an intermediate RGB target first. So
+	// are resampled NV16 renditions as `scaleToNv16()` always box filters.
+	if(rend.format == GfxNV12Format || rend.format == GfxYV12Format ||
+		rend.format == GfxIYUVFormat ||
+		(rend.format == GfxNV16Format && isResampleFilter(rend.filter)))
+	{
+		rend.rgbTarget = m_context->createTexture(rend.size, false, true);
+		ok = (rend.rgbTarget != NULL);
+	}
+
+	for(int i = 0; ok && i < rend.numPlanes; i++) {
+		QSize planeSize = getPlaneSize(rend, i);
+		rend.planes[i] = m_context->createTexture(planeSize, false, true);
+		rend.queues[i] =
+			m_context->createReadbackQueue(planeSize, m_readbackDepth);
+		ok = (rend.planes[i] != NULL && rend.queues[i] != NULL);
+	}
+	if(ok)
+		return true;
+
+	gfxLog(LOG_CAT, GfxLog::Warning)
+		<< "Failed to create resources for " << rend.size.width() << "x"
+		<< rend.size.height() << " " << VidgfxPixFormatStrs[rend.format]
+		<< " rendition";
+	deleteResources(rend);
+	return false;
+}
+
+void RenditionScaler::deleteResources(Rendition &rend)
+{
+	for(int i = 0; i < MaxPlanes; i++) {
+		if(rend.dequeued[i] != NULL)
+			rend.queues[i]->releaseDequeued();
+		rend.dequeued[i] = NULL;
+		m_context->deleteReadbackQueue(rend.queues[i]);
+		rend.queues[i] = NULL;
+		if(rend.planes[i] != NULL)
+			m_context->deleteTexture(rend.planes[i]);
+		rend.planes[i] = NULL;
+	}
+	if(rend.rgbTarget != NULL)
+		m_context->deleteTexture(rend.rgbTarget);
+	rend.rgbTarget = NULL;
+}
+
+/// <summary>
+/// Returns the number of pyramid levels below a source of `srcSize` that are
+/// still at least as large as `size` in both dimensions.
+/// </summary>
+int RenditionScaler::getNumLevels(const QSize &srcSize, const QSize &size)
+{
+	QSize levelSize = srcSize;
+	int num = 0;
+	while(levelSize.width() / 2 >= size.width() &&
+		levelSize.height() / 2 >= size.height())
+	{
+		levelSize = QSize(levelSize.width() / 2, levelSize.height() / 2);
+		num++;
+	}
+	return num;
+}
+
+/// <summary>
+/// Renders every pyramid level that is required by at least one rendition or
+/// the preview if `includePreview` is true. Each level is half the size of the
+/// previous one so a bilinear sample in the centre of each output pixel is an
+/// exact 2x2 box filter.
+/// </summary>
+bool RenditionScaler::updateLevels(Texture *src, bool includePreview)
+{
+	QSize srcSize = src->getSize();
+	if(srcSize != m_levelsSrcSize) {
+		// Source size changed, all levels must be recreated
+		for(int i = 0; i < m_levels.size(); i++)
+			m_context->deleteTexture(m_levels.at(i));
+		m_levels.clear();
+		m_levelsSrcSize = srcSize;
+	}
+
+	// Determine the deepest level that is required
+	int numLevels = 0;
+	for(int i = 0; i < m_renditions.size(); i++) {
+		const Rendition &rend = m_renditions.at(i);
+		if(rend.filter == GfxPointFilter || isResampleFilter(rend.filter))
+			continue; // Samples the source directly
+		numLevels = qMax(numLevels, getNumLevels(srcSize, rend.size));
+	}
+	if(includePreview)
+		numLevels = qMax(numLevels, getNumLevels(srcSize, m_previewSize));
+
+	// Create missing levels and render them from the previous level
+	Texture *prev = src;
+	for(int i = 0; i < numLevels; i++) {
+		if(i >= m_levels.size()) {
+			QSize levelSize(
+				prev->getWidth() / 2, prev->getHeight() / 2);
+			Texture *tex = m_context->createTexture(levelSize, false, true);
+			if(tex == NULL) {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Failed to create rendition pyramid level";
+				return false;
+			}
+			m_levels.append(tex);
+		}
+		Texture *level = m_levels.at(i);
+		drawScaled(prev, level, GfxBilinearFilter);
+		prev = level;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Returns the smallest rendered level of the pyramid that is at least as
+/// large as `size` in both dimensions or `src` if there isn't one.
+/// </summary>
+Texture *RenditionScaler::getNearestLevel(
+	Texture *src, const QSize &size) const
+{
+	Texture *ret = src;
+	for(int i = 0; i < m_levels.size(); i++) {
+		Texture *level = m_levels.at(i);
+		if(level->getWidth() < size.width() ||
+			level->getHeight() < size.height())
+		{
+			break;
+		}
+		ret = level;
+	}
+	return ret;
+}
+
+/// <summary>
+/// Scales the entire `src` texture to fill the `dst` render target. Only the
+/// area of `src` between the top-left corner and `srcBotRight` in UV
+/// coordinates is used.
+/// </summary>
+void RenditionScaler::drawScaled(
+	Texture *src, Texture *dst, VidgfxFilter filter,
+	const QPointF &srcBotRight)
+{
+	drawScaled(src, dst, filter, QRect(QPoint(0, 0), dst->getSize()),
+		srcBotRight);
+}
+
+/// <summary>
+/// Scales the entire `src` texture to fill the `dst` render target but only
+/// renders the pixels of `dstRect`. The rest of `dst` is left untouched.
+/// </summary>
+void RenditionScaler::drawScaled(
+	Texture *src, Texture *dst, VidgfxFilter filter, const QRect &dstRect,
+	const QPointF &srcBotRight)
+{
+	QSize outSize = dst->getSize();
+	QRectF rect(dstRect);
+	QPointF tlUv(
+		rect.left() / (qreal)outSize.width() * srcBotRight.x(),
+		rect.top() / (qreal)outSize.height() * srcBotRight.y());
+	QPointF brUv(
+		rect.right() / (qreal)outSize.width() * srcBotRight.x(),
+		rect.bottom() / (qreal)outSize.height() * srcBotRight.y());
+	GraphicsContext::createTexDecalRect(
+		m_vertBuf, rect, tlUv, QPointF(brUv.x(), tlUv.y()),
+		QPointF(tlUv.x(), brUv.y()), brUv);
+
+	// Setup render target
+	m_context->setUserRenderTarget(dst);
+	m_context->setUserRenderTargetViewport(outSize);
+	m_context->setRenderTarget(GfxUserTarget);
+	QMatrix4x4 mat;
+	m_context->setViewMatrix(mat);
+	mat.ortho(
+		0.0f, outSize.width(), outSize.height(), 0.0f, -1.0f, 1.0f);
+	m_context->setProjectionMatrix(mat);
+
+	// Render the texture
+	m_context->setShader(GfxTexDecalShader);
+	m_context->setTopology(GfxTriangleStripTopology);
+	m_context->setBlending(GfxNoBlending);
+	m_context->setTexture(src);
+	m_context->setTextureFilter(filter);
+	m_context->drawBuffer(m_vertBuf);
+}
+
+bool RenditionScaler::renderRendition(Rendition &rend, Texture *src)
+{
+	// Bicubic and Lanczos renditions are resampled to their exact size by
+	// `prepareTexture()` which can return a scratch target that is larger than
+	// the result. The result is then drawn into the rendition at 1:1.
+	Texture *tex = src;
+	VidgfxFilter filter = rend.filter;
+	QPointF botRight(1.0f, 1.0f);
+	if(isResampleFilter(rend.filter)) {
+		QPointF pxSize;
+		tex = m_context->prepareTexture(
+			src, rend.size, rend.filter, false, pxSize, botRight);
+		if(tex == NULL)
+			return false;
+		filter = GfxBilinearFilter; // Also correct if it fell back to mipmaps
+	} else if(rend.filter != GfxPointFilter)
+		tex = getNearestLevel(src, rend.size);
+
+	switch(rend.format) {
+	default:
+		return false;
+	case GfxRGB32Format:
+	case GfxARGB32Format:
+		drawScaled(tex, rend.planes[0], filter, botRight);
+		return true;
+	case GfxNV12Format:
+	case GfxYV12Format:
+	case GfxIYUVFormat:
+		drawScaled(tex, rend.rgbTarget, filter, botRight);
+		return m_context->convertFromRgb(
+			rend.format, rend.rgbTarget, rend.planes[0], rend.planes[1],
+			rend.planes[2]);
+	case GfxNV16Format:
+		if(rend.rgbTarget != NULL) {
+			// Resampled, convert the intermediate target at 1:1
+			drawScaled(tex, rend.rgbTarget, filter, botRight);
+			tex = rend.rgbTarget;
+		}
+		// The nearest level is never more than 2x larger than the output so
+		// this is always a single fused pass. This always box filters.
+		return m_context->scaleToNv16(
+			tex, rend.planes[0], rend.planes[1], rend.matrix);
+	}
+}
+
+/// <summary>
+/// Returns true if the preview should be redrawn during this call to
+/// `process()`. Dirty areas are accumulated over the calls that are skipped.
+/// </summary>
+bool RenditionScaler::isPreviewDue(Texture *src)
+{
+	if(m_previewSize.isEmpty())
+		return false;
+
+	// Everything is dirty if the source changed size or the preview target
+	// was recreated
+	QRect srcRect(QPoint(0, 0), src->getSize());
+	if(m_previewSrcSize != srcRect.size() || m_previewTarget == NULL) {
+		m_previewSrcSize = srcRect.size();
+		m_previewDirty = srcRect;
+	}
+
+	// Everything is also dirty if the source was modified and the user didn't
+	// tell us where. Generations are unique so this also detects a different
+	// source texture such as the other canvas.
+	quint32 generation = src->getGeneration();
+	if(generation != m_previewSrcGeneration) {
+		m_previewSrcGeneration = generation;
+		if(!m_previewMarked)
+			m_previewDirty = srcRect;
+	}
+	m_previewMarked = false;
+
+	bool isDue = (m_previewCounter % (quint32)m_previewDivisor) == 0;
+	m_previewCounter++;
+	if(!isDue)
+		return false;
+	m_previewDirty = m_previewDirty.intersected(srcRect);
+	return !m_previewDirty.isEmpty();
+}
+
+bool RenditionScaler::renderPreview(Texture *src)
+{
+	if(m_previewTarget == NULL) {
+		m_previewTarget =
+			m_context->createTexture(m_previewSize, false, true);
+		if(m_previewTarget == NULL) {
+			gfxLog(LOG_CAT, GfxLog::Warning)
+				<< "Failed to create preview target";
+			return false;
+		}
+	}
+	Texture *tex = getNearestLevel(src, m_previewSize);
+
+	// Map the dirty area into preview pixels. We expand it by a pixel in each
+	// direction to include the footprint of the bilinear filter
+	QSizeF scale(
+		(qreal)m_previewSize.width() / (qreal)m_previewSrcSize.width(),
+		(qreal)m_previewSize.height() / (qreal)m_previewSrcSize.height());
+	int left = qMax(0, qFloor(m_previewDirty.left() * scale.width()) - 1);
+	int top = qMax(0, qFloor(m_previewDirty.top() * scale.height()) - 1);
+	int right = qMin(m_previewSize.width(),
+		qCeil((m_previewDirty.right() + 1) * scale.width()) + 1);
+	int bottom = qMin(m_previewSize.height(),
+		qCeil((m_previewDirty.bottom() + 1) * scale.height()) + 1);
+	drawScaled(tex, m_previewTarget, GfxBilinearFilter,
+		QRect(left, top, right - left, bottom - top));
+
+	m_previewDirty = QRect();
+	return true;
+}
+
+bool RenditionScaler::enqueueRendition(Rendition &rend)
+{
+	for(int i = 0; i < rend.numPlanes; i++) {
+		if(rend.queues[i] == NULL)
+			return false;
+		if(rend.queues[i]->isFull()) {
+			// The user isn't dequeuing fast enough, drop the whole frame
+			m_numDropped++;
+			return false;
+		}
+	}
+	bool ret = true;
+	for(int i = 0; i < rend.numPlanes; i++) {
+		if(!rend.queues[i]->enqueue(rend.planes[i]))
+			ret = false;
+	}
+	return ret;
+}
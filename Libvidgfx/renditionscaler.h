@@ -0,0 +1,180 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#ifndef RENDITIONSCALER_H
+#define RENDITIONSCALER_H
+
+#include "graphicscontext.h"
+#include <QtCore/QVector>
+
+//=============================================================================
+/// <summary>
+/// Renders a single source texture into several outputs ("renditions") of
+/// different sizes and pixel formats in one pass. A shared pyramid of the
+/// source is built once per `process()` and every rendition is derived from
+/// the smallest level that is still at least as large as the rendition. Each
+/// rendition owns its own render targets and readback queues so renditions do
+/// not ping-pong the scratch targets and all readbacks are queued together.
+/// Bicubic and Lanczos renditions are the exception as they are resampled
+/// from the source through the scratch targets by `prepareTexture()`.
+///
+/// Supported output formats are `GfxRGB32Format`, `GfxARGB32Format`,
+/// `GfxNV12Format`, `GfxIYUVFormat`, `GfxYV12Format` and `GfxNV16Format`. The
+/// planes are in the packed layout that `convertFromRgb()` and `scaleToNv16()`
+/// output and RGB renditions use the same RGBA layout as the staging textures
+/// of `createStagingTexture()`. It is up to the user to either call
+/// `deleteResources()` or delete the whole object when the graphics context is
+/// released.
+///
+/// The scaler can also maintain a downscaled preview of the source that is
+/// derived from the same pyramid so that the screen target doesn't need to
+/// sample the full-size canvas every frame. The preview is not read back, it
+/// is only redrawn on every Nth call to `process()` and only if the source
+/// was modified since the last update (See `Texture::getGeneration()`). The
+/// entire preview is redrawn unless the changed areas were marked with
+/// `markPreviewDirty()`, in which case only those areas are redrawn.
+/// </summary>
+class RenditionScaler
+{
+public: // Constants ----------------------------------------------------------
+	static const int	MaxPlanes = 3;
+
+private: // Datatypes ---------------------------------------------------------
+	struct Rendition {
+		QSize				size;
+		VidgfxFilter		filter;
+		VidgfxPixFormat		format;
+		VidgfxYuvMatrix		matrix;
+		int					numPlanes;
+		Texture *			rgbTarget; // NULL if the RGB is the output plane
+		Texture *			planes[MaxPlanes];
+		ReadbackQueue *		queues[MaxPlanes];
+		Texture *			dequeued[MaxPlanes];
+	};
+
+protected: // Members ---------------------------------------------------------
+	GraphicsContext *	m_context;
+	int					m_readbackDepth;
+	QVector<Rendition>	m_renditions;
+	QVector<Texture *>	m_levels; // Level N is 1/(2^(N+1)) of the source
+	QSize				m_levelsSrcSize;
+	VertexBuffer *		m_vertBuf;
+	quint32				m_numDropped;
+
+	// Preview
+	QSize				m_previewSize; // Empty if disabled
+	int					m_previewDivisor;
+	Texture *			m_previewTarget;
+	QSize				m_previewSrcSize;
+	QRect				m_previewDirty; // In source pixels
+	bool				m_previewMarked; // Dirty area came from the user
+	quint32				m_previewSrcGeneration;
+	quint32				m_previewCounter;
+
+public: // Constructor/destructor ---------------------------------------------
+	RenditionScaler(GraphicsContext *context = NULL, int readbackDepth = 3);
+	virtual ~RenditionScaler();
+
+public: // Methods ------------------------------------------------------------
+	void			setContext(GraphicsContext *context);
+	void			deleteResources();
+
+	int				addRendition(
+		const QSize &size, VidgfxPixFormat format,
+		VidgfxFilter filter = GfxBilinearFilter,
+		VidgfxYuvMatrix matrix = GfxBt601Matrix);
+	void			removeAllRenditions();
+	int				getNumRenditions() const;
+	QSize			getRenditionSize(int rendition) const;
+	VidgfxPixFormat	getRenditionFormat(int rendition) const;
+	int				getNumPlanes(int rendition) const;
+	Texture *		getPlane(int rendition, int plane) const;
+
+	bool			process(Texture *src);
+	bool			tryDequeue(int rendition, Texture *planesOut[]);
+	void			releaseDequeued(int rendition);
+	quint32			getNumDropped() const;
+
+	void			setPreview(const QSize &size, int divisor = 1);
+	QSize			getPreviewSize() const;
+	int				getPreviewDivisor() const;
+	Texture *		getPreviewTexture() const;
+	void			markPreviewDirty(const QRect &rect);
+	void			markPreviewDirty();
+
+private:
+	static QSize	getPlaneSize(const Rendition &rend, int plane);
+	static int		getNumLevels(const QSize &srcSize, const QSize &size);
+	static bool		isResampleFilter(VidgfxFilter filter);
+	bool			createResources(Rendition &rend);
+	void			deleteResources(Rendition &rend);
+	bool			updateLevels(Texture *src, bool includePreview);
+	Texture *		getNearestLevel(Texture *src, const QSize &size) const;
+	void			drawScaled(
+		Texture *src, Texture *dst, VidgfxFilter filter,
+		const QPointF &srcBotRight = QPointF(1.0f, 1.0f));
+	void			drawScaled(
+		Texture *src, Texture *dst, VidgfxFilter filter,
+		const QRect &dstRect,
+		const QPointF &srcBotRight = QPointF(1.0f, 1.0f));
+	bool			renderRendition(Rendition &rend, Texture *src);
+	bool			isPreviewDue(Texture *src);
+	bool			renderPreview(Texture *src);
+	bool			enqueueRendition(Rendition &rend);
+};
+//=============================================================================
+
+inline void RenditionScaler::setContext(GraphicsContext *context)
+{
+	m_context = context;
+}
+
+inline int RenditionScaler::getNumRenditions() const
+{
+	return m_renditions.size();
+}
+
+/// <summary>
+/// Returns the number of frames that were rendered but not queued for
+/// readback as the user didn't dequeue the previous frames fast enough.
+/// </summary>
+inline quint32 RenditionScaler::getNumDropped() const
+{
+	return m_numDropped;
+}
+
+inline QSize RenditionScaler::getPreviewSize() const
+{
+	return m_previewSize;
+}
+
+inline int RenditionScaler::getPreviewDivisor() const
+{
+	return m_previewDivisor;
+}
+
+/// <summary>
+/// Returns the render target that contains the preview or NULL if the preview
+/// is disabled or hasn't been rendered yet. The texture remains valid until the
+/// preview size is changed or the resources are deleted.
+/// </summary>
+inline Texture *RenditionScaler::getPreviewTexture() const
+{
+	return m_previewTarget;
+}
+
+#endif // RENDITIONSCALER_H
@@ -0,0 +1,299 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#include "textureloader.h"
+#include "gfxlog.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRunnable>
+
+const QString LOG_CAT = QStringLiteral("Gfx");
+
+//=============================================================================
+// TextureLoaderTask class
+
+/// <summary>
+/// Decodes a single request on the loader's worker pool.
+/// </summary>
+class TextureLoaderTask : public QRunnable
+{
+private: // Members -----------------------------------------------------------
+	TextureLoader *				m_loader;
+	TextureLoader::Request		m_req;
+
+public: // Constructor/destructor ---------------------------------------------
+	TextureLoaderTask(TextureLoader *loader, const TextureLoader::Request &req)
+		: QRunnable()
+		, m_loader(loader)
+		, m_req(req)
+	{
+	};
+
+public: // Methods ------------------------------------------------------------
+	virtual void run()
+	{
+		m_loader->decodeRequest(m_req);
+	};
+};
+
+//=============================================================================
+// TextureLoader class
+
+TextureLoader::TextureLoader(GraphicsContext *context, int maxThreads)
+	: m_context(context)
+	, m_pool()
+	, m_mutex()
+	, m_nextId(1)
+	, m_pending()
+	, m_ready()
+	, m_loadedCallbackList()
+{
+	m_pool.setMaxThreadCount(qMax(1, maxThreads));
+}
+
+TextureLoader::~TextureLoader()
+{
+	// Workers discard their result once their request is no longer pending
+	cancelAll();
+	m_pool.waitForDone();
+}
+
+/// <summary>
+/// Queues the image file at `filename` to be loaded into a texture. If
+/// `dilute` is true then the image is passed through `diluteImage()` before it
+/// is uploaded.
+/// </summary>
+/// <returns>The ID of the request which is always greater than zero.</returns>
+int TextureLoader::loadFile(const QString &filename, bool dilute)
+{
+	Request req;
+	req.filename = filename;
+	req.dilute = dilute;
+	return queueRequest(req);
+}
+
+/// <summary>
+/// Queues an already decoded image to be loaded into a texture. As `QImage`
+/// is implicitly shared the image is not copied unless it needs to be diluted
+/// or converted.
+/// </summary>
+/// <returns>The ID of the request which is always greater than zero.</returns>
+int TextureLoader::loadImage(const QImage &img, bool dilute)
+{
+	Request req;
+	req.img = img;
+	req.dilute = dilute;
+	return queueRequest(req);
+}
+
+int TextureLoader::queueRequest(Request &req)
+{
+	req.context = m_context;
+
+	m_mutex.lock();
+	req.id = m_nextId++;
+	if(m_nextId <= 0)
+		m_nextId = 1; // Wrapped
+	m_pending.append(req.id);
+	m_mutex.unlock();
+
+	TextureLoaderTask *task = new TextureLoaderTask(this, req);
+	task->setAutoDelete(true);
+	m_pool.start(task);
+
+	return req.id;
+}
+
+/// <summary>
+/// Cancels the specified request. The loaded callbacks are not called for
+/// cancelled requests. Does nothing if the request has already completed.
+/// </summary>
+void TextureLoader::cancel(int id)
+{
+	QMutexLocker lock(&m_mutex);
+	int index = m_pending.indexOf(id);
+	if(index < 0)
+		return;
+	m_pending.remove(index);
+	for(int i = 0; i < m_ready.size(); i++) {
+		if(m_ready.at(i).id == id) {
+			m_ready.remove(i);
+			break;
+		}
+	}
+}
+
+void TextureLoader::cancelAll()
+{
+	QMutexLocker lock(&m_mutex);
+	m_pending.clear();
+	m_ready.clear();
+}
+
+/// <summary>
+/// Returns true if the specified request has been queued but its loaded
+/// callbacks have not been called yet.
+/// </summary>
+bool TextureLoader::isPending(int id) const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_pending.contains(id);
+}
+
+int TextureLoader::getNumPending() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_pending.size();
+}
+
+/// <summary>
+/// Executed on a worker thread. Does everything that doesn't require the
+/// graphics device so that the upload in `processUploads()` is a single
+/// texture creation with initial data.
+/// </summary>
+void TextureLoader::decodeRequest(Request &req)
+{
+	// Skip the work if the request was cancelled while it was queued
+	m_mutex.lock();
+	bool isCancelled = !m_pending.contains(req.id);
+	m_mutex.unlock();
+	if(isCancelled)
+		return;
+
+	// Decode the image file. Errors are logged in `processUploads()` as we
+	// don't want to log from multiple threads at once.
+	if(!req.filename.isEmpty())
+		req.img.load(req.filename);
+
+	if(!req.img.isNull()) {
+		if(req.dilute && req.context != NULL)
+			req.context->diluteImage(req.img);
+
+		// Convert to a format that the context can use directly. This must be
+		// kept in sync with what `createTexture()` accepts without a copy
+		switch(req.img.format()) {
+		case QImage::Format_RGB32:
+		case QImage::Format_ARGB32:
+			break;
+		default:
+			req.img = req.img.convertToFormat(QImage::Format_ARGB32);
+			break;
+		}
+	}
+
+	// Hand the request back to the device thread
+	QMutexLocker lock(&m_mutex);
+	if(!m_pending.contains(req.id))
+		return; // Cancelled while decoding
+	m_ready.append(req);
+}
+
+/// <summary>
+/// Creates the textures of decoded requests and calls the loaded callbacks.
+/// Must be called from the thread that owns the graphics context, usually once
+/// per frame. At least one texture is uploaded per call if any are ready; after
+/// that uploads stop as soon as `budgetUsec` microseconds have elapsed.
+/// </summary>
+/// <returns>The number of requests that were completed.</returns>
+int TextureLoader::processUploads(int budgetUsec)
+{
+	if(m_context == NULL || !m_context->isValid())
+		return 0;
+
+	QElapsedTimer timer;
+	timer.start();
+	const qint64 budgetNsec = (qint64)budgetUsec * 1000LL;
+
+	int numCompleted = 0;
+	for(;;) {
+		// Take the oldest ready request. We release the lock before uploading
+		// so that the workers are never blocked by the device
+		Request req;
+		m_mutex.lock();
+		if(m_ready.isEmpty()) {
+			m_mutex.unlock();
+			break;
+		}
+		req = m_ready.first();
+		m_ready.remove(0);
+		m_pending.removeOne(req.id);
+		m_mutex.unlock();
+
+		Texture *tex = NULL;
+		if(req.img.isNull()) {
+			if(req.filename.isEmpty()) {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Cannot load a null image into a texture";
+			} else {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Failed to load image file \"" << req.filename << "\"";
+			}
+		} else {
+			tex = m_context->createTexture(req.img);
+			req.img = QImage(); // Release the pixel data as soon as possible
+			if(tex == NULL) {
+				gfxLog(LOG_CAT, GfxLog::Warning)
+					<< "Failed to create texture for request " << req.id;
+			}
+		}
+		if(m_loadedCallbackList.isEmpty()) {
+			// Nobody can take ownership of the texture
+			if(tex != NULL)
+				m_context->deleteTexture(tex);
+		} else
+			callLoadedCallbacks(req.id, tex);
+		numCompleted++;
+
+		if(timer.nsecsElapsed() >= budgetNsec)
+			break;
+	}
+	return numCompleted;
+}
+
+/// <summary>
+/// Calls the loaded callbacks in the reverse order that they were added. The
+/// callback that was added first owns the texture and is therefore called
+/// last so that the texture is valid for the duration of every other call.
+/// </summary>
+void TextureLoader::callLoadedCallbacks(int id, Texture *tex)
+{
+	for(int i = m_loadedCallbackList.size() - 1; i >= 0; i--) {
+		const LoadedCallback &callback = m_loadedCallbackList.at(i);
+		callback.callback(
+			callback.opaque, reinterpret_cast<VidgfxTexLoader *>(this), id,
+			reinterpret_cast<VidgfxTex *>(tex));
+	}
+}
+
+void TextureLoader::addLoadedCallback(
+	VidgfxTexLoaderLoadedCallback *loaded, void *opaque)
+{
+	LoadedCallback callback;
+	callback.callback = loaded;
+	callback.opaque = opaque;
+	m_loadedCallbackList.append(callback);
+}
+
+void TextureLoader::removeLoadedCallback(
+	VidgfxTexLoaderLoadedCallback *loaded, void *opaque)
+{
+	LoadedCallback callback;
+	callback.callback = loaded;
+	callback.opaque = opaque;
+	int id = m_loadedCallbackList.indexOf(callback);
+	if(id >= 0)
+		m_loadedCallbackList.remove(id);
+}
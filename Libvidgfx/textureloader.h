@@ -0,0 +1,117 @@
+//*****************************************************************************
+// Libvidgfx: A graphics library for video compositing
+//
+// Copyright (C) 2014 Lucas Murray <lucas@polyflare.com>
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//*****************************************************************************
+
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include "graphicscontext.h"
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+class TextureLoaderTask;
+
+//=============================================================================
+/// <summary>
+/// Loads textures in the background. Decoding the image file, calling
+/// `diluteImage()` and converting the image into a format that can be directly
+/// uploaded to the GPU are all done on a private worker pool and only the
+/// final texture creation is done on the thread that owns the graphics
+/// context. The user must call `processUploads()` once per frame from that
+/// thread with a time budget so that large batches of images do not cause the
+/// frame to stall.
+///
+/// Every load request is identified by a positive integer that is returned
+/// when the request is queued. Once the texture has been created the loaded
+/// callbacks are called with the request's ID and the new texture, or NULL if
+/// the image failed to load. The callback that was added first owns the
+/// texture and must release it with `deleteTexture()` when done. It is called
+/// after every other callback which may only use the texture during the call.
+/// If no callbacks are connected the loader deletes the texture immediately.
+/// </summary>
+class TextureLoader
+{
+	friend class TextureLoaderTask;
+
+private: // Datatypes ---------------------------------------------------------
+	struct Request {
+		int					id;
+		QString				filename; // Empty if `img` was provided
+		QImage				img;
+		GraphicsContext *	context; // Used for dilution only
+		bool				dilute;
+	};
+
+	struct LoadedCallback {
+		VidgfxTexLoaderLoadedCallback *	callback;
+		void *							opaque;
+
+		inline bool operator==(const LoadedCallback &r) const {
+			return callback == r.callback && opaque == r.opaque;
+		};
+	};
+	typedef QVector<LoadedCallback> LoadedCallbackList;
+
+protected: // Members ---------------------------------------------------------
+	GraphicsContext *	m_context;
+	QThreadPool			m_pool;
+	mutable QMutex		m_mutex; // Protects everything below
+	int					m_nextId;
+	QVector<int>		m_pending; // Queued, decoding or ready for upload
+	QVector<Request>	m_ready;
+
+	LoadedCallbackList	m_loadedCallbackList;
+
+public: // Constructor/destructor ---------------------------------------------
+	TextureLoader(GraphicsContext *context = NULL, int maxThreads = 2);
+	virtual ~TextureLoader();
+
+public: // Methods ------------------------------------------------------------
+	void			setContext(GraphicsContext *context);
+
+	int				loadFile(const QString &filename, bool dilute = true);
+	int				loadImage(const QImage &img, bool dilute = true);
+	void			cancel(int id);
+	void			cancelAll();
+	bool			isPending(int id) const;
+	int				getNumPending() const;
+
+	int				processUploads(int budgetUsec = 2000);
+
+private:
+	int				queueRequest(Request &req);
+	void			decodeRequest(Request &req);
+
+public: // Signals ------------------------------------------------------------
+	void	callLoadedCallbacks(int id, Texture *tex);
+	void	addLoadedCallback(
+		VidgfxTexLoaderLoadedCallback *loaded, void *opaque);
+	void	removeLoadedCallback(
+		VidgfxTexLoaderLoadedCallback *loaded, void *opaque);
+};
+//=============================================================================
+
+/// <summary>
+/// Sets the context that textures are created in. Must not be changed while
+/// `processUploads()` is executing.
+/// </summary>
+inline void TextureLoader::setContext(GraphicsContext *context)
+{
+	m_context = context;
+}
+
+#endif // TEXTURELOADER_H